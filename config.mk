@@ -131,6 +131,17 @@ else
 $(error Cannot find json-c)
 endif
 
+# zlib is only needed for compressed exar archives, set EXAR_NO_ZLIB=1 to
+# build without it
+ifneq (${EXAR_NO_ZLIB}, 1)
+ZLIB=zlib
+ifeq ($(shell pkg-config --exists $(ZLIB) && echo 1), 1)
+LIBS+=$(ZLIB)
+else
+$(error Cannot find $(ZLIB), set EXAR_NO_ZLIB=1 to build without compression)
+endif
+endif
+
 LIBSECRET=libsecret-1
 ifeq ($(shell pkg-config --exists ${LIBSECRET} && echo 1), 1)
 LIBS+=libsecret-1
@@ -171,6 +182,10 @@ M4FLAGS += -DWITH_LIBSOUP_2_38=1 -G
 CFLAGS += -DWITH_LIBSOUP_2_38=1
 endif
 
+ifeq (${EXAR_NO_ZLIB}, 1)
+CFLAGS += -DEXAR_NO_ZLIB
+endif
+
 ifeq (${DISABLE_HSTS}, 1)
 CFLAGS += -DDISABLE_HSTS
 else 
@@ -83,6 +83,7 @@ enum {
     EXAR_FLAG_l = 1<<8,
     EXAR_FLAG_s = 1<<9,
     EXAR_FLAG_a = 1<<10,
+    EXAR_FLAG_m = 1<<11,
 };
 #define EXAR_OPTION_FLAG (0xffff & ~(0x7))
 #define EXAR_CHECK_FLAG(x, flag) !!(((x) & (EXAR_FLAG_##flag)) && !((x) & ( (EXAR_OPTION_FLAG)^(EXAR_FLAG_##flag) ) ))
@@ -239,6 +240,28 @@ set_data(const char *name, const char *data, const char *template, int flags)
     return ret;
 }
 
+/* 
+ * Reads main.js from an archive, is_archive is set to true if path is an
+ * archive
+ * */
+static char *
+get_archive_main(const char *path, gboolean *is_archive)
+{
+    struct exar_archive_s *archive;
+    const unsigned char *data;
+    off_t size;
+    char *ret = NULL;
+
+    *is_archive = false;
+    if ((archive = exar_open(path)) != NULL) 
+    {
+        *is_archive = true;
+        if (exar_search_lookup(archive, "main.js", &data, &size) == 0)
+            ret = g_strndup((const char *)data, size);
+        exar_close(archive);
+    }
+    return ret;
+}
 
 static char *
 get_data(const char *name, const char *data, const char *template, int flags) 
@@ -247,6 +270,7 @@ get_data(const char *name, const char *data, const char *template, int flags)
     char *content = NULL, *regex = NULL, *econtent = NULL;
     const char *new_data = NULL;
     const char *format;
+    gboolean is_archive;
     const char *nname = name == NULL ? "" : name;
 
     if (flags & F_MATCH_MULTILINE)
@@ -260,8 +284,8 @@ get_data(const char *name, const char *data, const char *template, int flags)
     }
     else 
     {
-        if (exar_check_version(data) == 0) {
-            econtent = (char*)exar_search_extract(data, "main.js", NULL);
+        econtent = get_archive_main(data, &is_archive);
+        if (is_archive) {
             new_data = econtent;
         }
         else {
@@ -277,7 +301,7 @@ get_data(const char *name, const char *data, const char *template, int flags)
         g_strfreev(matches);
     }
     g_free(content);
-    exar_free(econtent);
+    g_free(econtent);
     g_free(regex);
     return ret;
 }
@@ -718,6 +742,7 @@ install_extension(const char *name, int flags)
     char meta[128];
     char *content = NULL;
     const char *tmp = NULL;
+    gboolean is_archive;
 
     if (grep(m_meta_data, name, meta, sizeof(meta)) == -1) 
         die(1, "extension %s not found", name);
@@ -726,14 +751,14 @@ install_extension(const char *name, int flags)
     if (g_file_test(buffer, G_FILE_TEST_EXISTS)) 
     {
         notify("Using %s", buffer);
-        if (exar_check_version(buffer) == 0) {
-            content = (char*) exar_search_extract(buffer, "main.js", NULL);
+        content = get_archive_main(buffer, &is_archive);
+        if (is_archive) {
             if (add_to_loader(name, content, flags) == 0) 
             {
                 update_installed(name, meta);
                 ret = 0;
             }
-            exar_free(content);
+            g_free(content);
         }
         else if (g_file_get_contents(buffer, &content, NULL, NULL) ) 
         {
@@ -759,8 +784,8 @@ install_extension(const char *name, int flags)
             snprintf(buffer, sizeof(buffer), "%s/%s", m_user_dir, name);
             if (set_content(buffer, msg->response_body->data, msg->response_body->length))
             {
-                if (exar_check_version(buffer) == 0) {
-                    content = (char *)exar_search_extract(buffer, "main.js", NULL);
+                content = get_archive_main(buffer, &is_archive);
+                if (is_archive) {
                     tmp = content;
                 }
                 else {
@@ -771,7 +796,7 @@ install_extension(const char *name, int flags)
                     update_installed(name, meta);
                     ret = 0;
                 }
-                exar_free(content);
+                g_free(content);
             }
             else 
                 print_error("Saving %s failed", name);
@@ -1253,6 +1278,7 @@ exar_help(int ret)
            "                        to stdout, the archive is not modified, the file path \n"
            "                        is the relative file path of the file in the archive.\n"
            "    l[v] archive        List archive content\n"
+           "    m[v] archive        Migrate an exar-1 archive to the current format\n"
            "    p[v] path [outname] Pack file or directory 'path'. If <outname> is \n"
            "                        omitted the default output name is <path>.exar.\n"
            "    s[v] archive file   Search for a file and write the content to stdout, the \n" 
@@ -1315,6 +1341,9 @@ parse_exar_options(char **argv)
             case 'l' : 
                 flag |= EXAR_FLAG_l;
                 break;
+            case 'm' : 
+                flag |= EXAR_FLAG_m;
+                break;
             case 'p' : 
                 flag |= EXAR_FLAG_p;
                 break;
@@ -1345,6 +1374,8 @@ parse_exar_options(char **argv)
         exar_xextract(argv[1], argv[2], exar_extract);
     else if (EXAR_CHECK_FLAG(flag, l))
         exar_info(argv[1]);
+    else if (EXAR_CHECK_FLAG(flag, m))
+        exar_migrate(argv[1]);
     else if (EXAR_CHECK_FLAG(flag, p))
         exar_pack(argv[1], argv[2]);
     else if (EXAR_CHECK_FLAG(flag, s) && argc > 2)
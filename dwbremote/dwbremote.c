@@ -16,11 +16,16 @@
  * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
  */
 
+#define _POSIX_C_SOURCE 200809L
 #include "dwbremote.h"
 #include <stdarg.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include <unistd.h>
 #include <signal.h>
+#include <errno.h>
+#include <sys/stat.h>
 #include <X11/Xatom.h>
 #ifndef MAX 
 #define MAX(X, Y) ((X) > (Y) ? (X) : (Y))
@@ -153,3 +158,130 @@ dwbremote_wait(Display *dpy, Window win, Atom atom) {
         }
     }
 }
+
+/*
+ * Without XDG_RUNTIME_DIR the socket is placed in /tmp/dwb-<uid>, the directory
+ * must be a real directory owned by the user and not accessible by others,
+ * otherwise another user could have created it in advance
+ * */
+static int 
+check_socket_dir(const char *dir, int create)
+{
+    struct stat st;
+    if (create && mkdir(dir, 0700) == -1 && errno != EEXIST)
+        return 0;
+    if (lstat(dir, &st) == -1)
+        return 0;
+    if (!S_ISDIR(st.st_mode) || st.st_uid != getuid() || (st.st_mode & 0777) != 0700)
+    {
+        fprintf(stderr, "%s is not a private directory, the ipc socket is not used\n", dir);
+        return 0;
+    }
+    return 1;
+}
+/*
+ * Gets the path of the socket of a dwb instance, if create is set a missing
+ * private directory is created. Returns 0 if the path cannot be used.
+ * */
+int 
+dwbremote_get_socket_path(char *buffer, size_t length, Window win, int create)
+{
+    int n;
+    char dir[64];
+    const char *runtime_dir = getenv("XDG_RUNTIME_DIR");
+    if (runtime_dir != NULL && *runtime_dir != '\0')
+        n = snprintf(buffer, length, "%s/dwb-ipc-%lu", runtime_dir, win);
+    else 
+    {
+        snprintf(dir, sizeof(dir), "/tmp/dwb-%lu", (unsigned long)getuid());
+        if (!check_socket_dir(dir, create))
+            return 0;
+        n = snprintf(buffer, length, "%s/dwb-ipc-%lu", dir, win);
+    }
+    return n > 0 && (size_t)n < length;
+}
+
+/*
+ * Frames on the ipc socket are single lines, the fields are separated by tabs,
+ * backslashes, tabs and newlines inside a field are escaped. Requests are 
+ * <id> <command> [arguments], responses are <id> <status> [text] where id is
+ * the id of the request, events have the id DWB_IPC_EVENT_ID.
+ * */
+static char *
+escape_field(char *dest, const char *src)
+{
+    for (; *src; src++)
+    {
+        switch (*src)
+        {
+            case '\\': *dest++ = '\\'; *dest++ = '\\'; break;
+            case '\t':  *dest++ = '\\'; *dest++ = 't'; break;
+            case '\n':  *dest++ = '\\'; *dest++ = 'n'; break;
+            default:    *dest++ = *src; break;
+        }
+    }
+    return dest;
+}
+
+char * 
+dwbremote_format_frame(const char *id, char **list, int count)
+{
+    size_t length = 2*strlen(id) + 2;
+    char *frame, *p;
+
+    for (int i=0; i<count; i++)
+        length += 2*strlen(list[i]) + 1;
+
+    frame = malloc(length);
+    if (frame == NULL)
+        return NULL;
+
+    p = escape_field(frame, id);
+    for (int i=0; i<count; i++)
+    {
+        *p++ = '\t';
+        p = escape_field(p, list[i]);
+    }
+    *p++ = '\n';
+    *p = '\0';
+    return frame;
+}
+
+/* Splits a line without the trailing newline in place, list must be freed with
+ * free, the fields point into line */
+int 
+dwbremote_parse_frame(char *line, char ***list, int *count)
+{
+    int n = 1;
+    char *src, *dest;
+
+    for (char *p = line; *p; p++)
+    {
+        if (*p == '\t')
+            n++;
+    }
+    *list = malloc((n + 1) * sizeof(char *));
+    if (*list == NULL)
+        return False;
+
+    *count = 0;
+    (*list)[(*count)++] = line;
+    for (src = dest = line; *src; src++)
+    {
+        if (*src == '\t')
+        {
+            *dest++ = '\0';
+            (*list)[(*count)++] = dest;
+        }
+        else if (*src == '\\' && src[1] != '\0')
+        {
+            src++;
+            *dest++ = *src == 't' ? '\t' : *src == 'n' ? '\n' : *src;
+        }
+        else 
+            *dest++ = *src;
+    }
+    *dest = '\0';
+    (*list)[*count] = NULL;
+    return True;
+}
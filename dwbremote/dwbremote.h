@@ -31,6 +31,11 @@
 #define DWB_ATOM_IPC_SERVER_STATUS "__DWB_IPC_SERVER_STATUS"
 #define DWB_ATOM_IPC_FOCUS_ID "__DWB_IPC_FOCUS_ID"
 
+/* Environment variable that holds the socket path in scripts spawned by dwb */
+#define DWB_IPC_SOCKET_ENV "DWB_SOCKET"
+/* Id of frames that aren't responses to a request */
+#define DWB_IPC_EVENT_ID "*"
+
 
 int 
 dwbremote_get_property(Display *dpy, Window win, Atom atom, char ***list, int *count);
@@ -62,4 +67,13 @@ dwbremote_get_last_focus_id(Display *dpy, Window win, Atom a, Window *win_ret);
 void 
 dwbremote_wait(Display *dpy, Window win, Atom atom);
 
+int 
+dwbremote_get_socket_path(char *buffer, size_t length, Window win, int create);
+
+char * 
+dwbremote_format_frame(const char *id, char **list, int count);
+
+int 
+dwbremote_parse_frame(char *line, char ***list, int *count);
+
 #endif
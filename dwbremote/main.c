@@ -16,9 +16,17 @@
  * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
  */
 
+#define _POSIX_C_SOURCE 200809L
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
 #include <X11/Xlib.h>
 #include <X11/Xatom.h>
 #include <X11/Xutil.h>
@@ -30,10 +38,13 @@
 #define PARSE_ARG(argc, argv, sopt, lopt) (CHECK_ARG(*argv, sopt, lopt) && CHECK_REMAINING(argc, argv))
 
 static int s_opts;
+static unsigned long s_repeat = 1;
 
 enum {
     OPT_SHOW_WID = 1<<0, 
     OPT_SNOOP = 1<<1, 
+    OPT_SOCKET = 1<<2, 
+    OPT_BENCHMARK = 1<<3, 
 };
 
 static void 
@@ -43,6 +54,7 @@ help()
             "   dwbremote [options] <command> [arguments]\n\n"
             "OPTIONS: \n"
             "   -a --all                Send command to all windows\n"
+            "   -b --benchmark <n>      Send the command n times and print the throughput\n"
             "   -c --class <class>      Search for window id by WM_CLASS <class>\n"
             "   -i --id    <windowid>   Send commands to window with id <windowid>\n"
             "   -h --help               Show this help and exit\n"
@@ -50,6 +62,9 @@ help()
             "   -n --name  <class>      Search for window id by WM_NAME <name>\n"
             "   -p --pid   <pid>        Send commands to instance with process id <pid>\n"
             "   -s --show-id            Print the window id in every response\n"
+            "   -S --socket             Use the ipc socket instead of X properties, commands\n"
+            "                           are pipelined, if the command is - commands are read\n"
+            "                           from stdin, one per line with tab separated arguments\n"
             "   -v --version            Print version information and exit\n");
 }
 static void
@@ -182,6 +197,20 @@ parse_number(char *str)
     return ret;
 }
 
+static double
+get_time()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void
+print_benchmark(const char *transport, unsigned long n, double elapsed)
+{
+    fprintf(stderr, "%s: %lu commands in %.3fs, %.0f commands/s\n", transport, n, elapsed, n / elapsed);
+}
+
 static void 
 send_command(Display *dpy, Window win, long event_mask, char **argv, int argc)
 {
@@ -207,9 +236,12 @@ process_one(Display *dpy, Window win, Atom read_atom, char **argv, int argc)
         {
             if (count > 0)
             {
-                if (s_opts & OPT_SHOW_WID)
-                    printf("%lu ", win);
-                printf("%s\n", list[0]);
+                if (!(s_opts & OPT_BENCHMARK))
+                {
+                    if (s_opts & OPT_SHOW_WID)
+                        printf("%lu ", win);
+                    printf("%s\n", list[0]);
+                }
                 XFreeStringList(list);
             }
             XDeleteProperty(dpy, pe->window, read_atom);
@@ -281,6 +313,221 @@ process_multiple(Display *dpy, Atom read_atom, char **argv, int argc, Window *al
     }
 }
 
+/* SOCKET {{{*/
+typedef struct {
+    char *data;
+    size_t length;
+    size_t size;
+} Buffer;
+
+static void
+buffer_append(Buffer *b, const char *data, size_t length)
+{
+    if (b->length + length + 1 > b->size)
+    {
+        b->size = (b->length + length + 1) * 2;
+        b->data = realloc(b->data, b->size);
+        if (b->data == NULL)
+        {
+            fprintf(stderr, "Cannot realloc %zu bytes!", b->size);
+            exit(1);
+        }
+    }
+    memcpy(b->data + b->length, data, length);
+    b->length += length;
+    b->data[b->length] = '\0';
+}
+
+static int
+connect_socket(const char *path)
+{
+    struct sockaddr_un addr;
+    int fd;
+
+    if (strlen(path) >= sizeof(addr.sun_path))
+        return -1;
+    if ((fd = socket(AF_UNIX, SOCK_STREAM, 0)) == -1)
+        return -1;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, path);
+    if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) == -1)
+    {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+/* Appends a request frame for a line read from stdin, arguments are separated
+ * by tabs */
+static int
+append_line_frame(Buffer *requests, char *line, unsigned long id)
+{
+    char sid[32];
+    char **list = NULL;
+    int count = 0;
+    char *frame;
+
+    if (*line == '\0' || !dwbremote_parse_frame(line, &list, &count))
+    {
+        free(list);
+        return 0;
+    }
+    snprintf(sid, sizeof(sid), "%lu", id);
+    frame = dwbremote_format_frame(sid, list, count);
+    buffer_append(requests, frame, strlen(frame));
+    free(frame);
+    free(list);
+    return 1;
+}
+
+/* Handles a response or event frame, returns 1 if it was a response */
+static int
+handle_frame(char *line, Window win, int *status)
+{
+    char **list;
+    int count;
+    int response = 0;
+
+    if (!dwbremote_parse_frame(line, &list, &count))
+        return 0;
+    if (count > 1 && !STREQ(list[0], DWB_IPC_EVENT_ID))
+    {
+        response = 1;
+        if (atoi(list[1]) != 0)
+            (*status)++;
+        if (count > 2 && !(s_opts & OPT_BENCHMARK))
+        {
+            if (s_opts & OPT_SHOW_WID)
+                printf("%lu ", win);
+            printf("%s\n", list[2]);
+        }
+    }
+    else if (count > 1)
+    {
+        if (s_opts & OPT_SHOW_WID)
+            printf("%lu ", win);
+        for (int i=1; i<count; i++)
+            printf(i == 1 ? "%s" : " %s", list[i]);
+        putchar('\n');
+        fflush(stdout);
+    }
+    free(list);
+    return response;
+}
+
+/* Sends all requests without waiting for responses and reads responses as
+ * they arrive, returns the number of failed commands */
+static int
+process_socket(const char *path, Window win, Buffer *requests, unsigned long n_requests, int events)
+{
+    Buffer input = { NULL, 0, 0 };
+    char buffer[8192];
+    size_t written = 0;
+    unsigned long n_responses = 0;
+    int status = 0;
+    double start = get_time();
+    struct pollfd pfd;
+
+    if ((pfd.fd = connect_socket(path)) == -1)
+    {
+        fprintf(stderr, "Cannot connect to %s: %s\n", path, strerror(errno));
+        return 1;
+    }
+    while (events || n_responses < n_requests)
+    {
+        pfd.events = POLLIN | (written < requests->length ? POLLOUT : 0);
+        if (poll(&pfd, 1, -1) == -1)
+        {
+            if (errno == EINTR)
+                continue;
+            break;
+        }
+        if (pfd.revents & POLLOUT)
+        {
+            ssize_t w = write(pfd.fd, requests->data + written, requests->length - written);
+            if (w == -1 && errno != EINTR && errno != EAGAIN)
+                break;
+            if (w > 0)
+                written += w;
+        }
+        if (pfd.revents & (POLLIN | POLLHUP | POLLERR))
+        {
+            ssize_t r = read(pfd.fd, buffer, sizeof(buffer));
+            if (r <= 0)
+            {
+                if (r == -1 && errno == EINTR)
+                    continue;
+                break;
+            }
+            buffer_append(&input, buffer, r);
+
+            char *line = input.data, *end;
+            while ((end = memchr(line, '\n', input.length - (line - input.data))) != NULL)
+            {
+                *end = '\0';
+                n_responses += handle_frame(line, win, &status);
+                line = end + 1;
+            }
+            input.length -= line - input.data;
+            memmove(input.data, line, input.length);
+        }
+    }
+    if (s_opts & OPT_BENCHMARK)
+        print_benchmark("socket", n_responses, get_time() - start);
+    if (n_responses < n_requests)
+        status += n_requests - n_responses;
+
+    close(pfd.fd);
+    free(input.data);
+    return status;
+}
+
+/* Builds the requests for the command line or stdin, events is set if one
+ * of the commands subscribes to events */
+static unsigned long
+get_socket_requests(Buffer *requests, char **argv, int argc, int *events)
+{
+    unsigned long n = 0;
+    char *frame, id[32];
+
+    if (argc == 1 && STREQ(argv[0], "-"))
+    {
+        Buffer input = { NULL, 0, 0 };
+        char buffer[8192], *line, *end;
+        size_t r;
+
+        while ((r = fread(buffer, 1, sizeof(buffer), stdin)) > 0)
+            buffer_append(&input, buffer, r);
+        buffer_append(&input, "\n", 1);
+
+        for (line = input.data; (end = strchr(line, '\n')) != NULL; line = end + 1)
+        {
+            *end = '\0';
+            size_t length = strcspn(line, "\t");
+            if (length == 4 && (!strncmp(line, "hook", 4) || !strncmp(line, "bind", 4)))
+                *events = 1;
+            for (unsigned long i=0; i<s_repeat; i++)
+            {
+                char *copy = strdup(line);
+                n += append_line_frame(requests, copy, n + 1);
+                free(copy);
+            }
+        }
+        free(input.data);
+        return n;
+    }
+    for (; n<s_repeat; n++)
+    {
+        snprintf(id, sizeof(id), "%lu", n + 1);
+        frame = dwbremote_format_frame(id, argv, argc);
+        buffer_append(requests, frame, strlen(frame));
+        free(frame);
+    }
+    return n;
+}
+/*}}}*/
 
 int 
 main(int argc, char **argv)
@@ -293,6 +540,9 @@ main(int argc, char **argv)
     int n_wins = 0;
     int get_multiple = 0;
     Window *all_wins = NULL;
+    Buffer requests = { NULL, 0, 0 };
+    unsigned long n_requests = 0;
+    char *socket_path;
 
     int pargc = argc - 1;
     char **pargv = argv + 1;
@@ -334,6 +584,15 @@ main(int argc, char **argv)
             get_wins(dpy, root, &all_wins, &n_wins, NULL, NULL, False);
         else if (CHECK_ARG(*pargv, "-s", "--show-id"))
             s_opts |= OPT_SHOW_WID;
+        else if (CHECK_ARG(*pargv, "-S", "--socket"))
+            s_opts |= OPT_SOCKET;
+        else if (consume_arg("-b", "--benchmark", &pargc, &pargv))
+        {
+            s_repeat = parse_number(*pargv);
+            if (s_repeat == 0)
+                goto finish;
+            s_opts |= OPT_BENCHMARK;
+        }
         else if (consume_arg("-i", "--id", &pargc, &pargv))
         {
             unsigned long wid = parse_number(*pargv);
@@ -356,11 +615,23 @@ main(int argc, char **argv)
             goto finish;
         }
     }
-    if (pargc < 2 && (pargc < 1 || *pargv[0] != ':'))
+    if (pargc < 2 && (pargc < 1 || (*pargv[0] != ':' && !((s_opts & OPT_SOCKET) && STREQ(*pargv, "-")))))
     {
         help();
         goto finish;
     }
+    get_multiple = STREQ(*pargv, "hook") || STREQ(*pargv, "bind");
+    if (s_opts & OPT_SOCKET)
+    {
+        n_requests = get_socket_requests(&requests, pargv, pargc, &get_multiple);
+        /* Scripts spawned by dwb talk to their own instance */
+        socket_path = getenv(DWB_IPC_SOCKET_ENV);
+        if (all_wins == NULL && socket_path != NULL && *socket_path != '\0')
+        {
+            ret = process_socket(socket_path, 0, &requests, n_requests, get_multiple);
+            goto finish;
+        }
+    }
     if (all_wins == NULL)
     {
         char *window_id = getenv("DWB_WINID");
@@ -381,6 +652,17 @@ main(int argc, char **argv)
         append_win(win, &all_wins, &n_wins);
     }
 
+    if (s_opts & OPT_SOCKET)
+    {
+        char path[512];
+        for (int i=0; i<n_wins; i++)
+        {
+            if (dwbremote_get_socket_path(path, sizeof(path), all_wins[i], 0))
+                ret += process_socket(path, all_wins[i], &requests, n_requests, get_multiple);
+        }
+        goto finish;
+    }
+
     if (STREQ(*pargv, "hook"))
     {
         get_multiple = 1;
@@ -402,12 +684,19 @@ main(int argc, char **argv)
     }
     else 
     {
+        double start = get_time();
         for (int i=0; i<n_wins; i++)
-            ret += process_one(dpy, all_wins[i], read_atom, pargv, pargc);
+        {
+            for (unsigned long j=0; j<s_repeat; j++)
+                ret += process_one(dpy, all_wins[i], read_atom, pargv, pargc);
+        }
+        if (s_opts & OPT_BENCHMARK)
+            print_benchmark("x11", s_repeat * n_wins, get_time() - start);
     }
 finish: 
     if (all_wins != NULL)
         free(all_wins);
+    free(requests.data);
     XCloseDisplay(dpy);
     return ret;
 }
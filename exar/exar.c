@@ -30,16 +30,21 @@
 #include <string.h>
 #include <stdio.h>
 #include <sys/stat.h>
+#include <sys/mman.h>
 #include <stdarg.h>
 #include <unistd.h>
 #include <ftw.h>
 #include <errno.h>
 #include <assert.h>
 #include <inttypes.h>
+#ifndef EXAR_NO_ZLIB
+#include <zlib.h>
+#endif
 #include "exar.h"
 
 #define EXAR_VERSION_BASE "exar-"
-#define EXAR_VERSION EXAR_VERSION_BASE "1"
+#define EXAR_VERSION_1 EXAR_VERSION_BASE "1"
+#define EXAR_VERSION EXAR_VERSION_BASE "2"
 #define EXTENSION "exar"
 
 #define SZ_VERSION 7
@@ -50,10 +55,26 @@
 #define HDR_SIZE (HDR_DFLAG + SZ_DFLAG)
 #define HDR_NAME (HDR_SIZE + SZ_SIZE)
 
+#define SZ_INDEX_HEADER (SZ_VERSION + HDR_NAME + 1)
+#define SZ_INDEX_ENTRY (SZ_DFLAG + 2*SZ_SIZE)
+#define SZ_TRAILER (SZ_SIZE + SZ_VERSION)
+
 #define DIR_FLAG    (100)
 #define FILE_FLAG  (102)
+#define INDEX_FLAG (105)
+#define ZFILE_FLAG (122)
+
+#define IS_FILE(flag) ((flag) == FILE_FLAG || (flag) == ZFILE_FLAG)
+
+/* Files are only compressed if they are at least COMPRESS_MIN_SIZE bytes and
+ * compression saves more than 10 percent */
+#define COMPRESS_MIN_SIZE 512
+#define COMPRESS_MAX_RATIO 0.9
+/* Larger files are only compressed if the beginning of the file compresses well */
+#define COMPRESS_SAMPLE_SIZE (1<<16)
 
 #define MAX_FILE_HANDLES 64
+#define SZ_COPY_BUFFER (1<<17)
 
 #define MIN(X, Y)  ((X) > (Y) ? (Y) : (X))
 
@@ -70,6 +91,26 @@ struct exar_header_s {
 };
 #define EXAR_HEADER_EMPTY  { 0, 0, { 0 } }  
 
+struct exar_entry_s {
+    unsigned char ee_flag;
+    off_t ee_offset;
+    off_t ee_size;
+    char *ee_name;
+    unsigned char *ee_content;
+};
+struct exar_index_s {
+    struct exar_entry_s *ei_entries;
+    size_t ei_length;
+    size_t ei_size;
+};
+#define EXAR_INDEX_EMPTY { NULL, 0, 0 }
+
+struct exar_archive_s {
+    unsigned char *ea_data;
+    size_t ea_length;
+    struct exar_index_s ea_index;
+};
+
 #define LOG(level, ...) do { if (s_verbose & EXAR_VERBOSE_L##level) { \
     fprintf(stderr, "exar-log%d: ", level); \
     fprintf(stderr, __VA_ARGS__); } } while(0)
@@ -78,6 +119,13 @@ static size_t s_offset;
 static FILE *s_out;
 static unsigned char s_verbose = 0;
 static const char *s_out_path;
+static const char *s_out_version;
+static struct exar_index_s *s_index;
+#ifndef EXAR_NO_ZLIB
+static int s_compression = Z_DEFAULT_COMPRESSION;
+#else 
+static int s_compression = 0;
+#endif
 
 static void *
 xcalloc(size_t nmemb, size_t size)
@@ -114,13 +162,23 @@ get_offset(char *buffer, size_t n, const char *path, int *end)
         *end = i;
     return offset;
 }
+/*
+ * Returns the format version of a version header, 0 if the version is unknown
+ * */
+static int 
+version_number(const unsigned char *version)
+{
+    if (memcmp(version, EXAR_VERSION, SZ_VERSION) == 0)
+        return 2;
+    else if (memcmp(version, EXAR_VERSION_1, SZ_VERSION) == 0)
+        return 1;
+    return 0;
+}
 static int 
 version_cmp(const unsigned char *data, int verbose) {
-    unsigned char orig_version[SZ_VERSION] = {0};
     unsigned char version[SZ_VERSION] = {0};
 
     memcpy(version, data, sizeof(version));
-    memcpy(orig_version, EXAR_VERSION, sizeof(orig_version));
 
     LOG(2, "Checking filetype\n");
     if (strncmp((char*)version, EXAR_VERSION_BASE, 5))
@@ -131,7 +189,7 @@ version_cmp(const unsigned char *data, int verbose) {
     }
 
     LOG(2, "Found version %s\n", data);
-    if (memcmp(version, orig_version, SZ_VERSION))
+    if (version_number(version) == 0)
     {
         if (verbose)
             fprintf(stderr, "Incompatible version number\n");
@@ -157,6 +215,22 @@ check_version(FILE *f, int verbose)
     }
     return version_cmp(version, verbose);
 }
+/*
+ * Returns the format version of an archive, the file position is reset to the
+ * start of the archive
+ * */
+static int 
+get_version(FILE *f)
+{
+    unsigned char version[SZ_VERSION] = {0};
+    int ret = EE_ERROR;
+
+    rewind(f);
+    if (fread(version, 1, SZ_VERSION, f) == SZ_VERSION && version_cmp(version, 1) == EE_OK)
+        ret = version_number(version);
+    rewind(f);
+    return ret;
+}
 /*
  * Opens archive and checks version, mode is either read or read-write
  * */ 
@@ -186,15 +260,15 @@ static int
 check_header(struct exar_header_s *head, const char *size) {
     char *endptr;
     off_t fs;
-    if (head->eh_flag != DIR_FLAG && head->eh_flag != FILE_FLAG)
+    if (head->eh_flag != DIR_FLAG && !IS_FILE(head->eh_flag) && head->eh_flag != INDEX_FLAG)
     {
         LOG(1, "No file flag found\n");
         fprintf(stderr, "The archive seems to be corrupted\n");
         return EE_ERROR;
     }
-    if (head->eh_flag == FILE_FLAG)
+    if (head->eh_flag != DIR_FLAG)
     {
-        fs = strtol(size, &endptr, 16);
+        fs = strtoll(size, &endptr, 16);
         if (*endptr)
         {
             LOG(1, "Cannot determine file size\n");
@@ -231,6 +305,11 @@ get_file_header(FILE *f, struct exar_header_s *head)
     if (check_header(head, &header[HDR_SIZE]) == EE_ERROR) {
         return EE_ERROR;
     }
+    if (head->eh_flag == INDEX_FLAG)
+    {
+        LOG(2, "Found index, end of archive\n");
+        return EE_EOF;
+    }
 
     while (fread(&rb, 1, 1, f) > 0)
     {
@@ -271,6 +350,11 @@ get_file_header_from_data(const unsigned char *data, int *offset, struct exar_he
     if (check_header(head, size) == EE_ERROR) {
         return EE_ERROR;
     }
+    if (head->eh_flag == INDEX_FLAG)
+    {
+        LOG(2, "Found index, end of archive\n");
+        return EE_EOF;
+    }
     *offset = SZ_VERSION + SZ_DFLAG + SZ_SIZE;
     while (*tmp && *tmp != '\0')
     {
@@ -287,6 +371,7 @@ get_file_header_from_data(const unsigned char *data, int *offset, struct exar_he
         LOG(1, "The archive seems to be corrupted\n");
         return EE_ERROR;
     }
+    head->eh_name[i] = '\0';
     *offset += i+1;
 
     LOG(2, "Found file header (%s, %c, %jd)\n", head->eh_name, head->eh_flag, (intmax_t)head->eh_size);
@@ -297,7 +382,7 @@ next_file(FILE *f, struct exar_header_s *header)
 {
     if (*(header->eh_name))
     {
-        if (header->eh_flag == FILE_FLAG)
+        if (IS_FILE(header->eh_flag))
         {
             if (fseek(f, header->eh_size, SEEK_CUR) != 0)
                 return EE_ERROR;
@@ -318,15 +403,286 @@ find_cmp(const char *name, const char *search)
     }
     return 0;
 }
+static void 
+index_add(struct exar_index_s *index, unsigned char flag, off_t offset, off_t size, const char *name)
+{
+    struct exar_entry_s *entry;
+    if (index->ei_length == index->ei_size)
+    {
+        index->ei_size = index->ei_size == 0 ? 32 : 2 * index->ei_size;
+        index->ei_entries = realloc(index->ei_entries, index->ei_size * sizeof(struct exar_entry_s));
+        if (index->ei_entries == NULL)
+        {
+            fprintf(stderr, "Cannot realloc %zu bytes\n", index->ei_size * sizeof(struct exar_entry_s));
+            exit(EXIT_FAILURE);
+        }
+    }
+    entry = &index->ei_entries[index->ei_length++];
+    entry->ee_flag = flag;
+    entry->ee_offset = offset;
+    entry->ee_size = size;
+    entry->ee_name = strdup(name);
+    entry->ee_content = NULL;
+}
+static void 
+index_clear(struct exar_index_s *index)
+{
+    for (size_t i=0; i<index->ei_length; i++)
+    {
+        free(index->ei_entries[i].ee_name);
+        free(index->ei_entries[i].ee_content);
+    }
+    exar_free(index->ei_entries);
+    index->ei_length = index->ei_size = 0;
+}
+static struct exar_entry_s * 
+index_find(struct exar_index_s *index, const char *name, int (*cmp)(const char *, const char *))
+{
+    for (size_t i=0; i<index->ei_length; i++)
+    {
+        if (cmp(index->ei_entries[i].ee_name, name) == 0)
+            return &index->ei_entries[i];
+    }
+    return NULL;
+}
+/*
+ * Gets the offset of the index header from the trailer of an exar-2 archive
+ *
+ * @trailer The trailer
+ * @fsize   Size of the archive without trailer
+ *
+ * returns the offset, EE_EOF if there is no trailer or EE_ERROR if the trailer
+ * is corrupted
+ * */
+static off_t 
+parse_trailer(const char *trailer, off_t fsize)
+{
+    char buffer[SZ_SIZE] = {0};
+    char *endptr;
+    off_t offset;
+
+    if (memcmp(&trailer[SZ_SIZE], EXAR_VERSION, SZ_VERSION))
+    {
+        LOG(3, "No index found\n");
+        return EE_EOF;
+    }
+    memcpy(buffer, trailer, SZ_SIZE - 1);
+    offset = strtoll(buffer, &endptr, 16);
+    if (*endptr || offset < 0 || offset + SZ_INDEX_HEADER > fsize)
+        return EE_ERROR;
+    return offset;
+}
+static off_t 
+parse_size(const char *data)
+{
+    char *endptr;
+    off_t size = strtoll(data, &endptr, 16);
+    if (endptr != data + SZ_SIZE - 1 || *endptr)
+        return EE_ERROR;
+    return size;
+}
+/*
+ * Parses the index, data points to the index header, length is the size of
+ * index header and index
+ * */
+static int 
+parse_index(const char *data, size_t length, struct exar_index_s *index)
+{
+    struct exar_header_s header = EXAR_HEADER_EMPTY;
+    const char *tmp, *end = data + length;
+    off_t e_offset, e_size;
+    size_t l_name;
+
+    if (version_cmp((const unsigned char*)data, 0) != EE_OK)
+        goto corrupted;
+    header.eh_flag = data[SZ_VERSION + HDR_DFLAG];
+    if (header.eh_flag != INDEX_FLAG || check_header(&header, &data[SZ_VERSION + HDR_SIZE]) != EE_OK 
+            || (size_t)header.eh_size != length - SZ_INDEX_HEADER)
+        goto corrupted;
+
+    for (tmp = data + SZ_INDEX_HEADER; tmp < end; tmp += SZ_INDEX_ENTRY + l_name + 1)
+    {
+        if (end - tmp <= SZ_INDEX_ENTRY)
+            goto corrupted;
+        if ((e_offset = parse_size(tmp + SZ_DFLAG)) < 0 || (e_size = parse_size(tmp + SZ_DFLAG + SZ_SIZE)) < 0)
+            goto corrupted;
+        for (l_name = 0; tmp + SZ_INDEX_ENTRY + l_name < end && tmp[SZ_INDEX_ENTRY + l_name]; l_name++)
+            ;
+        if (tmp + SZ_INDEX_ENTRY + l_name >= end)
+            goto corrupted;
+        index_add(index, *tmp, e_offset, e_size, tmp + SZ_INDEX_ENTRY);
+    }
+    LOG(2, "Found %zu index entries\n", index->ei_length);
+    return EE_OK;
+
+corrupted:
+    fprintf(stderr, "The archive index seems to be corrupted\n");
+    index_clear(index);
+    return EE_ERROR;
+}
+/*
+ * Reads the index of an exar-2 archive, the trailer points to the index header,
+ * header and index are read at once.
+ *
+ * @start Return location for the offset of the index header
+ *
+ * returns EE_OK if the archive has a valid index
+ * */
+static int 
+read_index(FILE *f, struct exar_index_s *index, off_t *start)
+{
+    char trailer[SZ_TRAILER];
+    char *data = NULL;
+    off_t offset, fsize;
+    size_t length;
+    int ret = EE_ERROR;
+
+    if (fseek(f, -SZ_TRAILER, SEEK_END) != 0 || (fsize = ftell(f)) == -1)
+        return EE_ERROR;
+    if (fread(trailer, 1, SZ_TRAILER, f) != SZ_TRAILER)
+        return EE_ERROR;
+    if ((offset = parse_trailer(trailer, fsize)) < 0)
+    {
+        if (offset == EE_ERROR)
+            fprintf(stderr, "The archive index seems to be corrupted\n");
+        return EE_ERROR;
+    }
+
+    LOG(2, "Reading index at offset %jd\n", (intmax_t)offset);
+    length = fsize - offset;
+    data = xcalloc(length, sizeof(char));
+    if (fseek(f, offset, SEEK_SET) != 0 || fread(data, 1, length, f) != length)
+        fprintf(stderr, "Failed to read the archive index\n");
+    else if ((ret = parse_index(data, length, index)) == EE_OK && start != NULL)
+        *start = offset;
+
+    free(data);
+    return ret;
+}
+/*
+ * Writes a size as 13 hex digits and a terminating null byte, SZ_SIZE bytes
+ * are written to dest
+ * */
+static void 
+format_size(char *dest, uintmax_t size)
+{
+    char buffer[32];
+    snprintf(buffer, sizeof(buffer), "%.13jx", size);
+    memcpy(dest, buffer, SZ_SIZE);
+}
+/*
+ * Gets the uncompressed size of a compressed file, data points to the stored
+ * content
+ * */
+static off_t 
+get_original_size(const unsigned char *data, off_t size)
+{
+    char buffer[SZ_SIZE] = {0};
+    if (size < SZ_SIZE)
+        return EE_ERROR;
+    memcpy(buffer, data, SZ_SIZE - 1);
+    return parse_size(buffer);
+}
+/*
+ * Decompresses the stored content of a compressed file into a newly allocated
+ * buffer
+ * */
+static unsigned char * 
+decompress(const unsigned char *data, off_t size, const char *name, off_t *s)
+{
+#ifndef EXAR_NO_ZLIB
+    unsigned char *ret = NULL;
+    off_t original = get_original_size(data, size);
+    uLongf length = original;
+
+    if (original < 0)
+    {
+        fprintf(stderr, "The archive seems to be corrupted\n");
+        return NULL;
+    }
+    LOG(3, "Decompressing %s (%jd bytes)\n", name, (intmax_t)original);
+    ret = xcalloc(original + 1, sizeof(unsigned char));
+    if (uncompress(ret, &length, data + SZ_SIZE, size - SZ_SIZE) != Z_OK || length != (uLongf)original)
+    {
+        fprintf(stderr, "Failed to decompress %s\n", name);
+        exar_free(ret);
+    }
+    else if (s != NULL)
+        *s = original;
+    return ret;
+#else 
+    (void)data; (void)size; (void)s;
+    fprintf(stderr, "Cannot decompress %s, exar was built without zlib\n", name);
+    return NULL;
+#endif
+}
+/*
+ * Reads the content of a file, the file position must point to the start of
+ * the content, compressed files are decompressed
+ * */
+static unsigned char * 
+read_content(FILE *f, const char *name, unsigned char flag, off_t size, off_t *s)
+{
+    unsigned char *ret = xcalloc(size + 1, sizeof(unsigned char)), *data;
+    LOG(3, "Reading %s\n", name);
+    if (fread(ret, 1, size, f) != (size_t)size)
+    {
+        fprintf(stderr, "Failed to read %s\n", name);
+        exar_free(ret);
+    }
+    else if (flag == ZFILE_FLAG)
+    {
+        data = ret;
+        ret = decompress(data, size, name, s);
+        free(data);
+    }
+    else if (s != NULL)
+        *s = size;
+    return ret;
+}
+/*
+ * Copies size bytes from the current position of in to out
+ * */
+static int 
+copy_data(FILE *in, FILE *out, off_t size)
+{
+    unsigned char *buffer;
+    size_t r;
+    int ret = EE_OK;
+
+    if (size == 0)
+        return EE_OK;
+    buffer = xcalloc(MIN(size, SZ_COPY_BUFFER), sizeof(unsigned char));
+    while (size > 0)
+    {
+        r = fread(buffer, 1, MIN(size, SZ_COPY_BUFFER), in);
+        if (r == 0 || fwrite(buffer, 1, r, out) != r)
+        {
+            ret = EE_ERROR;
+            break;
+        }
+        size -= r;
+    }
+    free(buffer);
+    return ret;
+}
 static int 
 contains(const char *archive, const char *name, int (*cmp)(const char *, const char *))
 {
     FILE *f = NULL;
     struct exar_header_s header = EXAR_HEADER_EMPTY;
+    struct exar_index_s index = EXAR_INDEX_EMPTY;
     int result = EE_ERROR;
 
     if ((f = open_archive(archive, "r")) == NULL)
         goto finish;
+    if (read_index(f, &index, NULL) == EE_OK)
+    {
+        if (index_find(&index, name, cmp) != NULL)
+            result = EE_OK;
+        goto finish;
+    }
+    rewind(f);
     while (next_file(f, &header) == EE_OK)
     {
         if (cmp(header.eh_name, name) == 0)
@@ -337,6 +693,7 @@ contains(const char *archive, const char *name, int (*cmp)(const char *, const c
     }
 
 finish:
+    index_clear(&index);
     close_file(f, archive);
     return result;
 }
@@ -344,6 +701,8 @@ static unsigned char *
 extract(const char *archive, const char *file, off_t *s, int (*cmp)(const char *, const char *))
 {
     struct exar_header_s header = EXAR_HEADER_EMPTY;
+    struct exar_index_s index = EXAR_INDEX_EMPTY;
+    struct exar_entry_s *entry;
     FILE *f = NULL;
     unsigned char *ret = NULL;
     if (s != NULL)
@@ -351,28 +710,31 @@ extract(const char *archive, const char *file, off_t *s, int (*cmp)(const char *
 
     if ((f = open_archive(archive, "r")) == NULL)
         goto finish;
+    if (read_index(f, &index, NULL) == EE_OK)
+    {
+        if ((entry = index_find(&index, file, cmp)) == NULL)
+            fprintf(stderr, "File %s was not found in %s\n", file, archive);
+        else if (!IS_FILE(entry->ee_flag))
+            fprintf(stderr, "%s is a directory, only regular files can be extracted\n", file);
+        else if (fseek(f, entry->ee_offset, SEEK_SET) != 0)
+            fprintf(stderr, "Failed to read %s\n", entry->ee_name);
+        else 
+            ret = read_content(f, entry->ee_name, entry->ee_flag, entry->ee_size, s);
+        goto finish;
+    }
+    rewind(f);
     while (get_file_header(f, &header) == EE_OK)
     {
         if (cmp(header.eh_name, file) == 0)
         {
-            if (header.eh_flag == FILE_FLAG)
-            {
-                ret = xcalloc(header.eh_size, sizeof(unsigned char));
-                LOG(3, "Reading %s\n", header.eh_name);
-                if (fread(ret, 1, header.eh_size, f) != (size_t)header.eh_size)
-                {
-                    fprintf(stderr, "Failed to read %s\n", header.eh_name);
-                    exar_free(ret);
-                }
-                else if (s != NULL)
-                    *s = header.eh_size;
-            }
+            if (IS_FILE(header.eh_flag))
+                ret = read_content(f, header.eh_name, header.eh_flag, header.eh_size, s);
             else {
                 fprintf(stderr, "%s is a directory, only regular files can be extracted\n", file);
             }
             goto finish;
         }
-        else if (header.eh_flag == FILE_FLAG)
+        else if (IS_FILE(header.eh_flag))
         {
             LOG(3, "Skipping %s\n", header.eh_name);
             fseek(f, header.eh_size, SEEK_CUR);
@@ -380,6 +742,7 @@ extract(const char *archive, const char *file, off_t *s, int (*cmp)(const char *
     }
     fprintf(stderr, "File %s was not found in %s\n", file, archive);
 finish:
+    index_clear(&index);
     close_file(f, archive);
     return ret;
 }
@@ -396,8 +759,11 @@ extract_from_data(const unsigned char *data, const char *file, off_t *s, int (*c
     while((get_file_header_from_data(data, &offset, &header) == EE_OK)) {
         data += offset;
         if (cmp(header.eh_name, file) == 0) {
-            if (header.eh_flag == FILE_FLAG) {
-                ret = xcalloc(header.eh_size, sizeof(unsigned char));
+            if (header.eh_flag == ZFILE_FLAG) {
+                return decompress(data, header.eh_size, header.eh_name, s);
+            }
+            else if (header.eh_flag == FILE_FLAG) {
+                ret = xcalloc(header.eh_size + 1, sizeof(unsigned char));
                 memcpy(ret, data, header.eh_size);
                 if (s != NULL) {
                     *s = header.eh_size;
@@ -416,7 +782,7 @@ extract_from_data(const unsigned char *data, const char *file, off_t *s, int (*c
 }
 
 static int 
-write_file_header(FILE *f, const char *name, char flag, off_t r)
+write_file_header(FILE *f, const char *v, const char *name, char flag, off_t r)
 {
     unsigned char version[SZ_VERSION] = {0};
     char buffer[HDR_NAME] = {0};
@@ -430,9 +796,9 @@ write_file_header(FILE *f, const char *name, char flag, off_t r)
         return EE_ERROR;
     }
 
-    LOG(2, "Writing version header (%s)\n", EXAR_VERSION);
+    LOG(2, "Writing version header (%s)\n", v);
 
-    memcpy(version, EXAR_VERSION, sizeof(version));
+    memcpy(version, v, sizeof(version));
     if (fwrite(version, 1, sizeof(version), f) != sizeof(version))
     {
         fprintf(stderr, "Failed to write %zu bytes", sizeof(version));
@@ -443,7 +809,7 @@ write_file_header(FILE *f, const char *name, char flag, off_t r)
 
     memset(buffer, 0, sizeof(buffer));
     buffer[HDR_DFLAG] = flag;
-    snprintf(buffer + HDR_SIZE, SZ_SIZE, "%.13x", flag == FILE_FLAG ? (unsigned int)r : 0);
+    format_size(buffer + HDR_SIZE, flag == DIR_FLAG ? (uintmax_t)0 : (uintmax_t)r);
     if (fwrite(buffer, 1, HDR_NAME, f) != HDR_NAME)
         return EE_ERROR;
     if (fwrite(name, 1, l_name, f) != l_name)
@@ -453,6 +819,44 @@ write_file_header(FILE *f, const char *name, char flag, off_t r)
 
     return EE_OK;
 }
+/*
+ * Writes the index and the trailer, the index is written at the current file
+ * position
+ * */
+static int 
+write_index(FILE *f, struct exar_index_s *index)
+{
+    char buffer[SZ_INDEX_ENTRY];
+    char trailer[SZ_TRAILER] = {0};
+    struct exar_entry_s *entry;
+    off_t start, length = 0;
+    size_t l_name;
+
+    if ((start = ftell(f)) == -1)
+        return EE_ERROR;
+    for (size_t i=0; i<index->ei_length; i++)
+        length += SZ_INDEX_ENTRY + strlen(index->ei_entries[i].ee_name) + 1;
+
+    LOG(2, "Writing index (%zu entries)\n", index->ei_length);
+    if (write_file_header(f, EXAR_VERSION, "", INDEX_FLAG, length) != EE_OK)
+        return EE_ERROR;
+    for (size_t i=0; i<index->ei_length; i++)
+    {
+        entry = &index->ei_entries[i];
+        memset(buffer, 0, sizeof(buffer));
+        buffer[0] = entry->ee_flag;
+        format_size(buffer + SZ_DFLAG, (uintmax_t)entry->ee_offset);
+        format_size(buffer + SZ_DFLAG + SZ_SIZE, (uintmax_t)entry->ee_size);
+        l_name = strlen(entry->ee_name) + 1;
+        if (fwrite(buffer, 1, SZ_INDEX_ENTRY, f) != SZ_INDEX_ENTRY || fwrite(entry->ee_name, 1, l_name, f) != l_name)
+            return EE_ERROR;
+    }
+    format_size(trailer, (uintmax_t)start);
+    memcpy(&trailer[SZ_SIZE], EXAR_VERSION, SZ_VERSION);
+    if (fwrite(trailer, 1, SZ_TRAILER, f) != SZ_TRAILER)
+        return EE_ERROR;
+    return EE_OK;
+}
 
 const char *
 strip_current(const char *path) {
@@ -465,16 +869,75 @@ strip_current(const char *path) {
     return cstrip;
 }
 
+/*
+ * Compresses a file, returns NULL if compression doesn't save enough space, the
+ * file position is reset in that case
+ *
+ * @csize Return location for the size of the stored content
+ * */
+static unsigned char * 
+compress_file(FILE *f, const char *path, off_t size, off_t *csize)
+{
+#ifndef EXAR_NO_ZLIB
+    unsigned char *data = xcalloc(size, sizeof(unsigned char));
+    unsigned char *ret = NULL;
+    uLongf length = compressBound(size);
+    off_t sample = MIN(size, COMPRESS_SAMPLE_SIZE);
+
+    if (fread(data, 1, sample, f) != (size_t)sample)
+    {
+        fprintf(stderr, "Failed to read %s\n", path);
+        goto finish;
+    }
+    ret = xcalloc(SZ_SIZE + length, sizeof(unsigned char));
+    if (sample < size)
+    {
+        if (compress2(ret, &length, data, sample, Z_BEST_SPEED) != Z_OK || length > sample * COMPRESS_MAX_RATIO)
+        {
+            LOG(2, "Not compressing %s\n", path);
+            exar_free(ret);
+            goto finish;
+        }
+        if (fread(data + sample, 1, size - sample, f) != (size_t)(size - sample))
+        {
+            fprintf(stderr, "Failed to read %s\n", path);
+            exar_free(ret);
+            goto finish;
+        }
+        length = compressBound(size);
+    }
+    format_size((char*)ret, (uintmax_t)size);
+    if (compress2(ret + SZ_SIZE, &length, data, size, s_compression) != Z_OK 
+            || SZ_SIZE + length > size * COMPRESS_MAX_RATIO)
+    {
+        LOG(2, "Not compressing %s\n", path);
+        exar_free(ret);
+    }
+    else 
+    {
+        *csize = SZ_SIZE + length;
+        LOG(2, "Compressed %s (%jd -> %jd bytes)\n", path, (intmax_t)size, (intmax_t)*csize);
+    }
+finish:
+    if (ret == NULL)
+        rewind(f);
+    free(data);
+    return ret;
+#else 
+    (void)f; (void)path; (void)size; (void)csize;
+    return NULL;
+#endif
+}
 static int
 ftw_pack(const char *fpath, const struct stat *st, int tf)
 {
     (void)tf;
 
     int result = -1;
-    unsigned char rbuf[512];
-    size_t r;
     FILE *f = NULL;
     char flag;
+    unsigned char *content = NULL;
+    off_t size = st->st_size;
     const char *stripped = &fpath[s_offset];
     const char *filename;
 
@@ -526,45 +989,75 @@ ftw_pack(const char *fpath, const struct stat *st, int tf)
         return 0;
     }
 
-    if (write_file_header(s_out, stripped, flag, st->st_size) != 0) 
+    // only archives in the current format can contain compressed files
+    if (f != NULL && s_index != NULL && s_compression != 0 && st->st_size >= COMPRESS_MIN_SIZE)
+    {
+        if ((content = compress_file(f, fpath, st->st_size, &size)) != NULL)
+            flag = ZFILE_FLAG;
+        else 
+            size = st->st_size;
+    }
+
+    if (write_file_header(s_out, s_out_version, stripped, flag, size) != 0) 
         goto finish;
+    if (s_index != NULL)
+        index_add(s_index, flag, ftell(s_out), IS_FILE(flag) ? size : 0, stripped);
 
-    if (f != NULL)
+    if (content != NULL)
+    {
+        LOG(2, "Writing %s (%jd bytes compressed)\n", stripped, (intmax_t)size);
+        if (fwrite(content, 1, size, s_out) != (size_t)size)
+        {
+            fprintf(stderr, "Failed to write %s\n", stripped);
+            goto finish;
+        }
+    }
+    else if (f != NULL)
     {
         LOG(2, "Writing %s (%jd bytes)\n", stripped, (intmax_t)(st->st_size));
-        while ((r = fread(rbuf, 1, sizeof(rbuf), f)) > 0)
+        if (copy_data(f, s_out, st->st_size) != EE_OK)
         {
-            if (fwrite(rbuf, 1, r, s_out) != r)
-            {
-                fprintf(stderr, "Failed to write %zu bytes", r);
-                goto finish;
-            }
+            fprintf(stderr, "Failed to write %s\n", stripped);
+            goto finish;
         }
     }
     result = 0;
 finish: 
+    free(content);
     close_file(f, fpath);
     return result;
 }
+/*
+ * Packs path to the current position of f, if index is not NULL the archive is
+ * written in the current format and the index is appended
+ * */
 static int 
-pack (const char *archive, const char *path, const char *mode)
+pack (FILE *f, const char *archive, const char *path, struct exar_index_s *index)
 {
     int ret = EE_OK;
 
-    LOG(3, "Opening %s for writing\n", archive);
-    if ((s_out = fopen(archive, mode)) == NULL)
-    {
-        perror(archive);
-        return EE_ERROR;
-    }
+    s_out = f;
     s_out_path = archive;
+    s_out_version = index != NULL ? EXAR_VERSION : EXAR_VERSION_1;
+    s_index = index;
 
     ret = ftw(path, ftw_pack, MAX_FILE_HANDLES);
+    if (ret == 0 && index != NULL && write_index(f, index) != EE_OK)
+    {
+        fprintf(stderr, "Failed to write index\n");
+        ret = EE_ERROR;
+    }
 
     LOG(3, "Closing %s\n", archive);
 
-    fclose(s_out);
+    if (fclose(s_out) != 0)
+    {
+        perror(archive);
+        ret = EE_ERROR;
+    }
+    s_out = NULL;
     s_out_path = NULL;
+    s_index = NULL;
 
     return ret;
 }
@@ -581,24 +1074,79 @@ exar_pack(const char *path, const char *outpath)
 
     if (outpath != NULL)
     {
-        strncpy(archive, outpath, sizeof(archive));
+        snprintf(archive, sizeof(archive), "%s", outpath);
     }
     else 
     {
         strncpy(&archive[i], "." EXTENSION, sizeof(archive) - i);
     }
 
-    return pack(archive, path, "w");
+    struct exar_index_s index = EXAR_INDEX_EMPTY;
+    FILE *f;
+    int ret;
+
+    LOG(3, "Opening %s for writing\n", archive);
+    if ((f = fopen(archive, "w")) == NULL)
+    {
+        perror(archive);
+        return EE_ERROR;
+    }
+    ret = pack(f, archive, path, &index);
+    index_clear(&index);
+    return ret;
 }
 int 
 exar_append(const char *archive, const char *path)
 {
     assert(path != NULL);
     char stripped[EXAR_NAME_MAX] = {0};
+    struct exar_index_s index = EXAR_INDEX_EMPTY;
+    FILE *f;
+    off_t start;
+    int version, ret = EE_ERROR;
 
     s_offset = get_offset(stripped, sizeof(stripped), path, 0);
 
-    return pack(archive, path, "a");
+    LOG(3, "Opening %s for appending\n", archive);
+    if ((f = fopen(archive, "r+")) == NULL)
+    {
+        if (errno != ENOENT || (f = fopen(archive, "w")) == NULL)
+        {
+            perror(archive);
+            return EE_ERROR;
+        }
+        version = 2;
+        start = 0;
+    }
+    else if ((version = get_version(f)) == EE_ERROR)
+    {
+        close_file(f, archive);
+        return EE_ERROR;
+    }
+    else if (version == 1)
+    {
+        // exar-1 archives are appended in the old format, use exar_migrate to
+        // convert them
+        fseek(f, 0, SEEK_END);
+        return pack(f, archive, path, NULL);
+    }
+    else if (read_index(f, &index, &start) != EE_OK)
+    {
+        close_file(f, archive);
+        return EE_ERROR;
+    }
+
+    // The new files overwrite the old index, a new index is written after the
+    // files have been packed
+    if (fseek(f, start, SEEK_SET) != 0 || ftruncate(fileno(f), start) != 0)
+    {
+        perror(archive);
+        close_file(f, archive);
+    }
+    else 
+        ret = pack(f, archive, path, &index);
+    index_clear(&index);
+    return ret;
 }
 
 int 
@@ -609,8 +1157,8 @@ exar_unpack(const char *archive, const char *dest)
     struct exar_header_s header = EXAR_HEADER_EMPTY;
     int ret = EE_ERROR;
     FILE *of, *f = NULL;
-    unsigned char buf[512];
-    size_t r = 0;
+    unsigned char *content;
+    off_t size;
     int status;
 
     if ((f = open_archive(archive, "r")) == NULL)
@@ -655,20 +1203,28 @@ exar_unpack(const char *archive, const char *dest)
                 goto finish;
             }
 
-            LOG(2, "Writing %s (%jd bytes)\n", header.eh_name, (intmax_t)header.eh_size);
-            for (off_t i=0; i<header.eh_size; i += sizeof(buf))
+            if (header.eh_flag == ZFILE_FLAG)
             {
-                if ( (r = fread(buf, 1, MIN(sizeof(buf), (size_t)header.eh_size - i), f)) != 0)
+                if ((content = read_content(f, header.eh_name, header.eh_flag, header.eh_size, &size)) == NULL)
+                    status = EE_ERROR;
+                else 
                 {
-                    if (fwrite(buf, 1, r, of) != r)
-                    {
-                        fprintf(stderr, "Failed to write %zu bytes\n", r);
-                        goto finish;
-                    }
+                    LOG(2, "Writing %s (%jd bytes)\n", header.eh_name, (intmax_t)size);
+                    status = fwrite(content, 1, size, of) == (size_t)size ? EE_OK : EE_ERROR;
+                    exar_free(content);
                 }
             }
+            else 
+            {
+                LOG(2, "Writing %s (%jd bytes)\n", header.eh_name, (intmax_t)header.eh_size);
+                status = copy_data(f, of, header.eh_size);
+            }
             LOG(3, "Closing %s\n", header.eh_name);
-            fclose(of);
+            if (fclose(of) != 0 || status != EE_OK)
+            {
+                fprintf(stderr, "Failed to write %s\n", header.eh_name);
+                goto finish;
+            }
         }
     }
     ret = EE_OK;
@@ -705,23 +1261,32 @@ exar_search_extract_from_data(const unsigned char *data, const char *file, off_t
 
     return extract_from_data(data, file, s, find_cmp);
 }
-int 
-exar_delete(const char *archive, const char *file)
+/*
+ * Copies an archive to a temporary file and replaces the archive, skips file if
+ * not NULL. If migrate is set the copy is written in the current format,
+ * otherwise the format of the archive is kept.
+ * */
+static int 
+rewrite(const char *archive, const char *file, int migrate)
 {
-    assert(archive != NULL && file != NULL);
-
     int result = EE_ERROR;
     struct exar_header_s header = EXAR_HEADER_EMPTY;
+    struct exar_index_s index = EXAR_INDEX_EMPTY;
+    int indexed = 0;
     FILE *f = NULL, *ftmp = NULL;
-    char tmp_file[128];
+    char tmp_file[128] = {0};
     char dir_name[EXAR_NAME_MAX-1] = {0};
-    unsigned char rbuf;
+    struct stat st;
     size_t dir_length = 0;
     int status = EE_ERROR;
     int fd;
 
     if ((f = open_archive(archive, "r")) == NULL)
         goto finish;
+    if ((status = get_version(f)) == EE_ERROR)
+        goto finish;
+    indexed = migrate || status == 2;
+    status = EE_ERROR;
 
     snprintf(tmp_file, sizeof(tmp_file), "%s.XXXXXX", archive);
     if ((fd = mkstemp(tmp_file)) == -1)
@@ -733,12 +1298,15 @@ exar_delete(const char *archive, const char *file)
     LOG(3, "Opening %s for writing\n", tmp_file);
     if ((ftmp = fdopen(fd, "w")) == NULL)
         goto finish;
+    // keep the permissions of the archive, mkstemp creates the file with mode 0600
+    if (fstat(fileno(f), &st) == 0)
+        fchmod(fd, st.st_mode & 0777);
 
     while ((status = get_file_header(f, &header)) == EE_OK)
     {
-        if (strcmp(header.eh_name, file) == 0)
+        if (file != NULL && strcmp(header.eh_name, file) == 0)
         {
-            if (header.eh_flag == FILE_FLAG)
+            if (IS_FILE(header.eh_flag))
             {
                 LOG(1, "Skipping %s\n", header.eh_name);
                 fseek(f, header.eh_size, SEEK_CUR);
@@ -748,7 +1316,7 @@ exar_delete(const char *archive, const char *file)
         }
         else if (*dir_name && strncmp(dir_name, header.eh_name, dir_length) == 0)
         {
-            if (header.eh_flag == FILE_FLAG)
+            if (IS_FILE(header.eh_flag))
             {
                 LOG(1, "Skipping %s\n", header.eh_name);
                 fseek(f, header.eh_size, SEEK_CUR);
@@ -757,39 +1325,108 @@ exar_delete(const char *archive, const char *file)
         else 
         {
             LOG(1, "Packing %s\n", header.eh_name);
-            write_file_header(ftmp, header.eh_name, header.eh_flag, header.eh_size);
-            if (header.eh_flag == FILE_FLAG)
+            write_file_header(ftmp, indexed ? EXAR_VERSION : EXAR_VERSION_1, header.eh_name, header.eh_flag, header.eh_size);
+            if (indexed)
+                index_add(&index, header.eh_flag, ftell(ftmp), header.eh_size, header.eh_name);
+            if (IS_FILE(header.eh_flag))
             {
                 LOG(2, "Copying %s (%jd bytes)\n", header.eh_name, (intmax_t)header.eh_size);
-                for (off_t s=0; s<header.eh_size; s++)
+                if (copy_data(f, ftmp, header.eh_size) != EE_OK)
                 {
-                    if (fread(&rbuf, 1, 1, f) != 1 || fwrite(&rbuf, 1, 1, ftmp) != 1)
-                    {
-                        fprintf(stderr, "Error copying %s\n", header.eh_name);
-                        goto finish;
-                    }
+                    fprintf(stderr, "Error copying %s\n", header.eh_name);
+                    status = EE_ERROR;
+                    goto finish;
                 }
             }
         }
     }
 finish:
+    if (status == EE_EOF && indexed && write_index(ftmp, &index) != EE_OK)
+    {
+        fprintf(stderr, "Failed to write index\n");
+        status = EE_ERROR;
+    }
+    // the content must be on disk before the archive is replaced
+    if (status == EE_EOF && (fflush(ftmp) != 0 || fsync(fileno(ftmp)) != 0))
+    {
+        perror(tmp_file);
+        status = EE_ERROR;
+    }
     if (status == EE_EOF)
     {
         LOG(2, "Copying %s to %s\n", tmp_file, archive);
         if (rename(tmp_file, archive) == -1)
+        {
             perror(archive);
+            unlink(tmp_file);
+        }
         else 
             result = EE_OK;
     }
-    else if (status == EE_ERROR)
+    else if (status == EE_ERROR && *tmp_file)
     {
         LOG(1, "An error occured, removing temporary file\n");
         unlink(tmp_file);
     }
+    index_clear(&index);
     close_file(f, archive);
     close_file(ftmp, tmp_file);
     return result;
 }
+int 
+exar_delete(const char *archive, const char *file)
+{
+    assert(archive != NULL && file != NULL);
+
+    return rewrite(archive, file, 0);
+}
+int 
+exar_migrate(const char *archive)
+{
+    assert(archive != NULL);
+
+    FILE *f;
+    int version;
+
+    if ((f = open_archive(archive, "r")) == NULL)
+        return EE_ERROR;
+    version = get_version(f);
+    close_file(f, archive);
+
+    if (version == EE_ERROR)
+        return EE_ERROR;
+    else if (version == 2)
+    {
+        LOG(1, "%s is already in the current format\n", archive);
+        return EE_OK;
+    }
+    LOG(1, "Migrating %s to %s\n", archive, EXAR_VERSION);
+    return rewrite(archive, NULL, 1);
+}
+/*
+ * Prints flag, uncompressed size, compression ratio and name of a file, offset
+ * is the offset of the content
+ * */
+static void 
+print_info(FILE *f, unsigned char flag, off_t offset, off_t size, const char *name)
+{
+    unsigned char buffer[SZ_SIZE];
+    char ratio[8] = "";
+    off_t original = size;
+
+    if (flag == ZFILE_FLAG)
+    {
+        if (fseek(f, offset, SEEK_SET) != 0 || fread(buffer, 1, SZ_SIZE, f) != SZ_SIZE 
+                || (original = get_original_size(buffer, size)) < 0)
+        {
+            fprintf(stderr, "Cannot determine size of %s\n", name);
+            return;
+        }
+    }
+    if (IS_FILE(flag))
+        snprintf(ratio, sizeof(ratio), "%.1f%%", original == 0 ? 100.0 : 100.0 * size / original);
+    fprintf(stdout, "%c %-14jd %-7s %s\n", flag, (intmax_t)original, ratio, name);
+}
 void 
 exar_info(const char *archive)
 {
@@ -797,12 +1434,31 @@ exar_info(const char *archive)
 
     FILE *f = NULL;
     struct exar_header_s header = EXAR_HEADER_EMPTY;
+    struct exar_index_s index = EXAR_INDEX_EMPTY;
+    struct exar_entry_s *entry;
+    off_t offset;
 
     if ((f = open_archive(archive, "r")) == NULL)
         goto finish;
-    while(next_file(f, &header) == EE_OK)
-        fprintf(stdout, "%c %-14jd %s\n", header.eh_flag, (intmax_t)header.eh_size, header.eh_name);
+    if (read_index(f, &index, NULL) == EE_OK)
+    {
+        for (size_t i=0; i<index.ei_length; i++)
+        {
+            entry = &index.ei_entries[i];
+            print_info(f, entry->ee_flag, entry->ee_offset, entry->ee_size, entry->ee_name);
+        }
+        goto finish;
+    }
+    rewind(f);
+    while (get_file_header(f, &header) == EE_OK)
+    {
+        offset = ftell(f);
+        print_info(f, header.eh_flag, offset, header.eh_size, header.eh_name);
+        if (fseek(f, offset + header.eh_size, SEEK_SET) != 0)
+            break;
+    }
 finish:
+    index_clear(&index);
     close_file(f, archive);
 }
 int
@@ -841,6 +1497,151 @@ exar_check_version_from_data(const unsigned char *data, size_t s)
         return EE_ERROR;
     return version_cmp(data, 0) == EE_OK ? EE_OK : EE_ERROR;
 }
+struct exar_archive_s * 
+exar_open(const char *archive)
+{
+    assert(archive != NULL);
+
+    struct exar_archive_s *ea = NULL;
+    struct exar_header_s header = EXAR_HEADER_EMPTY;
+    struct stat st;
+    FILE *f;
+    void *data;
+    off_t offset = EE_EOF;
+    int status;
+
+    if ((f = open_archive(archive, "r")) == NULL)
+        return NULL;
+    if (check_version(f, 0) != EE_OK)
+    {
+        LOG(1, "%s is not an archive\n", archive);
+        goto finish;
+    }
+    if (fstat(fileno(f), &st) != 0)
+    {
+        perror(archive);
+        goto finish;
+    }
+    LOG(3, "Mapping %s (%jd bytes)\n", archive, (intmax_t)st.st_size);
+    if ((data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fileno(f), 0)) == MAP_FAILED)
+    {
+        perror(archive);
+        goto finish;
+    }
+
+    ea = xcalloc(1, sizeof(struct exar_archive_s));
+    ea->ea_data = data;
+    ea->ea_length = st.st_size;
+
+    if (ea->ea_length > SZ_TRAILER)
+        offset = parse_trailer((char*)ea->ea_data + ea->ea_length - SZ_TRAILER, ea->ea_length - SZ_TRAILER);
+    if (offset >= 0)
+    {
+        LOG(2, "Reading index at offset %jd\n", (intmax_t)offset);
+        status = parse_index((char*)ea->ea_data + offset, ea->ea_length - SZ_TRAILER - offset, &ea->ea_index);
+    }
+    else 
+    {
+        // exar-1 archive, the index is built from the file headers
+        rewind(f);
+        while ((status = get_file_header(f, &header)) == EE_OK)
+        {
+            index_add(&ea->ea_index, header.eh_flag, ftell(f), header.eh_size, header.eh_name);
+            if (IS_FILE(header.eh_flag) && fseek(f, header.eh_size, SEEK_CUR) != 0)
+                break;
+        }
+        status = status == EE_EOF ? EE_OK : EE_ERROR;
+    }
+    for (size_t i=0; status == EE_OK && i<ea->ea_index.ei_length; i++)
+    {
+        if ((size_t)(ea->ea_index.ei_entries[i].ee_offset + ea->ea_index.ei_entries[i].ee_size) > ea->ea_length)
+        {
+            fprintf(stderr, "The archive seems to be corrupted\n");
+            status = EE_ERROR;
+        }
+    }
+    if (status != EE_OK)
+    {
+        exar_close(ea);
+        ea = NULL;
+    }
+finish:
+    close_file(f, archive);
+    return ea;
+}
+static int 
+lookup(struct exar_archive_s *ea, const char *file, const unsigned char **data, off_t *size, 
+        int (*cmp)(const char *, const char *))
+{
+    struct exar_entry_s *entry;
+
+    if ((entry = index_find(&ea->ea_index, file, cmp)) == NULL)
+    {
+        fprintf(stderr, "File %s was not found\n", file);
+        return EE_ERROR;
+    }
+    if (!IS_FILE(entry->ee_flag))
+    {
+        fprintf(stderr, "%s is a directory, only regular files can be extracted\n", file);
+        return EE_ERROR;
+    }
+    LOG(3, "Found %s at offset %jd\n", entry->ee_name, (intmax_t)entry->ee_offset);
+    if (entry->ee_flag == ZFILE_FLAG)
+    {
+        // compressed files are decompressed once and kept until the archive is
+        // closed
+        if (entry->ee_content == NULL)
+        {
+            entry->ee_content = decompress(ea->ea_data + entry->ee_offset, entry->ee_size, entry->ee_name, NULL);
+            if (entry->ee_content == NULL)
+                return EE_ERROR;
+        }
+        if (data != NULL)
+            *data = entry->ee_content;
+        if (size != NULL)
+            *size = get_original_size(ea->ea_data + entry->ee_offset, entry->ee_size);
+        return EE_OK;
+    }
+    if (data != NULL)
+        *data = ea->ea_data + entry->ee_offset;
+    if (size != NULL)
+        *size = entry->ee_size;
+    return EE_OK;
+}
+int 
+exar_lookup(struct exar_archive_s *ea, const char *file, const unsigned char **data, off_t *size)
+{
+    assert(ea != NULL && file != NULL);
+
+    return lookup(ea, file, data, size, strcmp);
+}
+int 
+exar_search_lookup(struct exar_archive_s *ea, const char *search, const unsigned char **data, off_t *size)
+{
+    assert(ea != NULL && search != NULL);
+
+    return lookup(ea, search, data, size, find_cmp);
+}
+void 
+exar_close(struct exar_archive_s *ea)
+{
+    if (ea != NULL)
+    {
+        LOG(3, "Unmapping archive\n");
+        munmap(ea->ea_data, ea->ea_length);
+        index_clear(&ea->ea_index);
+        free(ea);
+    }
+}
+void 
+exar_compression(int level)
+{
+#ifndef EXAR_NO_ZLIB
+    s_compression = MIN(level, Z_BEST_COMPRESSION);
+#else 
+    (void)level;
+#endif
+}
 void 
 exar_verbose(const unsigned char v)
 {
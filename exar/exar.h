@@ -25,14 +25,30 @@
  *
  * File format:
  *
- * [file header][file][file header][file][file he...
+ * [file header][file][file header][file]...[index header][index][trailer]
  *
  * file header    : - file info 22 bytes
  *                      - 7 bytes  version header, null terminated  (char)
- *                      - 1 byte   filetype flag (d|f)              (char)
+ *                      - 1 byte   filetype flag (d|f|z)            (char)
  *                      - 14 byte  file size, null terminated       (char, hex)
  *                  - file name, null terminated, maximum 4096 bytes
- * file           : saved as unsigned char
+ * file           : saved as unsigned char, files with flag z are compressed
+ *                      - 14 byte  uncompressed size, null terminated (char, hex)
+ *                      - zlib compressed content
+ * index header   : file header with filetype flag i, the size of the index
+ *                  and an empty file name
+ * index          : one entry per file header
+ *                  - entry info 29 bytes
+ *                      - 1 byte   filetype flag (d|f|z)            (char)
+ *                      - 14 byte  file offset, null terminated     (char, hex)
+ *                      - 14 byte  file size, null terminated       (char, hex)
+ *                  - file name, null terminated
+ * trailer        : - 14 byte  index header offset, null terminated (char, hex)
+ *                  - 7 bytes  version header, null terminated  (char)
+ *
+ * The version header is exar-2. Archives with version exar-1 have no index and
+ * no trailer, they can still be read, appending to them keeps the old format.
+ * Compressed files are only written to exar-2 archives.
  * */
 
 #ifndef __EXAR_H__
@@ -48,6 +64,11 @@ enum {
 #define EXAR_VERBOSE_MASK (0x7)
 #define exar_free(x)  ((x) = (x) == NULL ? NULL : (free(x), NULL))
 
+/* 
+ * An archive opened with exar_open
+ * */
+struct exar_archive_s;
+
 /* 
  * Packs a file or directory
  * @path: Path to the file or directory to pack
@@ -83,8 +104,8 @@ exar_unpack(const char *path, const char *dest);
  * @file    The path of the file in the archive
  * @size    Return location for the size, if an error occurs size will be set to -1
  *
- * @returns A newly allocated char buffer with the file content or NULL if an error
- *          occured or the file was not found in the archive
+ * @returns A newly allocated null terminated buffer with the file content or
+ *          NULL if an error occured or the file was not found in the archive
  * */
 unsigned char * 
 exar_extract(const char *archive, const char *file, off_t *size);
@@ -97,8 +118,8 @@ exar_extract(const char *archive, const char *file, off_t *size);
  *          the filename 
  * @size    Return location for the size, if an error occurs size will be set to -1
  *
- * @returns A newly allocated char buffer with the file content or NULL if an error
- *          occured or the file was not found in the archive
+ * @returns A newly allocated null terminated buffer with the file content or
+ *          NULL if an error occured or the file was not found in the archive
  * */
 unsigned char * 
 exar_search_extract(const char *archive, const char *search, off_t *size);
@@ -110,8 +131,8 @@ exar_search_extract(const char *archive, const char *search, off_t *size);
  * @file    The path of the file in the archive
  * @size    Return location for the size, if an error occurs size will be set to -1
  *
- * @returns A newly allocated char buffer with the file content or NULL if an error
- *          occured or the file was not found in the archive
+ * @returns A newly allocated null terminated buffer with the file content or
+ *          NULL if an error occured or the file was not found in the archive
  * */
 unsigned char * 
 exar_extract_from_data(const unsigned char *data, const char *file, off_t *size);
@@ -124,8 +145,8 @@ exar_extract_from_data(const unsigned char *data, const char *file, off_t *size)
  *          the filename 
  * @size    Return location for the size, if an error occurs size will be set to -1
  *
- * @returns A newly allocated char buffer with the file content or NULL if an error
- *          occured or the file was not found in the archive
+ * @returns A newly allocated null terminated buffer with the file content or
+ *          NULL if an error occured or the file was not found in the archive
  * */
 
 unsigned char * 
@@ -143,6 +164,17 @@ exar_search_extract_from_data(const unsigned char *data, const char *file, off_t
 int 
 exar_delete(const char *archive, const char *file);
 
+/*
+ * Converts an exar-1 archive to the current format, archives that are already
+ * in the current format are not modified.
+ *
+ * @archive  The archive
+ *
+ * @returns 0 on success and -1 on error
+ */
+int 
+exar_migrate(const char *archive);
+
 /*
  * Checks if the file is an archive file with compatible version number
  *
@@ -193,6 +225,67 @@ exar_contains(const char *archive, const char *path);
  * */
 int 
 exar_search_contains(const char *archive, const char *search);
+/*
+ * Opens an archive, the archive is mapped into memory and the index is read
+ * once, files can then be looked up without reopening the archive. If the
+ * archive is modified while it is open the behaviour is undefined. 
+ *
+ * @archive The archive
+ *
+ * @returns The archive or NULL if the file isn't an archive or an error
+ *          occured, must be closed with exar_close
+ * */
+struct exar_archive_s * 
+exar_open(const char *archive);
+
+/* 
+ * Looks up a file in an open archive
+ *
+ * @archive The archive
+ * @file    The path of the file in the archive
+ * @data    Return location for the file content, the content points into the
+ *          mapped archive, it is not null terminated and only valid until the
+ *          archive is closed
+ * @size    Return location for the size of the content
+ *
+ * @returns 0 if the file was found, -1 otherwise
+ * */
+int 
+exar_lookup(struct exar_archive_s *archive, const char *file, const unsigned char **data, off_t *size);
+
+/* 
+ * Searches for a file in an open archive
+ *
+ * @archive The archive
+ * @search  The search term. The search term must either match the full path or
+ *          the filename 
+ * @data    Return location for the file content, the content points into the
+ *          mapped archive, it is not null terminated and only valid until the
+ *          archive is closed
+ * @size    Return location for the size of the content
+ *
+ * @returns 0 if the file was found, -1 otherwise
+ * */
+int 
+exar_search_lookup(struct exar_archive_s *archive, const char *search, const unsigned char **data, off_t *size);
+
+/* 
+ * Closes an archive opened with exar_open
+ *
+ * @archive The archive, may be NULL
+ * */
+void 
+exar_close(struct exar_archive_s *archive);
+
+/*
+ * Sets the zlib compression level used by exar_pack and exar_append. A file is
+ * only compressed if it is not too small and compression saves enough space.
+ *
+ * @level 0 disables compression, 1 to 9 or -1 for the default level 
+ * */
+void 
+exar_compression(int level);
+
 /*
  * Set verbosity flags, exar will be most verbose if all flags are set, log
  * messages are printed to stderr.
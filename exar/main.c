@@ -30,6 +30,9 @@ enum {
     EXAR_FLAG_L = 1<<8,
     EXAR_FLAG_S = 1<<9,
     EXAR_FLAG_A = 1<<10,
+    EXAR_FLAG_M = 1<<11,
+    /* modifier, not part of EXAR_OPTION_FLAG */
+    EXAR_FLAG_N = 1<<16,
 };
 #ifndef MIN
 #define MIN(X, Y) ((X) > (Y) ? (Y) : (X))
@@ -55,6 +58,8 @@ help(int ret)
            "                        to stdout, the archive is not modified, the file path \n"
            "                        is the relative file path of the file in the archive.\n"
            "    l[v] archive        List archive content\n"
+           "    m[v] archive        Migrate an exar-1 archive to the current format\n"
+           "    n                   Don't compress files when packing or appending\n"
            "    p[v] path           Pack file or directory 'path'.\n"
            "    s[v] archive file   Search for a file and write the content to stdout, the \n" 
            "                        archive is not modified, the filename is the basename\n" 
@@ -112,6 +117,12 @@ main (int argc, char **argv)
             case 'l' : 
                 flag |= EXAR_FLAG_L;
                 break;
+            case 'm' : 
+                flag |= EXAR_FLAG_M;
+                break;
+            case 'n' : 
+                flag |= EXAR_FLAG_N;
+                break;
             case 'p' : 
                 flag |= EXAR_FLAG_P;
                 break;
@@ -126,6 +137,7 @@ main (int argc, char **argv)
                 break;
             case 'h' : 
                 help(EXIT_SUCCESS);
+                break;
             default : 
                 help(EXIT_FAILURE);
         }
@@ -133,6 +145,8 @@ main (int argc, char **argv)
     }
     if (flag & EXAR_VERBOSE_MASK)
         exar_verbose(flag);
+    if (flag & EXAR_FLAG_N)
+        exar_compression(0);
 
     if (EXAR_CHECK_FLAG(flag, EXAR_FLAG_U))
         exar_unpack(argv[2], argv[3]);
@@ -142,6 +156,8 @@ main (int argc, char **argv)
         exar_pack(argv[2], argv[3]);
     else if (EXAR_CHECK_FLAG(flag, EXAR_FLAG_L))
         exar_info(argv[2]);
+    else if (EXAR_CHECK_FLAG(flag, EXAR_FLAG_M))
+        return exar_migrate(argv[2]) == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
     else if (EXAR_CHECK_FLAG(flag, EXAR_FLAG_D) && argc > 3)
         exar_delete(argv[2], argv[3]);
     else if (EXAR_CHECK_FLAG(flag, EXAR_FLAG_E) && argc > 3)
@@ -154,9 +154,16 @@ html_input(auto-insert-mode, checkbox, Whether to automatically go in insert mod
 html_select(cache-model, html_options(webbrowser, documentviewer), The cache-model used by webkit )
 html_select(close-last-tab-policy, html_options(ignore, clear, close), Behaviour when the last tab is closed)
 html_input(custom-encoding, text, The custom encoding of the view)
+html_input(download-bandwidth-limit, text, Bandwidth limit for all downloads in KiB/s, 0 means unlimited)
+html_input(download-checksums, text, Space separated list of checksums that are computed for downloads)
+html_input(download-decompress, checkbox, Whether to decompress downloaded gzip files)
 html_input(download-directory, text, Default download directory)
 html_input(download-external-command, text, External application used for downloads)
+html_input(download-max-active, text, Maximum number of downloads that run at the same time)
+html_input(download-max-per-host, text, Maximum number of downloads from the same host that run at the same time)
+html_input(download-move-directory, text, Directory finished downloads are moved to)
 html_input(download-no-confirm, checkbox, Whether to immediately start a download if download-directory is set)
+html_input(download-segments, text, Maximum number of parallel connections per download)
 html_input(download-use-external-program, checkbox, Whether to use an external download helper)
 html_input(editable, checkbox, Whether content can be modified)
 html_input(editor, text, External editor used for inputs/textareas)
@@ -20,6 +20,11 @@ Object.freeze((function () {
         lastPosition : 0,
         newTab : false,
         notify : null,
+        type : null,
+        lastFilter : null,
+        scrollWindows : [],
+        scrollTimer : null,
+        styleSheets : [],
         hintTypes :  [ 
             "a, textarea, select, input:not([type=hidden]), button,  frame, iframe, [onclick], [onmousedown]," + 
             "[role=link], [role=option], [role=button], [role=option], img",  // HINT_T_ALL
@@ -341,6 +346,7 @@ Object.freeze((function () {
             doc.body.appendChild(styleSheet);
 
         doc.hasStyleSheet = true;
+        globals.styleSheets.push(styleSheet);
     };
     var p_getOffsets = function(doc) 
     {
@@ -401,7 +407,10 @@ Object.freeze((function () {
             p_appendHint(hints, varructor, a, win, r, offsets);
         }
     };
-    var p_createHints = function(win, varructor, type) 
+    /* Creates hints for the elements in the viewport of a frame and its
+     * subframes, the hints are only collected in a fragment per frame, they
+     * are inserted with p_insertHints after all positions have been read */
+    var p_createHints = function(win, varructor, type, fragments) 
     {
         var i;
         try 
@@ -409,17 +418,19 @@ Object.freeze((function () {
             var doc = win.document;
             var res = doc.body.querySelectorAll(globals.hintTypes[type]); 
             var e, r;
+            var height = win.innerHeight || doc.body.offsetHeight;
+            var width = win.innerWidth || doc.body.offsetWidth;
             p_createStyleSheet(doc);
             var hints = doc.createDocumentFragment();
             var oe = p_getOffsets(doc);
             for (i=0;i < res.length; i++) 
             {
                 e = res[i];
-                if ((r = p_getVisibility(e, win)) === null) {
+                if ((r = p_getVisibility(e, win, height, width)) === null) {
                     continue;
                 }
                 if ( (e instanceof HTMLFrameElement || e instanceof HTMLIFrameElement)) {
-                    p_createHints(e.contentWindow, varructor, type);
+                    p_createHints(e.contentWindow, varructor, type, fragments);
                     continue;
                 }
                 else if (e instanceof HTMLImageElement 
@@ -432,13 +443,99 @@ Object.freeze((function () {
                     p_appendHint(hints, varructor, e, win, r, oe);
                 }
             }
-            doc.body.appendChild(hints);
+            fragments.push({ win : win, hints : hints });
         }
         catch(exc) 
         {
             console.error(exc);
         }
     };
+    var p_insertHints = function(fragments) 
+    {
+        var i, f;
+        for (i=0; i<fragments.length; i++) 
+        {
+            f = fragments[i];
+            if (f.hints.firstChild)
+                f.win.document.body.appendChild(f.hints);
+            if (globals.scrollWindows.indexOf(f.win) == -1) 
+            {
+                f.win.addEventListener("scroll", p_onScroll, false);
+                globals.scrollWindows.push(f.win);
+            }
+        }
+    };
+    var p_removeHints = function() 
+    {
+        var p, i, e;
+        for (i=0; i<globals.elements.length; i++) 
+        {
+            e = globals.elements[i];
+            if ( (p = e.hint.parentNode) ) 
+                p.removeChild(e.hint);
+
+            if (e.overlay && (p = e.overlay.parentNode)) 
+                p.removeChild(e.overlay);
+        }
+        globals.elements = [];
+        globals.activeArr = [];
+        globals.active = null;
+        globals.positions = [];
+        globals.lastPosition = 0;
+    };
+    /* Scrolling moves other elements into the viewport, the hints are
+     * recomputed when scrolling stopped */
+    var p_onScroll = function() 
+    {
+        if (globals.scrollTimer !== null) 
+            clearTimeout(globals.scrollTimer);
+        globals.scrollTimer = setTimeout(p_refreshHints, 100);
+    };
+    var p_refreshHints = function() 
+    {
+        var fragments = [], array;
+        globals.scrollTimer = null;
+        if (globals.type === null) 
+            return;
+
+        if(! globals.markHints && globals.active) 
+            globals.active.element.removeAttribute("dwb_highlight");
+        p_removeHints();
+        p_createHints(window, globals.style == "letter" ? p_letterHint : p_numberHint, globals.type, fragments);
+        p_getTextHints(globals.elements);
+        p_insertHints(fragments);
+        globals.activeArr = globals.elements;
+        if (globals.lastFilter !== null)
+            globals.activeArr = p_filterHints(globals.lastFilter.input, globals.lastFilter.matchHint);
+        if (globals.activeArr.length > 0)
+            p_setActive(globals.activeArr[0]);
+    };
+    /* Hides all hints that don't match, returns the matching hints */
+    var p_filterHints = function(input, matchHint) 
+    {
+        var i, e, array = [];
+        for (i=0; i<globals.activeArr.length; i++) 
+        {
+            e = globals.activeArr[i];
+            if (e.matchText(input, matchHint)) 
+                array.push(e);
+            else
+                e.hint.style.visibility = 'hidden';
+        }
+        return array;
+    };
+    /* Shows all hints again, e.g. after characters have been removed from
+     * the input, the existing hints are reused */
+    var p_resetHints = function() 
+    {
+        for (var i=0; i<globals.elements.length; i++) 
+            globals.elements[i].hint.style.visibility = '';
+        globals.activeArr = globals.elements;
+        globals.matchHint = -1;
+        globals.lastFilter = null;
+        if (globals.style == "number") 
+            p_getTextHints(globals.elements);
+    };
     var p_showHints = function (type, newTab, selector) 
     {
         var i;
@@ -452,12 +549,14 @@ Object.freeze((function () {
             globals.hintTypes[HintTypes.HINT_T_SELECTOR] = selector;
         }
         globals.newTab = newTab;
-        p_createHints(window, globals.style == "letter" ? p_letterHint : p_numberHint, type);
+        globals.type = type;
+        var fragments = [];
+        p_createHints(window, globals.style == "letter" ? p_letterHint : p_numberHint, type, fragments);
         var l = globals.elements.length;
 
         if (l === 0) 
         {
-            return "_dwb_no_hints_";
+            return p_result("_dwb_no_hints_");
         }
         else if (l == 1)  
         {
@@ -477,14 +576,14 @@ Object.freeze((function () {
         document.body.appendChild(globals.notify);
 
         p_getTextHints(globals.elements);
+        p_insertHints(fragments);
         globals.activeArr = globals.elements;
         p_setActive(globals.elements[0]);
         return null;
     };
     var p_updateHints = function(input, type) 
     {
-        var i;
-        var array = [];
+        var array;
         var matchHint = false;
         if (!globals.activeArr.length) 
         {
@@ -493,10 +592,7 @@ Object.freeze((function () {
         }
         if (globals.lastInput && (globals.lastInput.length > input.length)) 
         {
-            p_clear();
-            globals.lastInput = input;
-            p_showHints(type, globals.newTab);
-            return p_updateHints(input, type);
+            p_resetHints();
         }
         globals.lastInput = input;
         if (input) 
@@ -526,7 +622,7 @@ Object.freeze((function () {
                 if (input[input.length-1].isLower()) 
                 {
                     if (lowerSeq.indexOf(input.charAt(input.length-1)) == -1) 
-                        return "_dwb_no_hints_";
+                        return p_result("_dwb_no_hints_");
 
                     input = input.match(new RegExp("[" + lowerSeq + "]", "g")).join("");
                     matchHint = true;
@@ -535,19 +631,13 @@ Object.freeze((function () {
                     input = input.match(new RegExp("[^" + lowerSeq + "]", "g")).join("");
             }
         }
-        for (i=0; i<globals.activeArr.length; i++) 
-        {
-            var e = globals.activeArr[i];
-            if (e.matchText(input, matchHint)) 
-                array.push(e);
-            else
-                e.hint.style.visibility = 'hidden';
-        }
+        array = p_filterHints(input, matchHint);
+        globals.lastFilter = { input : input, matchHint : matchHint };
         globals.activeArr = array;
         if (array.length === 0) 
         {
             p_clear();
-            return "_dwb_no_hints_";
+            return p_result("_dwb_no_hints_");
         }
         else if (array.length == 1 && globals.autoFollow) 
         {
@@ -560,51 +650,56 @@ Object.freeze((function () {
         }
         return null;
     };
-    var p_getVisibility = function (e, win) 
+    /* Returns the first client rect of an element if it intersects the
+     * viewport, the computed style is only checked for elements in the
+     * viewport */
+    var p_getVisibility = function (e, win, height, width) 
     {
-        var style = win.getComputedStyle(e, null);
-        if ((style.getPropertyValue("visibility") == "hidden" || style.getPropertyValue("display") == "none" ) ) 
+        var r = e.getClientRects()[0];
+        if (!r)
             return null;
 
-        var r = e.getClientRects()[0] || e.getBoundingClientRect();
+        if (height === undefined) 
+        {
+            height = win.innerHeight || document.body.offsetHeight;
+            width = win.innerWidth || document.body.offsetWidth;
+        }
 
-        var height = win.innerHeight || document.body.offsetHeight;
-        var width = win.innerWidth || document.body.offsetWidth;
+        if (r.top > height || r.bottom < 0 || r.left > width ||  r.right < 0) 
+            return null;
 
-        if (!r || r.top > height || r.bottom < 0 || r.left > width ||  r.right < 0 || !e.getClientRects()[0]) 
+        var style = win.getComputedStyle(e, null);
+        if ((style.getPropertyValue("visibility") == "hidden" || style.getPropertyValue("display") == "none" ) ) 
             return null;
 
         return r;
     };
     var p_clear = function() 
     {
-        var p, i;
+        var i;
         try 
         {
-            if (globals.elements) 
-            {
-                for (i=0; i<globals.elements.length; i++) 
-                {
-                    var e = globals.elements[i];
-                    if ( (p = e.hint.parentNode) ) 
-                        p.removeChild(e.hint);
-
-                    if (e.overlay && (p = e.overlay.parentNode)) 
-                        p.removeChild(e.overlay);
-                }
-            }
             if(! globals.markHints && globals.active) 
                 globals.active.element.removeAttribute("dwb_highlight");
+            p_removeHints();
+            for (i=0; i<globals.scrollWindows.length; i++) 
+                globals.scrollWindows[i].removeEventListener("scroll", p_onScroll, false);
         }
         catch (exc) 
         { 
             console.error(exc); 
         }
+        if (globals.scrollTimer !== null) 
+            clearTimeout(globals.scrollTimer);
+        globals.scrollTimer = null;
+        globals.scrollWindows = [];
         globals.elements = [];
         globals.activeArr = [];
         globals.active = null;
         globals.lastPosition = 0;
         globals.lastInput = null;
+        globals.lastFilter = null;
+        globals.type = null;
         globals.positions = [];
         globals.matchHint = -1;
         globals.actionElement = null;
@@ -640,10 +735,15 @@ Object.freeze((function () {
         }
         p_clear();
     }
+    /* Result of a hint action, read by dwb_evaluate_hints */
+    var p_result = function (event, action, resource) 
+    {
+        return { event : event, action : action || null, resource : resource || null };
+    };
     var p_evaluate = function (e, type) 
     {
         globals.actionElement = e;
-        var ret = null;
+        var event = null, action = null;
         var elementType = null;
         var resource = "unknown";
         if (e.type) 
@@ -663,54 +763,54 @@ Object.freeze((function () {
         {
             resource = e.href;
         }
-        if (type == HintTypes.HINT_T_IMAGES)
-        {
-            ret = "none|none";
-        }
-        else if (type == HintTypes.HINT_T_URL)
+        if (type == HintTypes.HINT_T_IMAGES || type == HintTypes.HINT_T_URL)
         {
-            ret = "none|none"
+            event = "none";
+            action = "none";
         }
         else if ((tagname && (tagname == "input" || tagname == "textarea"))) 
         {
             if (elementType == "radio" || elementType == "checkbox") 
             {
-                ret = "_dwb_check_|clickFocus|";
+                event = "_dwb_check_";
+                action = "clickFocus";
                 resource = "@" + elementType;
             }
             else if (elementType && (elementType == "submit" || elementType == "reset" || elementType  == "button")) 
             {
                 p_clickElement(e, "click");
-                ret = "_dwb_click_|click";
+                event = "_dwb_click_";
+                action = "click";
                 resource = "@" + elementType;
             }
             else 
             {
-                ret = "_dwb_input_|focus";
+                event = "_dwb_input_";
+                action = "focus";
                 resource = "@" + tagname;
             }
         }
         else if (e.hasAttribute("role")) 
         {
-            ret = "_dwb_click_|all";
+            event = "_dwb_click_";
+            action = "all";
             resource = "@role";
         }
         else 
         {
-            ret = "_dwb_click_";
+            event = "_dwb_click_";
             if (tagname == "a" || e.hasAttribute("onclick"))
-                ret += "|click";
+                action = "click";
             else if (e.hasAttribute("onmousedown")) 
-                ret += "|mousedown";
+                action = "mousedown";
             else if (e.hasAttribute("onmouseover")) 
-                ret += "|mouseover";
+                action = "mouseover";
             else {
-                ret += "|all";
+                action = "all";
                 p_clickElement(e);
             }
         }
-        ret += "|" + resource;
-        return ret;
+        return p_result(event, action, resource);
     };
     var p_focusNext = function()  
     {
@@ -845,6 +945,14 @@ Object.freeze((function () {
         globals.autoFollow = autoFollow;
         globals.bigFont = Math.ceil(font.replace(/\D/g, "") * 1.25) + "px";
         globals.fontSize = Math.ceil(font.replace(/\D/g, ""))/2;
+        // the style changed at runtime, style sheets are created again
+        globals.styleSheets.forEach(function(styleSheet) {
+            var doc = styleSheet.ownerDocument;
+            if (styleSheet.parentNode)
+                styleSheet.parentNode.removeChild(styleSheet);
+            doc.hasStyleSheet = false;
+        });
+        globals.styleSheets = [];
     };
     var p_pastePrimary = function(primary) 
     {
@@ -870,21 +978,21 @@ Object.freeze((function () {
         {
             p_createStyleSheet(document);
         },
-        showHints : function(obj) 
+        showHints : function(type, newTab, selector) 
         {
-            return p_showHints(obj.type, obj.newTab, obj.selector);
+            return p_showHints(type, newTab, selector);
         },
-        updateHints : function (obj) 
+        updateHints : function (input, type) 
         {
-            return p_updateHints(obj.input, obj.type);
+            return p_updateHints(input, type);
         },
         clear : function () 
         {
             p_clear();
         },
-        followActive : function (obj) 
+        followActive : function (type) 
         {
-            return p_evaluate(globals.active.element, obj.type);
+            return p_evaluate(globals.active.element, type);
         },
         focusNext : function () 
         {
@@ -375,9 +375,17 @@ adblock_apply_element_hider(WebKitWebFrame *frame, GList *gl)
 
 /* LOAD_CALLBACKS {{{*/
 
-/* adblock_before_load_cb  (domcallback) {{{*/
+/* adblock_account_time {{{*/
+/* Time spent in the adblocker is accounted to the tab */
+static void
+adblock_account_time(GList *gl, gint64 start) 
+{
+    VIEW(gl)->status->stats.adblock_time += g_get_monotonic_time() - start;
+}/*}}}*/
+
+/* adblock_before_load  {{{*/
 static gboolean
-adblock_before_load_cb(WebKitDOMDOMWindow *win, WebKitDOMEvent *event, GList *gl) 
+adblock_before_load(WebKitDOMDOMWindow *win, WebKitDOMEvent *event, GList *gl) 
 {
 
     WebKitDOMEventTarget *src = webkit_dom_event_get_target(event);
@@ -448,12 +456,26 @@ error_out:
     return ret;
 }/*}}}*/
 
+/* adblock_before_load_cb  (domcallback) {{{*/
+static gboolean
+adblock_before_load_cb(WebKitDOMDOMWindow *win, WebKitDOMEvent *event, GList *gl) 
+{
+    gint64 start = g_get_monotonic_time();
+    gboolean ret = adblock_before_load(win, event, gl);
+    adblock_account_time(gl, start);
+    return ret;
+}/*}}}*/
+
 static void 
 adblock_frame_load_status_cb(WebKitWebFrame *frame, GParamSpec *p, GList *gl) 
 {
     WebKitLoadStatus status = webkit_web_frame_get_load_status(frame);
     if (status == WEBKIT_LOAD_FIRST_VISUALLY_NON_EMPTY_LAYOUT) 
+    {
+        gint64 start = g_get_monotonic_time();
         adblock_apply_element_hider(frame, gl);
+        adblock_account_time(gl, start);
+    }
     else if (status == WEBKIT_LOAD_COMMITTED) 
         dom_add_frame_listener(frame, "beforeload", G_CALLBACK(adblock_before_load_cb), true, gl);
 }
@@ -464,11 +486,9 @@ adblock_frame_created_cb(WebKitWebView *wv, WebKitWebFrame *frame, GList *gl)
 {
     g_signal_connect(frame, "notify::load-status", G_CALLBACK(adblock_frame_load_status_cb), gl);
 }/*}}}*/
-/* adblock_resource_request_cb {{{*/
+/* adblock_filter_request {{{*/
 static void 
-adblock_resource_request_cb(WebKitWebView *wv, WebKitWebFrame *frame,
-    WebKitWebResource *resource, WebKitNetworkRequest *request,
-    WebKitNetworkResponse *response, GList *gl) 
+adblock_filter_request(WebKitWebView *wv, WebKitWebFrame *frame, WebKitNetworkRequest *request) 
 {
     if (request == NULL) 
         return;
@@ -516,6 +536,17 @@ adblock_resource_request_cb(WebKitWebView *wv, WebKitWebFrame *frame,
         }
     }
 }/*}}}*/
+
+/* adblock_resource_request_cb {{{*/
+static void 
+adblock_resource_request_cb(WebKitWebView *wv, WebKitWebFrame *frame,
+    WebKitWebResource *resource, WebKitNetworkRequest *request,
+    WebKitNetworkResponse *response, GList *gl) 
+{
+    gint64 start = g_get_monotonic_time();
+    adblock_filter_request(wv, frame, request);
+    adblock_account_time(gl, start);
+}/*}}}*/
  
 /* adblock_load_status_cb(WebKitWebView *, GParamSpec *, GList *) {{{*/
 static void
@@ -531,7 +562,9 @@ adblock_load_status_cb(WebKitWebView *wv, GParamSpec *p, GList *gl)
     else if (status == WEBKIT_LOAD_FIRST_VISUALLY_NON_EMPTY_LAYOUT) 
     {
         WebKitWebFrame *frame = webkit_web_view_get_main_frame(wv);
+        gint64 start = g_get_monotonic_time();
         adblock_apply_element_hider(frame, gl);
+        adblock_account_time(gl, start);
     }
 }/*}}}*//*}}}*/
 
@@ -569,6 +602,9 @@ adblock_disconnect(GList *gl)
 void 
 adblock_connect(GList *gl) 
 {
+    /* Placeholder tabs are connected when they get a webview */
+    if (VIEW(gl)->web == NULL)
+        return;
     if (!s_init && !adblock_init()) 
         return;
     if (s_rules->len > 0 || s_css_hider_list != NULL || s_has_hider_rules) 
@@ -475,7 +475,7 @@ application_start(GApplication *app, char **argv)
      * */
 
     if (EMIT_SCRIPT(READY)) {
-        ScriptSignal signal = { NULL, SCRIPTS_SIG_META(NULL, READY, 0) };
+        ScriptSignal signal = { .jsobj = NULL, SCRIPTS_SIG_META(NULL, READY, 0) };
         scripts_emit(&signal);
     }
 
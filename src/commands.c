@@ -128,16 +128,20 @@ commands_simple_command(KeyMap *km)
 static WebKitWebView * 
 commands_get_webview_with_nummod() 
 {
-    if (dwb.state.nummod > 0 && dwb.state.nummod <= (gint)g_list_length(dwb.state.views)) 
-        return WEBVIEW(g_list_nth(dwb.state.views, NUMMOD - 1));
+    if (dwb.state.nummod > 0 && dwb.state.nummod <= view_count()) 
+    {
+        GList *gl = view_nth(NUMMOD - 1);
+        view_materialize(gl);
+        return WEBVIEW(gl);
+    }
     else 
         return CURRENT_WEBVIEW();
 }
 static GList * 
 commands_get_view_from_nummod() 
 {
-    if (dwb.state.nummod > 0 && dwb.state.nummod <= (gint)g_list_length(dwb.state.views)) 
-        return g_list_nth(dwb.state.views, NUMMOD - 1);
+    if (dwb.state.nummod > 0 && dwb.state.nummod <= view_count()) 
+        return view_nth(NUMMOD - 1);
     return dwb.state.fview;
 }
 
@@ -313,8 +317,8 @@ commands_quickmark(KeyMap *km, Arg *arg)
 DwbStatus
 commands_reload(KeyMap *km, Arg *arg) 
 {
-    GList *gl = dwb.state.nummod > 0 && dwb.state.nummod <= (gint)g_list_length(dwb.state.views)
-        ? g_list_nth(dwb.state.views, dwb.state.nummod-1) 
+    GList *gl = dwb.state.nummod > 0 && dwb.state.nummod <= view_count()
+        ? view_nth(dwb.state.nummod-1) 
         : dwb.state.fview;
     dwb_reload(gl);
     return STATUS_OK;
@@ -324,7 +328,10 @@ commands_reload(KeyMap *km, Arg *arg)
 DwbStatus
 commands_reload_bypass_cache(KeyMap *km, Arg *arg) 
 {
-    webkit_web_view_reload_bypass_cache(commands_get_webview_with_nummod());
+    GList *gl = commands_get_view_from_nummod();
+    /* Loading a placeholder tab is a reload */
+    if (!view_materialize(gl))
+        webkit_web_view_reload_bypass_cache(WEBVIEW(gl));
     return STATUS_OK;
 }
 /*}}}*/
@@ -333,7 +340,9 @@ commands_reload_bypass_cache(KeyMap *km, Arg *arg)
 DwbStatus
 commands_stop_loading(KeyMap *km, Arg *arg) 
 {
-    webkit_web_view_stop_loading(commands_get_webview_with_nummod());
+    GList *gl = commands_get_view_from_nummod();
+    if (!VIEW_PLACEHOLDER(VIEW(gl)))
+        webkit_web_view_stop_loading(WEBVIEW(gl));
     return STATUS_OK;
 }
 /*}}}*/
@@ -432,8 +441,8 @@ commands_focus(KeyMap *km, Arg *arg)
 {
     if (dwb.state.views->next) 
     {
-        int pos = util_modulo(g_list_position(dwb.state.views, dwb.state.fview) + NUMMOD * arg->n, g_list_length(dwb.state.views));
-        GList *g = g_list_nth(dwb.state.views, pos);
+        int pos = util_modulo(view_position(dwb.state.fview) + NUMMOD * arg->n, view_count());
+        GList *g = view_nth(pos);
         dwb_focus_view(g, km->map->n.first);
         return STATUS_OK;
     }
@@ -452,7 +461,7 @@ commands_focus_nth_view(KeyMap *km, Arg *arg)
     {
         case 0  : l = g_list_last(dwb.state.views); break;
         case -1 : l = g_list_first(dwb.state.views); break;
-        default : l = g_list_nth(dwb.state.views, dwb.state.nummod - 1); 
+        default : l = view_nth(dwb.state.nummod - 1); 
     }
 
     if (l == NULL) 
@@ -465,8 +474,10 @@ commands_focus_nth_view(KeyMap *km, Arg *arg)
 static gboolean
 match_tab(GList *gl, GRegex *regex, GPatternSpec *pattern)
 {
-    const char *title = webkit_web_view_get_title(WEBVIEW(gl));
-    const char *uri = webkit_web_view_get_uri(WEBVIEW(gl));
+    const char *title = view_get_title(gl);
+    const char *uri = view_get_uri(gl);
+    if (title == NULL || uri == NULL)
+        return false;
     if ((regex != NULL && (g_regex_match(regex, title, 0, NULL) || g_regex_match(regex, uri, 0, NULL)))
             || (pattern != NULL && (g_pattern_match_string(pattern, uri) || g_pattern_match_string(pattern, title))))
         return true;
@@ -526,12 +537,12 @@ commands_yank(KeyMap *km, Arg *arg)
 {
     const char *text = NULL;
     GdkAtom atom = GDK_POINTER_TO_ATOM(arg->p);
-    WebKitWebView *wv = commands_get_webview_with_nummod();
+    GList *gl = commands_get_view_from_nummod();
 
     if (arg->n == CA_URI) 
-        text = webkit_web_view_get_uri(wv);
+        text = view_get_uri(gl);
     else if (arg->n == CA_TITLE)
-        text = webkit_web_view_get_title(wv);
+        text = view_get_title(gl);
 
     return dwb_set_clipboard(text, atom);
 }/*}}}*/
@@ -947,7 +958,7 @@ commands_presentation_mode(KeyMap *km, Arg *arg)
 DwbStatus
 commands_toggle_lock_protect(KeyMap *km, Arg *arg) 
 {
-  GList *gl = dwb.state.nummod < 0 ? dwb.state.fview : g_list_nth(dwb.state.views, dwb.state.nummod-1);
+  GList *gl = dwb.state.nummod < 0 ? dwb.state.fview : view_nth(dwb.state.nummod-1);
   if (gl == NULL)
     return STATUS_ERROR;
 
@@ -1001,14 +1012,14 @@ DwbStatus
 commands_tab_move(KeyMap *km, Arg *arg) 
 {
     GList *sibling;
-    int newpos;
-    int l = g_list_length(dwb.state.views);
+    int newpos, oldpos;
+    int l = view_count();
     if (dwb.state.views->next == NULL) 
         return STATUS_ERROR;
     switch (arg->n) 
     {
-        case TAB_MOVE_LEFT   : newpos = MAX(MIN(l-1, g_list_position(dwb.state.views, dwb.state.fview)-NUMMOD), 0); break;
-        case TAB_MOVE_RIGHT  : newpos = MAX(MIN(l-1, g_list_position(dwb.state.views, dwb.state.fview)+NUMMOD), 0); break;
+        case TAB_MOVE_LEFT   : newpos = MAX(MIN(l-1, view_position(dwb.state.fview)-NUMMOD), 0); break;
+        case TAB_MOVE_RIGHT  : newpos = MAX(MIN(l-1, view_position(dwb.state.fview)+NUMMOD), 0); break;
         default :  newpos = MAX(MIN(l, NUMMOD)-1, 0); break;
     }
 #if _HAS_GTK3
@@ -1019,10 +1030,12 @@ commands_tab_move(KeyMap *km, Arg *arg)
     gtk_box_reorder_child(GTK_BOX(dwb.gui.mainbox), CURRENT_VIEW()->scroll, newpos);
 #endif
 
-    dwb.state.views = g_list_remove_link(dwb.state.views, dwb.state.fview);
+    /* the tab that will follow the moved tab, looked up before the tab is
+     * unlinked */
+    oldpos = view_position(dwb.state.fview);
+    sibling = view_nth(newpos < oldpos ? newpos : newpos + 1);
 
-    sibling = g_list_nth(dwb.state.views, newpos);
-    g_list_position(dwb.state.fview, sibling);
+    dwb.state.views = g_list_remove_link(dwb.state.views, dwb.state.fview);
 
     if (sibling == NULL) 
     {
@@ -1042,6 +1055,7 @@ commands_tab_move(KeyMap *km, Arg *arg)
         sibling->prev = dwb.state.fview;
         dwb.state.fview->next = sibling;
     }
+    view_index_update(MIN(oldpos, newpos));
     dwb_focus(dwb.state.fview);
     dwb_update_layout();
     return STATUS_OK;
@@ -1091,10 +1105,7 @@ commands_sanitize(KeyMap *km, Arg *arg)
     if (s & (SANITIZE_HISTORY | SANITIZE_CACHE)) 
     {
         for (GList *gl = dwb.state.views; gl; gl=gl->next) 
-        {
-            WebKitWebBackForwardList *bf_list = webkit_web_view_get_back_forward_list(WEBVIEW(gl));
-            webkit_web_back_forward_list_clear(bf_list);
-        }
+            view_clear_history(gl);
     }
     if (s & SANITIZE_COOKIES) 
         remove(dwb.files[FILES_COOKIES]);
@@ -1137,7 +1148,7 @@ commands_download(KeyMap *km, Arg *arg)
 DwbStatus 
 commands_toggle_tab(KeyMap *km, Arg *arg) 
 {
-    GList *last = g_list_nth(dwb.state.views, dwb.state.last_tab);
+    GList *last = view_nth(dwb.state.last_tab);
     if (last) 
     {
         dwb_focus_view(last, km->map->n.first);
@@ -23,6 +23,7 @@
 #include "commands.h"
 #include "util.h"
 #include "entry.h"
+#include "view.h"
 #include "completion.h"
 
 static GList * completion_update_completion(GtkWidget *box, GList *comps, GList *active, int max, int back);
@@ -519,11 +520,11 @@ completion_buffer_key_press(GdkEventKey *e)
         completion_complete(COMP_BUFFER, e->state & GDK_SHIFT_MASK);
     else if (DIGIT(e)) {
         int value = e->keyval - GDK_KEY_0;
-        int length = g_list_length(dwb.state.views);
+        int length = view_count();
         if (length < 10) 
         {
             if (value != 0 && value <= length) 
-                completion_buffer_exec(g_list_nth(dwb.state.views, value-1));
+                completion_buffer_exec(view_nth(value-1));
         }
         else 
         {
@@ -535,7 +536,7 @@ completion_buffer_key_press(GdkEventKey *e)
             }
             if (s_last_buf != 0) {
                 if ((s_last_buf < 10 && s_leading0 == true) || s_last_buf >= 10) 
-                    completion_buffer_exec(g_list_nth(dwb.state.views, s_last_buf-1));
+                    completion_buffer_exec(view_nth(s_last_buf-1));
             }
             else 
                 s_leading0 = true;
@@ -561,12 +562,12 @@ completion_complete_buffer()
     Completion *c; 
     WebKitWebView *wv;
 
-    format = g_list_length(dwb.state.views) > 10 ? "%02d : %s" : "%d : %s";
+    format = view_count() > 10 ? "%02d : %s" : "%d : %s";
     for (GList *l = dwb.state.views;l; l=l->next) 
     {
-        if (VIEW(l)->status->deferred) 
+        if (VIEW(l)->status->deferred || VIEW_PLACEHOLDER(VIEW(l))) 
         {
-            text = g_strdup_printf(format, i, VIEW(l)->status->deferred_uri);
+            text = g_strdup_printf(format, i, view_get_title(l));
             uri = "deferred";
         }
         else 
@@ -1161,6 +1161,20 @@ static WebSettings DWB_SETTINGS[] = {
     SETTING_GLOBAL,  CHAR, { .p = NULL   },     NULL,  { 0 }, },
   { { "download-use-external-program",           "Whether to use an external download program", },                           
     SETTING_GLOBAL,  BOOLEAN, { .b = false         },    NULL,  { 0 }, },
+  { { "download-segments",                        "Maximum number of parallel connections per download", },                           
+    SETTING_GLOBAL,  INTEGER, { .i = 4             },    NULL,  { 0 }, },
+  { { "download-max-active",                        "Maximum number of downloads that run at the same time", },                           
+    SETTING_GLOBAL,  INTEGER, { .i = 3             },    NULL,  { 0 }, },
+  { { "download-max-per-host",                        "Maximum number of downloads from the same host that run at the same time", },                           
+    SETTING_GLOBAL,  INTEGER, { .i = 2             },    NULL,  { 0 }, },
+  { { "download-checksums",                        "Checksums that are computed for downloads", },                           
+    SETTING_GLOBAL,  CHAR, { .p = "sha256"      },    NULL,  { 0 }, },
+  { { "download-decompress",                        "Whether to decompress downloaded gzip files", },                           
+    SETTING_GLOBAL,  BOOLEAN, { .b = false         },    NULL,  { 0 }, },
+  { { "download-move-directory",                        "Directory finished downloads are moved to", },                           
+    SETTING_GLOBAL,  CHAR, { .p = NULL   },     NULL,  { 0 }, },
+  { { "download-bandwidth-limit",                        "Bandwidth limit for all downloads in KiB/s", },                           
+    SETTING_GLOBAL | SETTING_ONINIT,  INTEGER, { .i = 0             },    (S_Func) dwb_set_download_bandwidth_limit,  { 0 }, },
 
   { { "complete-history",                        "Whether to complete browsing history with tab", },                              
     SETTING_GLOBAL,  BOOLEAN, { .b = true         },     NULL,  { 0 }, },
@@ -1225,6 +1239,14 @@ static WebSettings DWB_SETTINGS[] = {
     SETTING_GLOBAL,  INTEGER, { .i = 250 }, NULL,   { 0 }, }, 
   { { "load-on-focus",                            "Load uris at the earliest when a tab gets focus", },                                            
     SETTING_GLOBAL,  BOOLEAN, { .b = false }, NULL,   { 0 }, }, 
+  { { "session-prefetch-tabs",                            "Number of restored tabs that are loaded concurrently in the background", },                                            
+    SETTING_GLOBAL,  INTEGER, { .i = 2 }, NULL,   { 0 }, }, 
+  { { "hibernate-timeout",                            "Seconds after which an unfocused tab is unloaded, 0 disables", },                                            
+    SETTING_GLOBAL | SETTING_ONINIT,  INTEGER, { .i = 0 }, (S_Func)dwb_set_hibernate_timeout,   { 0 }, }, 
+  { { "hibernate-max-tabs",                            "Maximum number of loaded tabs before idle tabs are unloaded, 0 disables", },                                            
+    SETTING_GLOBAL | SETTING_ONINIT,  INTEGER, { .i = 0 }, (S_Func)dwb_set_hibernate_max_tabs,   { 0 }, }, 
+  { { "hibernate-memory-limit",                            "Memory usage in MB above which idle tabs are unloaded, 0 disables", },                                            
+    SETTING_GLOBAL | SETTING_ONINIT,  INTEGER, { .i = 0 }, (S_Func)dwb_set_hibernate_memory_limit,   { 0 }, }, 
   { { "print-previewer",                            "Command used for the printing preview", },                                            
     SETTING_GLOBAL,  CHAR, { .p = NULL }, NULL,   { 0 }, }, 
   { { "accept-language",                            "If set will be used for 'Accept-Language' header in all requests", },                                            
@@ -23,19 +23,36 @@
 #include "soup.h"
 #include "scripts.h"
 #include "ipc.h"
+#include "transfer.h"
+#include "pipeline.h"
 
+typedef struct _DwbDownloadStatus DwbDownloadStatus;
 typedef struct _DwbDownload {
     GtkWidget *event;
     GtkWidget *rlabel;
     GtkWidget *llabel;
     WebKitDownload *download;
+    /* Set if the download is handled by the transfer engine, download is only
+     * used as a handle for scripts then */
+    Transfer *transfer;
     DownloadAction action;
     char *path;
     guint n;
     guint sig_button;
     char *mimetype;
+    /* Host used for the per-host limit, NULL for non-network downloads */
+    char *host;
+    int priority;
+    /* Queued downloads with the same priority are started in this order */
+    guint sequence;
+    gboolean running;
+    DwbDownloadStatus *status;
+    /* Set while and after the download is post processed */
+    Pipeline *pipeline;
+    /* Destination uri after post processing */
+    char *destination;
 } DwbDownload;
-typedef struct _DwbDownloadStatus {
+struct _DwbDownloadStatus {
 #if _HAS_GTK3 
     gdouble blue, red, green, alpha;
 #else
@@ -43,15 +60,39 @@ typedef struct _DwbDownloadStatus {
 #endif
     gint64 time;
     gint64 speedtime;
-    gdouble  progress;
+    /* Size at speedtime */
+    goffset speedsize;
+    /* Smoothed rate in bytes per second */
+    double speed;
+    guint remaining;
     DwbDownload *download;
-} DwbDownloadStatus;
+};
 
 #define DWB_DOWNLOAD(X) ((DwbDownload*)((X)->data))
 
 static GList *s_downloads = NULL;
 static char *s_lastdir = NULL;
 static DownloadAction s_lastaction;
+/* Downloads waiting for a free slot, sorted by priority */
+static GList *s_queue = NULL;
+static guint s_queue_sequence = 0;
+static guint s_schedule_source = 0;
+static int s_active = 0;
+
+static const struct {
+    const char *name;
+    GChecksumType type;
+} s_checksum_types[] = {
+    { "md5",    G_CHECKSUM_MD5 },
+    { "sha1",   G_CHECKSUM_SHA1 },
+    { "sha256", G_CHECKSUM_SHA256 },
+#if GLIB_CHECK_VERSION(2, 36, 0)
+    { "sha512", G_CHECKSUM_SHA512 },
+#endif
+};
+
+static void download_schedule(void);
+static void download_status_changed(WebKitDownload *download, WebKitDownloadStatus status, DwbDownloadStatus *dstatus);
 
 /*  dwb_get_command_from_mimetype(char *mimetype){{{*/
 static char *
@@ -158,31 +199,36 @@ download_get_download_label(WebKitDownload *download)
     return NULL;
 }/*}}}*/
 
-/* download_progress_cb(WebKitDownload *) {{{*/
+/* download_update_progress {{{*/
 static void
-download_progress_cb(WebKitDownload *download, GParamSpec *p, DwbDownloadStatus *status) 
+download_update_progress(DwbDownloadStatus *status, double progress, goffset current, goffset total) 
 {
     /* Update at most four times a second */
     gint64 time = g_get_monotonic_time();
-    static double speed = 0;
-    static guint remaining = 0;
     if (time - status->time > 250000) 
     {
-        GList *l = download_get_download_label(download); 
-        DwbDownload *label = l->data;
-        double elapsed = webkit_download_get_elapsed_time(download);
-        double progress = webkit_download_get_progress(download);
-        double total_size = (double)webkit_download_get_total_size(download) / 0x100000;
+        DwbDownload *label = status->download;
+        double total_size = (double)MAX(total, 0) / 0x100000;
 
-        if (time - status->speedtime > 1000000) 
+        if (status->speedtime == 0) 
         {
-            speed = ((progress - status->progress)*total_size) * 1000000 / (time - status->speedtime);
+            /* Resumed downloads don't start at 0 */
             status->speedtime = time;
-            status->progress = progress;
-            remaining = (guint)(elapsed / progress - elapsed);
+            status->speedsize = current;
+        }
+        else if (time - status->speedtime > 1000000) 
+        {
+            /* Exponential moving average of the rate of this download */
+            double rate = (double)(current - status->speedsize) * 1000000 / (time - status->speedtime);
+            status->speed = status->speed == 0 ? rate : 0.3 * rate + 0.7 * status->speed;
+            status->speedtime = time;
+            status->speedsize = current;
+            status->remaining = total > 0 && status->speed > 0 ? (guint)((total - current) / status->speed) : 0;
         }
 
-        double current_size = (double)webkit_download_get_current_size(download) / 0x100000;
+        double speed = status->speed / 0x100000;
+        guint remaining = status->remaining;
+        double current_size = (double)current / 0x100000;
         char buffer[128] = {0};
         const char *format = speed > 1 ? "[%.1fM/s|%d:%02d|%2d%%|%.3f/%.3f]" : "[%3.1fK/s|%d:%02d|%2d%%|%.3f/%.3f]";
         snprintf(buffer, sizeof(buffer), format, speed > 1 ? speed : speed*1024, remaining/60, remaining%60,  (int)(progress*100), current_size,  total_size);
@@ -223,12 +269,37 @@ download_progress_cb(WebKitDownload *download, GParamSpec *p, DwbDownloadStatus
     }
 }/*}}}*/
 
+/* download_progress_cb(WebKitDownload *) {{{*/
+static void
+download_progress_cb(WebKitDownload *download, GParamSpec *p, DwbDownloadStatus *status) 
+{
+    download_update_progress(status, webkit_download_get_progress(download), 
+            webkit_download_get_current_size(download), webkit_download_get_total_size(download));
+}/*}}}*/
+
+/* download_transfer_progress_cb {{{*/
+static void
+download_transfer_progress_cb(Transfer *transfer, DwbDownloadStatus *status) 
+{
+    download_update_progress(status, transfer_get_progress(transfer), 
+            transfer_get_current_size(transfer), transfer_get_total_size(transfer));
+}/*}}}*/
+
 static void 
 download_finished(DwbDownload *d) 
 {
     char buffer[64];
-    double elapsed = webkit_download_get_elapsed_time(d->download);
-    double total_size = (double)webkit_download_get_total_size(d->download);
+    double elapsed, total_size;
+    if (d->transfer != NULL) 
+    {
+        elapsed = transfer_get_elapsed_time(d->transfer);
+        total_size = (double)transfer_get_total_size(d->transfer);
+    }
+    else 
+    {
+        elapsed = webkit_download_get_elapsed_time(d->download);
+        total_size = (double)webkit_download_get_total_size(d->download);
+    }
     snprintf(buffer, sizeof(buffer), "[%.2f KB/s|%.3f MB]", (total_size / (elapsed*0x400)), total_size / 0x100000);
     gtk_label_set_text(GTK_LABEL(d->rlabel), buffer);
 }
@@ -275,20 +346,33 @@ download_do_spawn(const char *command, const char *path, const char *mimetype)
     }
     g_strfreev(argv);
 }/*}}}*/
+/* download_get_destination {{{*/
+static const char *
+download_get_destination(DwbDownload *d) 
+{
+    return d->destination != NULL ? d->destination : webkit_download_get_destination_uri(d->download);
+}/*}}}*/
+
 /* download_spawn(DwbDownload *) {{{*/
 static void 
 download_spawn(DwbDownload *dl) 
 {
-    const char *filename = webkit_download_get_destination_uri(dl->download);
+    const char *filename = download_get_destination(dl);
     download_do_spawn(dl->path, filename, dl->mimetype);
 }/*}}}*/
 
 gboolean
 download_delay(DwbDownload *download) 
 {
+    if (download->transfer != NULL)
+        transfer_unref(download->transfer);
+    if (download->pipeline != NULL)
+        pipeline_free(download->pipeline);
+    g_free(download->destination);
     gtk_widget_destroy(download->event);
     g_free(download->path);
     g_free(download->mimetype);
+    g_free(download->host);
     g_free(download);
     if (!s_downloads) 
         gtk_widget_hide(dwb.gui.downloadbar);
@@ -296,11 +380,77 @@ download_delay(DwbDownload *download)
     return false;
 }
 
-/* download_status_cb(WebKitDownload *) {{{*/
-static void
-download_status_cb(WebKitDownload *download, GParamSpec *p, DwbDownloadStatus *dstatus) 
+/* CHECKSUMS {{{*/
+/* download_checksum_enabled {{{*/
+static gboolean
+download_checksum_enabled(int i) 
+{
+    gboolean ret = false;
+    char *types = GET_CHAR("download-checksums");
+    if (types == NULL)
+        return false;
+
+    char **token = g_strsplit_set(types, " ,", -1);
+    for (int j=0; token[j] != NULL && !ret; j++) 
+        ret = !g_ascii_strcasecmp(token[j], s_checksum_types[i].name);
+    g_strfreev(token);
+    return ret;
+}/*}}}*/
+
+/* download_checksums_json {{{*/
+static char *
+download_checksums_json(DwbDownload *d) 
+{
+    GString *buffer = NULL;
+    const char *digest;
+    for (guint i=0; i<G_N_ELEMENTS(s_checksum_types); i++) 
+    {
+        digest = d->pipeline != NULL ? pipeline_get_checksum(d->pipeline, s_checksum_types[i].type) : NULL;
+        if (digest == NULL) 
+            continue;
+
+        if (buffer == NULL) 
+            buffer = g_string_new("{");
+        else 
+            g_string_append_c(buffer, ',');
+        g_string_append_printf(buffer, "\"%s\":\"%s\"", s_checksum_types[i].name, digest);
+    }
+    if (buffer == NULL) 
+        return NULL;
+    g_string_append_c(buffer, '}');
+    return g_string_free(buffer, false);
+}/*}}}*//*}}}*/
+
+/* download_status_json {{{*/
+static char *
+download_status_json(WebKitDownload *download, const char *status, DwbDownloadStatus *dstatus)
+{
+    DwbDownload *d = dstatus->download;
+    Transfer *transfer = d->transfer;
+    gboolean webkit = transfer == NULL;
+    char *checksums = download_checksums_json(d);
+    char *ret = util_create_json(13, 
+            CHAR, "status", status, 
+            DOUBLE, "currentSize", (double)(webkit ? webkit_download_get_current_size(download) : transfer_get_current_size(transfer)), 
+            DOUBLE, "totalSize", (double)(webkit ? webkit_download_get_total_size(download) : transfer_get_total_size(transfer)), 
+            INTEGER, "segments", webkit ? 1 : transfer_get_segments(transfer), 
+            BOOLEAN, "resumed", webkit ? false : transfer_get_resumed(transfer), 
+            DOUBLE, "speed", dstatus->speed, 
+            UINTEGER, "remaining", dstatus->remaining, 
+            INTEGER, "priority", d->priority, 
+            INTEGER, "queuePosition", g_list_index(s_queue, d), 
+            INTEGER, "activeDownloads", s_active, 
+            INTEGER, "queuedDownloads", g_list_length(s_queue), 
+            CHAR, "destinationUri", download_get_destination(d), 
+            OBJECT, "checksums", checksums);
+    g_free(checksums);
+    return ret;
+}/*}}}*/
+
+/* download_emit_status {{{*/
+static gboolean
+download_emit_status(WebKitDownload *download, const char *status, DwbDownloadStatus *dstatus) 
 {
-    WebKitDownloadStatus status = webkit_download_get_status(download);
     gboolean script_handled = false;
     if (EMIT_SCRIPT(DOWNLOAD_STATUS)) 
     {
@@ -316,15 +466,156 @@ download_status_cb(WebKitDownload *download, GParamSpec *p, DwbDownloadStatus *d
          * Callback called when the download status changes
          * @callback signals~onDownloadStatus
          *
-         * @param {WebKitDownload} download   The download
+         * @param {WebKitDownload} download   
+         *      The download, downloads that are handled by dwb's own download
+         *      engine are never started by webkit, so the status and the size
+         *      must be taken from data
+         * @param {Object} data
+         * @param {String} data.status 
+         *      The status, one of <i>queued</i>, <i>created</i>,
+         *      <i>started</i>, <i>processing</i>, <i>finished</i>,
+         *      <i>cancelled</i> or <i>error</i>, since 1.14, downloads are
+         *      <i>processing</i> while they are hashed, decompressed or moved
+         *      after the data has arrived
+         * @param {Number} data.currentSize The current size in bytes, since 1.14
+         * @param {Number} data.totalSize 
+         *      The total size in bytes or -1 if it isn't known yet, since 1.14
+         * @param {Number} data.segments 
+         *      The number of segments that are downloaded in parallel, since 1.14
+         * @param {Boolean} data.resumed 
+         *      Whether an interrupted download was resumed, since 1.14
+         * @param {Number} data.speed 
+         *      The current rate of the download in bytes per second, since 1.14
+         * @param {Number} data.remaining 
+         *      The estimated remaining time in seconds or 0 if it isn't known,
+         *      since 1.14
+         * @param {Number} data.priority 
+         *      The priority of the download, see 
+         *      {@link WebKitDownload#priority|priority}, since 1.14
+         * @param {Number} data.queuePosition 
+         *      The position in the download queue or -1 if the download isn't
+         *      queued, since 1.14
+         * @param {Number} data.activeDownloads 
+         *      The number of running downloads, since 1.14
+         * @param {Number} data.queuedDownloads 
+         *      The number of downloads waiting for a free slot, see also
+         *      <i>download-max-active</i> and <i>download-max-per-host</i>,
+         *      since 1.14
+         * @param {String} data.destinationUri 
+         *      The destination uri, it changes if the file is decompressed or
+         *      moved, see <i>download-decompress</i> and
+         *      <i>download-move-directory</i>, since 1.14
+         * @param {Object} data.checksums 
+         *      The hex digests of the file, e.g. <i>data.checksums.sha256</i>,
+         *      or null if they aren't known yet, the digests are computed
+         *      for the types in <i>download-checksums</i> before the file is
+         *      decompressed, since 1.14
          *
          * @returns {Boolean} 
          *      Return true to stop dwb from handling the download when the
          *      download has finished
          * */
-        ScriptSignal signal = { .jsobj = NULL, { G_OBJECT(download) }, SCRIPTS_SIG_META(NULL, DOWNLOAD_STATUS, 1) };
+        char *json = download_status_json(download, status, dstatus);
+        ScriptSignal signal = { .jsobj = NULL, .objects = { G_OBJECT(download) }, SCRIPTS_SIG_META(json, DOWNLOAD_STATUS, 1) };
         script_handled = scripts_emit(&signal);
+        g_free(json);
+    }
+    return script_handled;
+}/*}}}*/
+
+/* POST PROCESSING {{{*/
+/* download_pipeline_finished_cb {{{*/
+static void
+download_pipeline_finished_cb(Pipeline *p, DwbDownloadStatus *dstatus) 
+{
+    DwbDownload *d = dstatus->download;
+    const char *error = pipeline_get_error(p);
+    if (error != NULL) 
+        fprintf(stderr, "Post processing of %s failed: %s\n", pipeline_get_path(p), error);
+    else if (pipeline_get_warning(p) != NULL) 
+        fprintf(stderr, "Post processing of %s: %s\n", pipeline_get_path(p), pipeline_get_warning(p));
+
+    d->destination = g_filename_to_uri(pipeline_get_path(p), NULL, NULL);
+    download_status_changed(d->download, error == NULL ? WEBKIT_DOWNLOAD_STATUS_FINISHED : WEBKIT_DOWNLOAD_STATUS_ERROR, dstatus);
+}/*}}}*/
+
+/* download_post_process {{{*/
+/* Runs the post processing stages on a separate thread, returns false if there
+ * is nothing to do. Downloads handled by the transfer engine are hashed while
+ * the data arrives, the thread only hashes what was written ahead. */
+static gboolean
+download_post_process(DwbDownload *d, DwbDownloadStatus *dstatus) 
+{
+    char buffer[PATH_MAX];
+    char *path = g_filename_from_uri(webkit_download_get_destination_uri(d->download), NULL, NULL);
+    if (path == NULL) 
+        return false;
+
+    Pipeline *p = pipeline_new(path);
+    g_free(path);
+    /* The partial checksums can only be used if the transfer has all of
+     * them, download-checksums may have changed in between */
+    gboolean partial = d->transfer != NULL;
+    for (guint i=0; i<G_N_ELEMENTS(s_checksum_types) && partial; i++) 
+    {
+        if (download_checksum_enabled(i) && transfer_get_checksum(d->transfer, s_checksum_types[i].type) == NULL) 
+            partial = false;
+    }
+    for (guint i=0; i<G_N_ELEMENTS(s_checksum_types); i++) 
+    {
+        if (!download_checksum_enabled(i)) 
+            continue;
+        if (partial) 
+            pipeline_continue_checksum(p, s_checksum_types[i].type, 
+                    g_checksum_copy(transfer_get_checksum(d->transfer, s_checksum_types[i].type)), transfer_get_hashed_size(d->transfer));
+        else 
+            pipeline_add_checksum(p, s_checksum_types[i].type);
+    }
+    /* Files that are opened with an application are left where they are */
+    if (d->action != DL_ACTION_EXECUTE) 
+    {
+        char *directory = GET_CHAR("download-move-directory");
+        pipeline_set_decompress(p, GET_BOOL("download-decompress"));
+        if (directory != NULL && *directory != '\0') 
+            pipeline_set_move_directory(p, util_expand_home(buffer, directory, sizeof(buffer)));
+    }
+    if (pipeline_is_empty(p)) 
+    {
+        pipeline_free(p);
+        return false;
     }
+    d->pipeline = p;
+    gtk_label_set_text(GTK_LABEL(d->rlabel), "[processing]");
+    download_emit_status(d->download, "processing", dstatus);
+    pipeline_run(p, (PipelineFunc)download_pipeline_finished_cb, dstatus);
+    return true;
+}/*}}}*//*}}}*/
+
+/* download_status_changed {{{*/
+static void
+download_status_changed(WebKitDownload *download, WebKitDownloadStatus status, DwbDownloadStatus *dstatus) 
+{
+    static const char *status_names[] = { "created", "started", "cancelled", "finished" };
+    DwbDownload *d = dstatus->download;
+    if (status == WEBKIT_DOWNLOAD_STATUS_FINISHED || status == WEBKIT_DOWNLOAD_STATUS_CANCELLED || status == WEBKIT_DOWNLOAD_STATUS_ERROR) 
+    {
+        if (d->running) 
+        {
+            d->running = false;
+            s_active--;
+            download_schedule();
+        }
+        else 
+        {
+            s_queue = g_list_remove(s_queue, d);
+        }
+        /* The download is finished after post processing */
+        if (status == WEBKIT_DOWNLOAD_STATUS_FINISHED && d->pipeline == NULL && download_post_process(d, dstatus)) 
+            return;
+    }
+    gboolean script_handled = download_emit_status(download, 
+            status == WEBKIT_DOWNLOAD_STATUS_ERROR ? "error" : status_names[status], dstatus);
+
     if (status == WEBKIT_DOWNLOAD_STATUS_FINISHED || status == WEBKIT_DOWNLOAD_STATUS_CANCELLED || status == WEBKIT_DOWNLOAD_STATUS_ERROR) 
     {
         GList *list = download_get_download_label(download);
@@ -339,7 +630,7 @@ download_status_cb(WebKitDownload *download, GParamSpec *p, DwbDownloadStatus *d
             switch (status) 
             {
                 case WEBKIT_DOWNLOAD_STATUS_FINISHED: 
-                    IPC_SEND_HOOK(download_finished, "%s", webkit_download_get_destination_uri(download));
+                    IPC_SEND_HOOK(download_finished, "%s", download_get_destination(label));
                     download_finished(label);
                     break;
                 case WEBKIT_DOWNLOAD_STATUS_CANCELLED: 
@@ -351,7 +642,7 @@ download_status_cb(WebKitDownload *download, GParamSpec *p, DwbDownloadStatus *d
                 default: 
                     break;
             }
-            Navigation *n = dwb_navigation_new(webkit_download_get_uri(download), webkit_download_get_destination_uri(download));
+            Navigation *n = dwb_navigation_new(webkit_download_get_uri(download), download_get_destination(label));
             dwb.fc.downloads = g_list_append(dwb.fc.downloads, n);
             g_signal_handler_disconnect(label->event, label->sig_button);
             label->download = NULL;
@@ -363,17 +654,212 @@ download_status_cb(WebKitDownload *download, GParamSpec *p, DwbDownloadStatus *d
             g_free(dwb.state.mimetype_request);
             dwb.state.mimetype_request = NULL;
         }
+        d->status = NULL;
         g_free(dstatus);
         dwb.state.download_ref_count--;
     }
 }/*}}}*/
 
+/* download_status_cb(WebKitDownload *) {{{*/
+static void
+download_status_cb(WebKitDownload *download, GParamSpec *p, DwbDownloadStatus *dstatus) 
+{
+    download_status_changed(download, webkit_download_get_status(download), dstatus);
+}/*}}}*/
+
+/* download_transfer_status_cb {{{*/
+static void
+download_transfer_status_cb(Transfer *transfer, DwbDownloadStatus *dstatus) 
+{
+    WebKitDownloadStatus status = WEBKIT_DOWNLOAD_STATUS_CREATED;
+    switch (transfer_get_status(transfer)) 
+    {
+        case TRANSFER_STARTED:   status = WEBKIT_DOWNLOAD_STATUS_STARTED; break;
+        case TRANSFER_FINISHED:  status = WEBKIT_DOWNLOAD_STATUS_FINISHED; break;
+        case TRANSFER_CANCELLED: status = WEBKIT_DOWNLOAD_STATUS_CANCELLED; break;
+        case TRANSFER_ERROR:     status = WEBKIT_DOWNLOAD_STATUS_ERROR; break;
+        default: break;
+    }
+    download_status_changed(dstatus->download->download, status, dstatus);
+}/*}}}*/
+
+/* SCHEDULER {{{*/
+/* download_run {{{*/
+static void
+download_run(DwbDownload *d) 
+{
+    DwbDownloadStatus *s = d->status;
+
+    d->running = true;
+    s_active++;
+    if (d->transfer != NULL) 
+        transfer_start(d->transfer);
+    else 
+    {
+        g_signal_connect(d->download, "notify::current-size", G_CALLBACK(download_progress_cb), s);
+        g_signal_connect(d->download, "notify::status", G_CALLBACK(download_status_cb), s);
+        webkit_download_start(d->download);
+    }
+}/*}}}*/
+
+/* download_can_run {{{*/
+static gboolean
+download_can_run(DwbDownload *d) 
+{
+    int max_active = GET_INT("download-max-active");
+    int max_host = GET_INT("download-max-per-host");
+    int n = 0;
+
+    if (max_active > 0 && s_active >= max_active) 
+        return false;
+    if (max_host <= 0 || d->host == NULL) 
+        return true;
+
+    for (GList *l = s_downloads; l; l=l->next) 
+    {
+        if (DWB_DOWNLOAD(l)->running && !g_strcmp0(DWB_DOWNLOAD(l)->host, d->host)) 
+            n++;
+    }
+    return n < max_host;
+}/*}}}*/
+
+/* download_queue_compare {{{*/
+static int
+download_queue_compare(DwbDownload *a, DwbDownload *b) 
+{
+    if (a->priority != b->priority) 
+        return b->priority - a->priority;
+    return a->sequence < b->sequence ? -1 : 1;
+}/*}}}*/
+
+/* download_schedule_cb {{{*/
+/* Starts queued downloads in order as long as there are free slots, downloads
+ * from hosts that have reached their limit are skipped */
+static gboolean
+download_schedule_cb(gpointer unused) 
+{
+    s_schedule_source = 0;
+    for (GList *l = s_queue; l; ) 
+    {
+        DwbDownload *d = l->data;
+        if (download_can_run(d)) 
+        {
+            /* Starting a download may emit signals that change the queue */
+            s_queue = g_list_delete_link(s_queue, l);
+            download_run(d);
+            l = s_queue;
+        }
+        else 
+            l = l->next;
+    }
+    return false;
+}/*}}}*/
+
+/* download_schedule {{{*/
+static void
+download_schedule() 
+{
+    if (s_queue != NULL && s_schedule_source == 0) 
+        s_schedule_source = g_idle_add(download_schedule_cb, NULL);
+}/*}}}*/
+
+/* download_enqueue {{{*/
+static void
+download_enqueue(DwbDownload *d) 
+{
+    if (s_queue == NULL && download_can_run(d)) 
+    {
+        download_run(d);
+        return;
+    }
+    d->sequence = s_queue_sequence++;
+    s_queue = g_list_insert_sorted(s_queue, d, (GCompareFunc)download_queue_compare);
+    gtk_label_set_text(GTK_LABEL(d->rlabel), "[queued]");
+    download_emit_status(d->download, "queued", d->status);
+    download_schedule();
+}/*}}}*/
+
+/* download_find {{{*/
+static DwbDownload *
+download_find(WebKitDownload *download) 
+{
+    GList *l = download_get_download_label(download);
+    return l != NULL ? l->data : NULL;
+}/*}}}*/
+
+/* download_get_priority {{{*/
+int
+download_get_priority(WebKitDownload *download) 
+{
+    return GPOINTER_TO_INT(g_object_get_data(G_OBJECT(download), "dwb-download-priority"));
+}/*}}}*/
+
+/* download_set_priority {{{*/
+/* The priority is also stored on the download so that it can be set before
+ * dwb handles the download, e.g. in the downloadStart signal, it only has an
+ * effect on queued downloads */
+gboolean
+download_set_priority(WebKitDownload *download, int priority) 
+{
+    g_object_set_data(G_OBJECT(download), "dwb-download-priority", GINT_TO_POINTER(priority));
+
+    DwbDownload *d = download_find(download);
+    if (d == NULL) 
+        return true;
+
+    d->priority = priority;
+    if (g_list_find(s_queue, d) != NULL) 
+    {
+        s_queue = g_list_remove(s_queue, d);
+        s_queue = g_list_insert_sorted(s_queue, d, (GCompareFunc)download_queue_compare);
+    }
+    return true;
+}/*}}}*/
+
+/* download_set_bandwidth_limit {{{*/
+void
+download_set_bandwidth_limit(int limit) 
+{
+    transfer_set_bandwidth_limit(MAX(limit, 0) * 1024);
+}/*}}}*//*}}}*/
+
+/* download_do_cancel {{{*/
+static void
+download_do_cancel(DwbDownload *d) 
+{
+    /* Post processing can't be interrupted */
+    if (d->pipeline != NULL) 
+        return;
+    /* Queued downloads were never started and hold no connection, the
+     * connection of the requested download has been closed in download_start.
+     * A partial file of an earlier session must not be removed */
+    if (!d->running) 
+        download_status_changed(d->download, WEBKIT_DOWNLOAD_STATUS_CANCELLED, d->status);
+    else if (d->transfer != NULL)
+        transfer_cancel(d->transfer);
+    else 
+        webkit_download_cancel(d->download);
+}/*}}}*/
+
+/* download_cancel_download {{{*/
+/* Cancels a download that is handled by dwb, returns false if the download
+ * isn't handled by dwb */
+gboolean
+download_cancel_download(WebKitDownload *download) 
+{
+    DwbDownload *d = download_find(download);
+    if (d == NULL) 
+        return false;
+    download_do_cancel(d);
+    return true;
+}/*}}}*/
+
 /* download_button_press_cb(GtkWidget *w, GdkEventButton *e, GList *) {{{*/
 static gboolean 
 download_button_press_cb(GtkWidget *w, GdkEventButton *e, GList *gl) 
 {
   if (e->button == 3 && DWB_DOWNLOAD(gl)->download != NULL) 
-      webkit_download_cancel(DWB_DOWNLOAD(gl)->download);
+      download_do_cancel(DWB_DOWNLOAD(gl));
   
   return false;
 }/*}}}*/
@@ -386,14 +872,14 @@ download_cancel(int number)
 
     if (number <= 0) 
     {
-        webkit_download_cancel(DWB_DOWNLOAD(s_downloads)->download);
+        download_do_cancel(DWB_DOWNLOAD(s_downloads));
         return STATUS_OK;
     }
     for (GList *l = s_downloads; l; l=l->next) 
     {
         if ((gint)DWB_DOWNLOAD(l)->n == number) 
         {
-            webkit_download_cancel(DWB_DOWNLOAD(l)->download);
+            download_do_cancel(DWB_DOWNLOAD(l));
             return STATUS_OK;
         }
     }
@@ -404,7 +890,7 @@ download_cancel(int number)
 static DwbDownload *
 download_add_progress_label(GList *gl, const char *filename, gint length) 
 {
-    DwbDownload *l = g_malloc(sizeof(DwbDownload));
+    DwbDownload *l = g_malloc0(sizeof(DwbDownload));
 
 #if _HAS_GTK3
     GtkWidget *hbox = gtk_box_new(GTK_ORIENTATION_HORIZONTAL, 3);
@@ -447,6 +933,18 @@ download_add_progress_label(GList *gl, const char *filename, gint length)
     return l;
 }/*}}}*/
 
+/* download_release_origin {{{*/
+/* The download that was passed to the download-requested signal keeps the
+ * connection of the response open and deferred. dwb refetches the uri with its
+ * own download or with the transfer engine, so the connection is closed,
+ * otherwise it would hold a connection of the host until dwb exits */
+static void
+download_release_origin(WebKitDownload *origin) 
+{
+    if (origin != NULL && webkit_download_get_status(origin) == WEBKIT_DOWNLOAD_STATUS_CREATED) 
+        webkit_download_cancel(origin);
+}/*}}}*/
+
 /* download_start {{{*/
 void 
 download_start(const char *path) 
@@ -462,6 +960,7 @@ download_start(const char *path)
     const char *uri = webkit_download_get_uri(dwb.state.download);
 
     /* FIXME seems to be a bug in webkit ? */
+    WebKitDownload *origin = dwb.state.download;
     WebKitNetworkRequest *request = webkit_download_get_network_request(dwb.state.download);
     dwb.state.download = webkit_download_new(request);
 
@@ -616,22 +1115,44 @@ download_start(const char *path)
             active->path = g_strdup(path);
             active->n = n;
             active->mimetype = dwb.state.mimetype_request != NULL ? g_strdup(dwb.state.mimetype_request) : NULL;
+            active->priority = download_get_priority(dwb.state.download);
 
             gtk_widget_show_all(dwb.gui.downloadbar);
             s_downloads = g_list_prepend(s_downloads, active);
 
-            DwbDownloadStatus *s = dwb_malloc(sizeof(DwbDownloadStatus));
-            s->blue = s->time = 0;
+            DwbDownloadStatus *s = g_malloc0(sizeof(DwbDownloadStatus));
             s->download = active;
-            s->progress = 0;
-            s->speedtime = g_get_monotonic_time();
+            active->status = s;
 
             active->sig_button = g_signal_connect(active->event, "button-press-event", G_CALLBACK(download_button_press_cb), s_downloads);
-            g_signal_connect(dwb.state.download, "notify::current-size", G_CALLBACK(download_progress_cb), s);
-            g_signal_connect(dwb.state.download, "notify::status", G_CALLBACK(download_status_cb), s);
-
-            webkit_download_start(dwb.state.download);
             dwb.state.download_ref_count++;
+
+            int segments = GET_INT("download-segments");
+            char *local = NULL;
+            SoupMessage *msg = webkit_network_request_get_message(webkit_download_get_network_request(dwb.state.download));
+            /* The engine refetches the uri with GET, responses to other
+             * requests, e.g. form submissions, are left to webkit */
+            gboolean refetch = msg == NULL || 
+                (!g_strcmp0(msg->method, SOUP_METHOD_GET) && (msg->request_body == NULL || msg->request_body->length == 0));
+            if (segments > 0 && refetch && (g_str_has_prefix(uri, "http://") || g_str_has_prefix(uri, "https://")) && 
+                    (local = g_filename_from_uri(fullpath, NULL, NULL)) != NULL) 
+            {
+                active->transfer = transfer_new(uri, local, msg != NULL ? msg->request_headers : NULL, segments);
+                transfer_set_callbacks(active->transfer, (TransferFunc)download_transfer_progress_cb, (TransferFunc)download_transfer_status_cb, s);
+                for (guint i=0; i<G_N_ELEMENTS(s_checksum_types); i++) 
+                {
+                    if (download_checksum_enabled(i)) 
+                        transfer_add_checksum(active->transfer, s_checksum_types[i].type);
+                }
+                g_free(local);
+            }
+            SoupURI *suri = soup_uri_new(uri);
+            if (suri != NULL) 
+            {
+                active->host = g_strdup(suri->host);
+                soup_uri_free(suri);
+            }
+            download_enqueue(active);
         }
         g_free(s_lastdir);
         if (dwb.state.dl_action != DL_ACTION_EXECUTE) 
@@ -641,6 +1162,7 @@ download_start(const char *path)
     }
 
 error_out:
+    download_release_origin(origin);
     dwb_change_mode(NORMAL_MODE, clean);
     dwb.state.download = NULL;
     g_free(json);
@@ -23,6 +23,10 @@
 void download_get_path(GList *, WebKitDownload *);
 void download_start(const char *);
 DwbStatus download_cancel(int number);
+gboolean download_cancel_download(WebKitDownload *);
+int download_get_priority(WebKitDownload *);
+gboolean download_set_priority(WebKitDownload *, int priority);
+void download_set_bandwidth_limit(int limit);
 
 void download_set_execute(Arg *);
 
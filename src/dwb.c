@@ -69,6 +69,7 @@ static DwbStatus dwb_set_user_agent(GList *, WebSettings *);
 static DwbStatus dwb_set_user_stylesheet(GList *, WebSettings *);
 static DwbStatus dwb_set_startpage(GList *, WebSettings *);
 static DwbStatus dwb_set_message_delay(GList *, WebSettings *);
+static DwbStatus dwb_set_download_bandwidth_limit(GList *, WebSettings *);
 static DwbStatus dwb_set_history_length(GList *, WebSettings *);
 static DwbStatus dwb_set_plugin_blocker(GList *, WebSettings *);
 static DwbStatus dwb_set_sync_interval(GList *, WebSettings *);
@@ -88,6 +89,9 @@ static DwbStatus dwb_set_statusbar_height(GList *gl, WebSettings *s);
 static DwbStatus dwb_set_auto_insert_mode(GList *, WebSettings *);
 static DwbStatus dwb_set_tabbar_delay(GList *, WebSettings *);
 static DwbStatus dwb_set_max_tabs(GList *, WebSettings *);
+static DwbStatus dwb_set_hibernate_timeout(GList *, WebSettings *);
+static DwbStatus dwb_set_hibernate_max_tabs(GList *, WebSettings *);
+static DwbStatus dwb_set_hibernate_memory_limit(GList *, WebSettings *);
 static DwbStatus dwb_set_close_last_tab_policy(GList *, WebSettings *);
 static DwbStatus dwb_set_find_delay(GList *gl, WebSettings *s);
 static DwbStatus dwb_set_do_not_track(GList *gl, WebSettings *s);
@@ -108,6 +112,7 @@ static void dwb_set_statusbar_color();
 static DwbStatus dwb_set_dns_lookup(GList *gl, WebSettings *s);
 #endif
 static DwbStatus dwb_init_hints(GList *gl, WebSettings *s);
+static void dwb_clear_hint_style(void);
 
 static Navigation * dwb_get_search_completion_from_navigation(Navigation *);
 static gboolean dwb_sync_files(gpointer);
@@ -231,7 +236,8 @@ dwb_set_block_insecure_content(GList *gl, WebSettings *s)
     {
         for (GList *gl = dwb.state.views; gl; gl = gl->next)
         {
-            g_object_steal_qdata(G_OBJECT(WEBVIEW(gl)), dwb.misc.https_quark);
+            if (VIEW(gl)->web != NULL)
+                g_object_steal_qdata(G_OBJECT(WEBVIEW(gl)), dwb.misc.https_quark);
         }
     }
     return STATUS_OK;
@@ -545,6 +551,16 @@ dwb_set_message_delay(GList *l, WebSettings *s)
     return STATUS_OK;
 }/*}}}*/
 
+/* dwb_set_download_bandwidth_limit(GList *l, WebSettings *){{{*/
+static DwbStatus 
+dwb_set_download_bandwidth_limit(GList *l, WebSettings *s) 
+{
+    if (s->arg_local.i < 0)
+        return STATUS_ERROR;
+    download_set_bandwidth_limit(s->arg_local.i);
+    return STATUS_OK;
+}/*}}}*/
+
 /* dwb_set_history_length(GList *l, WebSettings *){{{*/
 static DwbStatus 
 dwb_set_history_length(GList *l, WebSettings *s) 
@@ -594,6 +610,39 @@ dwb_set_max_tabs(GList *l, WebSettings *s)
     return STATUS_ERROR;
 }/*}}}*/
 
+/* dwb_set_hibernate_timeout(GList *l, WebSettings *s){{{*/
+static DwbStatus
+dwb_set_hibernate_timeout(GList *l, WebSettings *s) 
+{
+    if (s->arg_local.i < 0)
+        return STATUS_ERROR;
+    dwb.misc.hibernate_timeout = s->arg_local.i;
+    view_hibernate_schedule();
+    return STATUS_OK;
+}/*}}}*/
+
+/* dwb_set_hibernate_max_tabs(GList *l, WebSettings *s){{{*/
+static DwbStatus
+dwb_set_hibernate_max_tabs(GList *l, WebSettings *s) 
+{
+    if (s->arg_local.i < 0)
+        return STATUS_ERROR;
+    dwb.misc.hibernate_max_tabs = s->arg_local.i;
+    view_hibernate_schedule();
+    return STATUS_OK;
+}/*}}}*/
+
+/* dwb_set_hibernate_memory_limit(GList *l, WebSettings *s){{{*/
+static DwbStatus
+dwb_set_hibernate_memory_limit(GList *l, WebSettings *s) 
+{
+    if (s->arg_local.i < 0)
+        return STATUS_ERROR;
+    dwb.misc.hibernate_memory_limit = s->arg_local.i;
+    view_hibernate_schedule();
+    return STATUS_OK;
+}/*}}}*/
+
 /* dwb_set_favicon(GList *l, WebSettings *s){{{*/
 static DwbStatus
 dwb_set_favicon(GList *l, WebSettings *s) 
@@ -602,14 +651,22 @@ dwb_set_favicon(GList *l, WebSettings *s)
     {
         for (GList *l = dwb.state.views; l; l=l->next) 
         {
-            g_signal_handler_disconnect(WEBVIEW(l), VIEW(l)->status->signals[SIG_ICON_LOADED]);
+            if (VIEW(l)->status->signals[SIG_ICON_LOADED] != 0) 
+            {
+                g_signal_handler_disconnect(WEBVIEW(l), VIEW(l)->status->signals[SIG_ICON_LOADED]);
+                VIEW(l)->status->signals[SIG_ICON_LOADED] = 0;
+            }
             view_set_favicon(l, false);
         }
     }
     else 
     {
+        /* Placeholder tabs connect the handler when they get a webview */
         for (GList *l = dwb.state.views; l; l=l->next) 
-            VIEW(l)->status->signals[SIG_ICON_LOADED] = g_signal_connect(VIEW(l)->web, "icon-loaded", G_CALLBACK(view_icon_loaded), l);
+        {
+            if (VIEW(l)->web != NULL && VIEW(l)->status->signals[SIG_ICON_LOADED] == 0)
+                VIEW(l)->status->signals[SIG_ICON_LOADED] = g_signal_connect(VIEW(l)->web, "icon-loaded", G_CALLBACK(view_icon_loaded), l);
+        }
     }
     return STATUS_OK;
 }/*}}}*/
@@ -945,7 +1002,7 @@ dwb_update_status_text(GList *gl, GtkAdjustment *a)
     const char *bof = back && forward ? " [-+]" : back ? " [-]" : forward  ? " [+]" : " ";
     g_string_append(string, bof);
 
-    g_string_append_printf(string, "[%d/%d]", g_list_position(dwb.state.views, dwb.state.fview) + 1, g_list_length(dwb.state.views));
+    g_string_append_printf(string, "[%d/%d]", view_position(dwb.state.fview) + 1, view_count());
 
     if (a) 
     {
@@ -1547,9 +1604,10 @@ dwb_apply_settings(WebSettings *s, const char *key, const char *value, int scope
     }
     else 
     {
+        /* Placeholder tabs get the settings when they are materialized */
         for (GList *l = dwb.state.views; l; l=l->next) 
         {
-            if (s->func) 
+            if (s->func && !VIEW_PLACEHOLDER(VIEW(l))) 
                 s->func(l, s);
         }
     }
@@ -1701,14 +1759,14 @@ dwb_limit_tabs(gint max)
     int length, n, i = 0;
     int m, median;
 
-    length = g_list_length(dwb.state.views);
+    length = view_count();
 
     if (length == 1)
         return;
 
     m = max/2+1;
     median = max % 2 == 0 ? max/2 : m;
-    n = g_list_position(dwb.state.views, dwb.state.fview);
+    n = view_position(dwb.state.fview);
     for (GList *l = dwb.state.views; l; l=l->next, i++)
     {
         if ((n < median && i<max) || 
@@ -1733,7 +1791,7 @@ dwb_focus_view(GList *gl, const char *event)
     static int running;
     if (gl != dwb.state.fview) 
     {
-        IPC_SEND_HOOK(focus_tab, "%d", g_list_position(dwb.state.views, gl) + 1);
+        IPC_SEND_TAB_HOOK(focus_tab, view_position(gl) + 1, NULL);
         if (EMIT_SCRIPT(TAB_FOCUS)) 
         {
             /**
@@ -1862,6 +1920,9 @@ dwb_toggle_allowed(const char *filename, const char *data, GList **pers)
 void
 dwb_reload(GList *gl) 
 {
+    /* Loading a placeholder tab is a reload */
+    if (view_materialize(gl))
+        return;
     const char *path = webkit_web_view_get_uri(WEBVIEW(gl));
     if ( !local_check_directory(dwb.state.fview, path, false, NULL) ) 
         webkit_web_view_reload(WEBVIEW(gl));
@@ -1986,7 +2047,8 @@ void
 dwb_unfocus() 
 {
     if (dwb.state.fview) {
-        dwb.state.last_tab = g_list_position(dwb.state.views, dwb.state.fview);
+        dwb.state.last_tab = view_position(dwb.state.fview);
+        CURRENT_VIEW()->status->last_active = g_get_monotonic_time();
         view_set_normal_style(dwb.state.fview);
         dwb_source_remove();
         CLEAR_COMMAND_TEXT();
@@ -2188,20 +2250,15 @@ dwb_hints_unlock() {
   return false;
 }
 
-/* dwb_evaluate_hints(const char *buffer)  return DwbStatus {{{*/
+/* dwb_evaluate_hints(const char *event, const char *action, const char *resource)  return DwbStatus {{{*/
 DwbStatus 
-dwb_evaluate_hints(const char *buffer) 
+dwb_evaluate_hints(const char *event, const char *action, const char *resource) 
 {
     DwbStatus ret = STATUS_OK;
-    char **token = g_strsplit(buffer, "|", 3);
 
-    if (g_strv_length(token) != 3)
+    if (event == NULL || action == NULL || resource == NULL)
         return STATUS_ERROR;
 
-    char *event = token[0];
-    char *action = token[1];
-    char *resource = token[2];
-
     /**
      * Emitted when a hint will be followed
      * @event  followHint
@@ -2241,11 +2298,10 @@ dwb_evaluate_hints(const char *buffer)
             goto finish;
         }
     }
-    js_call_as_function(MAIN_FRAME(), CURRENT_VIEW()->js_base, "follow", action, kJSTypeString, NULL);
+    JSValueRef argv[] = { js_char_to_value(webkit_web_frame_get_global_context(MAIN_FRAME()), action) };
+    view_call_base(dwb.state.fview, BASE_FOLLOW, 1, argv);
 
-    if (!g_strcmp0(event, "undefined")) 
-        goto finish;
-    else if (!g_strcmp0("_dwb_no_hints_", event)) 
+    if (!g_strcmp0("_dwb_no_hints_", event)) 
         ret = STATUS_ERROR;
     else if (!g_strcmp0(event, "_dwb_input_")) 
     {
@@ -2279,12 +2335,12 @@ dwb_evaluate_hints(const char *buffer)
         switch (dwb.state.hint_type) 
         {
             case HINT_T_ALL:     break;
-            case HINT_T_IMAGES : dwb_load_uri(NULL, resource); 
+            case HINT_T_IMAGES : dwb_load_uri(NULL, (char*)resource); 
                                  dwb_change_mode(NORMAL_MODE, true);
                                  break;
             case HINT_T_URL    : a = util_arg_new();
                                  a->n = dwb.state.nv | SET_URL;
-                                 a->p = resource;
+                                 a->p = (char*)resource;
                                  commands_open(NULL, a);
                                  break;
             case HINT_T_CLIPBOARD : dwb_change_mode(NORMAL_MODE, true);
@@ -2310,7 +2366,31 @@ dwb_evaluate_hints(const char *buffer)
         g_free(a);
     }
 finish: 
-    g_strfreev(token);
+    return ret;
+}/*}}}*/
+
+/* dwb_evaluate_hint_result(JSValueRef)  return DwbStatus {{{*/
+/* Evaluates the object returned by a hint function of base.js, null means
+ * that no hint was selected */
+static DwbStatus 
+dwb_evaluate_hint_result(JSValueRef result) 
+{
+    DwbStatus ret = STATUS_OK;
+    JSContextRef ctx = webkit_web_frame_get_global_context(MAIN_FRAME());
+    JSObjectRef o;
+
+    if (result == NULL || !JSValueIsObject(ctx, result) || (o = JSValueToObject(ctx, result, NULL)) == NULL) 
+        return STATUS_OK;
+
+    char *event = js_get_string_property(ctx, o, "event");
+    char *action = js_get_string_property(ctx, o, "action");
+    char *resource = js_get_string_property(ctx, o, "resource");
+
+    ret = dwb_evaluate_hints(event, action, resource);
+
+    g_free(event);
+    g_free(action);
+    g_free(resource);
     return ret;
 }/*}}}*/
 
@@ -2318,25 +2398,24 @@ finish:
 gboolean
 dwb_update_hints(GdkEventKey *e) 
 {
-    char *buffer = NULL;
-    char *com = NULL;
-    char *val;
+    JSContextRef ctx = webkit_web_frame_get_global_context(MAIN_FRAME());
+    JSValueRef result = NULL;
+    char *input, *val;
     gboolean ret = false;
-    char json[BUFFER_LENGTH] = {0};
-    char *escaped;
+    JSValueRef type = JSValueMakeNumber(ctx, hint_map[dwb.state.hint_type].arg);
 
     if (IS_RETURN_KEY(e)) 
     {
-        com = "followActive";
-        snprintf(json, sizeof(json), "{ \"type\" : \"%d\" }", hint_map[dwb.state.hint_type].arg);
+        JSValueRef argv[] = { type };
+        result = view_call_base(dwb.state.fview, BASE_FOLLOW_ACTIVE, 1, argv);
         ret = true;
     }
     else if (DWB_COMPLETE_KEY(e)) 
     {
         if ((DWB_TAB_KEY(e) && e->state & GDK_SHIFT_MASK) || e->keyval == GDK_KEY_Up) 
-            com = "focusPrev";
+            view_call_base(dwb.state.fview, BASE_FOCUS_PREV, 0, NULL);
         else 
-            com = "focusNext";
+            view_call_base(dwb.state.fview, BASE_FOCUS_NEXT, 0, NULL);
         ret = true;
     }
     else if (e->is_modifier) 
@@ -2346,22 +2425,14 @@ dwb_update_hints(GdkEventKey *e)
     else 
     {
         val = util_keyval_to_char(e->keyval, true);
-        escaped = g_strescape(GET_TEXT(), NULL);
-        snprintf(json, sizeof(json), "{ \"input\" : \"%s%s\", \"type\" : %d }", escaped, val ?  (*val == '\\' ? "\\\\" : val) : "", hint_map[dwb.state.hint_type].arg);
-        com = "updateHints";
+        input = g_strconcat(GET_TEXT(), val, NULL);
+        JSValueRef argv[] = { js_char_to_value(ctx, input), type };
+        result = view_call_base(dwb.state.fview, BASE_UPDATE_HINTS, 2, argv);
+        g_free(input);
         g_free(val);
-        g_free(escaped);
-    }
-    if (com) 
-    {
-        buffer = js_call_as_function(MAIN_FRAME(), CURRENT_VIEW()->js_base, com, *json ? json : NULL, *json ? kJSTypeObject : kJSTypeUndefined, &buffer);
-    }
-    if (buffer != NULL) 
-    {
-        if (dwb_evaluate_hints(buffer) == STATUS_END) 
-            ret = true;
-        g_free(buffer);
     }
+    if (dwb_evaluate_hint_result(result) == STATUS_END) 
+        ret = true;
     return ret;
 }/*}}}*/
 
@@ -2369,28 +2440,23 @@ dwb_update_hints(GdkEventKey *e)
 DwbStatus 
 dwb_show_hints(Arg *arg) 
 {
-    char *jsret; 
     DwbStatus ret = STATUS_OK;
     if (dwb.state.nv == OPEN_NORMAL) 
         dwb_set_open_mode(arg->n | OPEN_VIA_HINTS);
 
     if (dwb.state.mode != HINT_MODE) 
     {
+        JSContextRef ctx = webkit_web_frame_get_global_context(MAIN_FRAME());
         gtk_entry_set_text(GTK_ENTRY(dwb.gui.entry), "");
 
-        char *json = util_create_json(3, INTEGER, "newTab", dwb.state.nv & (OPEN_NEW_VIEW|OPEN_NEW_WINDOW), 
-                INTEGER, "type", hint_map[arg->i].arg, 
-                CHAR, "selector", arg->p);
-
-        js_call_as_function(MAIN_FRAME(), CURRENT_VIEW()->js_base, "showHints", json, kJSTypeObject, &jsret);
-        g_free(json);
-        if (jsret != NULL) 
-        {
-            ret = dwb_evaluate_hints(jsret);
-            g_free(jsret);
-            if (ret == STATUS_END) 
-                return ret;
-        }
+        JSValueRef argv[] = { 
+            JSValueMakeNumber(ctx, hint_map[arg->i].arg), 
+            JSValueMakeBoolean(ctx, dwb.state.nv & (OPEN_NEW_VIEW|OPEN_NEW_WINDOW)), 
+            arg->p != NULL ? js_char_to_value(ctx, arg->p) : JSValueMakeNull(ctx)
+        };
+        ret = dwb_evaluate_hint_result(view_call_base(dwb.state.fview, BASE_SHOW_HINTS, 3, argv));
+        if (ret == STATUS_END) 
+            return ret;
         dwb_change_mode(HINT_MODE);
         dwb.state.hint_type = arg->i;
         entry_focus();
@@ -2697,7 +2763,7 @@ dwb_tab_label_set_text(GList *gl, const char *text)
     char *escaped;
 
     if (text == NULL) 
-        title = webkit_web_view_get_title(WEBVIEW(gl));
+        title = view_get_title(gl);
     else 
         title = text;
 
@@ -2706,10 +2772,10 @@ dwb_tab_label_set_text(GList *gl, const char *text)
 
     escaped = g_markup_printf_escaped("<span foreground='%s'>%d%s</span> %s%s%s", 
             LP_PROTECTED(v) ? dwb.color.tab_protected_color : dwb.color.tab_number_color,
-            g_list_position(dwb.state.views, gl) + 1, 
+            view_position(gl) + 1, 
             LP_VISIBLE(v) ? "*" : "",
             progress,
-            v->status->deferred ? "*" : "",
+            v->status->deferred || VIEW_PLACEHOLDER(v) ? "*" : "",
             title ? title : "---");
     gtk_label_set_markup(GTK_LABEL(v->tablabel), escaped);
 
@@ -2722,9 +2788,8 @@ dwb_update_status(GList *gl, const char *title)
 {
     View *v = gl->data;
     char *filename = NULL, *text;
-    WebKitWebView *w = WEBKIT_WEB_VIEW(v->web);
     if (title == NULL)
-        title = webkit_web_view_get_title(w);
+        title = view_get_title(gl);
     if (!title) 
         title = "---";
 
@@ -2750,14 +2815,8 @@ dwb_update_status(GList *gl, const char *title)
 void 
 dwb_update_layout() 
 {
-    const char *title;
     for (GList *gl = dwb.state.views; gl; gl = gl->next) 
-    {
-        View *v = gl->data;
-        title = v->status->deferred ? v->status->deferred_uri : webkit_web_view_get_title(WEBKIT_WEB_VIEW(v->web));
-        dwb_tab_label_set_text(gl, title);
-
-    }
+        dwb_tab_label_set_text(gl, view_get_title(gl));
     dwb_update_tabs();
 }/*}}}*/
 
@@ -2766,6 +2825,9 @@ void
 dwb_focus(GList *gl) 
 {
     dwb.state.fview = gl;
+    VIEW(gl)->status->last_active = g_get_monotonic_time();
+    /* The focused tab always has a webview */
+    view_materialize(gl);
     view_set_active_style(gl);
     dwb_focus_scroll(gl);
     if (!VIEW(gl)->status->deferred)
@@ -2830,6 +2892,8 @@ dwb_load_uri(GList *gl, const char *arg)
 
     g_return_if_fail(gl != NULL);
 
+    view_materialize(gl);
+
     WebKitWebView *web = WEBVIEW(gl);
 
     if (!g_strcmp0(tmpuri, "$URI"))
@@ -3295,7 +3359,7 @@ dwb_clear_mode() {
     Mode mode = dwb.state.mode;
 
     if (mode == HINT_MODE || mode == SEARCH_FIELD_MODE) 
-        js_call_as_function(MAIN_FRAME(), CURRENT_VIEW()->js_base, "clear", NULL, kJSTypeUndefined, NULL);
+        view_call_base(dwb.state.fview, BASE_CLEAR, 0, NULL);
     else if (mode == DOWNLOAD_GET_PATH) 
         completion_clean_path_completion();
     
@@ -3574,6 +3638,8 @@ dwb_execute_user_script(KeyMap *km, Arg *a)
     unsigned long wid = GDK_WINDOW_XID(gtk_widget_get_window(dwb.gui.window));
     snprintf(wid_buffer, sizeof(wid_buffer), "%lu", wid);
     envp = g_environ_setenv(envp, "DWB_WINID", wid_buffer, true);
+    if (ipc_get_socket_path() != NULL)
+        envp = g_environ_setenv(envp, DWB_IPC_SOCKET_ENV, ipc_get_socket_path(), true);
 
 
 
@@ -3611,94 +3677,164 @@ dwb_execute_user_script(KeyMap *km, Arg *a)
 }/*}}}*/
 
 /* dwb_get_scripts() {{{*/
-static GList * 
-dwb_get_scripts() 
+enum {
+    USERSCRIPT_SKIP, 
+    USERSCRIPT_NATIVE, 
+    USERSCRIPT_JAVASCRIPT, 
+};
+typedef struct _UserscriptLoad {
+    char *filename;
+    char *path;
+    char *content;
+    PreparedScript *prepared;
+    int type;
+} UserscriptLoad;
+
+/* 
+ * Reads and prepares a single userscript, called from the loader threads, the
+ * script itself is compiled and executed on the main thread.
+ * */
+static void
+dwb_load_userscript(UserscriptLoad *load, gpointer unused) 
 {
-    GDir *dir;
-    char *filename = NULL;
-    char *content = NULL;
-    GList *gl = NULL;
-    Navigation *n;
     GError *error = NULL;
     FILE *f = NULL;
     int l1, l2;
-
-    if ( (dir = g_dir_open(dwb.files[FILES_USERSCRIPTS], 0, NULL)) ) 
+    struct exar_archive_s *archive;
+    const unsigned char *data;
+    off_t size;
+    gboolean javascript = false;
+    char buf[11] = {0};
+    char *path = g_build_filename(dwb.files[FILES_USERSCRIPTS], load->filename, NULL);
+    char *realpath, *script;
+    gint64 start = g_get_monotonic_time();
+
+    /* ignore subdirectories */
+    if (g_file_test(path, G_FILE_TEST_IS_DIR))
+        goto error_out;
+    else if (g_file_test(path, G_FILE_TEST_IS_SYMLINK)) 
+    {
+        realpath = g_file_read_link(path, &error);
+        if (realpath == NULL) 
+        {
+            fprintf(stderr, "Cannot read %s : %s\n", path, error->message);
+            g_clear_error(&error);
+            goto error_out;
+        }
+        else 
+        {
+            g_free(path);
+            path = realpath;
+        }
+    }
+    if (dwb.misc.js_api != JS_API_DISABLED)
     {
-        while ( (filename = (char*)g_dir_read_name(dir)) ) 
+        if ((archive = exar_open(path)) != NULL)
         {
-            gboolean javascript = false;
-            char buf[11] = {0};
-            char *path = g_build_filename(dwb.files[FILES_USERSCRIPTS], filename, NULL);
-            char *realpath, *tmp, **lines;
-            int i=0;
-            /* ignore subdirectories */
-            if (g_file_test(path, G_FILE_TEST_IS_DIR))
-                continue;
-            else if (g_file_test(path, G_FILE_TEST_IS_SYMLINK)) 
+            if (exar_search_lookup(archive, "main.js", &data, &size) == 0) 
             {
-                realpath = g_file_read_link(path, &error);
-                if (realpath == NULL) 
-                {
-                    fprintf(stderr, "Cannot read %s : %s\n", path, error->message);
-                    g_free(path);
-                    goto loop_end;
-                }
-                else 
-                {
-                    g_free(path);
-                    path = realpath;
-                }
+                load->prepared = scripts_prepare(path, g_strndup((const char *)data, size), true);
+                load->type = USERSCRIPT_JAVASCRIPT;
             }
-            if (dwb.misc.js_api != JS_API_DISABLED)
+            exar_close(archive);
+            goto error_out;
+        }
+        else if (  (f = fopen(path, "r")) != NULL)  
+        {
+            if ( ( (l1 = fgetc(f)) && (l2 = fgetc(f)) ) &&  
+                    ( (l1 == '#' && l2 == '!') || (l1 == '/' && l2 == '/' && fgetc(f) == '!') ) && 
+                    (fgets(buf, sizeof(buf), f) != NULL && !g_strcmp0(buf, "javascript")) )
             {
-                if (exar_check_version(path) == 0)
-                {
-                    content = (char *) exar_search_extract(path, "main.js", NULL);
-                    if (content != NULL) {
-                        scripts_init_archive(path, content);
-                        exar_free(content);
-                    }
-                    continue;
-                }
-                else if (  (f = fopen(path, "r")) != NULL)  
-                {
-                    if ( ( (l1 = fgetc(f)) && (l2 = fgetc(f)) ) &&  
-                         ( (l1 == '#' && l2 == '!') || (l1 == '/' && l2 == '/' && fgetc(f) == '!') ) && 
-                         (fgets(buf, sizeof(buf), f) != NULL && !g_strcmp0(buf, "javascript")) )
-                    {
-                        int next = fgetc(f);
-                        if (g_ascii_isspace(next)) 
-                            javascript = true;
-                    }
-                    fclose(f);
-                }
-
+                int next = fgetc(f);
+                if (g_ascii_isspace(next)) 
+                    javascript = true;
             }
+            fclose(f);
+        }
+    }
 
-            if (!javascript && !g_file_test(path, G_FILE_TEST_IS_EXECUTABLE)) 
-            {
-                fprintf(stderr, "Warning: userscript %s isn't executable and will be ignored.\n", path);
-                FREE0(path);
-                goto loop_end;
-            }
+    if (!javascript && !g_file_test(path, G_FILE_TEST_IS_EXECUTABLE)) 
+    {
+        fprintf(stderr, "Warning: userscript %s isn't executable and will be ignored.\n", path);
+        goto error_out;
+    }
 
-            g_file_get_contents(path, &content, NULL, NULL);
-            if (content == NULL) 
-                goto loop_end;
+    g_file_get_contents(path, &load->content, NULL, NULL);
+    if (load->content == NULL) 
+        goto error_out;
 
-            if (javascript) 
-            {
-                char *script = strchr(content, '\n');
-                if (script && *(script+1)) 
-                {
-                    scripts_init_script(path, script+1);
-                    goto loop_end;
-                }
-            }
+    if (javascript) 
+    {
+        script = strchr(load->content, '\n');
+        if (script && *(script+1)) 
+        {
+            load->prepared = scripts_prepare(path, g_strdup(script+1), false);
+            load->type = USERSCRIPT_JAVASCRIPT;
+            goto error_out;
+        }
+    }
+    load->type = USERSCRIPT_NATIVE;
+    load->path = path;
+    return;
+
+error_out:
+    /* Includes the time spent in scripts_prepare */
+    if (load->prepared != NULL)
+        load->prepared->load_time = g_get_monotonic_time() - start;
+    g_free(path);
+}
+
+static GList * 
+dwb_get_scripts() 
+{
+    GDir *dir;
+    const char *filename;
+    GList *gl = NULL;
+    GSList *loads = NULL;
+    GThreadPool *pool;
+    UserscriptLoad *load;
+    Navigation *n;
+    char *tmp, **lines;
+    int i;
+    int threads = 4;
 
-            lines = g_strsplit(content, "\n", -1);
+    if ( (dir = g_dir_open(dwb.files[FILES_USERSCRIPTS], 0, NULL)) == NULL) 
+        return NULL;
 
+#if GLIB_CHECK_VERSION(2, 36, 0)
+    threads = g_get_num_processors();
+#endif
+    /* Reading and preparing the scripts is done in parallel, compiling and
+     * running them must happen on the main thread and in directory order */
+    pool = g_thread_pool_new((GFunc)dwb_load_userscript, NULL, threads, false, NULL);
+    while ( (filename = g_dir_read_name(dir)) ) 
+    {
+        load = dwb_malloc(sizeof(UserscriptLoad));
+        memset(load, 0, sizeof(UserscriptLoad));
+        load->filename = g_strdup(filename);
+        loads = g_slist_prepend(loads, load);
+        if (pool != NULL)
+            g_thread_pool_push(pool, load, NULL);
+        else 
+            dwb_load_userscript(load, NULL);
+    }
+    g_dir_close(dir);
+    if (pool != NULL)
+        g_thread_pool_free(pool, false, true);
+
+    loads = g_slist_reverse(loads);
+    for (GSList *l = loads; l; l=l->next) 
+    {
+        load = l->data;
+        if (load->type == USERSCRIPT_JAVASCRIPT) 
+        {
+            scripts_init_prepared(load->prepared);
+        }
+        else if (load->type == USERSCRIPT_NATIVE) 
+        {
+            lines = g_strsplit(load->content, "\n", -1);
+
+            i = 0;
             n = NULL;
             KeyMap *map = dwb_malloc(sizeof(KeyMap));
             FunctionMap *fmap = dwb_malloc(sizeof(FunctionMap));
@@ -3714,7 +3850,7 @@ dwb_get_scripts()
                         while (g_ascii_isspace(*tmp))
                             tmp++;
                         if (*tmp != '\0') {
-                            n = dwb_navigation_new(filename, tmp);
+                            n = dwb_navigation_new(load->filename, tmp);
                             Key key = dwb_str_to_key(tmp);
                             map->key = key.str;
                             map->mod = key.mod;
@@ -3727,23 +3863,26 @@ dwb_get_scripts()
             }
             if (!n) 
             {
-                n = dwb_navigation_new(filename, "");
+                n = dwb_navigation_new(load->filename, "");
                 map->key = "";
                 map->mod = 0;
             }
             // TODO Free navigation
-            FunctionMap fm = { { n->first, n->first }, CP_DONT_SAVE | CP_COMMANDLINE | CP_USERSCRIPT, (Func)dwb_execute_user_script, NULL, POST_SM, { .arg = path }, EP_NONE, {NULL} };
+            FunctionMap fm = { { n->first, n->first }, CP_DONT_SAVE | CP_COMMANDLINE | CP_USERSCRIPT, (Func)dwb_execute_user_script, NULL, POST_SM, { .arg = load->path }, EP_NONE, {NULL} };
             *fmap = fm;
             map->map = fmap;
             dwb.misc.userscripts = g_list_prepend(dwb.misc.userscripts, n);
             gl = g_list_prepend(gl, map);
 
             g_strfreev(lines);
-loop_end: 
-            FREE0(content);
         }
-        g_dir_close(dir);
+        scripts_prepared_free(load->prepared);
+        g_free(load->filename);
+        g_free(load->content);
+        g_free(load);
     }
+    g_slist_free(loads);
+    scripts_prune_prepared();
     return gl;
 }/*}}}*/
 
@@ -3832,7 +3971,9 @@ dwb_clean_up()
         view_clean(gl);
     g_list_free(dwb.state.views);
     dwb.state.views = NULL;
+    view_index_update(0);
     scripts_end(true);
+    ipc_end(dwb.gui.window);
     
 #ifndef DISABLE_HSTS
     hsts_end(); /* Assumes it has access to dwb.settings */
@@ -3855,8 +3996,12 @@ dwb_clean_up()
     dwb.keymap = NULL;
     g_hash_table_remove_all(dwb.settings);
     g_string_free(dwb.state.buffer, true);
-    g_free(dwb.misc.hints);
-    g_free(dwb.misc.hint_style);
+    if (dwb.misc.hints != NULL) 
+    {
+        JSStringRelease(dwb.misc.hints);
+        dwb.misc.hints = NULL;
+    }
+    dwb_clear_hint_style();
     dwb_clear_last_command();
 
     dwb_free_list(dwb.fc.bookmarks, (void_func)dwb_navigation_free);
@@ -4282,6 +4427,8 @@ dwb_init_auto_started_files()
     snprintf(buffer, sizeof(buffer), "%lu", GDK_WINDOW_XID(gtk_widget_get_window(dwb.gui.window)));
     char **envp = g_get_environ();
     envp = g_environ_setenv(envp, "DWB_WINID", buffer, true);
+    if (ipc_get_socket_path() != NULL)
+        envp = g_environ_setenv(envp, DWB_IPC_SOCKET_ENV, ipc_get_socket_path(), true);
 
     if ( (dir = g_dir_open(dwb.files[FILES_AUTOSTART], 0, NULL)) ) 
     {
@@ -4386,35 +4533,56 @@ dwb_init_settings()
         g_strfreev(keys);
 }/*}}}*/
 
+static void
+dwb_clear_hint_style() 
+{
+    HintStyle *hs = &dwb.misc.hint_style;
+    g_free(hs->letter_seq);
+    g_free(hs->font);
+    g_free(hs->style);
+    g_free(hs->fg_color);
+    g_free(hs->bg_color);
+    g_free(hs->active_color);
+    g_free(hs->normal_color);
+    g_free(hs->border);
+    memset(hs, 0, sizeof(HintStyle));
+}
 static DwbStatus 
 dwb_init_hints(GList *gl, WebSettings *s) 
 {
+    HintStyle *hs = &dwb.misc.hint_style;
     setlocale(LC_NUMERIC, "C");
-    g_free(dwb.misc.hints);
+
+    /* base.js is converted once per setting change, not for every document */
     char *scriptpath = util_get_data_file(BASE_SCRIPT, "scripts");
-    dwb.misc.hints = util_get_file_content(scriptpath, NULL);
+    char *content = util_get_file_content(scriptpath, NULL);
+    if (content != NULL) 
+    {
+        if (dwb.misc.hints != NULL)
+            JSStringRelease(dwb.misc.hints);
+        dwb.misc.hints = JSStringCreateWithUTF8CString(content);
+    }
+    g_free(content);
     g_free(scriptpath);
 
-    g_free(dwb.misc.hint_style);
-    dwb.misc.hint_style = g_strdup_printf(
-            "{ \"hintLetterSeq\" : \"%s\", \"hintFont\" : \"%s\", \"hintStyle\" : \"%s\", \"hintFgColor\" : \"%s\",\
-            \"hintBgColor\" : \"%s\", \"hintActiveColor\" : \"%s\", \"hintNormalColor\" : \"%s\", \"hintBorder\" : \"%s\",\
-            \"hintOffsetTop\" : %d, \
-            \"hintOffsetLeft\" : %d, \
-            \"hintOpacity\" : \"%f\", \"hintHighlighLinks\" : %s, \"hintAutoFollow\" : %s }", 
-            GET_CHAR("hint-letter-seq"),
-            GET_CHAR("hint-font"),
-            GET_CHAR("hint-style"), 
-            GET_CHAR("hint-fg-color"), 
-            GET_CHAR("hint-bg-color"), 
-            GET_CHAR("hint-active-color"), 
-            GET_CHAR("hint-normal-color"), 
-            GET_CHAR("hint-border"), 
-            GET_INT("hint-offset-top"), 
-            GET_INT("hint-offset-left"), 
-            GET_DOUBLE("hint-opacity"),
-            GET_BOOL("hint-highlight-links") ? "true" : "false",
-            GET_BOOL("hint-autofollow") ? "true" : "false");
+    dwb_clear_hint_style();
+    hs->letter_seq = g_strdup(GET_CHAR("hint-letter-seq"));
+    hs->font = g_strdup(GET_CHAR("hint-font"));
+    hs->style = g_strdup(GET_CHAR("hint-style"));
+    hs->fg_color = g_strdup(GET_CHAR("hint-fg-color"));
+    hs->bg_color = g_strdup(GET_CHAR("hint-bg-color"));
+    hs->active_color = g_strdup(GET_CHAR("hint-active-color"));
+    hs->normal_color = g_strdup(GET_CHAR("hint-normal-color"));
+    hs->border = g_strdup(GET_CHAR("hint-border"));
+    hs->offset_top = GET_INT("hint-offset-top");
+    hs->offset_left = GET_INT("hint-offset-left");
+    hs->opacity = GET_DOUBLE("hint-opacity");
+    hs->highlight_links = GET_BOOL("hint-highlight-links");
+    hs->autofollow = GET_BOOL("hint-autofollow");
+
+    /* Documents that are already loaded get the new style too */
+    for (GList *l = dwb.state.views; l; l=l->next)
+        view_apply_hint_style(l);
     return STATUS_OK;
 }
 
@@ -5004,6 +5172,10 @@ dwb_init_files()
     dwb.files[FILES_AUTOSTART]      = util_resolve_symlink(dwb.files[FILES_AUTOSTART]);
     dwb.files[FILES_AUTOSTART]      = util_check_directory(dwb.files[FILES_AUTOSTART]);
 
+    dwb.files[FILES_PREPARED_SCRIPTS] = g_build_filename(path, "prepared_scripts", NULL);
+    dwb.files[FILES_PREPARED_SCRIPTS] = util_resolve_symlink(dwb.files[FILES_PREPARED_SCRIPTS]);
+    dwb.files[FILES_PREPARED_SCRIPTS] = util_check_directory(dwb.files[FILES_PREPARED_SCRIPTS]);
+
 
     dwb.fc.bookmarks = dwb_init_file_content(dwb.fc.bookmarks, dwb.files[FILES_BOOKMARKS], (Content_Func)dwb_navigation_new_from_line); 
     dwb.fc.history = dwb_init_file_content(dwb.fc.history, dwb.files[FILES_HISTORY], (Content_Func)dwb_navigation_new_from_line); 
@@ -5179,7 +5351,7 @@ dwb_init_vars(void)
     dwb.misc.proxyuri = NULL;
 
     dwb.misc.hints = NULL;
-    dwb.misc.hint_style = NULL;
+    memset(&dwb.misc.hint_style, 0, sizeof(HintStyle));
 
     dwb.misc.sync_interval = 0;
     dwb.misc.synctimer = 0;
@@ -218,6 +218,7 @@ typedef struct _FileContent FileContent;
 typedef struct _Font DwbFont;
 typedef struct _FunctionMap FunctionMap;
 typedef struct _Gui Gui;
+typedef struct _HintStyle HintStyle;
 typedef struct _Key Key;
 typedef struct _KeyMap KeyMap;
 typedef struct _KeyValue KeyValue;
@@ -227,6 +228,8 @@ typedef struct _Plugins Plugins;
 typedef struct _Quickmark Quickmark;
 typedef struct _Settings Settings;
 typedef struct _State State;
+typedef struct _TabHistory TabHistory;
+typedef struct _ViewStats ViewStats;
 typedef struct _View View;
 typedef struct _ViewStatus ViewStatus;
 typedef struct _WebSettings WebSettings;
@@ -332,6 +335,9 @@ typedef enum {
 #define LP_VISIBLE(v) ((v)->status->lockprotect & LP_VISIBLE)
 #define LP_STATUS(v)   ((v)->status->lockprotect & (LP_LOCK_DOMAIN | LP_LOCK_URI))
 
+/* Placeholder tabs don't have a webview, v->web is NULL */
+#define VIEW_PLACEHOLDER(v) ((v)->status->placeholder != NULL)
+
 enum {
   SYNC_HISTORY = 1<<0, 
   SYNC_COOKIES = 1<<1,
@@ -353,6 +359,18 @@ typedef enum {
 } HintType;
 #define HINT_NOT_RAPID (dwb.state.hint_type != HINT_T_RAPID && dwb.state.hint_type != HINT_T_RAPID_NW)
 
+/* Functions of base.js called with view_call_base */
+typedef enum {
+  BASE_SHOW_HINTS = 0,
+  BASE_UPDATE_HINTS,
+  BASE_FOLLOW_ACTIVE,
+  BASE_FOCUS_NEXT,
+  BASE_FOCUS_PREV,
+  BASE_FOLLOW,
+  BASE_CLEAR,
+  BASE_LAST,
+} BaseFunction;
+
 typedef enum {
   BAR_VIS_TOP = 1<<0,
   BAR_VIS_STATUS = 1<<1,
@@ -488,6 +506,7 @@ enum Signal {
   SIG_PROGRESS,
   SIG_TITLE,
   SIG_URI,
+  SIG_CONTENT_LENGTH,
   SIG_SCROLL,
   SIG_SCROLL_TAB,
   SIG_VALUE_CHANGED,
@@ -694,6 +713,22 @@ struct _Plugins {
   int max;
   PluginBlockerStatus status;
 };
+/* History of a tab that hasn't loaded its page yet */
+struct _TabHistory {
+  GList *items;                 /* Navigation* */
+  int current;                  /* index of the current item in items */
+  unsigned int lockprotect;     /* applied after the first load finished */
+  double scroll;                /* vertical scroll position of the current item */
+  gboolean hibernated;          /* unloaded by hibernation, not by session restore */
+};
+/* Resource usage of a tab, reset when a new page is loaded */
+struct _ViewStats {
+  guint resources;              /* number of requested resources */
+  guint64 resource_bytes;       /* received content length */
+  gint64 adblock_time;          /* microseconds spent in the adblocker */
+  gint64 script_time;           /* microseconds spent in script signal handlers */
+  gint64 base_time;             /* microseconds spent initializing base.js */
+};
 struct _ViewStatus {
   gboolean add_history;
   char *search_string;
@@ -714,6 +749,11 @@ struct _ViewStatus {
   guint group;
   gboolean deferred;
   char *deferred_uri;
+  TabHistory *placeholder;
+  gint64 last_active;
+  int position;
+  unsigned int dirty;
+  ViewStats stats;
   double marks[MARK_LENGTH];
   WebKitWebNavigationReason reason;
 };
@@ -729,6 +769,7 @@ struct _View {
   Plugins *plugins;
   WebKitWebSettings *settings;
   JSObjectRef js_base;
+  JSObjectRef js_base_functions[BASE_LAST];  /* looked up on first call */
   JSObjectRef script_wv;
 };
 struct _Color {
@@ -798,11 +839,28 @@ struct _Gui {
   int height;
   guint wid;
 };
+/* Hint settings, passed to base.js when a document is created */
+struct _HintStyle {
+  char *letter_seq;
+  char *font;
+  char *style;
+  char *fg_color;
+  char *bg_color;
+  char *active_color;
+  char *normal_color;
+  char *border;
+  int offset_top;
+  int offset_left;
+  double opacity;
+  gboolean highlight_links;
+  gboolean autofollow;
+};
 struct _Misc {
   const char *name;
   const char *prog_path;
-  /* applied to the mainframe */
-  char *hints;
+  /* applied to the mainframe, converted once and evaluated in every new
+   * document */
+  JSStringRef hints;
   /* applied to all frames */
   const char *profile;
   const char *default_search;
@@ -839,7 +897,7 @@ struct _Misc {
   int tabbar_height;
   int favicon_size;
   TabPosition tab_position;
-  char *hint_style;
+  HintStyle hint_style;
   uint64_t script_signals;
   CloseLastTabPolicy clt_policy;
   ProgressBarStyle progress_bar_style;
@@ -851,6 +909,10 @@ struct _Misc {
   gint max_tabs;
   JsApi js_api;
 
+  int hibernate_timeout;
+  int hibernate_max_tabs;
+  int hibernate_memory_limit;
+
   GQuark https_quark;
 
 
@@ -883,6 +945,7 @@ enum Files {
   FILES_CUSTOM_KEYS,
   FILES_AUTOSTART,
   FILES_PLUGINDB,
+  FILES_PREPARED_SCRIPTS,
   FILES_LAST
 };
 // TODO implement plugins blocker, script blocker with File struct
@@ -1016,7 +1079,7 @@ void dwb_remove_download(const char *);
 void dwb_remove_history(const char *);
 void dwb_remove_quickmark(const char *);
 void dwb_remove_search_engine(const char *);
-DwbStatus dwb_evaluate_hints(const char *);
+DwbStatus dwb_evaluate_hints(const char *event, const char *action, const char *resource);
 void dwb_set_open_mode(Open);
 
 DwbStatus dwb_set_clipboard(const char *text, GdkAtom atom);
@@ -23,6 +23,7 @@
 #include "util.h"
 #include "scripts.h"
 #include "plugindb.h"
+#include "view.h"
 
 #define SCRIPT_PATH "dwb:script"
 #define HTML_REMOVE_BUTTON "<div style='float:right;cursor:pointer;' navigation='%s %s' onclick='location.reload();'>&times</div>"
@@ -50,6 +51,7 @@ DwbStatus html_scripts(GList *, HtmlTable *);
 DwbStatus html_keys(GList *, HtmlTable *);
 DwbStatus html_plugins(GList *, HtmlTable *);
 DwbStatus html_cookies(GList *, HtmlTable *);
+DwbStatus html_resources(GList *, HtmlTable *);
 
 
 static HtmlTable table[] = {
@@ -64,6 +66,7 @@ static HtmlTable table[] = {
     { SCRIPT_PATH,            "Scripts",        NULL,           0, html_scripts },
     { "dwb:startpage",         NULL,            NULL,           0, html_startpage },
     { "dwb:cookies",         "cookies",            NULL,           0, html_cookies },
+    { "dwb:resources",        "Resources",      INFO_FILE,      0, html_resources },
 };
 
 static char current_uri[BUFFER_LENGTH];
@@ -574,6 +577,89 @@ html_downloads(GList *gl, HtmlTable *table)
     return ret;
 }
 DwbStatus
+html_resources(GList *gl, HtmlTable *table) 
+{
+    DwbStatus ret;
+    WebKitWebView *wv = WEBVIEW(gl);
+    GString *panels = g_string_new(NULL);
+    guint hibernated;
+    guint64 reclaimed;
+    char *rss = g_format_size(view_get_rss());
+    char *reclaimed_size;
+
+    view_hibernate_stats(&hibernated, NULL, &reclaimed);
+    reclaimed_size = g_format_size(reclaimed);
+    g_string_append_printf(panels, "\n<tr class='dwb_table_row'>\n"
+            "<th class='dwb_table_headline' colspan='2'>Total</th></tr><tr>\n"
+            "<td class='dwb_table_cell_left'>memory %s</td>\n"
+            "<td class='dwb_table_cell_middle'>%d tabs, %u hibernated, %s reclaimed</td></tr>\n", 
+            rss, view_count(), hibernated, reclaimed_size);
+    g_free(rss);
+    g_free(reclaimed_size);
+
+    for (GList *l = dwb.state.views; l; l=l->next) 
+    {
+        ViewStats *stats = &VIEW(l)->status->stats;
+        char *title = g_markup_escape_text(view_get_title(l) ? view_get_title(l) : "---", -1);
+        char *uri = g_markup_escape_text(view_get_uri(l) ? view_get_uri(l) : "", -1);
+        char *bytes = g_format_size(stats->resource_bytes);
+        g_string_append_printf(panels, "\n<tr class='dwb_table_row'>\n"
+                "<th class='dwb_table_headline' colspan='2'>%d : %s</th></tr><tr>\n"
+                "<td class='dwb_table_cell_left'><a href='%s'>%s</a></td>\n", 
+                view_position(l) + 1, title, uri, uri);
+        if (VIEW_PLACEHOLDER(VIEW(l)))
+            g_string_append(panels, "<td class='dwb_table_cell_middle'>not loaded</td></tr>\n");
+        else 
+        {
+            g_string_append_printf(panels, "<td class='dwb_table_cell_middle'>"
+                    "%d frames, %lu elements, %u resources (%s), adblock %.1f ms, scripts %.1f ms, hints %.1f ms</td></tr>\n", 
+                    view_get_frame_count(l), view_get_dom_node_count(l), stats->resources, bytes,
+                    stats->adblock_time / 1000.0, stats->script_time / 1000.0, stats->base_time / 1000.0);
+        }
+        g_free(title);
+        g_free(uri);
+        g_free(bytes);
+    }
+    GSList *startup_times = g_slist_reverse(g_slist_copy(scripts_get_startup_times()));
+    if (startup_times != NULL)
+    {
+        g_string_append(panels, "\n<tr class='dwb_table_row'>\n"
+                "<th class='dwb_table_headline' colspan='2'>Userscripts</th></tr>\n");
+        for (GSList *l = startup_times; l; l=l->next) 
+        {
+            ScriptStartup *startup = l->data;
+            char *path = g_markup_escape_text(startup->path, -1);
+            g_string_append_printf(panels, "<tr><td class='dwb_table_cell_left'>%s</td>\n"
+                    "<td class='dwb_table_cell_middle'>load %.1f ms, compile %.1f ms, run %.1f ms</td></tr>\n", 
+                    path, startup->load / 1000.0, startup->compile / 1000.0, startup->run / 1000.0);
+            g_free(path);
+        }
+        g_slist_free(startup_times);
+    }
+    gboolean wrapper_headline = false;
+    for (int i=SCRIPTS_SIG_FIRST; i<SCRIPTS_SIG_LAST; i++) 
+    {
+        ScriptWrapperStats stats;
+        const char *signal = scripts_get_wrapper_stats(i, &stats);
+        if (stats.created == 0 && stats.reused == 0)
+            continue;
+        if (!wrapper_headline) 
+        {
+            g_string_append(panels, "\n<tr class='dwb_table_row'>\n"
+                    "<th class='dwb_table_headline' colspan='2'>Signal wrappers</th></tr>\n");
+            wrapper_headline = true;
+        }
+        g_string_append_printf(panels, "<tr><td class='dwb_table_cell_left'>%s</td>\n"
+                "<td class='dwb_table_cell_middle'>%u created, %u reused</td></tr>\n", 
+                signal, stats.created, stats.reused);
+    }
+    if ( (ret = html_load_page(wv, table, panels->str)) == STATUS_OK) 
+        g_signal_connect(wv, "notify::load-status", G_CALLBACK(html_load_status_cb), gl); 
+
+    g_string_free(panels, true);
+    return ret;
+}
+DwbStatus
 html_startpage(GList *gl, HtmlTable *table) 
 {
     return dwb_open_startpage(gl);
@@ -19,16 +19,32 @@
 #include "dwb.h"
 #include "ipc.h"
 #include "session.h"
+#include "view.h"
 #include <dwbremote.h>
 #include "soup.h"
 #include <string.h>
 #include <stdlib.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <glib/gstdio.h>
 #include <gdk/gdkx.h>
 #include <X11/Xlib.h>
 #include <X11/Xatom.h>
 #define IPC_EXECUTE(list) do { char *_ex_command = g_strjoinv(" ", list); s_dirty = true; dwb_parse_command_line(_ex_command); s_dirty = false; g_free(_ex_command); } while(0)
 
 #define OPTNL(cond) ((cond) ? "" : "\n")
+/* Clients that send longer lines are disconnected */
+#define IPC_MAX_LINE_LENGTH (1<<20)
+/* Number of hook events that are queued for a socket client, if a client
+ * doesn't read fast enough the oldest events are dropped */
+#define IPC_EVENT_QUEUE_LENGTH 256
+/* Queued events are only moved to the output buffer below this size, above
+ * it requests of the client are not read until the client has caught up */
+#define IPC_OUT_HIGH_WATER (1<<16)
 
 enum {
     DWB_ATOM_READ = 0, 
@@ -50,6 +66,65 @@ static gulong s_sig_focus;
 static Window s_root; 
 static int s_dirty;
 
+/*
+ * Besides X properties dwb listens on a unix socket, see
+ * dwbremote_get_socket_path. Requests use the same commands as dwbremote,
+ * every request carries an id that is sent back with the response, so clients
+ * can send any number of requests without waiting. All requests that arrive
+ * in one read are handled in one go and their responses are sent in a single
+ * write, output is buffered so that slow clients never block dwb.
+ * */
+typedef struct _IpcSubscription {
+    /* IPC_HOOK_* flags */
+    int hooks;
+    /* Tab numbers hooks that refer to a tab are restricted to, NULL for all
+     * tabs */
+    GSList *tabs;
+} IpcSubscription;
+
+typedef struct _IpcClient {
+    int ref;
+    int fd;
+    GIOChannel *channel;
+    guint in_source;
+    guint out_source;
+    GString *in;
+    GString *out;
+    gboolean closed;
+    /* Reading requests is paused while the output buffer is full */
+    gboolean paused;
+    /* Whether buffered requests are being answered */
+    gboolean handling;
+    /* The client has shut down writing, it is closed after the buffered
+     * requests have been answered */
+    gboolean eof;
+    /* Whether the client has registered keybindings */
+    gboolean binds;
+    IpcSubscription subscription;
+    /* Ring buffer of formatted hook events */
+    char *events[IPC_EVENT_QUEUE_LENGTH];
+    int event_head;
+    int event_count;
+    /* Events that were dropped since the last notification */
+    gulong dropped;
+} IpcClient;
+
+/* Hooks of clients that use X properties */
+static IpcSubscription s_x_subscription;
+
+static int s_socket = -1;
+static char *s_socket_path;
+static GIOChannel *s_socket_channel;
+static guint s_socket_source;
+static GSList *s_clients;
+/* The client whose request is currently handled */
+static IpcClient *s_current_client;
+
+static void ipc_client_send(IpcClient *client, const char *id, char **list, int count);
+static void ipc_client_push_event(IpcClient *client, char *frame);
+static gboolean ipc_client_in_cb(GIOChannel *channel, GIOCondition condition, IpcClient *client);
+static void ipc_client_handle_input(IpcClient *client);
+
 static long 
 get_number(const char *text)
 {
@@ -104,23 +179,94 @@ send_hook_list(const char *action, char **list, int count)
     GString *response = g_string_new(action);
     for (int i=0; i<count; i++)
         g_string_append_printf(response, " %s", list[i]);
-    ipc_send_hook("hook", response->str);
+    ipc_send_hook(IPC_HOOK_hook, "hook", 0, "%s", response->str);
     g_string_free(response, true);
 }
+/* The subscription hook commands refer to, each socket client has its own */
+static IpcSubscription *
+get_subscription()
+{
+    return s_current_client != NULL ? &s_current_client->subscription : &s_x_subscription;
+}
+
+/* dwb.state.ipc_hooks is the union of all subscriptions, so that hooks
+ * nobody listens to aren't even formatted */
+static void 
+update_hooks()
+{
+    dwb.state.ipc_hooks = s_x_subscription.hooks;
+    for (GSList *l = s_clients; l; l=l->next)
+        dwb.state.ipc_hooks |= ((IpcClient *)l->data)->subscription.hooks;
+}
+
+static gboolean 
+subscription_matches(IpcSubscription *s, int hook, int tab)
+{
+    return (s->hooks & hook) && (tab == 0 || s->tabs == NULL || g_slist_find(s->tabs, GINT_TO_POINTER(tab)) != NULL);
+}
+
+static int 
+set_hook_tabs(IpcSubscription *s, char **list, int count)
+{
+    GSList *tabs = NULL;
+    long n;
+    for (int i=0; i<count; i++)
+    {
+        if ((n = get_number(list[i])) <= 0)
+        {
+            g_slist_free(tabs);
+            return 37;
+        }
+        tabs = g_slist_prepend(tabs, GINT_TO_POINTER(n));
+    }
+    g_slist_free(s->tabs);
+    s->tabs = tabs;
+    return 0;
+}
+
+/* Host or domain of a tab, placeholder tabs don't have a main frame */
+static const char *
+get_host(GList *gl, gboolean domain)
+{
+    WebKitWebFrame *frame;
+    if (VIEW(gl)->web == NULL)
+        return NULL;
+    frame = webkit_web_view_get_main_frame(WEBVIEW(gl));
+    return domain ? dwb_soup_get_domain(frame) : dwb_soup_get_host(frame);
+}
+
 static DwbStatus 
 bind_callback(KeyMap *map, Arg *a)
 {
-    char *data = g_strdup_printf("%d %s", g_list_position(dwb.state.views, dwb.state.fview), CURRENT_URL());
+    char *data = g_strdup_printf("%d %s", view_position(dwb.state.fview), CURRENT_URL());
     char *argv[2] = { a->arg, data };
-    dwbremote_set_property_list(s_dpy, s_win, s_atoms[DWB_ATOM_BIND], argv, 2);
+    if (s_win != 0)
+        dwbremote_set_property_list(s_dpy, s_win, s_atoms[DWB_ATOM_BIND], argv, 2);
+
+    /* Bind events share the bounded queue of the hook events */
+    char *event[3] = { "bind", a->arg, data };
+    char *frame = NULL;
+    for (GSList *l = s_clients; l; l=l->next)
+    {
+        IpcClient *client = l->data;
+        if (client->closed || !client->binds)
+            continue;
+        if (frame == NULL && (frame = dwbremote_format_frame(DWB_IPC_EVENT_ID, event, 3)) == NULL)
+            break;
+        ipc_client_push_event(client, g_strdup(frame));
+    }
+    free(frame);
+    g_free(data);
     return STATUS_OK;
 }
 
+/* Executes a command, text is set to the response or NULL */
 static int 
-parse_commands(char **list, int count)
+parse_commands(char **list, int count, char **response)
 {
     int status = 0;
     char *text = NULL; 
+    *response = NULL;
     if (count < 1 || (*list[0] != ':' && count < 2))
         return 37;
     if (*list[0] == ':')
@@ -168,7 +314,7 @@ parse_commands(char **list, int count)
             if ((n = get_number(list[argc])) != -1)
             {
                 argc++;
-                l = g_list_nth(dwb.state.views, n - 1);
+                l = view_nth(n - 1);
                 if (l == NULL)
                 {
                     return -1;
@@ -177,27 +323,27 @@ parse_commands(char **list, int count)
         }
         if (STREQ(list[argc], "uri"))
         {
-            text = g_strdup(webkit_web_view_get_uri(WEBVIEW(l)));
+            text = g_strdup(view_get_uri(l));
         }
         else if (STREQ(list[argc], "domain"))
         {
-            const char *domain = dwb_soup_get_domain(webkit_web_view_get_main_frame(WEBVIEW(l)));
+            const char *domain = get_host(l, true);
             text = g_strdup(domain != NULL ? domain : "null");
 
         }
         else if (STREQ(list[argc], "host"))
         {
-            const char *host = dwb_soup_get_host(webkit_web_view_get_main_frame(WEBVIEW(l)));
+            const char *host = get_host(l, false);
             text = g_strdup(host != NULL ? host : "null");
 
         }
         else if (STREQ(list[argc], "title"))
         {
-            text = g_strdup(webkit_web_view_get_title(WEBVIEW(l)));
+            text = g_strdup(view_get_title(l));
         }
         else if (STREQ(list[argc], "ntabs"))
         {
-            text = g_strdup_printf("%d", g_list_length(dwb.state.views));
+            text = g_strdup_printf("%d", view_count());
         }
         else if (STREQ(list[argc], "all_uris"))
         {
@@ -205,7 +351,7 @@ parse_commands(char **list, int count)
             int i=1;
             for (GList *l = dwb.state.views; l; l=l->next, i++)
             {
-                const char *uri = VIEW(l)->status->deferred && VIEW(l)->status->deferred_uri ? VIEW(l)->status->deferred_uri : webkit_web_view_get_uri(WEBVIEW(l));
+                const char *uri = view_get_uri(l);
                 g_string_append_printf(s, "%s%d %s", OPTNL(l == dwb.state.views), i, uri);
             }
             text = s->str;
@@ -216,7 +362,7 @@ parse_commands(char **list, int count)
             GString *s = g_string_new(NULL);
             int i=1;
             for (GList *l = dwb.state.views; l; l=l->next, i++)
-                g_string_append_printf(s, "%s%d %s", OPTNL(l == dwb.state.views), i, webkit_web_view_get_title(WEBVIEW(l)));
+                g_string_append_printf(s, "%s%d %s", OPTNL(l == dwb.state.views), i, view_get_title(l));
             text = s->str;
             g_string_free(s, false);
         }
@@ -225,7 +371,7 @@ parse_commands(char **list, int count)
             GString *s = g_string_new(NULL);
             int i=1;
             for (GList *l = dwb.state.views; l; l=l->next, i++)
-                g_string_append_printf(s, "%s%d %s", OPTNL(l == dwb.state.views), i, dwb_soup_get_host(webkit_web_view_get_main_frame(WEBVIEW(l))));
+                g_string_append_printf(s, "%s%d %s", OPTNL(l == dwb.state.views), i, get_host(l, false));
             text = s->str;
             g_string_free(s, false);
         }
@@ -234,14 +380,23 @@ parse_commands(char **list, int count)
             GString *s = g_string_new(NULL);
             int i=1;
             for (GList *l = dwb.state.views; l; l=l->next, i++)
-                g_string_append_printf(s, "%s%d %s", OPTNL(l == dwb.state.views), i, dwb_soup_get_domain(webkit_web_view_get_main_frame(WEBVIEW(l))));
+                g_string_append_printf(s, "%s%d %s", OPTNL(l == dwb.state.views), i, get_host(l, true));
             text = s->str;
             g_string_free(s, false);
         }
         else if (STREQ(list[argc], "current_tab"))
         {
-            dwbremote_set_formatted_property_value(s_dpy, s_win, s_atoms[DWB_ATOM_WRITE],
-                    "%d", g_list_position(dwb.state.views, dwb.state.fview) + 1);
+            text = g_strdup_printf("%d", view_position(dwb.state.fview) + 1);
+        }
+        else if (STREQ(list[argc], "history") && VIEW_PLACEHOLDER(VIEW(l)))
+        {
+            GString *s = g_string_new(NULL);
+            TabHistory *th = VIEW(l)->status->placeholder;
+            int i = -th->current;
+            for (GList *item = th->items; item; item=item->next, i++)
+                g_string_append_printf(s, "%s%d %s", OPTNL(item == th->items), i, ((Navigation*)item->data)->first);
+            text = s->str;
+            g_string_free(s, false);
         }
         else if (STREQ(list[argc], "history"))
         {
@@ -269,23 +424,23 @@ parse_commands(char **list, int count)
         {
             WebSettings *s = g_hash_table_lookup(dwb.settings, list[argc+1]);
             if (s == NULL) 
-                dwbremote_set_property_value(s_dpy, s_win, s_atoms[DWB_ATOM_WRITE], "(not found)");
+                text = g_strdup("(not found)");
             else 
             {
                 switch (s->type) 
                 {
                     case INTEGER : 
-                        dwbremote_set_formatted_property_value(s_dpy, s_win, s_atoms[DWB_ATOM_WRITE], "%d", s->arg_local.i);
+                        text = g_strdup_printf("%d", s->arg_local.i);
                         break;
                     case DOUBLE : 
-                        dwbremote_set_formatted_property_value(s_dpy, s_win, s_atoms[DWB_ATOM_WRITE], "%.2f", s->arg_local.d);
+                        text = g_strdup_printf("%.2f", s->arg_local.d);
                         break;
                     case BOOLEAN : 
-                        dwbremote_set_property_value(s_dpy, s_win, s_atoms[DWB_ATOM_WRITE], s->arg_local.b ? "true" : "false");
+                        text = g_strdup(s->arg_local.b ? "true" : "false");
                         break;
                     case CHAR : 
                     case COLOR_CHAR : 
-                        dwbremote_set_property_value(s_dpy, s_win, s_atoms[DWB_ATOM_WRITE], s->arg_local.p ? s->arg_local.p : "(none)");
+                        text = g_strdup(s->arg_local.p ? s->arg_local.p : "(none)");
                         break;
                     default : break;
                 }
@@ -300,18 +455,26 @@ parse_commands(char **list, int count)
     {
         if (dwb.state.ipc_hooks & IPC_HOOK_hook)
             send_hook_list("clear", &list[1], count-1);
-        dwb.state.ipc_hooks &= ~get_hooks(&list[1], count-1);
+        get_subscription()->hooks &= ~get_hooks(&list[1], count-1);
+        update_hooks();
     }
     else if (STREQ(list[0], "hook") || STREQ(list[0], "add_hooks"))
     {
         if (dwb.state.ipc_hooks & IPC_HOOK_hook)
             send_hook_list("add", &list[1], count-1);
-        dwb.state.ipc_hooks |= get_hooks(&list[1], count-1);
+        get_subscription()->hooks |= get_hooks(&list[1], count-1);
+        update_hooks();
+    }
+    else if (STREQ(list[0], "hook_tabs"))
+    {
+        status = set_hook_tabs(get_subscription(), &list[1], count-1);
     }
     else if (STREQ(list[0], "bind"))
     {
         char *com, *shortcut;
         int options = 0;
+        if (s_current_client != NULL)
+            s_current_client->binds = true;
         for (int i=1; i<count; i++)
         {
             char **binds = g_strsplit(list[i], ":", -1);
@@ -340,11 +503,7 @@ parse_commands(char **list, int count)
     {
         return 37;
     }
-    if (text != NULL)
-    {
-        dwbremote_set_property_value(s_dpy, s_win, s_atoms[DWB_ATOM_WRITE], text);
-        g_free(text);
-    }
+    *response = text;
     return status;
 }
 
@@ -353,6 +512,7 @@ on_property_notify(GtkWidget *widget, GdkEventProperty *e, gpointer data)
 {
     static int status, count;
     char **list;
+    char *text;
 
     if (e->state == GDK_PROPERTY_NEW_VALUE && e->atom == s_readatom)
     {
@@ -361,7 +521,16 @@ on_property_notify(GtkWidget *widget, GdkEventProperty *e, gpointer data)
             return false;
         }
 
-        status = parse_commands(list, count);
+        /* Requests of socket clients may run a nested main loop */
+        IpcClient *current = s_current_client;
+        s_current_client = NULL;
+        status = parse_commands(list, count, &text);
+        s_current_client = current;
+        if (text != NULL)
+        {
+            dwbremote_set_property_value(s_dpy, s_win, s_atoms[DWB_ATOM_WRITE], text);
+            g_free(text);
+        }
 
         XDeleteProperty(s_dpy, s_win, s_atoms[DWB_ATOM_READ]);
         dwbremote_set_int_property(s_dpy, s_win, s_atoms[DWB_ATOM_STATUS], status);
@@ -398,21 +567,404 @@ on_focus_in(GtkWidget *widget, GdkEventFocus *e, gpointer data)
     return false;
 }
 
+/* SOCKET {{{*/
+/* ipc_client_unref {{{*/
+static void
+ipc_client_unref(IpcClient *client)
+{
+    if (--client->ref > 0)
+        return;
+    for (int i=0; i<client->event_count; i++)
+        g_free(client->events[(client->event_head + i) % IPC_EVENT_QUEUE_LENGTH]);
+    g_slist_free(client->subscription.tabs);
+    g_string_free(client->in, true);
+    g_string_free(client->out, true);
+    g_free(client);
+}/*}}}*/
+
+/* ipc_client_close {{{*/
+static void
+ipc_client_close(IpcClient *client)
+{
+    if (client->closed)
+        return;
+    client->closed = true;
+    if (client->in_source != 0)
+        g_source_remove(client->in_source);
+    if (client->out_source != 0)
+        g_source_remove(client->out_source);
+    client->in_source = client->out_source = 0;
+    g_io_channel_shutdown(client->channel, false, NULL);
+    g_io_channel_unref(client->channel);
+    s_clients = g_slist_remove(s_clients, client);
+    update_hooks();
+    ipc_client_unref(client);
+}/*}}}*/
+
+/* ipc_client_fill {{{*/
+/* Moves queued events to the output buffer, the output buffer of a client
+ * that doesn't read stays bounded */
+static void
+ipc_client_fill(IpcClient *client)
+{
+    while (client->event_count > 0 && client->out->len < IPC_OUT_HIGH_WATER)
+    {
+        if (client->dropped > 0)
+        {
+            g_string_append_printf(client->out, "%s\tdropped\t%lu\n", DWB_IPC_EVENT_ID, client->dropped);
+            client->dropped = 0;
+        }
+        g_string_append(client->out, client->events[client->event_head]);
+        g_free(client->events[client->event_head]);
+        client->event_head = (client->event_head + 1) % IPC_EVENT_QUEUE_LENGTH;
+        client->event_count--;
+    }
+}/*}}}*/
+
+/* ipc_client_flush {{{*/
+/* Writes as much as possible without blocking, returns false if the client
+ * has gone */
+static gboolean
+ipc_client_flush(IpcClient *client)
+{
+    while (ipc_client_fill(client), client->out->len > 0)
+    {
+        /* A client that has gone must not raise SIGPIPE */
+        ssize_t w = send(client->fd, client->out->str, client->out->len, MSG_NOSIGNAL);
+        if (w == -1)
+        {
+            if (errno == EINTR)
+                continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+                return true;
+            return false;
+        }
+        g_string_erase(client->out, 0, w);
+    }
+    return true;
+}/*}}}*/
+
+/* ipc_client_done {{{*/
+/* Whether a client that has shut down writing has got all its responses */
+static gboolean
+ipc_client_done(IpcClient *client)
+{
+    return client->eof && !client->handling && client->out->len == 0 && client->event_count == 0 
+        && memchr(client->in->str, '\n', client->in->len) == NULL;
+}/*}}}*/
+
+/* ipc_client_out_cb {{{*/
+static gboolean
+ipc_client_out_cb(GIOChannel *channel, GIOCondition condition, IpcClient *client)
+{
+    if (!ipc_client_flush(client))
+    {
+        client->out_source = 0;
+        ipc_client_close(client);
+        return false;
+    }
+    /* The client has caught up, buffered requests are answered before new
+     * requests are read */
+    if (client->paused && client->out->len < IPC_OUT_HIGH_WATER)
+    {
+        client->ref++;
+        ipc_client_handle_input(client);
+        if (!client->closed && client->out->len < IPC_OUT_HIGH_WATER)
+        {
+            client->paused = false;
+            if (!client->eof)
+                client->in_source = g_io_add_watch(client->channel, G_IO_IN | G_IO_HUP | G_IO_ERR, (GIOFunc)ipc_client_in_cb, client);
+        }
+        gboolean closed = client->closed;
+        ipc_client_unref(client);
+        if (closed)
+            return false;
+    }
+    if (client->out->len == 0 && client->event_count == 0)
+    {
+        client->out_source = 0;
+        if (ipc_client_done(client))
+            ipc_client_close(client);
+        return false;
+    }
+    return true;
+}/*}}}*/
+
+/* ipc_client_schedule_flush {{{*/
+static void
+ipc_client_schedule_flush(IpcClient *client)
+{
+    if (!client->closed && (client->out->len > 0 || client->event_count > 0) && client->out_source == 0)
+        client->out_source = g_io_add_watch(client->channel, G_IO_OUT, (GIOFunc)ipc_client_out_cb, client);
+}/*}}}*/
+
+/* ipc_client_send {{{*/
+/* Queues a frame, it is written when dwb is idle */
+static void
+ipc_client_send(IpcClient *client, const char *id, char **list, int count)
+{
+    if (client->closed)
+        return;
+    char *frame = dwbremote_format_frame(id, list, count);
+    if (frame != NULL)
+    {
+        g_string_append(client->out, frame);
+        free(frame);
+    }
+    ipc_client_schedule_flush(client);
+}/*}}}*/
+
+/* ipc_client_push_event {{{*/
+/* Queues a hook event, takes ownership of frame. If the queue is full the
+ * oldest event is dropped, the client is notified with a dropped event */
+static void
+ipc_client_push_event(IpcClient *client, char *frame)
+{
+    if (client->event_count == IPC_EVENT_QUEUE_LENGTH)
+    {
+        g_free(client->events[client->event_head]);
+        client->event_head = (client->event_head + 1) % IPC_EVENT_QUEUE_LENGTH;
+        client->event_count--;
+        client->dropped++;
+    }
+    client->events[(client->event_head + client->event_count) % IPC_EVENT_QUEUE_LENGTH] = frame;
+    client->event_count++;
+    ipc_client_schedule_flush(client);
+}/*}}}*/
+
+/* ipc_client_handle_line {{{*/
+static void
+ipc_client_handle_line(IpcClient *client, char *line)
+{
+    char **list = NULL;
+    int count;
+    char *text = NULL;
+    char status[16];
+
+    if (*line == '\0' || !dwbremote_parse_frame(line, &list, &count))
+    {
+        free(list);
+        return;
+    }
+    /* The first field is the id, commands may run a nested main loop that
+     * handles other requests */
+    IpcClient *current = s_current_client;
+    s_current_client = client;
+    snprintf(status, sizeof(status), "%d", count > 1 ? parse_commands(&list[1], count - 1, &text) : 37);
+    s_current_client = current;
+
+    char *response[2] = { status, text };
+    ipc_client_send(client, list[0], response, text != NULL ? 2 : 1);
+    g_free(text);
+    free(list);
+}/*}}}*/
+
+/* ipc_client_handle_input {{{*/
+/* Answers the complete requests that have been read, stops while the output
+ * buffer is above the high water mark */
+static void
+ipc_client_handle_input(IpcClient *client)
+{
+    char *end, *line;
+
+    if (client->handling)
+        return;
+    client->handling = true;
+    while (!client->closed && client->out->len < IPC_OUT_HIGH_WATER 
+            && (end = memchr(client->in->str, '\n', client->in->len)) != NULL)
+    {
+        /* Commands may run a nested main loop, e.g. prompts, that appends to
+         * the input buffer */
+        line = g_strndup(client->in->str, end - client->in->str);
+        g_string_erase(client->in, 0, end - client->in->str + 1);
+        ipc_client_handle_line(client, line);
+        g_free(line);
+    }
+    client->handling = false;
+}/*}}}*/
+
+/* ipc_client_in_cb {{{*/
+static gboolean
+ipc_client_in_cb(GIOChannel *channel, GIOCondition condition, IpcClient *client)
+{
+    char buffer[8192];
+    ssize_t r = 1;
+    gboolean error = false;
+
+    /* Fast writers must not keep dwb busy forever, the rest is read in the
+     * next iteration */
+    while (client->in->len < IPC_MAX_LINE_LENGTH && (r = read(client->fd, buffer, sizeof(buffer))) != 0)
+    {
+        if (r == -1)
+        {
+            if (errno == EINTR)
+                continue;
+            error = errno != EAGAIN && errno != EWOULDBLOCK;
+            break;
+        }
+        g_string_append_len(client->in, buffer, r);
+    }
+    /* No more requests are read but the buffered requests are still
+     * answered */
+    if (r == 0)
+        client->eof = true;
+
+    /* The client must not be freed while a nested main loop runs */
+    client->ref++;
+    ipc_client_handle_input(client);
+
+    if (client->in->len > IPC_MAX_LINE_LENGTH && memchr(client->in->str, '\n', client->in->len) == NULL)
+        error = true;
+    if (!client->closed)
+    {
+        if (error || !ipc_client_flush(client))
+        {
+            /* Responses that are still queued are dropped */
+            client->in_source = 0;
+            ipc_client_close(client);
+        }
+        else 
+        {
+            /* Requests are not read until the client reads its responses */
+            if (client->out->len >= IPC_OUT_HIGH_WATER)
+                client->paused = true;
+            if (client->paused || client->eof)
+                client->in_source = 0;
+            ipc_client_schedule_flush(client);
+            if (ipc_client_done(client))
+                ipc_client_close(client);
+        }
+    }
+    gboolean ret = !client->closed && !client->paused && !client->eof;
+    ipc_client_unref(client);
+    return ret;
+}/*}}}*/
+
+/* ipc_socket_accept_cb {{{*/
+static gboolean
+ipc_socket_accept_cb(GIOChannel *channel, GIOCondition condition, gpointer data)
+{
+    int fd = accept(s_socket, NULL, NULL);
+    if (fd == -1)
+        return true;
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+    fcntl(fd, F_SETFD, FD_CLOEXEC);
+
+    IpcClient *client = g_malloc0(sizeof(IpcClient));
+    client->ref = 1;
+    client->fd = fd;
+    client->channel = g_io_channel_unix_new(fd);
+    client->in = g_string_new(NULL);
+    client->out = g_string_new(NULL);
+    client->in_source = g_io_add_watch(client->channel, G_IO_IN | G_IO_HUP | G_IO_ERR, (GIOFunc)ipc_client_in_cb, client);
+    s_clients = g_slist_prepend(s_clients, client);
+    return true;
+}/*}}}*/
+
+/* ipc_socket_start {{{*/
+static void
+ipc_socket_start(Window win)
+{
+    struct sockaddr_un addr;
+    char path[sizeof(addr.sun_path)];
+
+    if (s_socket != -1 || !dwbremote_get_socket_path(path, sizeof(path), win, 1))
+        return;
+    if ((s_socket = socket(AF_UNIX, SOCK_STREAM, 0)) == -1)
+        return;
+    fcntl(s_socket, F_SETFD, FD_CLOEXEC);
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    g_strlcpy(addr.sun_path, path, sizeof(addr.sun_path));
+    /* A socket of a crashed instance with a recycled window id, the directory
+     * is private */
+    g_unlink(path);
+
+    mode_t mask = umask(0077);
+    int ret = bind(s_socket, (struct sockaddr *)&addr, sizeof(addr));
+    umask(mask);
+    if (ret == -1 || listen(s_socket, 16) == -1)
+    {
+        fprintf(stderr, "Cannot listen on %s: %s\n", path, g_strerror(errno));
+        close(s_socket);
+        s_socket = -1;
+        return;
+    }
+    s_socket_path = g_strdup(path);
+    s_socket_channel = g_io_channel_unix_new(s_socket);
+    s_socket_source = g_io_add_watch(s_socket_channel, G_IO_IN, ipc_socket_accept_cb, NULL);
+}/*}}}*/
+
+/* ipc_socket_end {{{*/
+static void
+ipc_socket_end()
+{
+    if (s_socket == -1)
+        return;
+    while (s_clients != NULL)
+    {
+        /* Best effort, e.g. for the quit hook */
+        ipc_client_flush(s_clients->data);
+        ipc_client_close(s_clients->data);
+    }
+    g_source_remove(s_socket_source);
+    g_io_channel_unref(s_socket_channel);
+    close(s_socket);
+    s_socket = -1;
+    g_unlink(s_socket_path);
+    g_free(s_socket_path);
+    s_socket_path = NULL;
+}/*}}}*/
+
+/* ipc_get_socket_path {{{*/
+/* The path of the ipc socket or NULL if ipc is disabled */
+const char *
+ipc_get_socket_path()
+{
+    return s_socket_path;
+}/*}}}*/
+/*}}}*/
+
+/* Sends a hook to all subscribers, tab is the tab number the hook refers to
+ * or 0, if set it is prepended to the message. Socket clients only get the
+ * event queued, the message is formatted once for all of them. */
 void 
-ipc_send_hook(char *name, const char *format, ...)
+ipc_send_hook(int hook, const char *name, int tab, const char *format, ...)
 {
     va_list arg_list; 
-    char buffer[4096];
-    if (format != NULL)
+    GString *message = NULL;
+    char *frame = NULL;
+
+    if (tab > 0 || format != NULL)
     {
-        va_start(arg_list, format);
-        vsnprintf(buffer, sizeof(buffer), format, arg_list);
-        va_end(arg_list);
-        char *argv[] = { name, buffer };
-        dwbremote_set_property_list(s_dpy, s_win, s_atoms[DWB_ATOM_HOOK], argv, 2);
+        message = g_string_new(NULL);
+        if (tab > 0)
+            g_string_append_printf(message, format != NULL ? "%d " : "%d", tab);
+        if (format != NULL)
+        {
+            va_start(arg_list, format);
+            g_string_append_vprintf(message, format, arg_list);
+            va_end(arg_list);
+        }
     }
-    else 
-        dwbremote_set_property_value(s_dpy, s_win, s_atoms[DWB_ATOM_HOOK], name);
+    char *argv[] = { (char *)name, message != NULL ? message->str : NULL };
+
+    if (s_win != 0 && subscription_matches(&s_x_subscription, hook, tab))
+        dwbremote_set_property_list(s_dpy, s_win, s_atoms[DWB_ATOM_HOOK], argv, message != NULL ? 2 : 1);
+
+    for (GSList *l = s_clients; l; l=l->next)
+    {
+        IpcClient *client = l->data;
+        if (client->closed || !subscription_matches(&client->subscription, hook, tab))
+            continue;
+        if (frame == NULL && (frame = dwbremote_format_frame(DWB_IPC_EVENT_ID, argv, message != NULL ? 2 : 1)) == NULL)
+            break;
+        ipc_client_push_event(client, g_strdup(frame));
+    }
+    free(frame);
+    if (message != NULL)
+        g_string_free(message, true);
 }
 void 
 ipc_send_end_win(void) {
@@ -437,12 +989,16 @@ ipc_end(GtkWidget *widget)
         XDeleteProperty(s_dpy, s_win, s_atoms[DWB_ATOM_FOCUS_ID]);
         s_sig_focus = 0;
     }
+    ipc_socket_end();
     s_win = 0;
 }
 void 
 ipc_start(GtkWidget *widget)
 {
-    dwb.state.ipc_hooks = 0;
+    s_x_subscription.hooks = 0;
+    g_slist_free(s_x_subscription.tabs);
+    s_x_subscription.tabs = NULL;
+    update_hooks();
 
     GdkWindow *gdkwin = gtk_widget_get_window(widget);
 
@@ -471,4 +1027,6 @@ ipc_start(GtkWidget *widget)
 
     s_sig_property = g_signal_connect(G_OBJECT(widget), "property-notify-event", G_CALLBACK(on_property_notify), NULL);
     s_sig_focus = g_signal_connect(G_OBJECT(widget), "focus-in-event", G_CALLBACK(on_focus_in), NULL);
+
+    ipc_socket_start(s_win);
 }
@@ -38,10 +38,15 @@ enum {
 
 void ipc_start(GtkWidget *);
 void ipc_end(GtkWidget *);
-void ipc_send_hook(char *hook, const char *format, ...);
+void ipc_send_hook(int hook, const char *name, int tab, const char *format, ...);
 void ipc_send_end_win(void);
+const char * ipc_get_socket_path(void);
 
 #define IPC_SEND_HOOK(hook, ...); do { \
-    if (dwb.state.ipc_hooks & IPC_HOOK_##hook) ipc_send_hook(#hook, __VA_ARGS__); \
+    if (dwb.state.ipc_hooks & IPC_HOOK_##hook) ipc_send_hook(IPC_HOOK_##hook, #hook, 0, __VA_ARGS__); \
+    } while(0)
+/* Hooks that refer to a tab, the tab number is prepended to the message */
+#define IPC_SEND_TAB_HOOK(hook, tab, ...) do { \
+    if (dwb.state.ipc_hooks & IPC_HOOK_##hook) ipc_send_hook(IPC_HOOK_##hook, #hook, (tab), __VA_ARGS__); \
     } while(0)
 #endif
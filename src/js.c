@@ -189,25 +189,22 @@ js_context_change(JSContextRef source_ctx, JSContextRef dest_ctx, JSValueRef val
     return ret;
 }
 
-/* js_create_object(WebKitWebFrame *frame, const char *) 
+/* js_create_object_from_string(WebKitWebFrame *frame, JSStringRef, JSStringRef) 
  *
- * Executes a script in a function scope, should return an object with
- * function-properties
+ * Same as js_create_object but takes an already converted script, so the same
+ * source can be evaluated in many frames without converting it again
  * {{{*/
 JSObjectRef 
-js_create_object(WebKitWebFrame *frame, const char *script) 
+js_create_object_from_string(WebKitWebFrame *frame, JSStringRef script, JSStringRef sourceurl) 
 {
     if (script == NULL)
         return NULL;
 
-    JSStringRef js_script;
     JSValueRef ret, exc = NULL;
     JSObjectRef return_object;
 
     JSContextRef ctx = webkit_web_frame_get_global_context(frame);
-    js_script = JSStringCreateWithUTF8CString(script);
-    ret = JSEvaluateScript(ctx, js_script, NULL, NULL, 0, &exc);
-    JSStringRelease(js_script);
+    ret = JSEvaluateScript(ctx, script, NULL, sourceurl, 0, &exc);
     if (exc != NULL)
         return NULL;
 
@@ -218,6 +215,23 @@ js_create_object(WebKitWebFrame *frame, const char *script)
     return return_object;
 }/*}}}*/
 
+/* js_create_object(WebKitWebFrame *frame, const char *) 
+ *
+ * Executes a script in a function scope, should return an object with
+ * function-properties
+ * {{{*/
+JSObjectRef 
+js_create_object(WebKitWebFrame *frame, const char *script) 
+{
+    if (script == NULL)
+        return NULL;
+
+    JSStringRef js_script = JSStringCreateWithUTF8CString(script);
+    JSObjectRef ret = js_create_object_from_string(frame, js_script, NULL);
+    JSStringRelease(js_script);
+    return ret;
+}/*}}}*/
+
 /* js_call_as_function(WebKitWebFrame, JSObjectRef, char *string, char *json, * char **ret) {{{*/
 char *  
 js_call_as_function(WebKitWebFrame *frame, JSObjectRef obj, const char *string, const char *json, JSType arg_type, char **char_ret) 
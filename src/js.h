@@ -49,6 +49,7 @@ char * js_get_string_property(JSContextRef ctx, JSObjectRef arg, const char *nam
 double  js_get_double_property(JSContextRef ctx, JSObjectRef arg, const char *name);
 double  js_val_get_double_property(JSContextRef ctx, JSValueRef arg, const char *name, JSValueRef *exc);
 JSObjectRef js_create_object(WebKitWebFrame *, const char *);
+JSObjectRef js_create_object_from_string(WebKitWebFrame *, JSStringRef script, JSStringRef sourceurl);
 char * js_call_as_function(WebKitWebFrame *, JSObjectRef, const char *string, const char *args, JSType, char **char_ret);
 JSValueRef js_char_to_value(JSContextRef ctx, const char *text);
 char * js_value_to_json(JSContextRef ctx, JSValueRef value, size_t limit, int indent, JSValueRef *exc);
@@ -0,0 +1,356 @@
+/*
+ * Copyright (c) 2010-2014 Stefan Bolte <portix@gmx.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <string.h>
+#include <errno.h>
+#include <gio/gio.h>
+#include "dwb.h"
+#include "pipeline.h"
+
+/*
+ * Post processing of finished downloads. The stages run in order on a
+ * separate thread: hashing the file, decompressing gzip files and moving the
+ * file to another directory. The thread only touches the Pipeline, the
+ * finished callback is invoked on the main loop. Existing files are never
+ * replaced, a number is appended to the name instead.
+ * */
+
+#define PIPELINE_BLOCK_SIZE (1<<16)
+
+typedef struct _PipelineChecksum {
+    GChecksumType type;
+    /* A checksum that already contains the first offset bytes or NULL */
+    GChecksum *checksum;
+    char *digest;
+} PipelineChecksum;
+
+struct _Pipeline {
+    char *path;
+    GSList *checksums;
+    goffset offset;
+    gboolean decompress;
+    char *directory;
+    char *error;
+    char *warning;
+    PipelineFunc finished;
+    gpointer data;
+};
+
+/* pipeline_new {{{*/
+Pipeline *
+pipeline_new(const char *path)
+{
+    Pipeline *p = g_malloc0(sizeof(Pipeline));
+    p->path = g_strdup(path);
+    return p;
+}/*}}}*/
+
+/* pipeline_free {{{*/
+void
+pipeline_free(Pipeline *p)
+{
+    for (GSList *l = p->checksums; l; l=l->next)
+    {
+        PipelineChecksum *c = l->data;
+        if (c->checksum != NULL)
+            g_checksum_free(c->checksum);
+        g_free(c->digest);
+        g_free(c);
+    }
+    g_slist_free(p->checksums);
+    g_free(p->path);
+    g_free(p->directory);
+    g_free(p->error);
+    g_free(p->warning);
+    g_free(p);
+}/*}}}*/
+
+/* SETTER {{{*/
+void
+pipeline_add_checksum(Pipeline *p, GChecksumType type)
+{
+    PipelineChecksum *c = g_malloc0(sizeof(PipelineChecksum));
+    c->type = type;
+    p->checksums = g_slist_append(p->checksums, c);
+}
+/* Continues a checksum that already contains the first offset bytes of the
+ * file, takes ownership of checksum. All continued checksums must have the
+ * same offset. */
+void
+pipeline_continue_checksum(Pipeline *p, GChecksumType type, GChecksum *checksum, goffset offset)
+{
+    PipelineChecksum *c = g_malloc0(sizeof(PipelineChecksum));
+    c->type = type;
+    c->checksum = checksum;
+    p->offset = offset;
+    p->checksums = g_slist_append(p->checksums, c);
+}
+void
+pipeline_set_decompress(Pipeline *p, gboolean decompress)
+{
+    p->decompress = decompress;
+}
+void
+pipeline_set_move_directory(Pipeline *p, const char *directory)
+{
+    g_free(p->directory);
+    p->directory = directory != NULL && *directory != '\0' ? g_strdup(directory) : NULL;
+}
+gboolean
+pipeline_is_empty(Pipeline *p)
+{
+    return p->checksums == NULL && !p->decompress && p->directory == NULL;
+}/*}}}*/
+
+/* GETTER {{{*/
+/* The path of the file after all stages have run */
+const char *
+pipeline_get_path(Pipeline *p)
+{
+    return p->path;
+}
+/* The error message if a stage failed, NULL otherwise */
+const char *
+pipeline_get_error(Pipeline *p)
+{
+    return p->error;
+}
+/* Non fatal errors, e.g. a file that couldn't be decompressed */
+const char *
+pipeline_get_warning(Pipeline *p)
+{
+    return p->warning;
+}
+const char *
+pipeline_get_checksum(Pipeline *p, GChecksumType type)
+{
+    for (GSList *l = p->checksums; l; l=l->next)
+    {
+        PipelineChecksum *c = l->data;
+        if (c->type == type)
+            return c->digest;
+    }
+    return NULL;
+}/*}}}*/
+
+/* pipeline_unique_path {{{*/
+/* Returns path or, if it exists, path with the first free number appended */
+static char *
+pipeline_unique_path(const char *path)
+{
+    if (!g_file_test(path, G_FILE_TEST_EXISTS))
+        return g_strdup(path);
+    for (int i=1; ; i++)
+    {
+        char *unique = g_strdup_printf("%s.%d", path, i);
+        if (!g_file_test(unique, G_FILE_TEST_EXISTS))
+            return unique;
+        g_free(unique);
+    }
+}/*}}}*/
+
+/* STAGES {{{*/
+/* pipeline_hash {{{*/
+static gboolean
+pipeline_hash(Pipeline *p, GError **error)
+{
+    guchar buffer[PIPELINE_BLOCK_SIZE];
+    gssize r;
+    GSList *checksums = NULL;
+    gboolean ret = false;
+
+    GFile *file = g_file_new_for_path(p->path);
+    GInputStream *is = G_INPUT_STREAM(g_file_read(file, NULL, error));
+    g_object_unref(file);
+    if (is == NULL)
+        return false;
+    if (p->offset > 0 && !g_seekable_seek(G_SEEKABLE(is), p->offset, G_SEEK_SET, NULL, error))
+    {
+        g_object_unref(is);
+        return false;
+    }
+
+    for (GSList *l = p->checksums; l; l=l->next)
+    {
+        PipelineChecksum *c = l->data;
+        checksums = g_slist_append(checksums, c->checksum != NULL ? g_checksum_copy(c->checksum) : g_checksum_new(c->type));
+    }
+
+    /* All checksums are computed in a single pass */
+    while ((r = g_input_stream_read(is, buffer, sizeof(buffer), NULL, error)) > 0)
+    {
+        for (GSList *l = checksums; l; l=l->next)
+            g_checksum_update(l->data, buffer, r);
+    }
+    if (r == 0)
+    {
+        GSList *c = checksums;
+        for (GSList *l = p->checksums; l; l=l->next, c=c->next)
+            ((PipelineChecksum *)l->data)->digest = g_strdup(g_checksum_get_string(c->data));
+        ret = true;
+    }
+    g_slist_free_full(checksums, (GDestroyNotify)g_checksum_free);
+    g_object_unref(is);
+    return ret;
+}/*}}}*/
+
+/* pipeline_decompress {{{*/
+/* Decompresses <name>.gz to <name> and removes the compressed file, other files
+ * are left untouched */
+static gboolean
+pipeline_decompress(Pipeline *p, GError **error)
+{
+    gboolean ret = false;
+    GFileInputStream *is = NULL;
+    GFileOutputStream *os = NULL;
+    GInputStream *cis = NULL;
+
+    if (!g_str_has_suffix(p->path, ".gz") || strlen(p->path) <= 3)
+        return true;
+
+    char *name = g_strndup(p->path, strlen(p->path) - 3);
+    char *path = pipeline_unique_path(name);
+    g_free(name);
+    GFile *source = g_file_new_for_path(p->path);
+    GFile *dest = g_file_new_for_path(path);
+
+    is = g_file_read(source, NULL, error);
+    if (is == NULL)
+        goto error_out;
+    os = g_file_create(dest, G_FILE_CREATE_NONE, NULL, error);
+    if (os == NULL)
+        goto error_out;
+
+    GZlibDecompressor *decompressor = g_zlib_decompressor_new(G_ZLIB_COMPRESSOR_FORMAT_GZIP);
+    cis = g_converter_input_stream_new(G_INPUT_STREAM(is), G_CONVERTER(decompressor));
+    g_object_unref(decompressor);
+
+    if (g_output_stream_splice(G_OUTPUT_STREAM(os), cis,
+                G_OUTPUT_STREAM_SPLICE_CLOSE_SOURCE | G_OUTPUT_STREAM_SPLICE_CLOSE_TARGET, NULL, error) == -1)
+    {
+        g_file_delete(dest, NULL, NULL);
+        goto error_out;
+    }
+    g_file_delete(source, NULL, NULL);
+    g_free(p->path);
+    p->path = path;
+    path = NULL;
+    ret = true;
+
+error_out:
+    if (cis != NULL)
+        g_object_unref(cis);
+    if (os != NULL)
+        g_object_unref(os);
+    if (is != NULL)
+        g_object_unref(is);
+    g_object_unref(source);
+    g_object_unref(dest);
+    g_free(path);
+    return ret;
+}/*}}}*/
+
+/* pipeline_move {{{*/
+static gboolean
+pipeline_move(Pipeline *p, GError **error)
+{
+    if (g_mkdir_with_parents(p->directory, 0755) != 0)
+    {
+        g_set_error(error, G_FILE_ERROR, g_file_error_from_errno(errno), "Cannot create %s", p->directory);
+        return false;
+    }
+    char *basename = g_path_get_basename(p->path);
+    char *name = g_build_filename(p->directory, basename, NULL);
+    char *path = pipeline_unique_path(name);
+    g_free(basename);
+    g_free(name);
+
+    GFile *source = g_file_new_for_path(p->path);
+    GFile *dest = g_file_new_for_path(path);
+    /* Falls back to copy and delete if the directory is on another
+     * filesystem */
+    gboolean ret = g_file_move(source, dest, G_FILE_COPY_NONE, NULL, NULL, NULL, error);
+    g_object_unref(source);
+    g_object_unref(dest);
+    if (ret)
+    {
+        g_free(p->path);
+        p->path = path;
+    }
+    else
+        g_free(path);
+    return ret;
+}/*}}}*/
+/*}}}*/
+
+/* pipeline_finished_cb {{{*/
+static gboolean
+pipeline_finished_cb(Pipeline *p)
+{
+    p->finished(p, p->data);
+    return false;
+}/*}}}*/
+
+/* pipeline_thread {{{*/
+static gpointer
+pipeline_thread(Pipeline *p)
+{
+    GError *error = NULL;
+
+    /* Stops at the first stage that fails, the compressed file is kept if it
+     * cannot be decompressed */
+    if (p->checksums != NULL && !pipeline_hash(p, &error))
+        goto error_out;
+    if (p->decompress && !pipeline_decompress(p, &error))
+    {
+        p->warning = g_strdup(error != NULL ? error->message : "unknown error");
+        g_clear_error(&error);
+    }
+    if (p->directory != NULL && !pipeline_move(p, &error))
+        goto error_out;
+
+    g_idle_add((GSourceFunc)pipeline_finished_cb, p);
+    return NULL;
+
+error_out:
+    p->error = g_strdup(error != NULL ? error->message : "unknown error");
+    g_clear_error(&error);
+    g_idle_add((GSourceFunc)pipeline_finished_cb, p);
+    return NULL;
+}/*}}}*/
+
+/* pipeline_run {{{*/
+/* Runs all stages on a new thread, finished is called on the main loop, the
+ * pipeline must not be freed before */
+void
+pipeline_run(Pipeline *p, PipelineFunc finished, gpointer data)
+{
+    GError *error = NULL;
+    GThread *thread;
+
+    p->finished = finished;
+    p->data = data;
+    if ((thread = g_thread_try_new("dwb-pipeline", (GThreadFunc)pipeline_thread, p, &error)) != NULL)
+        g_thread_unref(thread);
+    else
+    {
+        p->error = g_strdup(error->message);
+        g_clear_error(&error);
+        g_idle_add((GSourceFunc)pipeline_finished_cb, p);
+    }
+}/*}}}*/
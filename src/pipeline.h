@@ -0,0 +1,39 @@
+/*
+ * Copyright (c) 2010-2014 Stefan Bolte <portix@gmx.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef __DWB_PIPELINE_H__
+#define __DWB_PIPELINE_H__
+
+typedef struct _Pipeline Pipeline;
+typedef void (*PipelineFunc)(Pipeline *, gpointer);
+
+Pipeline * pipeline_new(const char *path);
+void pipeline_add_checksum(Pipeline *p, GChecksumType type);
+void pipeline_continue_checksum(Pipeline *p, GChecksumType type, GChecksum *checksum, goffset offset);
+void pipeline_set_decompress(Pipeline *p, gboolean decompress);
+void pipeline_set_move_directory(Pipeline *p, const char *directory);
+gboolean pipeline_is_empty(Pipeline *p);
+void pipeline_run(Pipeline *p, PipelineFunc finished, gpointer data);
+void pipeline_free(Pipeline *p);
+
+const char * pipeline_get_path(Pipeline *p);
+const char * pipeline_get_error(Pipeline *p);
+const char * pipeline_get_warning(Pipeline *p);
+const char * pipeline_get_checksum(Pipeline *p, GChecksumType type);
+
+#endif
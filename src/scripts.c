@@ -68,11 +68,106 @@
 
 static pthread_rwlock_t s_context_lock = PTHREAD_RWLOCK_INITIALIZER;
 
+/* Prepared userscripts, keyed by checksum, shared with the loader threads */
+#define PREPARED_CACHE_MAX 256
+static pthread_mutex_t s_prepared_mutex = PTHREAD_MUTEX_INITIALIZER;
+static GHashTable *s_prepared_cache;
+/* Checksums of scripts with valid syntax, main thread only */
+static GHashTable *s_checked_scripts;
+/* Checksums of the prepared scripts on disk used by the last load of the
+ * userscripts, main thread only */
+static GHashTable *s_prepared_used;
+/* Changes to the macros must change the checksums of scripts on disk */
+#define PREPARED_FORMAT "1"
+/* Startup times of scripts not yet applied and of the applied scripts */
+static GSList *s_startup_pending;
+static GSList *s_startup_times;
+/* Wrappers created and reused for signal arguments */
+static ScriptWrapperStats s_wrapper_stats[SCRIPTS_SIG_LAST];
+
 typedef struct SigData_s {
     gulong id; 
     GObject *instance;
 } SigData;
 
+/* Queued emission of a batched signal */
+typedef struct SignalEvent_s {
+    JSObjectRef jsobj;
+    GObject *objects[SCRIPT_MAX_SIG_OBJECTS];
+    int numobj;
+    char *json;
+    int status;                 /* load status or -1 */
+} SignalEvent;
+
+/* Signals that only observe and can be delivered in batches */
+#define SIGNAL_IS_BATCHABLE(sig) ((sig) == SCRIPTS_SIG_LOAD_STATUS || (sig) == SCRIPTS_SIG_FRAME_STATUS \
+        || (sig) == SCRIPTS_SIG_MOUSE_MOVE || (sig) == SCRIPTS_SIG_SCROLL || (sig) == SCRIPTS_SIG_STATUS_BAR)
+/* Only the latest queued event of a webview is delivered */
+#define SIGNAL_COALESCES(sig) ((sig) == SCRIPTS_SIG_MOUSE_MOVE || (sig) == SCRIPTS_SIG_SCROLL)
+
+/* Native filter of a connected Signal, all conditions must match */
+typedef struct SignalFilter_s {
+    int signal;
+    GPatternSpec *glob;
+    GRegex *regex;
+    char *host;                 /* host suffix */
+    unsigned int types;         /* mask of SignalResourceType */
+    int frame;                  /* 0 any frame, 1 main frame, 2 subframes */
+    gboolean matched;           /* result of the last check */
+} SignalFilter;
+
+typedef enum {
+    RESOURCE_DOCUMENT   = 1<<0,
+    RESOURCE_IMAGE      = 1<<1,
+    RESOURCE_SCRIPT     = 1<<2,
+    RESOURCE_STYLESHEET = 1<<3,
+    RESOURCE_FONT       = 1<<4,
+    RESOURCE_MEDIA      = 1<<5,
+    RESOURCE_OTHER      = 1<<6,
+} SignalResourceType;
+
+static const struct {
+    const char *name;
+    SignalResourceType type;
+} s_resource_types[] = {
+    { "document",   RESOURCE_DOCUMENT },
+    { "image",      RESOURCE_IMAGE },
+    { "script",     RESOURCE_SCRIPT },
+    { "stylesheet", RESOURCE_STYLESHEET },
+    { "font",       RESOURCE_FONT },
+    { "media",      RESOURCE_MEDIA },
+    { "other",      RESOURCE_OTHER },
+};
+
+/* Resource types guessed from the extension of the path, WebKit doesn't tell
+ * what kind of resource a request is for */
+static const struct {
+    const char *extension;
+    SignalResourceType type;
+} s_resource_extensions[] = {
+    { ".png",   RESOURCE_IMAGE },
+    { ".jpg",   RESOURCE_IMAGE },
+    { ".jpeg",  RESOURCE_IMAGE },
+    { ".gif",   RESOURCE_IMAGE },
+    { ".svg",   RESOURCE_IMAGE },
+    { ".webp",  RESOURCE_IMAGE },
+    { ".ico",   RESOURCE_IMAGE },
+    { ".bmp",   RESOURCE_IMAGE },
+    { ".js",    RESOURCE_SCRIPT },
+    { ".css",   RESOURCE_STYLESHEET },
+    { ".woff",  RESOURCE_FONT },
+    { ".woff2", RESOURCE_FONT },
+    { ".ttf",   RESOURCE_FONT },
+    { ".otf",   RESOURCE_FONT },
+    { ".eot",   RESOURCE_FONT },
+    { ".mp3",   RESOURCE_MEDIA },
+    { ".mp4",   RESOURCE_MEDIA },
+    { ".ogg",   RESOURCE_MEDIA },
+    { ".ogv",   RESOURCE_MEDIA },
+    { ".webm",  RESOURCE_MEDIA },
+    { ".wav",   RESOURCE_MEDIA },
+};
+
 static const char  *s_sigmap[SCRIPTS_SIG_LAST] = {
     [SCRIPTS_SIG_NAVIGATION]        = "navigation", 
     [SCRIPTS_SIG_LOAD_STATUS]       = "loadStatus", 
@@ -185,12 +280,24 @@ error_out:
     return result;
 }
 
+static void 
+signal_filter_free(SignalFilter *filter) 
+{
+    if (filter->glob != NULL)
+        g_pattern_spec_free(filter->glob);
+    if (filter->regex != NULL)
+        g_regex_unref(filter->regex);
+    g_free(filter->host);
+    g_free(filter);
+}
+
 ScriptContext * 
 script_context_new() {
     ScriptContext *ctx = g_malloc0(sizeof(ScriptContext));
 
     ctx->gobject_signals = g_ptr_array_new();
     ctx->exports = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, (GDestroyNotify)scripts_unprotect);
+    ctx->signal_filters = g_hash_table_new_full(g_direct_hash, g_direct_equal, NULL, (GDestroyNotify)signal_filter_free);
 
     ctx->keymap_dirty = false;
     ctx->ref_quark = g_quark_from_static_string("dwb_js_ref");
@@ -202,9 +309,32 @@ JSValueRef
 scripts_get_nil() {
     return s_nil;
 }
+static void 
+startup_free(ScriptStartup *startup) 
+{
+    g_free(startup->path);
+    g_free(startup);
+}
+static void 
+signal_event_free(SignalEvent *event) 
+{
+    if (event->jsobj != NULL)
+        JSValueUnprotect(s_ctx->global_context, event->jsobj);
+    for (int i=0; i<event->numobj; i++)
+    {
+        if (event->objects[i] != NULL)
+            g_object_unref(event->objects[i]);
+    }
+    g_free(event->json);
+    g_free(event);
+}
 void 
 script_context_free(ScriptContext *ctx) {
     if (ctx != NULL) {
+        if (ctx->batch_source != 0) {
+            g_source_remove(ctx->batch_source);
+            ctx->batch_source = 0;
+        }
         if (ctx->gobject_signals != NULL) {
             for (guint i=0; i<ctx->gobject_signals->len; i++)
             {
@@ -219,10 +349,20 @@ script_context_free(ScriptContext *ctx) {
             g_hash_table_unref(ctx->exports);
             ctx->exports = NULL;
         }
+        for (int i=0; i<SCRIPTS_SIG_LAST; i++) {
+            g_slist_free(ctx->filter_list[i]);
+            ctx->filter_list[i] = NULL;
+        }
+        if (ctx->signal_filters != NULL) {
+            g_hash_table_unref(ctx->signal_filters);
+            ctx->signal_filters = NULL;
+        }
         if (ctx->script_list != NULL) {
             g_slist_free(ctx->script_list);
             ctx->script_list = NULL;
         }
+        g_slist_free_full(s_startup_pending, (GDestroyNotify)startup_free);
+        s_startup_pending = NULL;
         if (ctx->timers != NULL) {
             for (GSList *timer = ctx->timers; timer; timer=timer->next)
                 g_source_remove(GPOINTER_TO_INT(timer->data));
@@ -239,6 +379,14 @@ script_context_free(ScriptContext *ctx) {
         }
 
         if (s_ctx->global_context != NULL) {
+            worker_finish(ctx);
+            for (int i=0; i<SCRIPTS_SIG_LAST; i++) {
+                if (ctx->batched_events[i] != NULL) {
+                    g_ptr_array_free(ctx->batched_events[i], true);
+                    ctx->batched_events[i] = NULL;
+                }
+                UNPROTECT_0(ctx->global_context, ctx->batch_objects[i]);
+            }
             if (ctx->constructors != NULL) {
                 for (int i=0; i<CONSTRUCTOR_LAST; i++) 
                     UNPROTECT_0(ctx->global_context, ctx->constructors[i]);
@@ -632,7 +780,8 @@ signal_set(JSContextRef ctx, JSObjectRef object, JSStringRef js_name, JSValueRef
         if (JSValueIsNull(ctx, value)) 
         {
             s_ctx->sig_objects[i] = NULL;
-            dwb.misc.script_signals &= ~(1ULL<<i);
+            if (s_ctx->batch_objects[i] == NULL)
+                dwb.misc.script_signals &= ~(1ULL<<i);
         }
         else if ( (o = js_value_to_function(ctx, value, exception)) != NULL) 
         {
@@ -646,7 +795,397 @@ signal_set(JSContextRef ctx, JSObjectRef object, JSStringRef js_name, JSValueRef
     return false;
 }/*}}}*/
 
+/* signal_filter_new {{{*/
+static SignalFilter *
+signal_filter_new(JSContextRef ctx, int signal, JSObjectRef descriptor, JSValueRef *exc) 
+{
+    char *uri = NULL, *regex = NULL, *type = NULL, *frame = NULL;
+    GError *error = NULL;
+    SignalFilter *filter = g_malloc0(sizeof(SignalFilter));
+    filter->signal = signal;
+
+    if (descriptor == NULL)
+        return filter;
+
+    if ((uri = js_get_string_property(ctx, descriptor, "uri")) != NULL)
+        filter->glob = g_pattern_spec_new(uri);
+    if ((regex = js_get_string_property(ctx, descriptor, "regex")) != NULL)
+    {
+        filter->regex = g_regex_new(regex, G_REGEX_OPTIMIZE, 0, &error);
+        if (filter->regex == NULL)
+        {
+            js_make_exception(ctx, exc, EXCEPTION("Signal.connect: invalid regular expression: %s"), error->message);
+            g_error_free(error);
+            goto error_out;
+        }
+    }
+    filter->host = js_get_string_property(ctx, descriptor, "host");
+    if ((type = js_get_string_property(ctx, descriptor, "type")) != NULL)
+    {
+        char **types = g_strsplit(type, ",", -1);
+        for (int i=0; types[i] != NULL; i++)
+        {
+            unsigned int mask = 0;
+            for (guint j=0; j<G_N_ELEMENTS(s_resource_types); j++)
+            {
+                if (!g_strcmp0(g_strstrip(types[i]), s_resource_types[j].name))
+                    mask = s_resource_types[j].type;
+            }
+            if (mask == 0)
+            {
+                js_make_exception(ctx, exc, EXCEPTION("Signal.connect: unknown resource type %s"), types[i]);
+                g_strfreev(types);
+                goto error_out;
+            }
+            filter->types |= mask;
+        }
+        g_strfreev(types);
+    }
+    if ((frame = js_get_string_property(ctx, descriptor, "frame")) != NULL)
+    {
+        if (!g_strcmp0(frame, "main"))
+            filter->frame = 1;
+        else if (!g_strcmp0(frame, "sub"))
+            filter->frame = 2;
+        else 
+        {
+            js_make_exception(ctx, exc, EXCEPTION("Signal.connect: frame must be \"main\" or \"sub\""));
+            goto error_out;
+        }
+    }
+    g_free(uri);
+    g_free(regex);
+    g_free(type);
+    g_free(frame);
+    return filter;
+
+error_out:
+    g_free(uri);
+    g_free(regex);
+    g_free(type);
+    g_free(frame);
+    signal_filter_free(filter);
+    return NULL;
+}/*}}}*/
+
+/** 
+ * Compiles the filter of a Signal connected to the resource or navigation
+ * event, used internally
+ *
+ * @name _setFilter
+ * @memberOf signals
+ * @function
+ * @private
+ *
+ * @param {String} name 
+ *      The name of the event
+ * @param {Number} id
+ *      The id of the Signal
+ * @param {Object} [filter] 
+ *      The normalized filter, if omitted the Signal matches every request
+ *
+ * @returns {Boolean}
+ *      true if the filter was compiled
+ * */
+static JSValueRef 
+signal_set_filter(JSContextRef ctx, JSObjectRef function, JSObjectRef this, size_t argc, const JSValueRef argv[], JSValueRef* exc) 
+{
+    char *name;
+    int signal = -1, id;
+    JSObjectRef descriptor = NULL;
+    SignalFilter *filter, *old;
+
+    if (argc < 2 || (name = js_value_to_char(ctx, argv[0], JS_STRING_MAX, exc)) == NULL)
+        return JSValueMakeBoolean(ctx, false);
+
+    if (!strcmp(name, s_sigmap[SCRIPTS_SIG_RESOURCE]))
+        signal = SCRIPTS_SIG_RESOURCE;
+    else if (!strcmp(name, s_sigmap[SCRIPTS_SIG_NAVIGATION]))
+        signal = SCRIPTS_SIG_NAVIGATION;
+    g_free(name);
+
+    id = JSValueToNumber(ctx, argv[1], exc);
+    if (signal == -1 || id <= 0)
+        return JSValueMakeBoolean(ctx, false);
+
+    if (argc > 2 && JSValueIsObject(ctx, argv[2]))
+        descriptor = JSValueToObject(ctx, argv[2], exc);
+
+    if ((filter = signal_filter_new(ctx, signal, descriptor, exc)) == NULL)
+        return JSValueMakeBoolean(ctx, false);
+
+    if ((old = g_hash_table_lookup(s_ctx->signal_filters, GINT_TO_POINTER(id))) != NULL)
+        s_ctx->filter_list[old->signal] = g_slist_remove(s_ctx->filter_list[old->signal], old);
+
+    g_hash_table_insert(s_ctx->signal_filters, GINT_TO_POINTER(id), filter);
+    s_ctx->filter_list[signal] = g_slist_prepend(s_ctx->filter_list[signal], filter);
+    return JSValueMakeBoolean(ctx, true);
+}
+/** 
+ * Removes the filter of a Signal, used internally
+ *
+ * @name _removeFilter
+ * @memberOf signals
+ * @function
+ * @private
+ *
+ * @param {Number} id
+ *      The id of the Signal
+ * */
+static JSValueRef 
+signal_remove_filter(JSContextRef ctx, JSObjectRef function, JSObjectRef this, size_t argc, const JSValueRef argv[], JSValueRef* exc) 
+{
+    SignalFilter *filter;
+    if (argc == 0)
+        return NIL;
+
+    int id = JSValueToNumber(ctx, argv[0], exc);
+    if ((filter = g_hash_table_lookup(s_ctx->signal_filters, GINT_TO_POINTER(id))) != NULL)
+    {
+        s_ctx->filter_list[filter->signal] = g_slist_remove(s_ctx->filter_list[filter->signal], filter);
+        g_hash_table_remove(s_ctx->signal_filters, GINT_TO_POINTER(id));
+    }
+    return NIL;
+}
+/** 
+ * Whether the filter of a Signal matched the request of the current emission,
+ * used internally
+ *
+ * @name _filterMatched
+ * @memberOf signals
+ * @function
+ * @private
+ *
+ * @param {Number} id
+ *      The id of the Signal
+ *
+ * @returns {Boolean}
+ *      true if the filter matched or the Signal has no filter
+ * */
+static JSValueRef 
+signal_filter_matched(JSContextRef ctx, JSObjectRef function, JSObjectRef this, size_t argc, const JSValueRef argv[], JSValueRef* exc) 
+{
+    SignalFilter *filter;
+    if (argc == 0)
+        return JSValueMakeBoolean(ctx, true);
+
+    int id = JSValueToNumber(ctx, argv[0], exc);
+    filter = g_hash_table_lookup(s_ctx->signal_filters, GINT_TO_POINTER(id));
+    return JSValueMakeBoolean(ctx, filter == NULL || filter->matched);
+}
+
+/** 
+ * Sets the dispatcher of a batched signal, used internally
+ *
+ * @name _setBatched
+ * @memberOf signals
+ * @function
+ * @private
+ *
+ * @param {String} name 
+ *      The name of the event
+ * @param {Function} [dispatcher]
+ *      Function that is called with the array of queued events, if omitted
+ *      events are no longer queued
+ *
+ * @returns {Boolean}
+ *      true if the signal can be batched
+ * */
+static JSValueRef 
+signal_set_batched(JSContextRef ctx, JSObjectRef function, JSObjectRef this, size_t argc, const JSValueRef argv[], JSValueRef* exc) 
+{
+    char *name;
+    int signal = -1;
+
+    if (argc == 0 || (name = js_value_to_char(ctx, argv[0], JS_STRING_MAX, exc)) == NULL)
+        return JSValueMakeBoolean(ctx, false);
+
+    for (int i=SCRIPTS_SIG_FIRST; i<SCRIPTS_SIG_LAST; i++) 
+    {
+        if (!strcmp(name, s_sigmap[i])) 
+        {
+            signal = i;
+            break;
+        }
+    }
+    g_free(name);
+    if (signal == -1 || !SIGNAL_IS_BATCHABLE(signal))
+        return JSValueMakeBoolean(ctx, false);
+
+    UNPROTECT_0(ctx, s_ctx->batch_objects[signal]);
+    if (argc > 1 && (s_ctx->batch_objects[signal] = js_value_to_function(ctx, argv[1], NULL)) != NULL) 
+    {
+        JSValueProtect(ctx, s_ctx->batch_objects[signal]);
+        dwb.misc.script_signals |= (1ULL<<signal);
+    }
+    else if (s_ctx->sig_objects[signal] == NULL)
+        dwb.misc.script_signals &= ~(1ULL<<signal);
+
+    return JSValueMakeBoolean(ctx, true);
+}
+
+/* scripts_filter_signal {{{*/
+/* Checks the filters of the Signals connected to the resource or navigation
+ * event, returns false if no filter matches and the emission can be skipped. */
+gboolean 
+scripts_filter_signal(int signal, const char *uri, gboolean main_frame, gboolean document)
+{
+    SoupURI *soup_uri = NULL;
+    unsigned int type = 0;
+    gboolean ret = false;
+
+    if (s_ctx == NULL || s_ctx->filter_list[signal] == NULL)
+        return true;
+
+    for (GSList *l = s_ctx->filter_list[signal]; l; l=l->next)
+    {
+        SignalFilter *filter = l->data;
+        filter->matched = false;
+
+        if ((filter->frame == 1 && !main_frame) || (filter->frame == 2 && main_frame))
+            continue;
+        if (filter->glob != NULL && !g_pattern_match_string(filter->glob, uri))
+            continue;
+        if (filter->regex != NULL && !g_regex_match(filter->regex, uri, 0, NULL))
+            continue;
+        if (filter->host != NULL || filter->types != 0) 
+        {
+            if (soup_uri == NULL && (soup_uri = soup_uri_new(uri)) == NULL)
+                continue;
+            if (filter->host != NULL) 
+            {
+                const char *host = soup_uri->host;
+                size_t hlen = host == NULL ? 0 : strlen(host), flen = strlen(filter->host);
+                if (hlen < flen || g_ascii_strcasecmp(host + hlen - flen, filter->host) 
+                        || (hlen > flen && host[hlen - flen - 1] != '.'))
+                    continue;
+            }
+            if (filter->types != 0) 
+            {
+                if (type == 0) 
+                {
+                    type = RESOURCE_OTHER;
+                    if (document)
+                        type = RESOURCE_DOCUMENT;
+                    else if (soup_uri->path != NULL) 
+                    {
+                        for (guint i=0; i<G_N_ELEMENTS(s_resource_extensions); i++)
+                        {
+                            if (g_str_has_suffix(soup_uri->path, s_resource_extensions[i].extension))
+                            {
+                                type = s_resource_extensions[i].type;
+                                break;
+                            }
+                        }
+                    }
+                }
+                if (!(filter->types & type))
+                    continue;
+            }
+        }
+        filter->matched = ret = true;
+    }
+    if (soup_uri != NULL)
+        soup_uri_free(soup_uri);
+    return ret;
+}/*}}}*/
+
 /* scripts_emit {{{*/
+/* signal_deliver_batches {{{*/
+/* Calls the dispatchers of batched signals with the events queued since the
+ * last main loop iteration, every event is the array of callback arguments */
+static gboolean
+signal_deliver_batches(gpointer unused)
+{
+    EXEC_LOCK_RETURN(true);
+
+    JSContextRef ctx = s_ctx->global_context;
+    s_ctx->batch_source = 0;
+    for (int i=SCRIPTS_SIG_FIRST; i<SCRIPTS_SIG_LAST; i++) 
+    {
+        GPtrArray *events = s_ctx->batched_events[i];
+        JSObjectRef function = s_ctx->batch_objects[i];
+        if (events == NULL)
+            continue;
+
+        /* Handlers may queue new events */
+        s_ctx->batched_events[i] = NULL;
+        if (function != NULL && events->len > 0)
+        {
+            JSValueRef *values = g_malloc_n(events->len, sizeof(JSValueRef));
+            for (guint j=0; j<events->len; j++)
+            {
+                SignalEvent *event = g_ptr_array_index(events, j);
+                JSValueRef args[SCRIPT_MAX_SIG_OBJECTS + 3];
+                int n = 0;
+                if (event->jsobj != NULL)
+                    args[n++] = event->jsobj;
+                for (int k=0; k<event->numobj; k++)
+                    args[n++] = event->objects[k] != NULL ? scripts_make_object(ctx, event->objects[k]) : NIL;
+                if (event->json != NULL)
+                {
+                    JSValueRef vson = js_json_to_value(ctx, event->json);
+                    args[n++] = vson == NULL ? NIL : vson;
+                }
+                if (event->status >= 0)
+                    args[n++] = JSValueMakeNumber(ctx, event->status);
+                values[j] = JSObjectMakeArray(ctx, n, args, NULL);
+            }
+            JSValueRef argv[] = { JSObjectMakeArray(ctx, events->len, values, NULL) };
+            scripts_call_as_function(ctx, function, function, 1, argv);
+            g_free(values);
+        }
+        g_ptr_array_free(events, true);
+    }
+
+    EXEC_UNLOCK;
+    return false;
+}/*}}}*/
+
+/* signal_queue_event {{{*/
+static void 
+signal_queue_event(ScriptSignal *sig)
+{
+    GPtrArray *events = s_ctx->batched_events[sig->signal];
+    if (events == NULL)
+        events = s_ctx->batched_events[sig->signal] = g_ptr_array_new_with_free_func((GDestroyNotify)signal_event_free);
+
+    if (SIGNAL_COALESCES(sig->signal))
+    {
+        for (guint i=0; i<events->len; i++)
+        {
+            if (((SignalEvent *)g_ptr_array_index(events, i))->jsobj == sig->jsobj)
+            {
+                g_ptr_array_remove_index(events, i);
+                break;
+            }
+        }
+    }
+
+    SignalEvent *event = g_malloc0(sizeof(SignalEvent));
+    if ((event->jsobj = sig->jsobj) != NULL)
+        JSValueProtect(s_ctx->global_context, event->jsobj);
+    event->numobj = MIN(sig->numobj, SCRIPT_MAX_SIG_OBJECTS);
+    for (int i=0; i<event->numobj; i++)
+    {
+        if (sig->objects[i] != NULL)
+            event->objects[i] = g_object_ref(sig->objects[i]);
+    }
+    event->json = g_strdup(sig->json);
+
+    /* The load status has changed again when the event is delivered */
+    event->status = -1;
+    if (sig->signal == SCRIPTS_SIG_LOAD_STATUS && sig->view != NULL)
+        event->status = webkit_web_view_get_load_status(WEBVIEW(sig->view));
+    else if (sig->signal == SCRIPTS_SIG_FRAME_STATUS && event->numobj > 0 && WEBKIT_IS_WEB_FRAME(sig->objects[0]))
+        event->status = webkit_web_frame_get_load_status(WEBKIT_WEB_FRAME(sig->objects[0]));
+
+    g_ptr_array_add(events, event);
+
+    if (s_ctx->batch_source == 0)
+        s_ctx->batch_source = g_idle_add(signal_deliver_batches, NULL);
+}/*}}}*/
+
 gboolean
 scripts_emit(ScriptSignal *sig) 
 {
@@ -655,6 +1194,8 @@ scripts_emit(ScriptSignal *sig)
     int numargs, i, additional = 0;
     gboolean ret = false;
     JSObjectRef function = s_ctx->sig_objects[sig->signal];
+    if (s_ctx->batch_objects[sig->signal] != NULL && s_ctx->global_context != NULL)
+        signal_queue_event(sig);
     if (function == NULL)
         return false;
 
@@ -679,13 +1220,23 @@ scripts_emit(ScriptSignal *sig)
     if (sig->jsobj != NULL) 
         val[i++] = sig->jsobj;
 
+    /* Wrappers are cached on the GObject, only objects seen for the first time
+     * create a new wrapper */
+    guint created = s_ctx->wrappers_created;
+    guint wrapped = 0;
     for (int j=0; j<sig->numobj; j++) 
     {
         if (sig->objects[j] != NULL) 
+        {
             val[i++] = scripts_make_object(s_ctx->global_context, G_OBJECT(sig->objects[j]));
+            wrapped++;
+        }
         else 
             val[i++] = NIL;
     }
+    created = s_ctx->wrappers_created - created;
+    s_wrapper_stats[sig->signal].created += created;
+    s_wrapper_stats[sig->signal].reused += wrapped - MIN(created, wrapped);
 
     if (sig->json != NULL)
     {
@@ -703,8 +1254,16 @@ scripts_emit(ScriptSignal *sig)
         }
     }
 
+    /* The handler may close the tab, the time is only accounted if the tab
+     * is still at the same position */
+    int position = view_position(sig->view);
+    gint64 start = g_get_monotonic_time();
+
     JSValueRef js_ret = scripts_call_as_function(s_ctx->global_context, function, function, numargs, val);
 
+    if (sig->view != NULL && view_nth(position) == sig->view)
+        VIEW(sig->view)->status->stats.script_time += g_get_monotonic_time() - start;
+
     if (JSValueIsBoolean(s_ctx->global_context, js_ret)) 
         ret = JSValueToBoolean(s_ctx->global_context, js_ret);
 
@@ -824,6 +1383,122 @@ scripts_get_exports(JSContextRef ctx, const char *path)
     }
     return ret;
 }
+/* EXTENSIONS {{{*/
+#define TRIGGERS_START "/*<TRIGGERS"
+#define TRIGGERS_END "TRIGGERS>*/"
+/** 
+ * Reads the activation triggers of an extension without evaluating the
+ * extension, used internally
+ *
+ * @name _getTriggers
+ * @memberOf extensions
+ * @function
+ * @private
+ *
+ * @param {String} path 
+ *      Path of the extension or of the extension archive
+ *
+ * @returns {Object}
+ *      The parsed triggers or null if the extension doesn't declare triggers
+ * */
+static JSValueRef 
+extensions_get_triggers(JSContextRef ctx, JSObjectRef function, JSObjectRef this, size_t argc, const JSValueRef argv[], JSValueRef* exc) 
+{
+    JSValueRef ret = NIL;
+    char *path = NULL, *content = NULL, *start, *end;
+    struct exar_archive_s *archive;
+    const unsigned char *data;
+    off_t size;
+
+    if (argc == 0 || (path = js_value_to_char(ctx, argv[0], JS_STRING_MAX, exc)) == NULL)
+        return NIL;
+
+    if ((archive = exar_open(path)) != NULL)
+    {
+        if (exar_search_lookup(archive, "main.js", &data, &size) == 0) 
+            content = g_strndup((const char *)data, size);
+        exar_close(archive);
+    }
+    else 
+        g_file_get_contents(path, &content, NULL, NULL);
+
+    if (content != NULL 
+            && (start = strstr(content, TRIGGERS_START)) != NULL 
+            && (end = strstr(start, TRIGGERS_END)) != NULL) 
+    {
+        *end = '\0';
+        ret = js_json_to_value(ctx, start + strlen(TRIGGERS_START));
+        if (ret == NULL)
+        {
+            fprintf(stderr, "Invalid triggers in %s\n", path);
+            ret = NIL;
+        }
+    }
+    g_free(content);
+    g_free(path);
+    return ret;
+}
+/** 
+ * Calls the binding for a shortcut or command after the stub of a deferred
+ * extension has been removed, used internally
+ *
+ * @name _dispatchBinding
+ * @memberOf extensions
+ * @function
+ * @private
+ *
+ * @param {String} shortcut 
+ *      The shortcut or null 
+ * @param {String} command 
+ *      The command or null 
+ * @param {String} [arg] 
+ *      Argument passed to the original binding 
+ *
+ * @returns {Boolean}
+ *      true if a binding was found
+ * */
+static JSValueRef 
+extensions_dispatch_binding(JSContextRef ctx, JSObjectRef function, JSObjectRef this, size_t argc, const JSValueRef argv[], JSValueRef* exc) 
+{
+    char *shortcut = NULL, *command = NULL, *arg = NULL;
+    Key key = { .str = NULL, .mod = 0 };
+    KeyMap *km = NULL;
+    gboolean ret = false;
+
+    if (argc < 2) 
+        return JSValueMakeBoolean(ctx, false);
+
+    if (!JSValueIsNull(ctx, argv[0]) && (shortcut = js_value_to_char(ctx, argv[0], JS_STRING_MAX, exc)) != NULL)
+        key = dwb_str_to_key(shortcut);
+    if (!JSValueIsNull(ctx, argv[1]))
+        command = js_value_to_char(ctx, argv[1], JS_STRING_MAX, exc);
+    if (argc > 2 && JSValueIsString(ctx, argv[2]))
+        arg = js_value_to_char(ctx, argv[2], JS_STRING_MAX, exc);
+
+    for (GList *l = dwb.keymap; l; l=l->next) 
+    {
+        km = l->data;
+        /* unbound maps are only removed after the callback returned */
+        if (! (km->map->prop & CP_SCRIPT) || km->map->arg.i == 0)
+            continue;
+        if ((key.str != NULL && *key.str != '\0' && !g_strcmp0(km->key, key.str) && km->mod == key.mod) 
+                || (command != NULL && !g_strcmp0(km->map->n.first, command)))
+        {
+            Arg a = km->map->arg;
+            a.p = arg;
+            scripts_eval_key(km, &a);
+            ret = true;
+            break;
+        }
+    }
+    g_free(key.str);
+    g_free(shortcut);
+    g_free(command);
+    g_free(arg);
+    return JSValueMakeBoolean(ctx, ret);
+}
+/*}}}*/
+
 /* create_global_object {{{*/
 static void  
 create_global_object() 
@@ -935,8 +1610,16 @@ create_global_object()
      *
      *
      * */
+    JSStaticFunction signal_functions[] = { 
+        { "_setFilter",         signal_set_filter,        kJSDefaultAttributes },
+        { "_removeFilter",      signal_remove_filter,     kJSDefaultAttributes },
+        { "_filterMatched",     signal_filter_matched,    kJSDefaultAttributes },
+        { "_setBatched",        signal_set_batched,       kJSDefaultAttributes },
+        { 0, 0, 0 }, 
+    };
     cd = kJSClassDefinitionEmpty;
     cd.className = "signals";
+    cd.staticFunctions = signal_functions;
     cd.setProperty = signal_set;
     class = JSClassCreate(&cd);
 
@@ -944,7 +1627,12 @@ create_global_object()
     JSValueProtect(ctx, s_ctx->namespaces[NAMESPACE_SIGNALS]);
     JSClassRelease(class);
 
-    class = scripts_create_class("extensions", NULL, NULL, NULL);
+    JSStaticFunction extension_functions[] = { 
+        { "_getTriggers",       extensions_get_triggers,        kJSDefaultAttributes },
+        { "_dispatchBinding",   extensions_dispatch_binding,    kJSDefaultAttributes },
+        { 0, 0, 0 }, 
+    };
+    class = scripts_create_class("extensions", extension_functions, NULL, NULL);
     s_ctx->namespaces[NAMESPACE_EXTENSIONS] = scripts_create_object(ctx, class, global_object, kJSDefaultAttributes, "extensions", NULL);
     JSClassRelease(class);
 
@@ -985,6 +1673,7 @@ create_global_object()
 #endif
     cookie_initialize(s_ctx);
     header_initialize(s_ctx);
+    worker_initialize(s_ctx);
 
     s_ctx->session = make_object_for_class(ctx, CLASS_GOBJECT, G_OBJECT(webkit_get_default_session()), false);
     JSValueProtect(ctx, s_ctx->session);
@@ -1004,6 +1693,12 @@ apply_scripts()
     JSValueRef exports[1];
     size_t argc = 0;
     char *path;
+    GSList *startup = s_startup_pending;
+    gint64 start;
+
+    g_slist_free_full(s_startup_times, (GDestroyNotify)startup_free);
+    s_startup_times = s_startup_pending;
+    s_startup_pending = NULL;
 
     // XXX Not needed?
     JSObjectRef *objects = g_malloc(length * sizeof(JSObjectRef));
@@ -1029,7 +1724,14 @@ apply_scripts()
             argc = 1;
         }
 
+        start = g_get_monotonic_time();
         JSObjectCallAsFunction(s_ctx->global_context, l->data, l->data, argc, argc > 0 ? exports : NULL, NULL);
+        if (startup != NULL)
+        {
+            ((ScriptStartup *)startup->data)->run = g_get_monotonic_time() - start;
+            startup = startup->next;
+        }
+        g_free(path);
     }
     g_slist_free(s_ctx->script_list);
     s_ctx->script_list = NULL;
@@ -1042,6 +1744,19 @@ apply_scripts()
     g_free(objects);
 }/*}}}*/
 
+/* scripts_make_tab_object {{{*/
+/* 
+ * Placeholder tabs get a wrapper without a webview, it is bound when the tab
+ * is materialized so that the object of a tab stays the same 
+ * */
+static JSObjectRef 
+scripts_make_tab_object(GList *gl) 
+{
+    if (VIEW(gl)->web != NULL)
+        return scripts_make_object(s_ctx->global_context, G_OBJECT(VIEW(gl)->web));
+    return JSObjectMake(s_ctx->global_context, s_ctx->classes[CLASS_WEBVIEW], NULL);
+}/*}}}*/
+
 /* scripts_create_tab {{{*/
 void 
 scripts_create_tab(GList *gl) 
@@ -1057,12 +1772,38 @@ scripts_create_tab(GList *gl)
         apply_scripts();
         applied = true;
     }
-    JSObjectRef o = scripts_make_object(s_ctx->global_context, G_OBJECT(VIEW(gl)->web));
+    JSObjectRef o = scripts_make_tab_object(gl);
 
     JSValueProtect(s_ctx->global_context, o);
     VIEW(gl)->script_wv = o;
 }/*}}}*/
 
+/* scripts_attach_tab {{{*/
+/* 
+ * Binds the wrapper of a tab to a newly created webview
+ * */
+void 
+scripts_attach_tab(GList *gl) 
+{
+    JSObjectRef o = VIEW(gl)->script_wv;
+    if (s_ctx == NULL || o == NULL || JSObjectGetPrivate(o) != NULL)
+        return;
+    bind_object(s_ctx->global_context, o, G_OBJECT(VIEW(gl)->web));
+}/*}}}*/
+
+/* scripts_detach_tab {{{*/
+/* 
+ * Releases the wrapper of a tab before its webview is destroyed
+ * */
+void 
+scripts_detach_tab(GList *gl) 
+{
+    JSObjectRef o = VIEW(gl)->script_wv;
+    if (s_ctx == NULL || o == NULL)
+        return;
+    unbind_object(s_ctx->global_context, o, G_OBJECT(VIEW(gl)->web));
+}/*}}}*/
+
 /* scripts_remove_tab {{{*/
 void 
 scripts_remove_tab(JSObjectRef obj) 
@@ -1088,7 +1829,7 @@ scripts_remove_tab(JSObjectRef obj)
          *
          * @param {WebKitWebView} webview The corresponding WebKitWebView
          * */
-        ScriptSignal signal = { obj, SCRIPTS_SIG_META(NULL, CLOSE_TAB, 0) };
+        ScriptSignal signal = { .jsobj = obj, SCRIPTS_SIG_META(NULL, CLOSE_TAB, 0) };
         scripts_emit(&signal);
     }
     JSValueUnprotect(s_ctx->global_context, obj);
@@ -1164,15 +1905,48 @@ init_macro(const char *content, const char *name, const char *fmt, ...) {
 }
 
 
-void 
-init_script(const char *path, const char *script, gboolean is_archive, const char *template, int offset)
+/* scripts_prepare {{{*/
+/* 
+ * Applies the macros to a userscript or the main script of an archive and wraps
+ * it into the script template. This doesn't touch the javascript context, so it
+ * can be called from any thread. The prepared text is cached by a checksum of
+ * path and content, in memory and on disk after the syntax check.
+ *
+ * Takes ownership of script.
+ * */
+PreparedScript * 
+scripts_prepare(const char *path, char *script, gboolean is_archive) 
 {
-    char *debug = NULL, *prepared = NULL, *tmp = NULL;
-    if (s_ctx == NULL) 
-        create_global_object();
-
+    char *prepared = NULL, *tmp = NULL;
+    gint64 start = g_get_monotonic_time();
+    GChecksum *checksum = g_checksum_new(G_CHECKSUM_SHA1);
+    PreparedScript *ps = g_malloc0(sizeof(PreparedScript));
+
+    ps->path = g_strdup(path);
+    ps->script = script;
+    ps->is_archive = is_archive;
+
+    g_checksum_update(checksum, (const guchar *) PREPARED_FORMAT SCRIPT_TEMPLATE SCRIPT_TEMPLATE_XINCLUDE, -1);
+    g_checksum_update(checksum, (const guchar *) path, -1);
+    g_checksum_update(checksum, (const guchar *) (is_archive ? "a" : "s"), 1);
+    g_checksum_update(checksum, (const guchar *) script, -1);
+    ps->checksum = g_strdup(g_checksum_get_string(checksum));
+    g_checksum_free(checksum);
+
+    pthread_mutex_lock(&s_prepared_mutex);
+    if (s_prepared_cache != NULL)
+        ps->prepared = g_strdup(g_hash_table_lookup(s_prepared_cache, ps->checksum));
+    pthread_mutex_unlock(&s_prepared_mutex);
+
+    /* Scripts on disk were written after a successful syntax check */
+    if (ps->prepared == NULL && dwb.files[FILES_PREPARED_SCRIPTS] != NULL)
+    {
+        char *cache_path = g_build_filename(dwb.files[FILES_PREPARED_SCRIPTS], ps->checksum, NULL);
+        ps->checked = g_file_get_contents(cache_path, &ps->prepared, NULL, NULL);
+        g_free(cache_path);
+    }
 
-    if (js_check_syntax(s_ctx->global_context, script, path, 2)) 
+    if (ps->prepared == NULL)
     {
         /** 
          * Prints an assertion message and removes all handles owned by the
@@ -1201,8 +1975,8 @@ init_script(const char *path, const char *script, gboolean is_archive, const cha
         prepared = init_macro(script, "assert", 
                 "if(!(\\1)){try{script.removeHandles();throw new Error();}catch(e){io.debug('Assertion in %s:'+(e.line)+' failed: \\1');};return;}", 
                 path);
-
-        g_return_if_fail(prepared != NULL);
+        if (prepared == NULL)
+            goto error_out;
 
         /** 
          * Use this script only for the specified profiles. If the current profile doesn't match
@@ -1230,37 +2004,157 @@ init_script(const char *path, const char *script, gboolean is_archive, const cha
         tmp = prepared;
         prepared = init_macro(tmp, "profile", 
                 "if(!([\\1].some(function(n) { return data.profile == n; }))){return;}");
+        if (prepared == NULL)
+            goto error_out;
 
-        g_return_if_fail(prepared != NULL);
+        ps->prepared = g_strdup_printf(is_archive ? SCRIPT_TEMPLATE_XINCLUDE : SCRIPT_TEMPLATE, path, prepared);
 
-        debug = g_strdup_printf(template, path, prepared);
+        pthread_mutex_lock(&s_prepared_mutex);
+        if (s_prepared_cache == NULL || g_hash_table_size(s_prepared_cache) >= PREPARED_CACHE_MAX)
+        {
+            if (s_prepared_cache != NULL)
+                g_hash_table_unref(s_prepared_cache);
+            s_prepared_cache = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, g_free);
+        }
+        g_hash_table_replace(s_prepared_cache, g_strdup(ps->checksum), g_strdup(ps->prepared));
+        pthread_mutex_unlock(&s_prepared_mutex);
+    }
+error_out:
+    ps->load_time = g_get_monotonic_time() - start;
+    g_free(prepared);
+    g_free(tmp);
+    return ps;
+}/*}}}*/
 
-        JSObjectRef function = js_make_function(s_ctx->global_context, debug, path, offset);
-        if (is_archive)
-            js_set_object_property(s_ctx->global_context, function, "path", path, NULL);
+/* scripts_prepared_free {{{*/
+void
+scripts_prepared_free(PreparedScript *ps) 
+{
+    if (ps != NULL)
+    {
+        g_free(ps->path);
+        g_free(ps->script);
+        g_free(ps->prepared);
+        g_free(ps->checksum);
+        g_free(ps);
+    }
+}/*}}}*/
 
-        if (function != NULL) 
-            s_ctx->script_list = g_slist_prepend(s_ctx->script_list, function);
+/* scripts_init_prepared {{{*/
+/* 
+ * Compiles a prepared script, must be called from the main thread. The syntax
+ * of the original script is only checked once for the same content.
+ * */
+void
+scripts_init_prepared(PreparedScript *ps) 
+{
+    ScriptStartup *startup;
+    JSObjectRef function = NULL;
+    gint64 start = g_get_monotonic_time();
 
-        g_free(prepared);
-        g_free(tmp);
-        g_free(debug);
+    if (s_ctx == NULL) 
+        create_global_object();
+
+    if (ps->prepared == NULL)
+        return;
+
+    if (s_checked_scripts == NULL)
+        s_checked_scripts = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+    if (ps->checked || g_hash_table_contains(s_checked_scripts, ps->checksum) || js_check_syntax(s_ctx->global_context, ps->script, ps->path, 2)) 
+    {
+        if (g_hash_table_size(s_checked_scripts) >= PREPARED_CACHE_MAX)
+            g_hash_table_remove_all(s_checked_scripts);
+        g_hash_table_add(s_checked_scripts, g_strdup(ps->checksum));
+
+        function = js_make_function(s_ctx->global_context, ps->prepared, ps->path, ps->is_archive ? 0 : 1);
     }
-}
+    if (function != NULL && dwb.files[FILES_PREPARED_SCRIPTS] != NULL) 
+    {
+        char *cache_path = g_build_filename(dwb.files[FILES_PREPARED_SCRIPTS], ps->checksum, NULL);
+        if (!ps->checked && !g_file_test(cache_path, G_FILE_TEST_EXISTS))
+            g_file_set_contents(cache_path, ps->prepared, -1, NULL);
+        if (s_prepared_used == NULL)
+            s_prepared_used = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+        g_hash_table_add(s_prepared_used, g_strdup(ps->checksum));
+        g_free(cache_path);
+    }
+    if (function != NULL) 
+    {
+        if (ps->is_archive)
+            js_set_object_property(s_ctx->global_context, function, "path", ps->path, NULL);
+        s_ctx->script_list = g_slist_prepend(s_ctx->script_list, function);
+
+        startup = g_malloc0(sizeof(ScriptStartup));
+        startup->path = g_strdup(ps->path);
+        startup->load = ps->load_time;
+        startup->compile = g_get_monotonic_time() - start;
+        s_startup_pending = g_slist_prepend(s_startup_pending, startup);
+    }
+}/*}}}*/
+
+/* scripts_prune_prepared {{{*/
+/* 
+ * Removes prepared scripts from disk that weren't used by the last load of the
+ * userscripts
+ * */
+void
+scripts_prune_prepared(void) 
+{
+    GDir *dir;
+    const char *filename;
+
+    if (dwb.files[FILES_PREPARED_SCRIPTS] == NULL || (dir = g_dir_open(dwb.files[FILES_PREPARED_SCRIPTS], 0, NULL)) == NULL)
+        return;
+    while ((filename = g_dir_read_name(dir)) != NULL) 
+    {
+        if (s_prepared_used == NULL || !g_hash_table_contains(s_prepared_used, filename)) 
+        {
+            char *path = g_build_filename(dwb.files[FILES_PREPARED_SCRIPTS], filename, NULL);
+            unlink(path);
+            g_free(path);
+        }
+    }
+    g_dir_close(dir);
+    if (s_prepared_used != NULL)
+        g_hash_table_remove_all(s_prepared_used);
+}/*}}}*/
 
 /* scripts_init_script {{{*/
 void
 scripts_init_script(const char *path, const char *script) 
 {
-    init_script(path, script, false, SCRIPT_TEMPLATE, 1);
+    PreparedScript *ps = scripts_prepare(path, g_strdup(script), false);
+    scripts_init_prepared(ps);
+    scripts_prepared_free(ps);
 }/*}}}*/
 
 void
 scripts_init_archive(const char *path, const char *script) 
 {
-    init_script(path, script, true, SCRIPT_TEMPLATE_XINCLUDE, 0);
+    PreparedScript *ps = scripts_prepare(path, g_strdup(script), true);
+    scripts_init_prepared(ps);
+    scripts_prepared_free(ps);
 }
 
+/* scripts_get_wrapper_stats {{{*/
+/* Returns the name of the signal and the number of wrappers created and reused
+ * for its arguments */
+const char *
+scripts_get_wrapper_stats(int signal, ScriptWrapperStats *stats)
+{
+    g_return_val_if_fail(signal >= SCRIPTS_SIG_FIRST && signal < SCRIPTS_SIG_LAST, NULL);
+
+    *stats = s_wrapper_stats[signal];
+    return s_sigmap[signal];
+}/*}}}*/
+
+/* scripts_get_startup_times {{{*/
+GSList *
+scripts_get_startup_times(void)
+{
+    return s_startup_times;
+}/*}}}*/
+
 void
 evaluate(const char *script) 
 {
@@ -1291,7 +2185,7 @@ scripts_reapply()
     {
         for (GList *gl = dwb.state.views; gl; gl=gl->next)
         {
-            JSObjectRef o = scripts_make_object(s_ctx->global_context, G_OBJECT(VIEW(gl)->web));
+            JSObjectRef o = scripts_make_tab_object(gl);
             JSValueProtect(s_ctx->global_context, o);
             VIEW(gl)->script_wv = o;
         }
@@ -61,6 +61,7 @@
 #define SCRIPT_MAX_SIG_OBJECTS 8
 
 typedef struct _ScriptSignal {
+  GList *view;                  /* the tab the handler time is accounted to */
   JSObjectRef jsobj;
   GObject *objects[SCRIPT_MAX_SIG_OBJECTS]; 
   char *json;
@@ -69,9 +70,37 @@ typedef struct _ScriptSignal {
   Arg *arg;
 } ScriptSignal;
 
+/* A userscript prepared off the main thread */
+typedef struct _PreparedScript {
+  char *path;
+  char *script;                 /* original content, used for the syntax check */
+  char *prepared;               /* content wrapped into the script template */
+  char *checksum;
+  gboolean is_archive;
+  gboolean checked;             /* read from disk, the syntax was already checked */
+  gint64 load_time;             /* microseconds */
+} PreparedScript;
+
+/* Startup times of a userscript in microseconds */
+typedef struct _ScriptStartup {
+  char *path;
+  gint64 load;
+  gint64 compile;
+  gint64 run;
+} ScriptStartup;
+
+/* JS wrappers created for and reused by the arguments of a signal */
+typedef struct _ScriptWrapperStats {
+  guint created;
+  guint reused;
+} ScriptWrapperStats;
+
 gboolean scripts_emit(ScriptSignal *);
+gboolean scripts_filter_signal(int signal, const char *uri, gboolean main_frame, gboolean document);
 
 void scripts_create_tab(GList *gl);
+void scripts_attach_tab(GList *gl);
+void scripts_detach_tab(GList *gl);
 void scripts_remove_tab(JSObjectRef );
 
 void scripts_check_syntax(char **scripts);
@@ -81,6 +110,12 @@ void scripts_end(gboolean);
 gboolean scripts_init(gboolean);
 void scripts_init_script(const char *, const char *);
 void scripts_init_archive(const char *, const char *);
+PreparedScript * scripts_prepare(const char *path, char *script, gboolean is_archive);
+void scripts_prepared_free(PreparedScript *);
+void scripts_init_prepared(PreparedScript *);
+void scripts_prune_prepared(void);
+GSList * scripts_get_startup_times(void);
+const char * scripts_get_wrapper_stats(int signal, ScriptWrapperStats *stats);
 gboolean scripts_execute_one(const char *script, const char *path);
 gboolean scripts_load_chrome(JSObjectRef,  const char *);
 void scripts_reapply(void);
@@ -114,7 +149,7 @@ G_STMT_END
   } else g_free(json); \
 G_STMT_END
 
-#define SCRIPTS_WV(gl) .jsobj = (VIEW(gl)->script_wv)
+#define SCRIPTS_WV(gl) .view = (gl), .jsobj = (VIEW(gl)->script_wv)
 #define SCRIPTS_SIG_META(js, sig, num) .json = js, .signal = SCRIPTS_SIG_##sig, .numobj = num, .arg = NULL
 #define SCRIPTS_SIG_ARG(js, sig, num) .json = js, .signal = SCRIPTS_SIG_##sig, .numobj = num 
 #endif
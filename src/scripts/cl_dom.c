@@ -79,8 +79,18 @@ make_dom_object(JSContextRef ctx, GObject *o) {
     if (WEBKIT_DOM_IS_NODE_LIST(o)) {
         return dom_make_node_list(ctx, WEBKIT_DOM_NODE_LIST(o), NULL);
     }
-    JSObjectRef result =  make_object_for_class(ctx, CLASS_DOM_OBJECT, o, true);
-    g_object_weak_ref(o, (GWeakNotify)object_destroy_weak_cb, result);
+    JSObjectRef result;
+    ScriptContext *sctx = scripts_get_context();
+    if (sctx == NULL)
+        return JSValueToObject(ctx, NIL, NULL);
+    guint created = sctx->wrappers_created;
+
+    result =  make_object_for_class(ctx, CLASS_DOM_OBJECT, o, true);
+    /* Cached wrappers already hold a weak reference */
+    if (sctx->wrappers_created != created)
+        g_object_weak_ref(o, (GWeakNotify)object_destroy_weak_cb, result);
+
+    scripts_release_context();
     return result;
 }
 // dom functions
@@ -17,6 +17,7 @@
  */
 
 #include "private.h"
+#include "../download.h"
 
 /* download_constructor_cb {{{*/
 /**
@@ -62,7 +63,7 @@ stop_download_notify(CallbackData *c)
     return false;
 }/*}}}*/
 
-/* download_start {{{*/
+/* download_js_start {{{*/
 /** 
  * Starts a download
  *
@@ -78,7 +79,7 @@ stop_download_notify(CallbackData *c)
  *      true if the download was started
  * */
 static JSValueRef 
-download_start(JSContextRef ctx, JSObjectRef function, JSObjectRef this, size_t argc, const JSValueRef argv[], JSValueRef* exc) 
+download_js_start(JSContextRef ctx, JSObjectRef function, JSObjectRef this, size_t argc, const JSValueRef argv[], JSValueRef* exc) 
 {
     WebKitDownload *download = JSObjectGetPrivate(this);
     if (download == NULL)
@@ -105,16 +106,46 @@ download_start(JSContextRef ctx, JSObjectRef function, JSObjectRef this, size_t
  * @memberOf WebKitDownload.prototype
  * @function 
  * */
-/* download_cancel {{{*/
+/* download_js_cancel {{{*/
 static JSValueRef 
-download_cancel(JSContextRef ctx, JSObjectRef function, JSObjectRef this, size_t argc, const JSValueRef argv[], JSValueRef* exc) 
+download_js_cancel(JSContextRef ctx, JSObjectRef function, JSObjectRef this, size_t argc, const JSValueRef argv[], JSValueRef* exc) 
 {
     WebKitDownload *download = JSObjectGetPrivate(this);
     g_return_val_if_fail(download != NULL, NULL);
 
-    webkit_download_cancel(download);
+    if (!download_cancel_download(download))
+        webkit_download_cancel(download);
     return NULL;
 }/*}}}*/
+
+/* download_js_get_priority {{{*/
+/**
+ * The priority of a download that is handled by dwb, downloads with a higher
+ * priority are started first if the download has to wait for a free slot.
+ * Changing the priority of a running download has no effect.
+ *
+ * @name priority
+ * @memberOf WebKitDownload.prototype
+ * @type Number
+ * @since 1.14
+ * */
+static JSValueRef 
+download_js_get_priority(JSContextRef ctx, JSObjectRef this, JSStringRef property, JSValueRef* exception) 
+{
+    WebKitDownload *download = JSObjectGetPrivate(this);
+    if (download == NULL)
+        return NIL;
+    return JSValueMakeNumber(ctx, download_get_priority(download));
+}
+static bool 
+download_js_set_priority(JSContextRef ctx, JSObjectRef this, JSStringRef property, JSValueRef value, JSValueRef* exception) 
+{
+    WebKitDownload *download = JSObjectGetPrivate(this);
+    double priority = JSValueToNumber(ctx, value, exception);
+    if (download == NULL || isnan(priority))
+        return false;
+    return download_set_priority(download, (int)priority);
+}/*}}}*/
 void 
 download_initialize(ScriptContext *sctx) {
     /** 
@@ -133,15 +164,20 @@ download_initialize(ScriptContext *sctx) {
      * */
     /* download */
     JSStaticFunction download_functions[] = { 
-        { "start",          download_start,        kJSDefaultAttributes },
-        { "cancel",         download_cancel,        kJSDefaultAttributes },
+        { "start",          download_js_start,        kJSDefaultAttributes },
+        { "cancel",         download_js_cancel,        kJSDefaultAttributes },
         { 0, 0, 0 }, 
     };
 
+    JSStaticValue download_values[] = {
+        { "priority",       download_js_get_priority, download_js_set_priority, kJSPropertyAttributeDontDelete },
+        { 0, 0, 0, 0 }, 
+    };
+
     JSClassDefinition cd = kJSClassDefinitionEmpty;
     cd.className = "WebKitDownload";
     cd.staticFunctions = download_functions;
-    cd.staticValues = NULL;
+    cd.staticValues = download_values;
     cd.parentClass = sctx->classes[CLASS_GOBJECT];
     sctx->classes[CLASS_DOWNLOAD] = JSClassCreate(&cd);
 
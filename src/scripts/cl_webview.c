@@ -72,6 +72,9 @@ wv_load_uri(JSContextRef ctx, JSObjectRef function, JSObjectRef this, size_t arg
     if (argc == 0) 
         return JSValueMakeBoolean(ctx, false);
 
+    GList *gl = find_webview(this);
+    if (gl != NULL)
+        view_materialize(gl);
     WebKitWebView *wv = JSObjectGetPrivate(this);
     if (wv != NULL) 
     {
@@ -126,6 +129,9 @@ wv_history(JSContextRef ctx, JSObjectRef function, JSObjectRef this, size_t argc
     }
     double steps = JSValueToNumber(ctx, argv[0], exc);
     if (!isnan(steps)) {
+        GList *gl = find_webview(this);
+        if (gl != NULL)
+            view_materialize(gl);
         WebKitWebView *wv = JSObjectGetPrivate(this);
         if (wv != NULL)
             webkit_web_view_go_back_or_forward(wv, (int)steps);
@@ -146,11 +152,37 @@ static JSValueRef
 wv_reload(JSContextRef ctx, JSObjectRef function, JSObjectRef this, size_t argc, const JSValueRef argv[], JSValueRef* exc) 
 {
     WebKitWebView *wv = JSObjectGetPrivate(this);
+    GList *gl = find_webview(this);
+    /* Loading a hibernated tab again is a reload */
+    if (gl != NULL && view_materialize(gl))
+        return NULL;
     if (wv != NULL)
         webkit_web_view_reload(wv);
     return NULL;
 }/*}}}*/
 
+/**
+ * Hibernates the webview, the webview is destroyed while the history, title
+ * and scroll position are kept, the page is loaded again when the tab gets
+ * focus. The focused tab, tabs that are loading and deferred tabs cannot be
+ * hibernated. The object stays valid, handlers connected to the webview with
+ * connect are disconnected.
+ *
+ * @name hibernate
+ * @memberOf WebKitWebView.prototype
+ * @function 
+ *
+ * @returns {Boolean}
+ *      Whether the webview was hibernated
+ * */
+/* wv_hibernate {{{*/
+static JSValueRef 
+wv_hibernate(JSContextRef ctx, JSObjectRef function, JSObjectRef this, size_t argc, const JSValueRef argv[], JSValueRef* exc) 
+{
+    GList *gl = find_webview(this);
+    return JSValueMakeBoolean(ctx, gl != NULL && view_hibernate(gl));
+}/*}}}*/
+
 /* wv_inject {{{*/
 static JSValueRef 
 wv_inject(JSContextRef ctx, JSObjectRef function, JSObjectRef this, size_t argc, const JSValueRef argv[], JSValueRef* exc) 
@@ -410,6 +442,102 @@ wv_load_deferred(JSContextRef ctx, JSObjectRef object, JSStringRef js_name, JSVa
     }
     return JSValueMakeBoolean(ctx, deferred);
 }
+/** 
+ * The uri of the webview, for a hibernated webview the uri of the saved
+ * history item
+ *
+ * @name uri
+ * @memberOf WebKitWebView.prototype
+ * @type String
+ * */
+static JSValueRef 
+wv_get_uri(JSContextRef ctx, JSObjectRef object, JSStringRef js_name, JSValueRef* exception) 
+{
+    const char *uri = NULL;
+    WebKitWebView *wv = JSObjectGetPrivate(object);
+    if (wv != NULL) 
+        uri = webkit_web_view_get_uri(wv);
+    else 
+    {
+        GList *gl = find_webview(object);
+        if (gl != NULL)
+            uri = view_get_uri(gl);
+    }
+    return uri != NULL ? js_char_to_value(ctx, uri) : NIL;
+}
+/** 
+ * The title of the webview, for a hibernated webview the title of the saved
+ * history item
+ *
+ * @name title
+ * @memberOf WebKitWebView.prototype
+ * @type String
+ * */
+static JSValueRef 
+wv_get_title(JSContextRef ctx, JSObjectRef object, JSStringRef js_name, JSValueRef* exception) 
+{
+    const char *title = NULL;
+    WebKitWebView *wv = JSObjectGetPrivate(object);
+    if (wv != NULL) 
+        title = webkit_web_view_get_title(wv);
+    else 
+    {
+        GList *gl = find_webview(object);
+        if (gl != NULL)
+            title = view_get_title(gl);
+    }
+    return title != NULL ? js_char_to_value(ctx, title) : NIL;
+}
+/** 
+ * Whether the webview is hibernated or restored from a session and hasn't been
+ * loaded yet
+ *
+ * @name hibernated
+ * @memberOf WebKitWebView.prototype
+ * @type Boolean
+ * */
+static JSValueRef 
+wv_hibernated(JSContextRef ctx, JSObjectRef object, JSStringRef js_name, JSValueRef* exception) {
+    GList *gl = find_webview(object);
+    return JSValueMakeBoolean(ctx, gl != NULL && VIEW_PLACEHOLDER(VIEW(gl)));
+}
+/** 
+ * Resource usage of the webview since the current page started loading,
+ * an object with properties
+ * <ul>
+ * <li><i>frames</i>, number of frames</li>
+ * <li><i>domNodes</i>, number of elements in all frames</li>
+ * <li><i>resources</i>, number of requested resources</li>
+ * <li><i>resourceBytes</i>, bytes received for all resources</li>
+ * <li><i>adblockTime</i>, milliseconds spent in the adblocker</li>
+ * <li><i>scriptTime</i>, milliseconds spent in script signal handlers</li>
+ * </ul>
+ * The JavaScript heap is shared between all webviews, its size is not
+ * available per webview.
+ *
+ * @name resourceUsage
+ * @memberOf WebKitWebView.prototype
+ * @type Object
+ * */
+/* wv_get_resource_usage {{{*/
+static JSValueRef 
+wv_get_resource_usage(JSContextRef ctx, JSObjectRef object, JSStringRef js_name, JSValueRef* exception) 
+{
+    GList *gl = find_webview(object);
+    if (gl == NULL)
+        return NIL;
+
+    ViewStats *stats = &VIEW(gl)->status->stats;
+    JSObjectRef ret = JSObjectMake(ctx, NULL, NULL);
+    js_set_object_number_property(ctx, ret, "frames", view_get_frame_count(gl), exception);
+    js_set_object_number_property(ctx, ret, "domNodes", VIEW_PLACEHOLDER(VIEW(gl)) ? 0 : view_get_dom_node_count(gl), exception);
+    js_set_object_number_property(ctx, ret, "resources", stats->resources, exception);
+    js_set_object_number_property(ctx, ret, "resourceBytes", stats->resource_bytes, exception);
+    js_set_object_number_property(ctx, ret, "adblockTime", stats->adblock_time / 1000.0, exception);
+    js_set_object_number_property(ctx, ret, "scriptTime", stats->script_time / 1000.0, exception);
+    return ret;
+}/*}}}*/
+
 /* wv_get_main_frame {{{*/
 /** 
  * The main frame
@@ -503,13 +631,7 @@ wv_get_all_frames(JSContextRef ctx, JSObjectRef object, JSStringRef js_name, JSV
 static JSValueRef 
 wv_get_number(JSContextRef ctx, JSObjectRef object, JSStringRef js_name, JSValueRef* exception) 
 {
-    GList *gl = dwb.state.views;
-    for (int i=0; gl; i++, gl=gl->next) 
-    {
-        if (object == VIEW(gl)->script_wv) 
-            return JSValueMakeNumber(ctx, i); 
-    }
-    return JSValueMakeNumber(ctx, -1); 
+    return JSValueMakeNumber(ctx, view_position(find_webview(object))); 
 }/*}}}*/
 
 /** 
@@ -624,6 +746,7 @@ webview_initialize(ScriptContext *sctx) {
         { "history",         wv_history,             kJSDefaultAttributes },
         { "reload",          wv_reload,             kJSDefaultAttributes },
         { "inject",          wv_inject,             kJSDefaultAttributes },
+        { "hibernate",       wv_hibernate,          kJSDefaultAttributes },
 #if WEBKIT_CHECK_VERSION(1, 10, 0) && CAIRO_VERSION >= CAIRO_VERSION_ENCODE(1, 12, 0)
         { "toPng",           wv_to_png,             kJSDefaultAttributes },
         { "toPng64",         wv_to_png64,             kJSDefaultAttributes },
@@ -631,7 +754,11 @@ webview_initialize(ScriptContext *sctx) {
         { 0, 0, 0 }, 
     };
     JSStaticValue wv_values[] = {
+        { "uri",           wv_get_uri, NULL, kJSDefaultAttributes }, 
+        { "title",         wv_get_title, NULL, kJSDefaultAttributes }, 
         { "loadDeferred",  wv_load_deferred, NULL, kJSDefaultAttributes }, 
+        { "hibernated",    wv_hibernated, NULL, kJSDefaultAttributes }, 
+        { "resourceUsage", wv_get_resource_usage, NULL, kJSDefaultAttributes }, 
         { "lastSearch",    wv_last_search, NULL, kJSDefaultAttributes }, 
         { "hasSelection",  wv_has_selection, NULL, kJSDefaultAttributes }, 
         { "mainFrame",     wv_get_main_frame, NULL, kJSDefaultAttributes }, 
@@ -0,0 +1,597 @@
+/*
+ * Copyright (c) 2010-2014 Stefan Bolte <portix@gmx.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "private.h"
+
+/*
+ * A worker runs a script in its own global context on its own thread, every
+ * context is created in a separate context group so it never shares a heap
+ * with the main context. Messages are passed as json strings, messages to the
+ * worker are dispatched by the worker's main loop, messages from the worker by
+ * the default main loop. The main side only touches the Worker-object while
+ * holding the read lock of the script context, scripts_end detaches all
+ * workers while holding the write lock.
+ *
+ * The natives of the restricted namespaces only use the context they are
+ * called with. They must not return NIL, it is protected in the main context
+ * and replaced when scripts are reloaded, null is created with
+ * JSValueMakeNull(ctx) instead.
+ * */
+
+typedef enum {
+    WORKER_MESSAGE,
+    WORKER_ERROR,
+    WORKER_CLOSED,
+} WorkerMessageType;
+
+typedef struct Worker_s {
+    volatile gint ref;
+    volatile gint closed;
+    GMainContext *context;
+    GMainLoop *loop;
+    char *script;
+    char *path;
+    /* The Worker object in the main context, only accessed from the main
+     * thread, NULL after the worker has been terminated */
+    JSObjectRef object;
+    /* Only accessed from the worker thread */
+    JSGlobalContextRef global_context;
+} Worker;
+
+typedef struct WorkerMessage_s {
+    Worker *worker;
+    WorkerMessageType type;
+    char *data;
+} WorkerMessage;
+
+static const char *s_worker_namespaces[] = { "data", "io", "util", NULL };
+
+/* worker_new {{{*/
+static Worker *
+worker_new(char *script, char *path)
+{
+    Worker *worker = g_malloc0(sizeof(Worker));
+    worker->ref = 1;
+    worker->context = g_main_context_new();
+    worker->loop = g_main_loop_new(worker->context, false);
+    worker->script = script;
+    worker->path = path;
+    return worker;
+}/*}}}*/
+
+/* worker_unref {{{*/
+static void
+worker_unref(Worker *worker)
+{
+    if (g_atomic_int_dec_and_test(&worker->ref))
+    {
+        g_main_loop_unref(worker->loop);
+        g_main_context_unref(worker->context);
+        g_free(worker->script);
+        g_free(worker->path);
+        g_free(worker);
+    }
+}/*}}}*/
+
+/* worker_message_new {{{*/
+static WorkerMessage *
+worker_message_new(Worker *worker, WorkerMessageType type, char *data)
+{
+    WorkerMessage *message = g_malloc(sizeof(WorkerMessage));
+    message->worker = worker;
+    message->type = type;
+    message->data = data;
+    return message;
+}/*}}}*/
+
+/* worker_message_free {{{*/
+static void
+worker_message_free(WorkerMessage *message)
+{
+    g_free(message->data);
+    g_free(message);
+}/*}}}*/
+
+/* worker_main_message_free {{{*/
+/* Messages to the main thread keep a reference to the worker */
+static void
+worker_main_message_free(WorkerMessage *message)
+{
+    worker_unref(message->worker);
+    worker_message_free(message);
+}/*}}}*/
+
+/* worker_data_to_value {{{*/
+static JSValueRef
+worker_data_to_value(JSContextRef ctx, const char *data)
+{
+    if (data == NULL)
+        return JSValueMakeUndefined(ctx);
+    return js_json_to_value(ctx, data);
+}/*}}}*/
+
+/* worker_attach {{{*/
+/* Adds an idle source to the main loop of the worker */
+static void
+worker_attach(Worker *worker, GSourceFunc func, gpointer data, GDestroyNotify notify)
+{
+    GSource *source = g_idle_source_new();
+    g_source_set_callback(source, func, data, notify);
+    g_source_attach(source, worker->context);
+    g_source_unref(source);
+}/*}}}*/
+
+/* worker_quit {{{*/
+static gboolean
+worker_quit_cb(Worker *worker)
+{
+    g_main_loop_quit(worker->loop);
+    return false;
+}
+/* Stops the worker after the current task, can be called from any thread */
+static void
+worker_quit(Worker *worker)
+{
+    g_atomic_int_set(&worker->closed, 1);
+    worker_attach(worker, (GSourceFunc)worker_quit_cb, worker, NULL);
+}/*}}}*/
+
+/* worker_detach {{{*/
+/* Called from the main thread */
+static void
+worker_detach(JSContextRef ctx, ScriptContext *sctx, Worker *worker)
+{
+    sctx->workers = g_slist_remove(sctx->workers, worker);
+    JSValueUnprotect(ctx, worker->object);
+    worker->object = NULL;
+}/*}}}*/
+
+/* WORKER THREAD {{{*/
+
+/* worker_dispatch_main {{{*/
+static gboolean
+worker_dispatch_main(WorkerMessage *message)
+{
+    Worker *worker = message->worker;
+    JSContextRef ctx = scripts_get_global_context();
+    if (ctx == NULL)
+        return false;
+
+    if (worker->object != NULL)
+    {
+        if (message->type == WORKER_CLOSED)
+        {
+            ScriptContext *sctx = scripts_get_context();
+            worker_detach(ctx, sctx, worker);
+            scripts_release_context();
+        }
+        else
+        {
+            JSObjectRef callback = js_get_object_property(ctx, worker->object,
+                    message->type == WORKER_ERROR ? "onerror" : "onmessage");
+            if (callback != NULL && JSObjectIsFunction(ctx, callback))
+            {
+                JSValueRef argv[] = { message->type == WORKER_ERROR
+                    ? js_char_to_value(ctx, message->data)
+                    : worker_data_to_value(ctx, message->data) };
+                scripts_call_as_function(ctx, callback, worker->object, 1, argv);
+            }
+            else if (message->type == WORKER_ERROR)
+                fprintf(stderr, "DWB SCRIPT EXCEPTION: in worker %s: %s\n", worker->path, message->data);
+        }
+    }
+    scripts_release_global_context();
+    return false;
+}/*}}}*/
+
+/* worker_post_main {{{*/
+/* Passes a message to the main thread, takes ownership of data */
+static void
+worker_post_main(Worker *worker, WorkerMessageType type, char *data)
+{
+    g_atomic_int_inc(&worker->ref);
+    g_idle_add_full(G_PRIORITY_DEFAULT_IDLE, (GSourceFunc)worker_dispatch_main,
+            worker_message_new(worker, type, data), (GDestroyNotify)worker_main_message_free);
+}/*}}}*/
+
+/* worker_post_exception {{{*/
+static void
+worker_post_exception(JSContextRef ctx, Worker *worker, JSValueRef exc)
+{
+    char *message = NULL;
+    JSObjectRef o;
+    if (JSValueIsObject(ctx, exc) && (o = JSValueToObject(ctx, exc, NULL)) != NULL)
+    {
+        char *text = js_get_string_property(ctx, o, "message");
+        message = g_strdup_printf("in line %d: %s", (int)js_get_double_property(ctx, o, "line"),
+                text == NULL ? "unknown" : text);
+        g_free(text);
+    }
+    else
+        message = js_value_to_char(ctx, exc, -1, NULL);
+    worker_post_main(worker, WORKER_ERROR, message);
+}/*}}}*/
+
+/* worker_dispatch {{{*/
+/* Calls onmessage of the worker's global object, runs in the worker thread */
+static gboolean
+worker_dispatch(WorkerMessage *message)
+{
+    JSValueRef exc = NULL;
+    Worker *worker = message->worker;
+    JSContextRef ctx = worker->global_context;
+    JSObjectRef callback = js_get_object_property(ctx, JSContextGetGlobalObject(ctx), "onmessage");
+    if (callback != NULL && JSObjectIsFunction(ctx, callback))
+    {
+        JSValueRef argv[] = { worker_data_to_value(ctx, message->data) };
+        JSObjectCallAsFunction(ctx, callback, NULL, 1, argv, &exc);
+        if (exc != NULL)
+            worker_post_exception(ctx, worker, exc);
+    }
+    return false;
+}/*}}}*/
+
+/* worker_post_message_cb {{{*/
+/** 
+ * Sends a message to the main context, the message must be serializable as
+ * json
+ *
+ * @name postMessage
+ * @memberOf WorkerScope
+ * @function
+ * @since 1.14
+ *
+ * @param {Object} message The message
+ * */
+static JSValueRef 
+worker_post_message_cb(JSContextRef ctx, JSObjectRef function, JSObjectRef this, size_t argc, const JSValueRef argv[], JSValueRef* exc) 
+{
+    Worker *worker = JSObjectGetPrivate(JSContextGetGlobalObject(ctx));
+    JSValueRef e = NULL;
+    char *json = NULL;
+    if (argc > 0) 
+    {
+        json = js_value_to_json(ctx, argv[0], -1, 0, &e);
+        if (e != NULL)
+        {
+            if (exc != NULL)
+                *exc = e;
+            return NULL;
+        }
+    }
+    worker_post_main(worker, WORKER_MESSAGE, json);
+    return NULL;
+}/*}}}*/
+
+/* worker_close_cb {{{*/
+/** 
+ * Stops the worker, messages that haven't been dispatched yet are discarded
+ *
+ * @name close
+ * @memberOf WorkerScope
+ * @function
+ * @since 1.14
+ * */
+static JSValueRef 
+worker_close_cb(JSContextRef ctx, JSObjectRef function, JSObjectRef this, size_t argc, const JSValueRef argv[], JSValueRef* exc) 
+{
+    worker_quit(JSObjectGetPrivate(JSContextGetGlobalObject(ctx)));
+    return NULL;
+}/*}}}*/
+
+/* worker_namespace_cb {{{*/
+/** 
+ * Gets a namespace, only <i>data</i>, <i>io</i> and <i>util</i> are available
+ * in workers and only functions that don't need the main context, i.e.
+ * io.out, io.err, io.read, io.write, io.dirNames, util.markupEscape and
+ * util.checksum
+ *
+ * @name namespace
+ * @memberOf WorkerScope
+ * @function
+ * @since 1.14
+ *
+ * @param {String} name The name of the namespace
+ *
+ * @returns {Object} 
+ *      The namespace or null if it isn't available in workers
+ * */
+static JSValueRef 
+worker_namespace_cb(JSContextRef ctx, JSObjectRef function, JSObjectRef this, size_t argc, const JSValueRef argv[], JSValueRef* exc) 
+{
+    JSValueRef ret = NULL;
+    char *name;
+    if (argc < 1 || (name = js_value_to_char(ctx, argv[0], JS_STRING_MAX, exc)) == NULL)
+        return JSValueMakeNull(ctx);
+
+    for (int i=0; s_worker_namespaces[i] != NULL && ret == NULL; i++)
+    {
+        if (!g_strcmp0(name, s_worker_namespaces[i]))
+            ret = js_get_object_property(ctx, JSContextGetGlobalObject(ctx), name);
+    }
+    g_free(name);
+    return ret != NULL ? ret : JSValueMakeNull(ctx);
+}/*}}}*/
+
+/* worker_context_new {{{*/
+static JSGlobalContextRef
+worker_context_new(Worker *worker)
+{
+    /**
+     * The global object of a worker 
+     *
+     * @namespace 
+     *      The global object of scripts running in a {@link Worker}
+     * @name WorkerScope
+     * @static 
+     * @since 1.14
+     * @example
+     * // worker.js
+     * var io = namespace("io");
+     * onmessage = function(path) {
+     *      var lines = io.read(path).split("\n");
+     *      postMessage(lines.filter(function(l) { return l[0] != "!"; }));
+     * };
+     * */
+    JSStaticFunction global_functions[] = { 
+        { "postMessage",    worker_post_message_cb,     kJSDefaultAttributes },
+        { "close",          worker_close_cb,            kJSDefaultAttributes },
+        { "namespace",      worker_namespace_cb,        kJSDefaultAttributes },
+        { 0, 0, 0 }, 
+    };
+    JSClassDefinition cd = kJSClassDefinitionEmpty;
+    cd.className = "WorkerScope";
+    cd.staticFunctions = global_functions;
+    JSClassRef klass = JSClassCreate(&cd);
+
+    /* A new context group so that the worker has its own heap */
+    JSGlobalContextRef ctx = JSGlobalContextCreate(klass);
+    JSClassRelease(klass);
+
+    JSObjectRef global_object = JSContextGetGlobalObject(ctx);
+    JSObjectSetPrivate(global_object, worker);
+    js_set_object_number_property(ctx, global_object, "version", API_VERSION, NULL);
+
+    data_initialize(ctx);
+    io_worker_initialize(ctx);
+    util_worker_initialize(ctx);
+    return ctx;
+}/*}}}*/
+
+/* worker_thread {{{*/
+static gpointer
+worker_thread(Worker *worker)
+{
+    JSValueRef exc = NULL;
+
+    g_main_context_push_thread_default(worker->context);
+    JSGlobalContextRef ctx = worker->global_context = worker_context_new(worker);
+
+    JSStringRef script = JSStringCreateWithUTF8CString(worker->script);
+    JSStringRef source = JSStringCreateWithUTF8CString(worker->path);
+    JSEvaluateScript(ctx, script, NULL, source, 0, &exc);
+    JSStringRelease(script);
+    JSStringRelease(source);
+    if (exc != NULL)
+        worker_post_exception(ctx, worker, exc);
+
+    /* If the worker is terminated before the loop runs the quit source is
+     * still pending */
+    if (!g_atomic_int_get(&worker->closed))
+        g_main_loop_run(worker->loop);
+
+    worker->global_context = NULL;
+    JSGlobalContextRelease(ctx);
+    g_main_context_pop_thread_default(worker->context);
+
+    worker_post_main(worker, WORKER_CLOSED, NULL);
+    worker_unref(worker);
+    return NULL;
+}/*}}}*//*}}}*/
+
+/* worker_post_message {{{*/
+/** 
+ * Sends a message to the worker, the message must be serializable as json.
+ * The message is passed to the worker's <i>onmessage</i> function.
+ *
+ * @name postMessage
+ * @memberOf Worker.prototype
+ * @function
+ * @since 1.14
+ *
+ * @param {Object} message The message
+ * */
+static JSValueRef 
+worker_post_message(JSContextRef ctx, JSObjectRef function, JSObjectRef this, size_t argc, const JSValueRef argv[], JSValueRef* exc) 
+{
+    char *json = NULL;
+    JSValueRef e = NULL;
+    Worker *worker = JSObjectGetPrivate(this);
+    if (worker == NULL || worker->object == NULL)
+        return JSValueMakeNull(ctx);
+
+    if (argc > 0) 
+    {
+        json = js_value_to_json(ctx, argv[0], -1, 0, &e);
+        if (e != NULL)
+        {
+            if (exc != NULL)
+                *exc = e;
+            return JSValueMakeNull(ctx);
+        }
+    }
+    worker_attach(worker, (GSourceFunc)worker_dispatch, 
+            worker_message_new(worker, WORKER_MESSAGE, json), (GDestroyNotify)worker_message_free);
+    return JSValueMakeNull(ctx);
+}/*}}}*/
+
+/* worker_terminate {{{*/
+/** 
+ * Terminates the worker after the current task, messages that haven't been
+ * dispatched yet are discarded
+ *
+ * @name terminate
+ * @memberOf Worker.prototype
+ * @function
+ * @since 1.14
+ * */
+static JSValueRef 
+worker_terminate(JSContextRef ctx, JSObjectRef function, JSObjectRef this, size_t argc, const JSValueRef argv[], JSValueRef* exc) 
+{
+    Worker *worker = JSObjectGetPrivate(this);
+    if (worker != NULL && worker->object != NULL)
+    {
+        ScriptContext *sctx = scripts_get_context();
+        worker_quit(worker);
+        worker_detach(ctx, sctx, worker);
+        scripts_release_context();
+    }
+    return JSValueMakeNull(ctx);
+}/*}}}*/
+
+/* worker_constructor_cb {{{*/
+static JSObjectRef 
+worker_constructor_cb(JSContextRef ctx, JSObjectRef constructor, size_t argc, const JSValueRef argv[], JSValueRef* exception) 
+{
+    char *script = NULL, *path = NULL;
+    char expanded[PATH_MAX];
+    JSObjectRef ret;
+    GThread *thread;
+    GError *error = NULL;
+
+    if (argc < 1)
+    {
+        js_make_exception(ctx, exception, EXCEPTION("Worker constructor: missing argument"));
+        return JSValueToObject(ctx, NIL, NULL);
+    }
+    if (JSValueIsObject(ctx, argv[0]) && JSObjectIsFunction(ctx, JSValueToObject(ctx, argv[0], NULL)))
+    {
+        if ((script = scripts_get_body(ctx, JSValueToObject(ctx, argv[0], NULL), exception)) == NULL)
+            return JSValueToObject(ctx, NIL, NULL);
+        path = g_strdup("worker");
+    }
+    else 
+    {
+        if ((path = js_value_to_char(ctx, argv[0], PATH_MAX, exception)) == NULL)
+            return JSValueToObject(ctx, NIL, NULL);
+        if (util_expand_home(expanded, path, sizeof(expanded)) == NULL || 
+                (script = util_get_file_content(expanded, NULL)) == NULL)
+        {
+            js_make_exception(ctx, exception, EXCEPTION("Worker constructor: cannot read %s"), path);
+            g_free(path);
+            return JSValueToObject(ctx, NIL, NULL);
+        }
+    }
+
+    ScriptContext *sctx = scripts_get_context();
+    Worker *worker = worker_new(script, path);
+    ret = JSObjectMake(ctx, sctx->classes[CLASS_WORKER], worker);
+    worker->object = ret;
+    JSValueProtect(ctx, ret);
+    sctx->workers = g_slist_prepend(sctx->workers, worker);
+
+    /* Reference for the worker thread */
+    g_atomic_int_inc(&worker->ref);
+    if ((thread = g_thread_try_new("dwb-worker", (GThreadFunc)worker_thread, worker, &error)) != NULL)
+        g_thread_unref(thread);
+    else 
+    {
+        js_make_exception(ctx, exception, EXCEPTION("Worker constructor: %s"), error->message);
+        g_error_free(error);
+        worker_detach(ctx, sctx, worker);
+        worker_unref(worker);
+    }
+    scripts_release_context();
+    return ret;
+}/*}}}*/
+
+/* worker_finalize {{{*/
+static void 
+worker_finalize(JSObjectRef o) 
+{
+    Worker *worker = JSObjectGetPrivate(o);
+    if (worker != NULL)
+        worker_unref(worker);
+}/*}}}*/
+
+/* worker_finish {{{*/
+/* Called from script_context_free while the context is locked for writing */
+void
+worker_finish(ScriptContext *sctx)
+{
+    for (GSList *l = sctx->workers; l; l=l->next)
+    {
+        Worker *worker = l->data;
+        worker_quit(worker);
+        JSValueUnprotect(sctx->global_context, worker->object);
+        worker->object = NULL;
+    }
+    g_slist_free(sctx->workers);
+    sctx->workers = NULL;
+}/*}}}*/
+
+void
+worker_initialize(ScriptContext *sctx) 
+{
+    /** 
+     * Constructs a new Worker. A worker runs a script in a separate context on
+     * a background thread so that expensive computations don't block the
+     * browser. Workers communicate with the main context by passing messages
+     * that are serializable as json, the worker has access to the restricted
+     * namespaces described in {@link WorkerScope}. A worker keeps running until
+     * it is terminated or calls <i>close</i>.
+     *
+     * @name Worker
+     * @class 
+     *      Runs scripts on a background thread
+     * @since 1.14
+     *
+     * @param {String|Function} script 
+     *      Path to the script or a function, the body of the function is run in
+     *      the worker, it cannot reference variables of the enclosing scope
+     *
+     * @property {Function} onmessage 
+     *      Called with every message posted by the worker
+     * @property {Function} onerror 
+     *      Called with the error message if an exception was thrown in the
+     *      worker 
+     * @example 
+     * var worker = new Worker(function() {
+     *      onmessage = function(numbers) {
+     *          postMessage(numbers.reduce(function(a, b) { return a + b; }, 0));
+     *      };
+     * });
+     * worker.onmessage = function(sum) {
+     *      io.out("sum: " + sum);
+     *      worker.terminate();
+     * };
+     * worker.postMessage([1, 2, 3]);
+     * */
+    JSStaticFunction worker_functions[] = {
+        { "postMessage",        worker_post_message,        kJSDefaultAttributes }, 
+        { "terminate",          worker_terminate,           kJSDefaultAttributes }, 
+        { 0, 0, 0 }, 
+    };
+
+    JSClassDefinition cd = kJSClassDefinitionEmpty;
+    cd.className = "Worker";
+    cd.staticFunctions = worker_functions;
+    cd.finalize = worker_finalize;
+    sctx->classes[CLASS_WORKER] = JSClassCreate(&cd);
+    sctx->constructors[CONSTRUCTOR_WORKER] = scripts_create_constructor(sctx->global_context, "Worker", sctx->classes[CLASS_WORKER], worker_constructor_cb, NULL);
+}
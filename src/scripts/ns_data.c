@@ -74,7 +74,7 @@ data_get_config_dir(JSContextRef ctx, JSObjectRef object, JSStringRef js_name, J
 {
     char *dir = util_build_path();
     if (dir == NULL) 
-        return NIL;
+        return JSValueMakeNull(ctx);
 
     JSValueRef ret = js_char_to_value(ctx, dir);
     g_free(dir);
@@ -94,7 +94,7 @@ data_get_system_data_dir(JSContextRef ctx, JSObjectRef object, JSStringRef js_na
 {
     char *dir = util_get_system_data_dir(NULL);
     if (dir == NULL) 
-        return NIL;
+        return JSValueMakeNull(ctx);
 
     JSValueRef ret = js_char_to_value(ctx, dir);
     g_free(dir);
@@ -114,7 +114,7 @@ data_get_user_data_dir(JSContextRef ctx, JSObjectRef object, JSStringRef js_name
 {
     char *dir = util_get_user_data_dir(NULL);
     if (dir == NULL) 
-        return NIL;
+        return JSValueMakeNull(ctx);
 
     JSValueRef ret = js_char_to_value(ctx, dir);
     g_free(dir);
@@ -22,19 +22,25 @@ static char *
 xextract(JSContextRef ctx, size_t argc, const JSValueRef argv[], char **archive, off_t *fs, JSValueRef *exc)
 {
     char *content = NULL, *larchive = NULL, *path = NULL;
+    struct exar_archive_s *ea = NULL;
+    const unsigned char *data;
+    int status;
     if (argc < 2) 
         return NULL;
     if ((larchive = js_value_to_char(ctx, argv[0], -1, exc)) == NULL)
         goto error_out;
     if ((path = js_value_to_char(ctx, argv[1], -1, exc)) == NULL)
         goto error_out;
-    if (*path == '~') {
-        content = (char*)exar_search_extract(larchive, path + 1, fs);
-    }
-    else {
-        content = (char*)exar_extract(larchive, path, fs);
-    }
+    if ((ea = exar_open(larchive)) == NULL)
+        goto error_out;
+    if (*path == '~') 
+        status = exar_search_lookup(ea, path + 1, &data, fs);
+    else 
+        status = exar_lookup(ea, path, &data, fs);
+    if (status == 0)
+        content = g_strndup((const char *)data, *fs);
 error_out: 
+    exar_close(ea);
     if (archive != NULL) 
         *archive = larchive;
     else 
@@ -97,10 +103,13 @@ global_include(JSContextRef ctx, JSObjectRef f, JSObjectRef this, size_t argc, c
 {
     JSValueRef ret = NIL;
     gboolean global = false;
-    char *path = NULL, *content = NULL, *econtent = NULL; 
+    char *path = NULL, *content = NULL; 
     const char *script;
     JSValueRef exports[1];
     gboolean is_archive = false;
+    struct exar_archive_s *ea;
+    const unsigned char *data;
+    off_t size;
 
     if (argc < 1) 
         return NIL;
@@ -111,17 +120,19 @@ global_include(JSContextRef ctx, JSObjectRef f, JSObjectRef this, size_t argc, c
     if ( (path = js_value_to_char(ctx, argv[0], PATH_MAX, exc)) == NULL) 
         goto error_out;
 
-    if (exar_check_version(path) == 0)
+    if ((ea = exar_open(path)) != NULL)
     {
-        econtent = (char*) exar_search_extract(path, "main.js", NULL);
-        if (econtent == NULL)
+        if (exar_search_lookup(ea, "main.js", &data, &size) != 0)
         {
+            exar_close(ea);
             js_make_exception(ctx, exc, EXCEPTION("include: main.js was not found in %s."), path);
             goto error_out;
         }
+        content = g_strndup((const char *)data, size);
+        exar_close(ea);
         exports[0] = scripts_get_exports(ctx, path);
         is_archive = true;
-        script = econtent;
+        script = content;
     }
     else if ( (content = util_get_file_content(path, NULL)) != NULL) 
     {
@@ -145,7 +156,6 @@ global_include(JSContextRef ctx, JSObjectRef f, JSObjectRef this, size_t argc, c
 
 error_out: 
     g_free(content);
-    exar_free(econtent);
     g_free(path);
     return ret;
 }/*}}}*/
@@ -458,7 +468,7 @@ global_xget_text(JSContextRef ctx, JSObjectRef f, JSObjectRef thisObject, size_t
     if (content != NULL) {
         ret = js_char_to_value(ctx, content);
     }
-    exar_free(content);
+    g_free(content);
     return ret;
 }
 /** 
@@ -535,7 +545,7 @@ global_xinclude(JSContextRef ctx, JSObjectRef f, JSObjectRef thisObject, size_t
         ret = scripts_include(ctx, archive, content, false, true, 1, exports, exc);
     }
     g_free(archive);
-    exar_free(content);
+    g_free(content);
     return ret;
 }
 
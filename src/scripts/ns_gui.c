@@ -132,6 +132,17 @@ static JSValueRef
 gui_get_status_label(JSContextRef ctx, JSObjectRef object, JSStringRef property, JSValueRef* exception) {
     return make_object_for_class(ctx, CLASS_SECURE_WIDGET, G_OBJECT(dwb.gui.rstatus), true);
 }
+/** 
+ * Number of status bar and tab label updates that were skipped because an
+ * update of the same tab was already pending
+ * @name skippedUpdates
+ * @memberOf gui
+ * @type Number
+ * */
+static JSValueRef
+gui_get_skipped_updates(JSContextRef ctx, JSObjectRef object, JSStringRef property, JSValueRef* exception) {
+    return JSValueMakeNumber(ctx, view_get_skipped_updates());
+}
 /*}}}*/
 /** 
  * Height of the tabbar, favicons will be rescaled to fit into the tab
@@ -184,6 +195,7 @@ gui_initialize(JSContextRef ctx) {
         { "entry",            gui_get_entry, NULL, kJSDefaultAttributes }, 
         { "uriLabel",         gui_get_uri_label, NULL, kJSDefaultAttributes }, 
         { "statusLabel",      gui_get_status_label, NULL, kJSDefaultAttributes }, 
+        { "skippedUpdates",   gui_get_skipped_updates, NULL, kJSDefaultAttributes }, 
         { "tabBarHeight",     gui_get_tabbar_height, gui_set_tabbar_height, kJSPropertyAttributeDontDelete|kJSPropertyAttributeDontEnum }, 
         { 0, 0, 0, 0 }, 
     };
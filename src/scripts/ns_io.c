@@ -16,6 +16,8 @@
  * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
  */
 
+#include <fcntl.h>
+#include <sys/stat.h>
 #include "private.h"
 
 static JSValueRef 
@@ -174,7 +176,7 @@ io_read(JSContextRef ctx, JSObjectRef function, JSObjectRef thisObject, size_t a
     if (argc < 1) 
     {
         js_make_exception(ctx, exc, EXCEPTION("io.read needs an argument."));
-        return NIL;
+        return JSValueMakeNull(ctx);
     }
     if ( (path = js_value_to_char(ctx, argv[0], PATH_MAX, exc) ) == NULL )
         goto error_out;
@@ -193,7 +195,7 @@ error_out:
     g_free(path);
     g_free(content);
     if (ret == NULL)
-        return NIL;
+        return JSValueMakeNull(ctx);
     return ret;
 
 }/*}}}*/
@@ -267,16 +269,16 @@ static JSValueRef
 io_dir_names(JSContextRef ctx, JSObjectRef function, JSObjectRef thisObject, size_t argc, const JSValueRef argv[], JSValueRef* exc) 
 {
     if (argc < 1) 
-        return NIL;
+        return JSValueMakeNull(ctx);
 
     char expanded[4096];
-    JSValueRef ret = NIL;
+    JSValueRef ret = JSValueMakeNull(ctx);
     GDir *dir;
     char *dir_name = js_value_to_char(ctx, argv[0], PATH_MAX, exc);
     const char *name;
 
     if (dir_name == NULL)
-        return NIL;
+        return JSValueMakeNull(ctx);
     if (util_expand_home(expanded, dir_name, sizeof(expanded)) == NULL)
     {
         js_make_exception(ctx, exc, EXCEPTION("Filename too long"));
@@ -302,7 +304,7 @@ io_dir_names(JSContextRef ctx, JSObjectRef function, JSObjectRef thisObject, siz
         g_slist_free(list);
     }
     else 
-        ret = NIL;
+        ret = JSValueMakeNull(ctx);
 
 error_out:
     g_free(dir_name);
@@ -372,6 +374,813 @@ error_out:
 }/*}}}*/
 
 
+/* ASYNC IO {{{*/
+#define IO_CHUNK_SIZE   65536
+/* Chunks of a stream that may wait for the main thread */
+#define IO_MAX_PENDING  8
+
+enum {
+    IO_TASK_READ, 
+    IO_TASK_WRITE, 
+    IO_TASK_STREAM, 
+    IO_TASK_WRITER_WRITE, 
+    IO_TASK_WRITER_CLOSE, 
+    IO_TASK_WRITER_ABORT, 
+};
+
+/* A file that is written to a temporary file and renamed on close, only
+ * accessed from the write pool except for closed */
+typedef struct IOWriter_s {
+    char *path;
+    char *tmp_path;
+    int fd;
+    GError *error;
+    gboolean closed;            /* close or abort was requested */
+    gint refs;
+} IOWriter;
+
+typedef struct IOStream_s {
+    char *path;
+    gboolean lines;
+    gsize chunk_size;
+    JSObjectRef callback;
+    JSObjectRef deferred;
+    GMutex mutex;
+    GCond cond;
+    GQueue queue;               /* GString chunks waiting for the main thread */
+    GError *error;
+    goffset bytes;
+    gboolean scheduled;
+    gboolean done;
+    gint cancelled;
+} IOStream;
+
+typedef struct IOTask_s {
+    int type;
+    char *path;
+    char *data;
+    gboolean append;
+    GError *error;
+    JSObjectRef deferred;
+    IOWriter *writer;
+    IOStream *stream;
+} IOTask;
+
+/* Reads and streams run in parallel, writes are serialized so that the writes
+ * of a writer keep their order */
+static GThreadPool *s_read_pool;
+static GThreadPool *s_write_pool;
+
+/* io_writer {{{*/
+static IOWriter *
+io_writer_new(const char *path) 
+{
+    IOWriter *writer = g_malloc0(sizeof(IOWriter));
+    writer->path = g_strdup(path);
+    writer->fd = -1;
+    writer->refs = 1;
+    return writer;
+}
+static IOWriter *
+io_writer_ref(IOWriter *writer) 
+{
+    g_atomic_int_inc(&writer->refs);
+    return writer;
+}
+/* Removes the temporary file if the writer wasn't committed */
+static void 
+io_writer_unref(IOWriter *writer) 
+{
+    if (g_atomic_int_dec_and_test(&writer->refs))
+    {
+        if (writer->fd != -1)
+            close(writer->fd);
+        if (writer->tmp_path != NULL)
+            unlink(writer->tmp_path);
+        if (writer->error != NULL)
+            g_error_free(writer->error);
+        g_free(writer->tmp_path);
+        g_free(writer->path);
+        g_free(writer);
+    }
+}
+static gboolean 
+io_writer_open(IOWriter *writer) 
+{
+    struct stat st;
+    if (writer->fd != -1 || writer->error != NULL)
+        return writer->error == NULL;
+
+    writer->tmp_path = g_strdup_printf("%s.XXXXXX", writer->path);
+    if ((writer->fd = g_mkstemp_full(writer->tmp_path, O_WRONLY, 0644)) == -1)
+    {
+        g_set_error(&writer->error, G_FILE_ERROR, g_file_error_from_errno(errno), 
+                "cannot create %s: %s", writer->tmp_path, g_strerror(errno));
+        g_free(writer->tmp_path);
+        writer->tmp_path = NULL;
+        return false;
+    }
+    /* Keep the permissions of the file that is replaced */
+    if (stat(writer->path, &st) == 0)
+        fchmod(writer->fd, st.st_mode & 07777);
+    return true;
+}
+static gboolean
+io_write_all(int fd, const char *data, const char *path, GError **error)
+{
+    size_t length = strlen(data);
+    while (length > 0)
+    {
+        ssize_t written = write(fd, data, length);
+        if (written < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            g_set_error(error, G_FILE_ERROR, g_file_error_from_errno(errno), 
+                    "cannot write to %s: %s", path, g_strerror(errno));
+            return false;
+        }
+        data += written;
+        length -= written;
+    }
+    return true;
+}
+static void 
+io_writer_write(IOWriter *writer, const char *data) 
+{
+    if (io_writer_open(writer))
+        io_write_all(writer->fd, data, writer->tmp_path, &writer->error);
+}
+/* Removes the temporary file, the original file is left untouched */
+static void 
+io_writer_discard(IOWriter *writer) 
+{
+    if (writer->fd != -1)
+    {
+        close(writer->fd);
+        writer->fd = -1;
+    }
+    if (writer->tmp_path != NULL)
+    {
+        unlink(writer->tmp_path);
+        g_free(writer->tmp_path);
+        writer->tmp_path = NULL;
+    }
+}
+/* Flushes the temporary file to disk and replaces the original file, after
+ * the first error all writes are skipped and the error is reported here */
+static gboolean 
+io_writer_commit(IOWriter *writer, GError **error) 
+{
+    if (io_writer_open(writer))
+    {
+        if (fsync(writer->fd) != 0)
+            g_set_error(&writer->error, G_FILE_ERROR, g_file_error_from_errno(errno), 
+                    "cannot write to %s: %s", writer->tmp_path, g_strerror(errno));
+        close(writer->fd);
+        writer->fd = -1;
+        if (writer->error == NULL && rename(writer->tmp_path, writer->path) != 0)
+            g_set_error(&writer->error, G_FILE_ERROR, g_file_error_from_errno(errno), 
+                    "cannot rename %s: %s", writer->tmp_path, g_strerror(errno));
+        if (writer->error == NULL)
+        {
+            g_free(writer->tmp_path);
+            writer->tmp_path = NULL;
+        }
+    }
+    if (writer->error != NULL)
+    {
+        g_propagate_error(error, writer->error);
+        writer->error = NULL;
+        return false;
+    }
+    return true;
+}/*}}}*/
+
+/* io_stream {{{*/
+static void 
+io_stream_free(IOStream *stream) 
+{
+    g_queue_foreach(&stream->queue, (GFunc)g_string_free, GINT_TO_POINTER(true));
+    g_queue_clear(&stream->queue);
+    g_mutex_clear(&stream->mutex);
+    g_cond_clear(&stream->cond);
+    if (stream->error != NULL)
+        g_error_free(stream->error);
+    g_free(stream->path);
+    g_free(stream);
+}
+static gboolean 
+io_stream_call(JSContextRef ctx, IOStream *stream, const char *text) 
+{
+    JSValueRef argv[] = { js_char_to_value(ctx, text) };
+    JSValueRef ret = scripts_call_as_function(ctx, stream->callback, stream->callback, 1, argv);
+    return ret != NULL && JSValueIsBoolean(ctx, ret) && JSValueToBoolean(ctx, ret);
+}
+/* Delivers the chunks read so far on the main thread and finishes the stream
+ * after the last chunk */
+static gboolean 
+io_stream_dispatch(IOStream *stream) 
+{
+    GList *chunks;
+    gboolean done;
+
+    g_mutex_lock(&stream->mutex);
+    chunks = stream->queue.head;
+    g_queue_init(&stream->queue);
+    done = stream->done;
+    stream->scheduled = false;
+    g_cond_broadcast(&stream->cond);
+    g_mutex_unlock(&stream->mutex);
+
+    JSContextRef ctx = scripts_get_global_context();
+    for (GList *l = chunks; l; l=l->next)
+    {
+        GString *chunk = l->data;
+        if (ctx != NULL && !g_atomic_int_get(&stream->cancelled))
+        {
+            gboolean cancel = false;
+            stream->bytes += chunk->len;
+            if (stream->lines)
+            {
+                char *line = chunk->str, *end;
+                while (!cancel && *line != '\0')
+                {
+                    if ((end = strchr(line, '\n')) != NULL)
+                        *end = '\0';
+                    cancel = io_stream_call(ctx, stream, line);
+                    line = end == NULL ? line + strlen(line) : end + 1;
+                }
+            }
+            else 
+                cancel = io_stream_call(ctx, stream, chunk->str);
+            if (cancel)
+            {
+                g_mutex_lock(&stream->mutex);
+                g_atomic_int_set(&stream->cancelled, 1);
+                g_cond_broadcast(&stream->cond);
+                g_mutex_unlock(&stream->mutex);
+            }
+        }
+        g_string_free(chunk, true);
+    }
+    g_list_free(chunks);
+
+    if (done)
+    {
+        if (ctx != NULL)
+        {
+            if (stream->error != NULL)
+            {
+                JSValueRef argv[] = { js_char_to_value(ctx, stream->error->message) };
+                deferred_reject(ctx, stream->deferred, stream->deferred, 1, argv, NULL);
+            }
+            else 
+            {
+                JSValueRef argv[] = { JSValueMakeNumber(ctx, stream->bytes) };
+                deferred_resolve(ctx, stream->deferred, stream->deferred, 1, argv, NULL);
+            }
+            JSValueUnprotect(ctx, stream->callback);
+        }
+        io_stream_free(stream);
+    }
+    if (ctx != NULL)
+        scripts_release_global_context();
+    return false;
+}
+/* Hands a chunk to the main thread, blocks while too many chunks are waiting,
+ * a NULL chunk finishes the stream */
+static void 
+io_stream_push(IOStream *stream, GString *chunk) 
+{
+    g_mutex_lock(&stream->mutex);
+    if (chunk != NULL)
+        g_queue_push_tail(&stream->queue, chunk);
+    else 
+        stream->done = true;
+
+    if (!stream->scheduled)
+    {
+        stream->scheduled = true;
+        g_idle_add((GSourceFunc)io_stream_dispatch, stream);
+    }
+    while (chunk != NULL && stream->queue.length >= IO_MAX_PENDING && !g_atomic_int_get(&stream->cancelled))
+        g_cond_wait(&stream->cond, &stream->mutex);
+    g_mutex_unlock(&stream->mutex);
+}
+static void 
+io_stream_read(IOStream *stream) 
+{
+    char buffer[IO_CHUNK_SIZE];
+    size_t length;
+    GString *chunk;
+    FILE *f = fopen(stream->path, "r");
+    if (f == NULL)
+    {
+        g_set_error(&stream->error, G_FILE_ERROR, g_file_error_from_errno(errno), 
+                "cannot open %s: %s", stream->path, g_strerror(errno));
+        goto finish;
+    }
+    if (stream->lines)
+    {
+        /* Complete lines are pushed in groups of about chunk_size bytes */
+        chunk = g_string_new(NULL);
+        while (!g_atomic_int_get(&stream->cancelled) && fgets(buffer, sizeof(buffer), f) != NULL)
+        {
+            g_string_append(chunk, buffer);
+            if (chunk->len >= stream->chunk_size && chunk->str[chunk->len-1] == '\n')
+            {
+                io_stream_push(stream, chunk);
+                chunk = g_string_new(NULL);
+            }
+        }
+        if (chunk->len > 0)
+            io_stream_push(stream, chunk);
+        else 
+            g_string_free(chunk, true);
+    }
+    else 
+    {
+        /* A utf-8 sequence that is split by the chunk size is completed in
+         * the next chunk */
+        size_t size = MIN(stream->chunk_size, sizeof(buffer));
+        char tail[4];
+        gsize carry = 0, complete;
+        while (!g_atomic_int_get(&stream->cancelled) && (length = fread(buffer, 1, size, f)) > 0)
+        {
+            chunk = g_string_new_len(tail, carry);
+            g_string_append_len(chunk, buffer, length);
+            complete = utf8_complete_length(chunk->str, chunk->len);
+            carry = chunk->len - complete;
+            memcpy(tail, chunk->str + complete, carry);
+            g_string_truncate(chunk, complete);
+            if (chunk->len > 0)
+                io_stream_push(stream, chunk);
+            else 
+                g_string_free(chunk, true);
+        }
+        if (carry > 0 && !g_atomic_int_get(&stream->cancelled))
+            io_stream_push(stream, g_string_new_len(tail, carry));
+    }
+    if (ferror(f))
+        g_set_error(&stream->error, G_FILE_ERROR, g_file_error_from_errno(errno), 
+                "cannot read %s: %s", stream->path, g_strerror(errno));
+    fclose(f);
+
+finish:
+    io_stream_push(stream, NULL);
+}/*}}}*/
+
+/* io_task {{{*/
+static void 
+io_task_free(IOTask *task) 
+{
+    if (task->writer != NULL)
+        io_writer_unref(task->writer);
+    if (task->error != NULL)
+        g_error_free(task->error);
+    g_free(task->path);
+    g_free(task->data);
+    g_free(task);
+}
+/* Settles the deferred of a task on the main thread */
+static gboolean 
+io_task_finish(IOTask *task) 
+{
+    JSContextRef ctx = scripts_get_global_context();
+    if (ctx != NULL)
+    {
+        if (task->error != NULL)
+        {
+            JSValueRef argv[] = { js_char_to_value(ctx, task->error->message) };
+            deferred_reject(ctx, task->deferred, task->deferred, 1, argv, NULL);
+        }
+        else 
+        {
+            JSValueRef argv[] = { task->type == IO_TASK_READ 
+                ? js_char_to_value(ctx, task->data) 
+                : JSValueMakeBoolean(ctx, true) };
+            deferred_resolve(ctx, task->deferred, task->deferred, 1, argv, NULL);
+        }
+        scripts_release_global_context();
+    }
+    io_task_free(task);
+    return false;
+}
+static void 
+io_task_run(IOTask *task, gpointer unused) 
+{
+    switch (task->type)
+    {
+        case IO_TASK_READ : 
+            g_file_get_contents(task->path, &task->data, NULL, &task->error);
+            break;
+        case IO_TASK_WRITE : 
+            if (task->append)
+            {
+                int fd = open(task->path, O_WRONLY | O_APPEND | O_CREAT, 0644);
+                if (fd == -1)
+                    g_set_error(&task->error, G_FILE_ERROR, g_file_error_from_errno(errno), 
+                            "cannot open %s: %s", task->path, g_strerror(errno));
+                else 
+                {
+                    if (io_write_all(fd, task->data, task->path, &task->error) && fsync(fd) != 0)
+                        g_set_error(&task->error, G_FILE_ERROR, g_file_error_from_errno(errno), 
+                                "cannot write to %s: %s", task->path, g_strerror(errno));
+                    close(fd);
+                }
+            }
+            else 
+            {
+                task->writer = io_writer_new(task->path);
+                io_writer_write(task->writer, task->data);
+                io_writer_commit(task->writer, &task->error);
+            }
+            break;
+        case IO_TASK_STREAM : 
+            io_stream_read(task->stream);
+            break;
+        case IO_TASK_WRITER_WRITE : 
+            io_writer_write(task->writer, task->data);
+            break;
+        case IO_TASK_WRITER_CLOSE : 
+            io_writer_commit(task->writer, &task->error);
+            break;
+        case IO_TASK_WRITER_ABORT : 
+            io_writer_discard(task->writer);
+            break;
+    }
+    if (task->deferred != NULL)
+        g_idle_add((GSourceFunc)io_task_finish, task);
+    else 
+        io_task_free(task);
+}
+static IOTask *
+io_task_new(int type, char *path, char *data, JSObjectRef deferred) 
+{
+    IOTask *task = g_malloc0(sizeof(IOTask));
+    task->type = type;
+    task->path = path;
+    task->data = data;
+    task->deferred = deferred;
+    return task;
+}
+static void 
+io_task_push(IOTask *task) 
+{
+    if (task->type == IO_TASK_READ || task->type == IO_TASK_STREAM)
+    {
+        if (s_read_pool == NULL)
+            s_read_pool = g_thread_pool_new((GFunc)io_task_run, NULL, 4, false, NULL);
+        g_thread_pool_push(s_read_pool, task, NULL);
+    }
+    else 
+    {
+        if (s_write_pool == NULL)
+            s_write_pool = g_thread_pool_new((GFunc)io_task_run, NULL, 1, false, NULL);
+        g_thread_pool_push(s_write_pool, task, NULL);
+    }
+}
+/* Returns the expanded path of a path argument */
+static char * 
+io_get_path(JSContextRef ctx, JSValueRef value, JSValueRef *exc) 
+{
+    char expanded[4096];
+    char *path = js_value_to_char(ctx, value, PATH_MAX, exc);
+    if (path == NULL)
+        return NULL;
+    if (util_expand_home(expanded, path, sizeof(expanded)) == NULL)
+    {
+        js_make_exception(ctx, exc, EXCEPTION("Filename too long"));
+        g_free(path);
+        return NULL;
+    }
+    g_free(path);
+    return g_strdup(expanded);
+}/*}}}*/
+
+/* io_read_async {{{*/
+/**
+ * Reads a file without blocking the browser
+ *
+ * @name readAsync 
+ * @memberOf io
+ * @function 
+ * @since 1.14
+ *
+ * @param {String} path A path to a file
+ *
+ * @returns {Deferred}
+ *      A deferred that will be resolved with the file content or rejected
+ *      with an error message
+ * @example 
+ * io.readAsync(data.configDir + "/state.json").then(function(content) {
+ *      state = JSON.parse(content);
+ * });
+ * */
+static JSValueRef 
+io_read_async(JSContextRef ctx, JSObjectRef function, JSObjectRef thisObject, size_t argc, const JSValueRef argv[], JSValueRef* exc) 
+{
+    char *path;
+    if (argc < 1) 
+    {
+        js_make_exception(ctx, exc, EXCEPTION("io.readAsync needs an argument."));
+        return NIL;
+    }
+    if ((path = io_get_path(ctx, argv[0], exc)) == NULL)
+        return NIL;
+
+    JSObjectRef deferred = deferred_new(ctx);
+    io_task_push(io_task_new(IO_TASK_READ, path, NULL, deferred));
+    return deferred;
+}/*}}}*/
+
+/* io_write_async {{{*/
+/** 
+ * Writes to a file without blocking the browser. In mode <i>"w"</i> the text
+ * is written to a temporary file that replaces the file after it has been
+ * flushed to disk, so the file is never left half written. Writes are done in
+ * the order they were requested.
+ *
+ * @name writeAsync
+ * @memberOf io
+ * @function
+ * @since 1.14
+ *
+ * @param {String} path Path to a file to write to
+ * @param {String} mode Either <i>"a"</i> to append or <i>"w"</i> to replace the file
+ * @param {String} text The text that should be written to the file
+ *
+ * @returns {Deferred}
+ *      A deferred that will be resolved when the text has been written or
+ *      rejected with an error message
+ * */
+static JSValueRef 
+io_write_async(JSContextRef ctx, JSObjectRef function, JSObjectRef thisObject, size_t argc, const JSValueRef argv[], JSValueRef* exc) 
+{
+    char *path = NULL, *content = NULL, *mode = NULL;
+    JSObjectRef deferred = NULL;
+    if (argc < 3) 
+    {
+        js_make_exception(ctx, exc, EXCEPTION("io.writeAsync needs 3 arguments."));
+        return NIL;
+    }
+    if ((mode = js_value_to_char(ctx, argv[1], -1, exc)) == NULL)
+        goto error_out;
+    if (g_strcmp0(mode, "w") && g_strcmp0(mode, "a")) 
+    {
+        js_make_exception(ctx, exc, EXCEPTION("io.writeAsync: invalid mode."));
+        goto error_out;
+    }
+    if ((content = js_value_to_char(ctx, argv[2], -1, exc)) == NULL) 
+        goto error_out;
+    if ((path = io_get_path(ctx, argv[0], exc)) == NULL)
+        goto error_out;
+
+    deferred = deferred_new(ctx);
+    IOTask *task = io_task_new(IO_TASK_WRITE, path, content, deferred);
+    task->append = *mode == 'a';
+    io_task_push(task);
+    path = content = NULL;
+
+error_out:
+    g_free(path);
+    g_free(mode);
+    g_free(content);
+    return deferred == NULL ? NIL : deferred;
+}/*}}}*/
+
+/* io_read_stream {{{*/
+/**
+ * Called for every chunk or line of a stream
+ *
+ * @callback io~onStream
+ *
+ * @param {String} text 
+ *      The next chunk or the next line without the newline
+ *
+ * @returns {Boolean}
+ *      Return true to stop reading
+ * */
+/**
+ * Reads a file in chunks or line by line without loading the whole file into
+ * memory. The file is read on a separate thread, reading pauses while the
+ * callback falls behind.
+ *
+ * @name readStream 
+ * @memberOf io
+ * @function 
+ * @since 1.14
+ *
+ * @param {String} path A path to a file
+ * @param {io~onStream} callback 
+ *      Callback function called for every chunk or line
+ * @param {Object} [options] 
+ * @param {Boolean} [options.lines] 
+ *      Whether the callback is called for every line, default true
+ * @param {Number} [options.chunkSize] 
+ *      The size of a chunk in bytes, default and maximum 65536
+ *
+ * @returns {Deferred}
+ *      A deferred that will be resolved with the number of bytes read or
+ *      rejected with an error message
+ * @example 
+ * var count = 0;
+ * io.readStream("/var/log/messages", function(line) {
+ *      if (/error/.test(line))
+ *          count++;
+ * }).then(function() {
+ *      io.out(count + " errors");
+ * });
+ * */
+static JSValueRef 
+io_read_stream(JSContextRef ctx, JSObjectRef function, JSObjectRef thisObject, size_t argc, const JSValueRef argv[], JSValueRef* exc) 
+{
+    char *path;
+    JSObjectRef callback, options;
+    double chunk_size;
+    if (argc < 2) 
+    {
+        js_make_exception(ctx, exc, EXCEPTION("io.readStream needs 2 arguments."));
+        return NIL;
+    }
+    if ((callback = js_value_to_function(ctx, argv[1], exc)) == NULL)
+        return NIL;
+    if ((path = io_get_path(ctx, argv[0], exc)) == NULL)
+        return NIL;
+
+    IOStream *stream = g_malloc0(sizeof(IOStream));
+    stream->path = path;
+    stream->lines = true;
+    stream->chunk_size = IO_CHUNK_SIZE;
+    g_mutex_init(&stream->mutex);
+    g_cond_init(&stream->cond);
+    g_queue_init(&stream->queue);
+
+    if (argc > 2 && JSValueIsObject(ctx, argv[2]) && (options = JSValueToObject(ctx, argv[2], NULL)) != NULL)
+    {
+        JSStringRef name = JSStringCreateWithUTF8CString("lines");
+        JSValueRef lines = JSObjectGetProperty(ctx, options, name, NULL);
+        JSStringRelease(name);
+        if (lines != NULL && JSValueIsBoolean(ctx, lines))
+            stream->lines = JSValueToBoolean(ctx, lines);
+        chunk_size = js_get_double_property(ctx, options, "chunkSize");
+        if (!isnan(chunk_size) && chunk_size >= 1 && chunk_size < IO_CHUNK_SIZE)
+            stream->chunk_size = chunk_size;
+    }
+
+    stream->callback = callback;
+    JSValueProtect(ctx, callback);
+    stream->deferred = deferred_new(ctx);
+
+    IOTask *task = io_task_new(IO_TASK_STREAM, NULL, NULL, NULL);
+    task->stream = stream;
+    io_task_push(task);
+    return stream->deferred;
+}/*}}}*/
+
+/* FileWriter {{{*/
+static IOWriter *
+io_get_writer(JSContextRef ctx, JSObjectRef this, JSValueRef *exc) 
+{
+    IOWriter *writer = JSObjectGetPrivate(this);
+    if (writer == NULL || writer->closed)
+    {
+        js_make_exception(ctx, exc, EXCEPTION("FileWriter: writer is closed."));
+        return NULL;
+    }
+    return writer;
+}
+/**
+ * Appends text to the temporary file
+ *
+ * @name write
+ * @memberOf FileWriter.prototype
+ * @function
+ * @since 1.14
+ *
+ * @param {String} text The text to write
+ * */
+static JSValueRef 
+io_writer_write_cb(JSContextRef ctx, JSObjectRef function, JSObjectRef this, size_t argc, const JSValueRef argv[], JSValueRef* exc) 
+{
+    char *text;
+    IOWriter *writer = io_get_writer(ctx, this, exc);
+    if (writer == NULL || argc == 0 || (text = js_value_to_char(ctx, argv[0], -1, exc)) == NULL)
+        return NULL;
+
+    IOTask *task = io_task_new(IO_TASK_WRITER_WRITE, NULL, text, NULL);
+    task->writer = io_writer_ref(writer);
+    io_task_push(task);
+    return NULL;
+}
+/**
+ * Flushes the temporary file to disk and replaces the file
+ *
+ * @name close
+ * @memberOf FileWriter.prototype
+ * @function
+ * @since 1.14
+ *
+ * @returns {Deferred}
+ *      A deferred that will be resolved when the file has been replaced or
+ *      rejected with the first error that occured while writing
+ * */
+static JSValueRef 
+io_writer_close_cb(JSContextRef ctx, JSObjectRef function, JSObjectRef this, size_t argc, const JSValueRef argv[], JSValueRef* exc) 
+{
+    IOWriter *writer = io_get_writer(ctx, this, exc);
+    if (writer == NULL)
+        return NIL;
+
+    writer->closed = true;
+    JSObjectRef deferred = deferred_new(ctx);
+    IOTask *task = io_task_new(IO_TASK_WRITER_CLOSE, NULL, NULL, deferred);
+    task->writer = io_writer_ref(writer);
+    io_task_push(task);
+    return deferred;
+}
+/**
+ * Discards everything written, the original file is left untouched
+ *
+ * @name abort
+ * @memberOf FileWriter.prototype
+ * @function
+ * @since 1.14
+ * */
+static JSValueRef 
+io_writer_abort_cb(JSContextRef ctx, JSObjectRef function, JSObjectRef this, size_t argc, const JSValueRef argv[], JSValueRef* exc) 
+{
+    IOWriter *writer = io_get_writer(ctx, this, exc);
+    if (writer == NULL)
+        return NULL;
+
+    writer->closed = true;
+    IOTask *task = io_task_new(IO_TASK_WRITER_ABORT, NULL, NULL, NULL);
+    task->writer = io_writer_ref(writer);
+    io_task_push(task);
+    return NULL;
+}
+static void 
+io_writer_finalize(JSObjectRef o) 
+{
+    IOWriter *writer = JSObjectGetPrivate(o);
+    if (writer != NULL)
+    {
+        /* Pending writes still hold a reference, the temporary file is
+         * removed after the last write */
+        writer->closed = true;
+        io_writer_unref(writer);
+    }
+}
+/**
+ * Opens a file for writing in chunks. Everything is written to a temporary
+ * file in the background, the file is only replaced when the writer is
+ * closed. If the writer is neither closed nor aborted the file is left
+ * untouched.
+ *
+ * @name openWriter
+ * @memberOf io
+ * @function
+ * @since 1.14
+ *
+ * @param {String} path Path of the file
+ *
+ * @returns {FileWriter}
+ *      A new writer
+ * @example 
+ * var writer = io.openWriter(data.configDir + "/history.txt");
+ * history.forEach(function(entry) {
+ *      writer.write(entry.uri + "\n");
+ * });
+ * writer.close().then(null, function(error) {
+ *      io.error(error);
+ * });
+ * */
+static JSValueRef 
+io_open_writer(JSContextRef ctx, JSObjectRef function, JSObjectRef thisObject, size_t argc, const JSValueRef argv[], JSValueRef* exc) 
+{
+    char *path;
+    JSObjectRef ret = NULL;
+    if (argc < 1) 
+    {
+        js_make_exception(ctx, exc, EXCEPTION("io.openWriter needs an argument."));
+        return NIL;
+    }
+    if ((path = io_get_path(ctx, argv[0], exc)) == NULL)
+        return NIL;
+
+    ScriptContext *sctx = scripts_get_context();
+    if (sctx != NULL)
+    {
+        ret = JSObjectMake(ctx, sctx->classes[CLASS_FILE_WRITER], io_writer_new(path));
+        scripts_release_context();
+    }
+    g_free(path);
+    return ret == NULL ? NIL : ret;
+}/*}}}*//*}}}*/
+
+
 /* io_print {{{*/
 /** 
  * Print messages to stdout
@@ -432,6 +1241,10 @@ io_initialize(JSContextRef ctx) {
         { "confirm",   io_confirm,          kJSDefaultAttributes },
         { "read",      io_read,             kJSDefaultAttributes },
         { "write",     io_write,            kJSDefaultAttributes },
+        { "readAsync",  io_read_async,      kJSDefaultAttributes },
+        { "writeAsync", io_write_async,     kJSDefaultAttributes },
+        { "readStream", io_read_stream,     kJSDefaultAttributes },
+        { "openWriter", io_open_writer,     kJSDefaultAttributes },
         { "dirNames",  io_dir_names,        kJSDefaultAttributes },
         { "notify",    io_notify,           kJSDefaultAttributes },
         { "error",     io_error,            kJSDefaultAttributes },
@@ -440,5 +1253,45 @@ io_initialize(JSContextRef ctx) {
     JSClassRef klass = scripts_create_class("io", io_functions, NULL, NULL);
     JSObjectRef ret = scripts_create_object(ctx, klass, global_object, kJSPropertyAttributeDontDelete, "io", NULL);
     JSClassRelease(klass);
+
+    /** 
+     * A writer that replaces a file atomically, see {@link io.openWriter}
+     *
+     * @name FileWriter
+     * @class 
+     * @since 1.14
+     * */
+    JSStaticFunction writer_functions[] = { 
+        { "write",     io_writer_write_cb,  kJSDefaultAttributes },
+        { "close",     io_writer_close_cb,  kJSDefaultAttributes },
+        { "abort",     io_writer_abort_cb,  kJSDefaultAttributes },
+        { 0,           0,           0 },
+    };
+    JSClassDefinition cd = kJSClassDefinitionEmpty;
+    cd.className = "FileWriter";
+    cd.staticFunctions = writer_functions;
+    cd.finalize = io_writer_finalize;
+    ScriptContext *sctx = scripts_get_context();
+    sctx->classes[CLASS_FILE_WRITER] = JSClassCreate(&cd);
+    scripts_release_context();
+    return ret;
+}
+
+/* Restricted io namespace of worker contexts, only functions that don't touch
+ * the gui or the main context */
+JSObjectRef 
+io_worker_initialize(JSContextRef ctx) {
+    JSObjectRef global_object = JSContextGetGlobalObject(ctx);
+    JSStaticFunction io_functions[] = { 
+        { "out",       io_out,              kJSDefaultAttributes },
+        { "err",       io_err,              kJSDefaultAttributes },
+        { "read",      io_read,             kJSDefaultAttributes },
+        { "write",     io_write,            kJSDefaultAttributes },
+        { "dirNames",  io_dir_names,        kJSDefaultAttributes },
+        { 0,           0,           0 },
+    };
+    JSClassRef klass = scripts_create_class("io", io_functions, NULL, NULL);
+    JSObjectRef ret = scripts_create_object(ctx, klass, global_object, kJSPropertyAttributeDontDelete, "io", NULL);
+    JSClassRelease(klass);
     return ret;
 }
@@ -22,4 +22,7 @@
 JSObjectRef 
 io_initialize(JSContextRef ctx);
 
+JSObjectRef 
+io_worker_initialize(JSContextRef ctx);
+
 #endif
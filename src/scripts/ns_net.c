@@ -18,13 +18,95 @@
 
 #include "private.h"
 
+/* Connection limits of the session used by scripts */
+#define NET_MAX_CONNS           16
+#define NET_MAX_CONNS_PER_HOST  4
+
+/* Requests of scripts use their own session, so they don't compete with page
+ * loads for connections */
+static SoupSession *s_session;
+
+typedef struct NetRequest_s {
+    JSObjectRef deferred;
+    JSObjectRef on_chunk;       /* NULL if the body is accumulated */
+    GString *partial;           /* incomplete utf-8 sequence of the last chunk */
+    gboolean cancelled;
+} NetRequest;
+
+/* net_get_session {{{*/
+/* Returns the session for script requests, cookies are shared with the webkit
+ * session, proxy and tls settings are copied on every request */
+static SoupSession *
+net_get_session(void)
+{
+    SoupSession *webkit_session = webkit_get_default_session();
+    SoupURI *proxy = NULL, *current = NULL;
+    gboolean strict;
+#ifdef WITH_LIBSOUP_2_38
+    gboolean system_ca;
+#else
+    char *ca_file = NULL;
+#endif
+
+    if (s_session == NULL)
+    {
+        s_session = soup_session_async_new_with_options(
+                SOUP_SESSION_MAX_CONNS, NET_MAX_CONNS, 
+                SOUP_SESSION_MAX_CONNS_PER_HOST, NET_MAX_CONNS_PER_HOST, 
+                NULL);
+        SoupSessionFeature *jar = soup_session_get_feature(webkit_session, SOUP_TYPE_COOKIE_JAR);
+        if (jar != NULL)
+            soup_session_add_feature(s_session, jar);
+    }
+    g_object_get(webkit_session, 
+            SOUP_SESSION_PROXY_URI, &proxy, 
+            SOUP_SESSION_SSL_STRICT, &strict, 
+            NULL);
+    g_object_get(s_session, SOUP_SESSION_PROXY_URI, &current, NULL);
+    /* Changing the proxy drops all connections of the session */
+    if ((proxy == NULL) != (current == NULL) || (proxy != NULL && !soup_uri_equal(proxy, current)))
+        g_object_set(s_session, SOUP_SESSION_PROXY_URI, proxy, NULL);
+    g_object_set(s_session, SOUP_SESSION_SSL_STRICT, strict, NULL);
+    /* Same as dwb_soup_init_session_features, the property is also reset when
+     * the setting is turned off */
+#ifdef WITH_LIBSOUP_2_38
+    g_object_get(webkit_session, SOUP_SESSION_SSL_USE_SYSTEM_CA_FILE, &system_ca, NULL);
+    g_object_set(s_session, SOUP_SESSION_SSL_USE_SYSTEM_CA_FILE, system_ca, NULL);
+#else 
+    g_object_get(webkit_session, SOUP_SESSION_SSL_CA_FILE, &ca_file, NULL);
+    g_object_set(s_session, SOUP_SESSION_SSL_CA_FILE, ca_file, NULL);
+    g_free(ca_file);
+#endif
+
+    if (proxy != NULL)
+        soup_uri_free(proxy);
+    if (current != NULL)
+        soup_uri_free(current);
+    return s_session;
+}/*}}}*/
+
 static void 
 set_request(JSContextRef ctx, SoupMessage *msg, JSValueRef val, JSValueRef *exc)
 {
-    char *content_type = NULL, *body = NULL;
+    char *content_type = NULL, *body = NULL, *name, *value;
+    JSObjectRef headers;
+    JSValueRef header;
+    js_property_iterator iter;
     JSObjectRef data = JSValueToObject(ctx, val, exc);
     if (data == NULL)
         return;
+    if ((headers = js_get_object_property(ctx, data, "headers")) != NULL)
+    {
+        js_property_iterator_init(ctx, &iter, headers);
+        while ((header = js_property_iterator_next(&iter, NULL, &name, NULL)) != NULL)
+        {
+            if ((value = js_value_to_char(ctx, header, JS_STRING_MAX, NULL)) != NULL)
+                soup_message_headers_replace(msg->request_headers, name, value);
+            g_free(value);
+            g_free(name);
+        }
+        js_property_iterator_finish(&iter);
+    }
     content_type = js_get_string_property(ctx, data, "contentType");
     if (content_type != NULL)
     {
@@ -51,7 +133,9 @@ get_message_data(SoupMessage *msg)
     }
 
     o = JSObjectMake(ctx, NULL, NULL);
-    js_set_object_property(ctx, o, "body", msg->response_body->data, NULL);
+    /* Streamed responses don't accumulate the body */
+    if (msg->response_body->data != NULL)
+        js_set_object_property(ctx, o, "body", msg->response_body->data, NULL);
 
     ho = JSObjectMake(ctx, NULL, NULL);
 
@@ -163,7 +247,7 @@ net_send_request(JSContextRef ctx, JSObjectRef f, JSObjectRef thisObject, size_t
         set_request(ctx, msg, argv[3], exc);
 
     JSValueProtect(ctx, function);
-    soup_session_queue_message(webkit_get_default_session(), msg, (SoupSessionCallback)request_callback, function);
+    soup_session_queue_message(net_get_session(), msg, (SoupSessionCallback)request_callback, function);
     ret = 0;
 
 error_out: 
@@ -223,6 +307,210 @@ net_send_request_sync(JSContextRef ctx, JSObjectRef f, JSObjectRef thisObject, s
     return o;
 }
 
+/* net_request_finished {{{*/
+static void
+net_request_finished(SoupSession *session, SoupMessage *msg, NetRequest *request) 
+{
+    JSContextRef ctx = scripts_get_global_context();
+    if (ctx != NULL) 
+    {
+        /* Bytes that don't form a complete character are passed as they are */
+        if (request->partial != NULL && request->partial->len > 0 && !request->cancelled)
+        {
+            JSValueRef argv[] = { js_char_to_value(ctx, request->partial->str) };
+            scripts_call_as_function(ctx, request->on_chunk, request->on_chunk, 1, argv);
+        }
+        JSValueRef data = get_message_data(msg);
+        js_set_object_number_property(ctx, JSValueToObject(ctx, data, NULL), "status", msg->status_code, NULL);
+        if (SOUP_STATUS_IS_TRANSPORT_ERROR(msg->status_code) && !request->cancelled)
+        {
+            JSValueRef argv[] = { data };
+            deferred_reject(ctx, request->deferred, request->deferred, 1, argv, NULL);
+        }
+        else 
+        {
+            JSValueRef argv[] = { data, make_object_for_class(ctx, CLASS_GOBJECT, G_OBJECT(msg), true) };
+            deferred_resolve(ctx, request->deferred, request->deferred, 2, argv, NULL);
+        }
+        if (request->on_chunk != NULL)
+            JSValueUnprotect(ctx, request->on_chunk);
+        scripts_release_global_context();
+    }
+    if (request->partial != NULL)
+        g_string_free(request->partial, true);
+    g_free(request);
+}/*}}}*/
+
+/* net_got_chunk_cb {{{*/
+static void
+net_got_chunk_cb(SoupMessage *msg, SoupBuffer *chunk, NetRequest *request) 
+{
+    gsize complete;
+
+    if (request->cancelled)
+        return;
+
+    /* A character split between two chunks is delivered with the next chunk */
+    g_string_append_len(request->partial, chunk->data, chunk->length);
+    complete = utf8_complete_length(request->partial->str, request->partial->len);
+    if (complete == 0)
+        return;
+
+    JSContextRef ctx = scripts_get_global_context();
+    if (ctx != NULL) 
+    {
+        char *text = g_strndup(request->partial->str, complete);
+        g_string_erase(request->partial, 0, complete);
+        JSValueRef argv[] = { js_char_to_value(ctx, text) };
+        JSValueRef ret = scripts_call_as_function(ctx, request->on_chunk, request->on_chunk, 1, argv);
+        if (ret != NULL && JSValueIsBoolean(ctx, ret) && JSValueToBoolean(ctx, ret))
+        {
+            request->cancelled = true;
+            soup_session_cancel_message(s_session, msg, SOUP_STATUS_CANCELLED);
+        }
+        g_free(text);
+        scripts_release_global_context();
+    }
+}/*}}}*/
+
+/* net_queue_request {{{*/
+/* Queues a request on the script session, arguments are uri, method and data
+ * starting at argv[offset] */
+static JSValueRef
+net_queue_request(JSContextRef ctx, size_t argc, const JSValueRef argv[], size_t offset, JSObjectRef on_chunk, JSValueRef *exc)
+{
+    char *method = NULL, *uri = NULL;
+    SoupMessage *msg = NULL;
+    JSValueRef ret = NIL;
+
+    if ((uri = js_value_to_char(ctx, argv[0], -1, exc)) == NULL) 
+        return NIL;
+    if (argc > offset && !JSValueIsNull(ctx, argv[offset]) && !JSValueIsUndefined(ctx, argv[offset]))
+        method = js_value_to_char(ctx, argv[offset], -1, exc);
+
+    if ((msg = soup_message_new(method == NULL ? "GET" : method, uri)) == NULL)
+    {
+        js_make_exception(ctx, exc, EXCEPTION("net: invalid uri %s"), uri);
+        goto error_out;
+    }
+    if (argc > offset + 1 && JSValueIsObject(ctx, argv[offset + 1]))
+        set_request(ctx, msg, argv[offset + 1], exc);
+
+    NetRequest *request = g_malloc0(sizeof(NetRequest));
+    request->deferred = deferred_new(ctx);
+    if (on_chunk != NULL)
+    {
+        request->on_chunk = on_chunk;
+        request->partial = g_string_new(NULL);
+        JSValueProtect(ctx, on_chunk);
+        soup_message_body_set_accumulate(msg->response_body, false);
+        g_signal_connect(msg, "got-chunk", G_CALLBACK(net_got_chunk_cb), request);
+    }
+    soup_session_queue_message(net_get_session(), msg, (SoupSessionCallback)net_request_finished, request);
+    ret = request->deferred;
+
+error_out: 
+    g_free(uri);
+    g_free(method);
+    return ret;
+}/*}}}*/
+
+/* net_send_request_async {{{*/
+/** 
+ * Sends a http-request without blocking the browser, requests of scripts use
+ * a separate connection pool that is limited to 4 connections per host and 16
+ * connections in total
+ *
+ * @name sendRequestAsync
+ * @memberOf net
+ * @function
+ * @since 1.14
+ *
+ * @param {String} uri          The uri the request will be sent to.
+ * @param {String} [method]     The http request method, default GET
+ * @param {Object} [data]       Request data
+ * @param {String} [data.contentType] The content type
+ * @param {String} [data.data]  The data that will be sent with the request
+ * @param {Object} [data.headers] Additional request headers
+ *
+ * @returns {Deferred}
+ *      A deferred that will be resolved with an object that contains the
+ *      response body, the response headers and the http status code and the
+ *      SoupMessage, or rejected with the same object if the request couldn't
+ *      be sent
+ *
+ * @example 
+ * net.sendRequestAsync("http://www.example.com/list.txt").then(function(response) {
+ *      if (response.status == 200)
+ *          io.out(response.body);
+ * }, function(response) {
+ *      io.error("Request failed: " + response.status);
+ * });
+ * */
+static JSValueRef 
+net_send_request_async(JSContextRef ctx, JSObjectRef f, JSObjectRef thisObject, size_t argc, const JSValueRef argv[], JSValueRef* exc) 
+{
+    if (argc < 1) 
+    {
+        js_make_exception(ctx, exc, EXCEPTION("net.sendRequestAsync: missing argument."));
+        return NIL;
+    }
+    return net_queue_request(ctx, argc, argv, 1, NULL, exc);
+}/*}}}*/
+
+/* net_stream_request {{{*/
+/**
+ * Called for every chunk of a streamed response
+ *
+ * @callback net~onChunk
+ *
+ * @param {String} chunk 
+ *      The next chunk of the response body
+ *
+ * @returns {Boolean}
+ *      Return true to cancel the request
+ * */
+/** 
+ * Sends a http-request and passes the response body to a callback chunk by
+ * chunk as it arrives, the body is never held in memory as a whole
+ *
+ * @name streamRequest
+ * @memberOf net
+ * @function
+ * @since 1.14
+ *
+ * @param {String} uri          The uri the request will be sent to.
+ * @param {net~onChunk} callback Callback called for every chunk
+ * @param {String} [method]     The http request method, default GET
+ * @param {Object} [data]       Request data, see {@link net.sendRequestAsync}
+ *
+ * @returns {Deferred}
+ *      A deferred that will be resolved with an object that contains the
+ *      response headers and the http status code when the response is
+ *      complete or has been cancelled
+ *
+ * @example 
+ * var lines = 0;
+ * net.streamRequest("http://www.example.com/filters.txt", function(chunk) {
+ *      lines += chunk.split("\n").length - 1;
+ * }).then(function(response) {
+ *      io.out(lines + " lines, status " + response.status);
+ * });
+ * */
+static JSValueRef 
+net_stream_request(JSContextRef ctx, JSObjectRef f, JSObjectRef thisObject, size_t argc, const JSValueRef argv[], JSValueRef* exc) 
+{
+    JSObjectRef on_chunk;
+    if (argc < 2) 
+    {
+        js_make_exception(ctx, exc, EXCEPTION("net.streamRequest: missing argument."));
+        return NIL;
+    }
+    if ((on_chunk = js_value_to_function(ctx, argv[1], exc)) == NULL)
+        return NIL;
+    return net_queue_request(ctx, argc, argv, 2, on_chunk, exc);
+}/*}}}*/
+
 /* net_domain_from_host {{{*/
 /**
  * Gets the base domain name from a hostname where the base domain name is the
@@ -346,6 +634,8 @@ net_initialize(JSContextRef ctx) {
     JSStaticFunction net_functions[] = { 
         { "sendRequest",      net_send_request,         kJSDefaultAttributes },
         { "sendRequestSync",  net_send_request_sync,         kJSDefaultAttributes },
+        { "sendRequestAsync", net_send_request_async,   kJSDefaultAttributes },
+        { "streamRequest",    net_stream_request,       kJSDefaultAttributes },
         { "domainFromHost",   net_domain_from_host,         kJSDefaultAttributes },
         { "parseUri",         net_parse_uri,         kJSDefaultAttributes },
         { "allCookies",       net_all_cookies,         kJSDefaultAttributes },
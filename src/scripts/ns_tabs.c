@@ -46,7 +46,7 @@ tabs_current(JSContextRef ctx, JSObjectRef this, JSStringRef name, JSValueRef* e
 static JSValueRef 
 tabs_number(JSContextRef ctx, JSObjectRef this, JSStringRef name, JSValueRef* exc) 
 {
-    return JSValueMakeNumber(ctx, g_list_position(dwb.state.views, dwb.state.fview));
+    return JSValueMakeNumber(ctx, view_position(dwb.state.fview));
 }/*}}}*/
 
 /* tabs_length {{{*/
@@ -60,7 +60,57 @@ tabs_number(JSContextRef ctx, JSObjectRef this, JSStringRef name, JSValueRef* ex
 static JSValueRef 
 tabs_length(JSContextRef ctx, JSObjectRef this, JSStringRef name, JSValueRef* exc) 
 {
-    return JSValueMakeNumber(ctx, g_list_length(dwb.state.views));
+    return JSValueMakeNumber(ctx, view_count());
+}/*}}}*/
+
+/* tabs_hibernated {{{*/
+/**
+ * Number of tabs that are currently hibernated
+ *
+ * @name hibernated 
+ * @memberOf tabs
+ * @type Number
+ * */
+static JSValueRef 
+tabs_hibernated(JSContextRef ctx, JSObjectRef this, JSStringRef name, JSValueRef* exc) 
+{
+    guint hibernated;
+    view_hibernate_stats(&hibernated, NULL, NULL);
+    return JSValueMakeNumber(ctx, hibernated);
+}/*}}}*/
+
+/* tabs_hibernations {{{*/
+/**
+ * Total number of tabs that have been hibernated since startup
+ *
+ * @name hibernations 
+ * @memberOf tabs
+ * @type Number
+ * */
+static JSValueRef 
+tabs_hibernations(JSContextRef ctx, JSObjectRef this, JSStringRef name, JSValueRef* exc) 
+{
+    guint total;
+    view_hibernate_stats(NULL, &total, NULL);
+    return JSValueMakeNumber(ctx, total);
+}/*}}}*/
+
+/* tabs_reclaimed_memory {{{*/
+/**
+ * Memory in bytes that has been reclaimed by hibernating tabs, the decrease
+ * of the resident memory is measured shortly after the webviews have been
+ * destroyed, hibernations while other tabs are loading are not counted
+ *
+ * @name reclaimedMemory 
+ * @memberOf tabs
+ * @type Number
+ * */
+static JSValueRef 
+tabs_reclaimed_memory(JSContextRef ctx, JSObjectRef this, JSStringRef name, JSValueRef* exc) 
+{
+    guint64 reclaimed;
+    view_hibernate_stats(NULL, NULL, &reclaimed);
+    return JSValueMakeNumber(ctx, reclaimed);
 }/*}}}*/
 
 /* tabs_get{{{*/
@@ -69,7 +119,7 @@ tabs_get(JSContextRef ctx, JSObjectRef this, JSStringRef name, JSValueRef* exc)
     JSValueRef v = JSValueMakeString(ctx, name);
     double n = JSValueToNumber(ctx, v, exc);
     if (!isnan(n)) {
-        GList *nth = g_list_nth(dwb.state.views, (int)n);
+        GList *nth = view_nth((int)n);
         if (nth != NULL) {
             return VIEW(nth)->script_wv;
         }
@@ -108,6 +158,9 @@ tabs_initialize(JSContextRef ctx) {
         { "current",      tabs_current, NULL,   kJSDefaultAttributes },
         { "number",       tabs_number,  NULL,   kJSDefaultAttributes },
         { "length",       tabs_length,  NULL,   kJSDefaultAttributes },
+        { "hibernated",   tabs_hibernated,  NULL,   kJSDefaultAttributes },
+        { "hibernations", tabs_hibernations,  NULL,   kJSDefaultAttributes },
+        { "reclaimedMemory", tabs_reclaimed_memory,  NULL,   kJSDefaultAttributes },
         { 0, 0, 0, 0 }, 
     };
 
@@ -249,7 +249,7 @@ sutil_checksum(JSContextRef ctx, JSObjectRef function, JSObjectRef thisObject, s
 
     original = (guchar*)js_value_to_char(ctx, argv[0], -1, exc);
     if (original == NULL)
-        return NIL;
+        return JSValueMakeNull(ctx);
 
     double dtype;
     GChecksumType type = G_CHECKSUM_SHA256;
@@ -258,7 +258,7 @@ sutil_checksum(JSContextRef ctx, JSObjectRef function, JSObjectRef thisObject, s
         dtype = JSValueToNumber(ctx, argv[1], exc);
         if (isnan(dtype)) 
         {
-            ret = NIL;
+            ret = JSValueMakeNull(ctx);
             goto error_out;
         }
         type = MIN(MAX((GChecksumType)dtype, G_CHECKSUM_MD5), G_CHECKSUM_SHA256);
@@ -523,10 +523,10 @@ sutil_base64_encode(JSContextRef ctx, JSObjectRef function, JSObjectRef thisObje
     JSValueRef ret;
 
     if (argc == 0)
-        return NIL;
+        return JSValueMakeNull(ctx);
     string = JSValueToStringCopy(ctx, argv[0], exc);
     if (string == NULL)
-        return NIL;
+        return JSValueMakeNull(ctx);
 
     length = JSStringGetLength(string);
     chars = JSStringGetCharactersPtr(string);
@@ -565,10 +565,10 @@ sutil_base64_decode(JSContextRef ctx, JSObjectRef function, JSObjectRef thisObje
     JSValueRef ret;
 
     if (argc == 0)
-        return NIL;
+        return JSValueMakeNull(ctx);
     base64 = js_value_to_char(ctx, argv[0], -1, exc);
     if (base64 == NULL)
-        return NIL;
+        return JSValueMakeNull(ctx);
     data = g_base64_decode(base64, &length);
     js_data = g_malloc0(length * sizeof(gushort));
     for (guint i=0; i<length; i++)
@@ -620,3 +620,19 @@ util_initialize(JSContextRef ctx) {
     return ret;
 }
 
+/* Restricted util namespace of worker contexts */
+JSObjectRef 
+util_worker_initialize(JSContextRef ctx) {
+    JSObjectRef global_object = JSContextGetGlobalObject(ctx);
+    JSStaticFunction util_functions[] = { 
+        { "markupEscape",     sutil_markup_escape,    kJSDefaultAttributes },
+        { "checksum",         sutil_checksum,         kJSDefaultAttributes },
+        { "_base64Encode",    sutil_base64_encode,    kJSDefaultAttributes },
+        { "_base64Decode",    sutil_base64_decode,    kJSDefaultAttributes },
+        { 0, 0, 0 }, 
+    };
+    JSClassRef klass = scripts_create_class("util", util_functions, NULL, NULL);
+    JSObjectRef ret = scripts_create_object(ctx, klass, global_object, kJSDefaultAttributes, "util", NULL);
+    JSClassRelease(klass);
+    return ret;
+}
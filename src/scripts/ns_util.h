@@ -22,4 +22,7 @@
 JSObjectRef 
 util_initialize(JSContextRef);
 
+JSObjectRef 
+util_worker_initialize(JSContextRef);
+
 #endif
@@ -22,6 +22,7 @@ typedef struct ScriptContext_s ScriptContext;
 #include "../scripts.h" 
 #include "../session.h" 
 #include "../util.h" 
+#include "../view.h" 
 #include "../js.h" 
 #include "../soup.h" 
 #include "../domain.h" 
@@ -55,6 +56,7 @@ typedef struct ScriptContext_s ScriptContext;
 #include "cl_download.h"
 #include "cl_cookie.h"
 #include "cl_header.h"
+#include "cl_worker.h"
 #if WEBKIT_CHECK_VERSION(1, 10, 0)
 #include "cl_filechooser.h"
 #endif
@@ -83,6 +85,8 @@ enum {
     CLASS_DOM_EVENT, 
 #endif
     CLASS_TIMER,
+    CLASS_FILE_WRITER,
+    CLASS_WORKER,
     CLASS_LAST,
 };
 
@@ -101,6 +105,7 @@ enum {
     CONSTRUCTOR_MENU,
     CONSTRUCTOR_ARRAY,
     CONSTRUCTOR_TIMER, 
+    CONSTRUCTOR_WORKER, 
     CONSTRUCTOR_LAST,
 };
 
@@ -134,6 +139,16 @@ struct ScriptContext_s {
     GSList *created_widgets;
     GPtrArray *gobject_signals;
     GHashTable *exports;
+    /* Compiled filters of the resource and navigation signal, keyed by the
+     * id of the Signal */
+    GHashTable *signal_filters;
+    GSList *filter_list[SCRIPTS_SIG_LAST];
+    /* Dispatchers and queued events of batched signals */
+    JSObjectRef batch_objects[SCRIPTS_SIG_LAST];
+    GPtrArray *batched_events[SCRIPTS_SIG_LAST];
+    guint batch_source;
+    /* Running workers, see cl_worker.c */
+    GSList *workers;
 
     JSClassRef classes[CLASS_LAST];
     JSObjectRef constructors[CONSTRUCTOR_LAST];
@@ -147,6 +162,8 @@ struct ScriptContext_s {
     JSObjectRef complete;
 
     GQuark ref_quark;
+    /* Number of wrappers created by make_object_for_class */
+    guint wrappers_created;
     gboolean keymap_dirty;
 }; 
 
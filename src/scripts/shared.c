@@ -57,6 +57,7 @@ make_object_for_class(JSContextRef ctx, int iclass, GObject *o, gboolean protect
     }
 
     retobj = JSObjectMake(ctx, sctx->classes[iclass], o);
+    sctx->wrappers_created++;
     if (protect) 
     {
         g_object_set_qdata_full(o, sctx->ref_quark, retobj, (GDestroyNotify)object_destroy_cb);
@@ -70,6 +71,60 @@ finish:
     return retobj;
 }
 
+/* 
+ * Binds an existing wrapper to a gobject, the wrapper is protected as long as
+ * the gobject is alive
+ * */
+void 
+bind_object(JSContextRef ctx, JSObjectRef obj, GObject *o)
+{
+    ScriptContext *sctx = scripts_get_context();
+    if (sctx == NULL) 
+        return;
+    JSObjectSetPrivate(obj, o);
+    g_object_set_qdata_full(o, sctx->ref_quark, obj, (GDestroyNotify)object_destroy_cb);
+    JSValueProtect(ctx, obj);
+    scripts_release_context();
+}
+
+/* 
+ * Releases a wrapper from its gobject before the gobject is destroyed, the
+ * wrapper itself stays valid
+ * */
+void 
+unbind_object(JSContextRef ctx, JSObjectRef obj, GObject *o)
+{
+    ScriptContext *sctx = scripts_get_context();
+    if (sctx == NULL) 
+        return;
+    if (g_object_get_qdata(o, sctx->ref_quark) == obj) 
+    {
+        g_object_steal_qdata(o, sctx->ref_quark);
+        JSObjectSetPrivate(obj, NULL);
+        JSValueUnprotect(ctx, obj);
+    }
+    scripts_release_context();
+}
+
+/* 
+ * Length of data without an incomplete utf-8 sequence at the end, the
+ * remaining bytes belong to the next chunk of a stream
+ * */
+gsize 
+utf8_complete_length(const char *data, gsize length)
+{
+    const unsigned char *s = (const unsigned char *)data;
+    for (gsize i=1; i<=MIN(length, 3); i++) 
+    {
+        unsigned char c = s[length - i];
+        if ((c & 0xc0) == 0x80)
+            continue;
+        gsize needed = c >= 0xf0 ? 4 : c >= 0xe0 ? 3 : c >= 0xc0 ? 2 : 1;
+        return needed > i ? length - i : length;
+    }
+    return length;
+}
+
 bool
 set_property_cb(JSContextRef ctx, JSObjectRef object, JSStringRef propertyName, JSValueRef value, JSValueRef* exception) {
     return true;
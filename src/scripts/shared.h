@@ -25,9 +25,18 @@ suri_to_object(JSContextRef ctx, SoupURI *uri, JSValueRef *exception);
 JSObjectRef 
 make_object_for_class(JSContextRef ctx, int iclass, GObject *o, gboolean protect);
 
+void 
+bind_object(JSContextRef ctx, JSObjectRef obj, GObject *o);
+
+void 
+unbind_object(JSContextRef ctx, JSObjectRef obj, GObject *o);
+
 bool
 set_property_cb(JSContextRef ctx, JSObjectRef object, JSStringRef propertyName, JSValueRef value, JSValueRef* exception);
 
+gsize 
+utf8_complete_length(const char *data, gsize length);
+
 JSValueRef 
 scripts_call_as_function(JSContextRef ctx, JSObjectRef func, JSObjectRef this, size_t argc, const JSValueRef argv[]);
 
@@ -26,11 +26,6 @@
 static char *s_session_name;
 static gboolean s_has_marked = true;
 
-typedef struct _SessionTab {
-    GList *gl;
-    unsigned int lock;
-} SessionTab;
-
 /* session_get_groups()                 return  char  ** (alloc){{{*/
 static char **
 session_get_groups() 
@@ -121,45 +116,12 @@ session_save_file(const char *groupname, const char *content, gboolean mark)
     g_strfreev(groups);
 }/*}}}*/
 
-void
-session_load_status_callback(WebKitWebView *wv, GParamSpec *p, SessionTab *tab) 
-{
-    WebKitLoadStatus status = webkit_web_view_get_load_status(wv);
-    switch (status) {
-        case WEBKIT_LOAD_FINISHED:  VIEW(tab->gl)->status->lockprotect = tab->lock;
-                                    dwb_tab_label_set_text(tab->gl, NULL);
-        case WEBKIT_LOAD_FAILED:    g_signal_handlers_disconnect_by_func(wv, (GFunc)session_load_status_callback, tab);
-                                    g_free(tab);
-                                    break;
-        default: return;
-    }
-}
 void
 session_clear_session() 
 {
     session_save_file(s_session_name ? s_session_name : "default", "", true);
 }
 
-/* session_load_webview(WebKitWebView *, char *, int *){{{*/
-static void
-session_load_webview(GList *gl, char *uri, int last, int lock_status) \
-{
-    if (last > 0) 
-        webkit_web_view_go_back_or_forward(WEBVIEW(gl), -last);
-    else 
-    {
-        WebKitWebBackForwardList *bf_list = webkit_web_view_get_back_forward_list(WEBVIEW(gl));
-        webkit_web_view_go_to_back_forward_item(WEBVIEW(gl), webkit_web_back_forward_list_get_nth_item(bf_list, 0));
-    }
-    if (lock_status > 0) 
-    {
-        SessionTab *tab = dwb_malloc(sizeof(SessionTab));
-        tab->gl = gl;
-        tab->lock = lock_status;
-        g_signal_connect(WEBVIEW(gl), "notify::load-status", G_CALLBACK(session_load_status_callback), tab);
-    }
-}/*}}}*/
-
 /* session_list {{{*/
 void
 session_list() 
@@ -185,18 +147,24 @@ session_list()
     exit(EXIT_SUCCESS);
 }/*}}}*/
 
+/* session_add_placeholder(TabHistory *) {{{*/
+static GList *
+session_add_placeholder(TabHistory *th) 
+{
+    th->items = g_list_reverse(th->items);
+    return view_add_placeholder(th);
+}/*}}}*/
+
 /* session_restore(const char *name) {{{*/
 gboolean
 session_restore(char *name, int flags) 
 {
     gboolean is_marked = false;
-    char *uri = NULL;
-    GList *currentview = NULL, *lastview = NULL;
-    WebKitWebBackForwardList *bf_list = NULL;
+    TabHistory *th = NULL;
+    GSList *restored = NULL;
     int last = 1;
     char *end;
     gboolean ret = false;
-    int locked_state = 0;
     if (name == NULL) 
         s_session_name = g_strdup("default");
     else 
@@ -219,6 +187,9 @@ session_restore(char *name, int flags)
     if (flags & SESSION_ONLY_MARK) 
         goto clean;
 
+    /* Tabs are only created as placeholders without a webview, the webviews
+     * are created when the tabs get focus or when the prefetch queue reaches
+     * them */
     char  **lines = g_strsplit(group, "\n", -1);
     int length = g_strv_length(lines) - 1;
     for (int i=1; i<=length; i++) 
@@ -230,31 +201,28 @@ session_restore(char *name, int flags)
 
             if (current <= last) 
             {
-                currentview = view_add(NULL, false);
-                bf_list = webkit_web_view_get_back_forward_list(WEBVIEW(currentview));
-                if (lastview) 
-                {
-                    session_load_webview(lastview, uri, last, locked_state);
-                    locked_state = 0;
-                }
-                lastview = currentview;
+                if (th != NULL) 
+                    restored = g_slist_prepend(restored, session_add_placeholder(th));
+                th = dwb_malloc(sizeof(TabHistory));
+                th->items = NULL;
+                th->current = 0;
+                th->lockprotect = 0;
+                th->scroll = 0;
+                th->hibernated = false;
             }
-            if (current == 0 && *end == '|') 
-                locked_state = strtol(end+1, NULL, 10);
-            if (bf_list != NULL) 
+            if (current == 0) 
             {
-                WebKitWebHistoryItem *item = webkit_web_history_item_new_with_data(line[1], line[2]);
-                webkit_web_back_forward_list_add_item(bf_list, item);
+                th->current = g_list_length(th->items);
+                if (*end == '|') 
+                    th->lockprotect = strtol(end+1, NULL, 10);
             }
+            th->items = g_list_prepend(th->items, dwb_navigation_new(line[1], line[2]));
             last = current;
-            g_free(uri);
-            uri = g_strdup(line[1]);
         }
-        if (i == length && lastview)
-            session_load_webview(lastview, uri, last, locked_state);
-
         g_strfreev(line);
     }
+    if (th != NULL) 
+        restored = g_slist_prepend(restored, session_add_placeholder(th));
     g_strfreev(lines);
 
     if (!dwb.state.views) 
@@ -263,7 +231,15 @@ session_restore(char *name, int flags)
         dwb_open_startpage(dwb.state.fview);
     }
     dwb_focus(dwb.state.fview);
-    g_free(uri);
+
+    restored = g_slist_reverse(restored);
+    for (GSList *l = restored; l; l=l->next) 
+    {
+        if (l->data != NULL)
+            view_prefetch(l->data);
+    }
+    g_slist_free(restored);
+
     ret = true;
 
 clean:
@@ -303,13 +279,27 @@ session_save(const char *name, int flags)
 
     for (GList *l = g_list_first(dwb.state.views); l; l=l->next) 
     {
-        WebKitWebView *web = WEBVIEW(l);
-        WebKitWebBackForwardList *bf_list = webkit_web_view_get_back_forward_list(web);
+        WebKitWebBackForwardList *bf_list;
+        TabHistory *th = VIEW(l)->status->placeholder;
+        if (th != NULL) 
+        {
+            int i = -th->current;
+            for (GList *item = th->items; item; item=item->next, i++) 
+            {
+                Navigation *n = item->data;
+                g_string_append_printf(buffer, "%d", i);
+                if (i == 0) 
+                    g_string_append_printf(buffer, "|%d", th->lockprotect);
+                g_string_append_printf(buffer, " %s %s\n", n->first, n->second);
+            }
+            continue;
+        }
         if (VIEW(l)->status->deferred) 
         {
             g_string_append_printf(buffer, "0|%d %s unknown\n", VIEW(l)->status->lockprotect, VIEW(l)->status->deferred_uri);
             continue;
         }
+        bf_list = webkit_web_view_get_back_forward_list(WEBVIEW(l));
         for (int i= -webkit_web_back_forward_list_get_back_length(bf_list); i<=webkit_web_back_forward_list_get_forward_length(bf_list); i++) 
         {
             WebKitWebHistoryItem *item = webkit_web_back_forward_list_get_nth_item(bf_list, i);
@@ -0,0 +1,899 @@
+/*
+ * Copyright (c) 2010-2014 Stefan Bolte <portix@gmx.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <glib/gstdio.h>
+#include "dwb.h"
+#include "transfer.h"
+
+/*
+ * Download engine on top of libsoup. The first request asks for the whole file
+ * with an open range, if the server answers with 206 the file is preallocated
+ * and split into up to n segments that are downloaded in parallel and written
+ * with pwrite. If the server answers with 200 the response is written as a
+ * single stream.
+ *
+ * The data is written to <path>.part, the segment offsets are saved to
+ * <path>.part.state every few seconds. If the same uri is downloaded to the
+ * same path again the download continues where it stopped, If-Range makes
+ * sure that the file hasn't changed in between.
+ *
+ * Checksums are computed while the data arrives. The hash position follows
+ * the segment that contains it, chunks that start at the hash position are
+ * hashed directly, data that was written ahead of it by other segments or in
+ * an earlier session is read back from the part file in an idle callback.
+ * What hasn't been hashed when the transfer finishes is left to the post
+ * processing thread, see transfer_get_checksum.
+ * */
+
+/* Segments are never smaller than this */
+#define TRANSFER_MIN_SEGMENT_SIZE   (1<<20)
+#define TRANSFER_MAX_RETRIES        5
+/* Interval in microseconds in which segment offsets are saved */
+#define TRANSFER_SAVE_INTERVAL      2000000
+/* Interval in milliseconds in which throttled segments are resumed */
+#define TRANSFER_THROTTLE_INTERVAL  50
+/* Bytes that are read back from disk per idle iteration for hashing */
+#define TRANSFER_HASH_BLOCK_SIZE    (1<<18)
+
+typedef struct _TransferSegment {
+    Transfer *transfer;
+    SoupMessage *msg;
+    goffset start;
+    /* Exclusive end of the segment, -1 if the size is unknown */
+    goffset end;
+    goffset offset;
+    guint retries;
+    gboolean done;
+    /* Set if the segment was dropped after falling back to a single stream */
+    gboolean dropped;
+} TransferSegment;
+
+typedef struct _TransferChecksum {
+    GChecksumType type;
+    GChecksum *checksum;
+} TransferChecksum;
+
+struct _Transfer {
+    int ref;
+    char *uri;
+    char *path;
+    char *part_path;
+    char *state_path;
+    /* ETag or Last-Modified of the first response, sent as If-Range */
+    char *validator;
+    SoupMessageHeaders *headers;
+    GPtrArray *segments;
+    int max_segments;
+    int fd;
+    /* Whether the server accepts range requests */
+    gboolean ranges;
+    gboolean probing;
+    gboolean resumed;
+    goffset total;
+    goffset current;
+    GTimer *timer;
+    gint64 saved;
+    TransferStatus status;
+    TransferFunc progress_cb;
+    TransferFunc status_cb;
+    gpointer data;
+    GSList *checksums;
+    /* Everything before this offset has been hashed */
+    goffset hashed;
+    guint hash_source;
+};
+
+/* Token bucket shared by all transfers, the rate is in bytes per second, 0
+ * disables throttling */
+static struct {
+    guint rate;
+    double tokens;
+    gint64 time;
+    GSList *paused;
+    guint source;
+} s_bucket;
+
+static void transfer_segment_start(TransferSegment *seg);
+
+/* transfer_new {{{*/
+static void
+transfer_copy_header(const char *name, const char *value, SoupMessageHeaders *headers)
+{
+    if (g_ascii_strcasecmp(name, "Range") && g_ascii_strcasecmp(name, "If-Range") && g_ascii_strcasecmp(name, "Accept-Encoding") &&
+            g_ascii_strcasecmp(name, "Cookie") && g_ascii_strcasecmp(name, "Host"))
+        soup_message_headers_append(headers, name, value);
+}
+Transfer *
+transfer_new(const char *uri, const char *path, SoupMessageHeaders *headers, int segments)
+{
+    Transfer *t = g_malloc0(sizeof(Transfer));
+    t->ref = 1;
+    t->uri = g_strdup(uri);
+    t->path = g_strdup(path);
+    t->part_path = g_strconcat(path, ".part", NULL);
+    t->state_path = g_strconcat(path, ".part.state", NULL);
+    t->headers = soup_message_headers_new(SOUP_MESSAGE_HEADERS_REQUEST);
+    if (headers != NULL)
+        soup_message_headers_foreach(headers, (SoupMessageHeadersForeachFunc)transfer_copy_header, t->headers);
+    t->segments = g_ptr_array_new_with_free_func(g_free);
+    t->max_segments = MAX(segments, 1);
+    t->fd = -1;
+    t->total = -1;
+    t->timer = g_timer_new();
+    g_timer_stop(t->timer);
+    t->status = TRANSFER_CREATED;
+    return t;
+}/*}}}*/
+
+/* transfer_unref {{{*/
+void
+transfer_unref(Transfer *t)
+{
+    if (--t->ref > 0)
+        return;
+    if (t->fd != -1)
+        close(t->fd);
+    for (GSList *l = t->checksums; l; l=l->next)
+    {
+        TransferChecksum *c = l->data;
+        g_checksum_free(c->checksum);
+        g_free(c);
+    }
+    g_slist_free(t->checksums);
+    g_free(t->uri);
+    g_free(t->path);
+    g_free(t->part_path);
+    g_free(t->state_path);
+    g_free(t->validator);
+    soup_message_headers_free(t->headers);
+    g_ptr_array_free(t->segments, true);
+    g_timer_destroy(t->timer);
+    g_free(t);
+}/*}}}*/
+
+void
+transfer_set_callbacks(Transfer *t, TransferFunc progress, TransferFunc status, gpointer data)
+{
+    t->progress_cb = progress;
+    t->status_cb = status;
+    t->data = data;
+}
+
+/* GETTER {{{*/
+TransferStatus
+transfer_get_status(Transfer *t)
+{
+    return t->status;
+}
+const char *
+transfer_get_uri(Transfer *t)
+{
+    return t->uri;
+}
+const char *
+transfer_get_path(Transfer *t)
+{
+    return t->path;
+}
+goffset
+transfer_get_current_size(Transfer *t)
+{
+    return t->current;
+}
+goffset
+transfer_get_total_size(Transfer *t)
+{
+    return t->total;
+}
+double
+transfer_get_progress(Transfer *t)
+{
+    if (t->status == TRANSFER_FINISHED)
+        return 1.0;
+    return t->total > 0 ? (double)t->current / t->total : 0.0;
+}
+double
+transfer_get_elapsed_time(Transfer *t)
+{
+    return g_timer_elapsed(t->timer, NULL);
+}
+int
+transfer_get_segments(Transfer *t)
+{
+    int n = 0;
+    for (guint i=0; i<t->segments->len; i++)
+    {
+        if (!((TransferSegment *)g_ptr_array_index(t->segments, i))->dropped)
+            n++;
+    }
+    return n;
+}
+gboolean
+transfer_get_resumed(Transfer *t)
+{
+    return t->resumed;
+}
+/* Returns the checksum of the data up to transfer_get_hashed_size, the data
+ * that was written ahead is hashed when the download is post processed */
+const GChecksum *
+transfer_get_checksum(Transfer *t, GChecksumType type)
+{
+    for (GSList *l = t->checksums; l; l=l->next)
+    {
+        TransferChecksum *c = l->data;
+        if (c->type == type)
+            return c->checksum;
+    }
+    return NULL;
+}
+goffset
+transfer_get_hashed_size(Transfer *t)
+{
+    return t->hashed;
+}/*}}}*/
+
+/* CHECKSUMS {{{*/
+/* transfer_add_checksum {{{*/
+void
+transfer_add_checksum(Transfer *t, GChecksumType type)
+{
+    g_return_if_fail(t->status == TRANSFER_CREATED);
+
+    if (transfer_get_checksum(t, type) != NULL)
+        return;
+    TransferChecksum *c = g_malloc0(sizeof(TransferChecksum));
+    c->type = type;
+    c->checksum = g_checksum_new(type);
+    t->checksums = g_slist_append(t->checksums, c);
+}/*}}}*/
+
+/* transfer_hash_update {{{*/
+static void
+transfer_hash_update(Transfer *t, const char *data, gsize length)
+{
+    for (GSList *l = t->checksums; l; l=l->next)
+        g_checksum_update(((TransferChecksum *)l->data)->checksum, (const guchar *)data, length);
+    t->hashed += length;
+}/*}}}*/
+
+/* transfer_hash_reset {{{*/
+/* Called when the data is written from the beginning again */
+static void
+transfer_hash_reset(Transfer *t)
+{
+    for (GSList *l = t->checksums; l; l=l->next)
+        g_checksum_reset(((TransferChecksum *)l->data)->checksum);
+    t->hashed = 0;
+}/*}}}*/
+
+/* transfer_hash_pending {{{*/
+/* Returns the segment if data at the hash position has already been written */
+static TransferSegment *
+transfer_hash_pending(Transfer *t)
+{
+    for (guint i=0; i<t->segments->len; i++)
+    {
+        TransferSegment *seg = g_ptr_array_index(t->segments, i);
+        if (!seg->dropped && seg->start <= t->hashed && t->hashed < seg->offset)
+            return seg;
+    }
+    return NULL;
+}/*}}}*/
+
+/* transfer_hash_read {{{*/
+/* Reads at most max bytes at the hash position back from the part file */
+static gboolean
+transfer_hash_read(Transfer *t, gsize max)
+{
+    char buffer[8192];
+    TransferSegment *seg;
+
+    while (max > 0 && (seg = transfer_hash_pending(t)) != NULL)
+    {
+        gsize length = MIN(MIN(sizeof(buffer), max), (gsize)(seg->offset - t->hashed));
+        ssize_t r = pread(t->fd, buffer, length, t->hashed);
+        if (r == -1 && errno == EINTR)
+            continue;
+        if (r <= 0)
+            return false;
+        transfer_hash_update(t, buffer, r);
+        max -= r;
+    }
+    return true;
+}/*}}}*/
+
+/* transfer_hash_cb {{{*/
+static gboolean
+transfer_hash_cb(Transfer *t)
+{
+    if (t->status == TRANSFER_STARTED && t->fd != -1 &&
+            transfer_hash_read(t, TRANSFER_HASH_BLOCK_SIZE) && transfer_hash_pending(t) != NULL)
+        return true;
+    t->hash_source = 0;
+    return false;
+}/*}}}*/
+
+/* transfer_hash_schedule {{{*/
+static void
+transfer_hash_schedule(Transfer *t)
+{
+    if (t->checksums == NULL || t->hash_source != 0 || transfer_hash_pending(t) == NULL)
+        return;
+    t->ref++;
+    t->hash_source = g_idle_add_full(G_PRIORITY_DEFAULT_IDLE, (GSourceFunc)transfer_hash_cb, t, (GDestroyNotify)transfer_unref);
+}/*}}}*/
+
+/*}}}*/
+
+/* STATE {{{*/
+/* transfer_save_state {{{*/
+/* Format: uri, total size, validator and one line per segment with start, end
+ * and current offset */
+static void
+transfer_save_state(Transfer *t)
+{
+    if (!t->ranges || t->total <= 0)
+        return;
+
+    /* The offsets must never be ahead of the data on disk */
+    fdatasync(t->fd);
+
+    GString *buffer = g_string_new(NULL);
+    g_string_append_printf(buffer, "%s\n%"G_GINT64_FORMAT"\n%s\n", t->uri, (gint64)t->total,
+            t->validator == NULL ? "" : t->validator);
+    for (guint i=0; i<t->segments->len; i++)
+    {
+        TransferSegment *seg = g_ptr_array_index(t->segments, i);
+        if (!seg->dropped)
+            g_string_append_printf(buffer, "%"G_GINT64_FORMAT" %"G_GINT64_FORMAT" %"G_GINT64_FORMAT"\n",
+                    (gint64)seg->start, (gint64)seg->end, (gint64)seg->offset);
+    }
+    g_file_set_contents(t->state_path, buffer->str, -1, NULL);
+    g_string_free(buffer, true);
+    t->saved = g_get_monotonic_time();
+}/*}}}*/
+
+/* transfer_load_state {{{*/
+static gboolean
+transfer_load_state(Transfer *t)
+{
+    char *content = NULL;
+    char **lines = NULL;
+    gboolean ret = false;
+    gint64 total, start, end, offset;
+    struct stat st;
+
+    if (!g_file_get_contents(t->state_path, &content, NULL, NULL))
+        return false;
+
+    lines = g_strsplit(content, "\n", -1);
+    if (g_strv_length(lines) < 4 || g_strcmp0(lines[0], t->uri))
+        goto error_out;
+
+    total = g_ascii_strtoll(lines[1], NULL, 10);
+    if (total <= 0 || stat(t->part_path, &st) != 0 || st.st_size != total)
+        goto error_out;
+
+    for (int i=3; lines[i] != NULL; i++)
+    {
+        if (sscanf(lines[i], "%"G_GINT64_FORMAT" %"G_GINT64_FORMAT" %"G_GINT64_FORMAT, &start, &end, &offset) != 3)
+            continue;
+        if (start < 0 || end > total || offset < start || offset > end)
+            goto error_out;
+
+        TransferSegment *seg = g_malloc0(sizeof(TransferSegment));
+        seg->transfer = t;
+        seg->start = start;
+        seg->end = end;
+        seg->offset = offset;
+        seg->done = offset == end;
+        g_ptr_array_add(t->segments, seg);
+        t->current += offset - start;
+    }
+    if (t->segments->len == 0)
+        goto error_out;
+
+    t->total = total;
+    t->validator = *lines[2] ? g_strdup(lines[2]) : NULL;
+    t->ranges = true;
+    ret = true;
+
+error_out:
+    if (!ret)
+    {
+        g_ptr_array_set_size(t->segments, 0);
+        t->current = 0;
+    }
+    g_strfreev(lines);
+    g_free(content);
+    return ret;
+}/*}}}*/
+
+static void
+transfer_remove_state(Transfer *t)
+{
+    g_unlink(t->state_path);
+}
+/*}}}*/
+
+/* transfer_set_status {{{*/
+static void
+transfer_set_status(Transfer *t, TransferStatus status)
+{
+    t->status = status;
+    if (status != TRANSFER_STARTED)
+    {
+        g_timer_stop(t->timer);
+        /* Cancelling the messages calls the finished callbacks which
+         * ignore transfers that aren't running */
+        for (guint i=0; i<t->segments->len; i++)
+        {
+            TransferSegment *seg = g_ptr_array_index(t->segments, i);
+            if (seg->msg != NULL)
+                soup_session_cancel_message(dwb.misc.soupsession, seg->msg, SOUP_STATUS_CANCELLED);
+        }
+        if (t->fd != -1)
+        {
+            close(t->fd);
+            t->fd = -1;
+        }
+    }
+    if (t->status_cb != NULL)
+        t->status_cb(t, t->data);
+}/*}}}*/
+
+/* transfer_fail {{{*/
+/* Keeps the partial file and the state so the download can be resumed */
+static void
+transfer_fail(Transfer *t)
+{
+    /* Without ranges nothing can be resumed, e.g. if the first request
+     * failed */
+    if (!t->ranges || t->total <= 0)
+        g_unlink(t->part_path);
+    else if (t->fd != -1)
+        transfer_save_state(t);
+    transfer_set_status(t, TRANSFER_ERROR);
+}/*}}}*/
+
+/* transfer_check_finished {{{*/
+static void
+transfer_check_finished(Transfer *t)
+{
+    for (guint i=0; i<t->segments->len; i++)
+    {
+        TransferSegment *seg = g_ptr_array_index(t->segments, i);
+        if (!seg->dropped && !seg->done)
+            return;
+    }
+    if (t->total < 0)
+        t->total = t->current;
+    if (t->hash_source != 0)
+    {
+        g_source_remove(t->hash_source);
+        t->hash_source = 0;
+    }
+    close(t->fd);
+    t->fd = -1;
+    if (g_rename(t->part_path, t->path) != 0)
+    {
+        fprintf(stderr, "Cannot rename %s: %s\n", t->part_path, g_strerror(errno));
+        transfer_set_status(t, TRANSFER_ERROR);
+        return;
+    }
+    transfer_remove_state(t);
+    transfer_set_status(t, TRANSFER_FINISHED);
+}/*}}}*/
+
+/* transfer_write {{{*/
+static gboolean
+transfer_write(int fd, const char *data, gsize length, goffset offset)
+{
+    while (length > 0)
+    {
+        ssize_t written = pwrite(fd, data, length, offset);
+        if (written == -1)
+        {
+            if (errno == EINTR)
+                continue;
+            return false;
+        }
+        data += written;
+        length -= written;
+        offset += written;
+    }
+    return true;
+}/*}}}*/
+
+/* transfer_preallocate {{{*/
+static gboolean
+transfer_preallocate(Transfer *t)
+{
+    /* Not all filesystems support posix_fallocate, a sparse file is good
+     * enough in that case */
+    if (posix_fallocate(t->fd, 0, t->total) == 0)
+        return true;
+    return ftruncate(t->fd, t->total) == 0;
+}/*}}}*/
+
+/* transfer_set_validator {{{*/
+static void
+transfer_set_validator(Transfer *t, SoupMessage *msg)
+{
+    const char *etag = soup_message_headers_get_one(msg->response_headers, "ETag");
+    g_free(t->validator);
+    /* Weak validators can't be used with If-Range */
+    if (etag != NULL && !g_str_has_prefix(etag, "W/"))
+        t->validator = g_strdup(etag);
+    else
+        t->validator = g_strdup(soup_message_headers_get_one(msg->response_headers, "Last-Modified"));
+}/*}}}*/
+
+/* THROTTLING {{{*/
+/* transfer_bucket_refill {{{*/
+static void
+transfer_bucket_refill()
+{
+    gint64 time = g_get_monotonic_time();
+    s_bucket.tokens = MIN(s_bucket.tokens + (double)s_bucket.rate * (time - s_bucket.time) / 1000000, s_bucket.rate);
+    s_bucket.time = time;
+}/*}}}*/
+
+/* transfer_unpause {{{*/
+static void
+transfer_unpause(TransferSegment *seg)
+{
+    Transfer *t = seg->transfer;
+    if (seg->msg != NULL && t->status == TRANSFER_STARTED)
+        soup_session_unpause_message(dwb.misc.soupsession, seg->msg);
+    transfer_unref(t);
+}/*}}}*/
+
+/* transfer_bucket_cb {{{*/
+static gboolean
+transfer_bucket_cb(gpointer unused)
+{
+    transfer_bucket_refill();
+    if (s_bucket.tokens < 0 && s_bucket.rate > 0)
+        return true;
+
+    GSList *paused = s_bucket.paused;
+    s_bucket.paused = NULL;
+    s_bucket.source = 0;
+    g_slist_free_full(paused, (GDestroyNotify)transfer_unpause);
+    return false;
+}/*}}}*/
+
+/* transfer_throttle {{{*/
+/* Takes length bytes from the bucket and pauses the segment if the bucket is
+ * empty */
+static void
+transfer_throttle(TransferSegment *seg, gsize length)
+{
+    if (s_bucket.rate == 0)
+        return;
+    transfer_bucket_refill();
+    s_bucket.tokens -= length;
+    if (s_bucket.tokens >= 0)
+        return;
+
+    seg->transfer->ref++;
+    soup_session_pause_message(dwb.misc.soupsession, seg->msg);
+    s_bucket.paused = g_slist_prepend(s_bucket.paused, seg);
+    if (s_bucket.source == 0)
+        s_bucket.source = g_timeout_add(TRANSFER_THROTTLE_INTERVAL, transfer_bucket_cb, NULL);
+}/*}}}*/
+
+/* transfer_set_bandwidth_limit {{{*/
+/* Limits the bandwidth of all transfers, rate is in bytes per second, 0
+ * removes the limit */
+void
+transfer_set_bandwidth_limit(guint rate)
+{
+    s_bucket.rate = rate;
+    s_bucket.tokens = MIN(s_bucket.tokens, rate);
+    s_bucket.time = g_get_monotonic_time();
+    if (rate == 0 && s_bucket.source != 0)
+    {
+        g_source_remove(s_bucket.source);
+        transfer_bucket_cb(NULL);
+    }
+}/*}}}*//*}}}*/
+
+/* transfer_segment_new {{{*/
+static TransferSegment *
+transfer_segment_new(Transfer *t, goffset start, goffset end)
+{
+    TransferSegment *seg = g_malloc0(sizeof(TransferSegment));
+    seg->transfer = t;
+    seg->start = seg->offset = start;
+    seg->end = end;
+    g_ptr_array_add(t->segments, seg);
+    return seg;
+}/*}}}*/
+
+/* transfer_split {{{*/
+/* Called when the first response was 206, the first segment keeps running and
+ * stops at the end of its range */
+static void
+transfer_split(Transfer *t, TransferSegment *first, SoupMessage *msg)
+{
+    goffset start, end, total;
+    t->probing = false;
+
+    if (!soup_message_headers_get_content_range(msg->response_headers, &start, &end, &total) || start != 0 || total <= 0)
+    {
+        /* Unknown size, write it as a single stream */
+        t->ranges = false;
+        return;
+    }
+    t->ranges = true;
+    t->total = total;
+    transfer_set_validator(t, msg);
+    if (!transfer_preallocate(t))
+    {
+        fprintf(stderr, "Cannot allocate %s: %s\n", t->part_path, g_strerror(errno));
+        transfer_fail(t);
+        return;
+    }
+
+    int n = CLAMP(total / TRANSFER_MIN_SEGMENT_SIZE, 1, t->max_segments);
+    goffset size = total / n;
+    first->end = n == 1 ? total : size;
+    for (int i=1; i<n; i++)
+        transfer_segment_start(transfer_segment_new(t, i * size, i == n-1 ? total : (i+1) * size));
+    transfer_save_state(t);
+}/*}}}*/
+
+/* transfer_restart_single {{{*/
+/* Called when a response was 200, either ranges aren't supported or the file
+ * has changed since the download was interrupted, the response is written from
+ * the beginning */
+static void
+transfer_restart_single(Transfer *t, TransferSegment *seg, SoupMessage *msg)
+{
+    t->probing = false;
+    t->ranges = false;
+    t->resumed = false;
+    for (guint i=0; i<t->segments->len; i++)
+    {
+        TransferSegment *other = g_ptr_array_index(t->segments, i);
+        if (other != seg && !other->dropped)
+        {
+            other->dropped = true;
+            if (other->msg != NULL)
+                soup_session_cancel_message(dwb.misc.soupsession, other->msg, SOUP_STATUS_CANCELLED);
+        }
+    }
+    if (ftruncate(t->fd, 0) != 0)
+    {
+        transfer_fail(t);
+        return;
+    }
+    transfer_hash_reset(t);
+    if (soup_message_headers_get_encoding(msg->response_headers) == SOUP_ENCODING_CONTENT_LENGTH)
+        t->total = soup_message_headers_get_content_length(msg->response_headers);
+    else
+        t->total = -1;
+    t->current = 0;
+    seg->start = seg->offset = 0;
+    seg->end = t->total;
+    seg->done = false;
+    transfer_remove_state(t);
+}/*}}}*/
+
+/* transfer_got_headers_cb {{{*/
+static void
+transfer_got_headers_cb(SoupMessage *msg, TransferSegment *seg)
+{
+    Transfer *t = seg->transfer;
+    if (seg->dropped || t->status != TRANSFER_STARTED)
+        return;
+
+    if (msg->status_code == SOUP_STATUS_PARTIAL_CONTENT)
+    {
+        if (t->probing)
+            transfer_split(t, seg, msg);
+    }
+    else if (msg->status_code == SOUP_STATUS_OK)
+        transfer_restart_single(t, seg, msg);
+    /* Redirects and errors are handled when the message has finished */
+}/*}}}*/
+
+/* transfer_got_chunk_cb {{{*/
+static void
+transfer_got_chunk_cb(SoupMessage *msg, SoupBuffer *chunk, TransferSegment *seg)
+{
+    Transfer *t = seg->transfer;
+    if (seg->dropped || seg->done || t->status != TRANSFER_STARTED || t->probing)
+        return;
+    /* Bodies of redirects and authentication requests */
+    if (msg->status_code != SOUP_STATUS_OK && msg->status_code != SOUP_STATUS_PARTIAL_CONTENT)
+        return;
+
+    gsize length = chunk->length;
+    if (seg->end >= 0 && seg->offset + (goffset)length > seg->end)
+        length = seg->end - seg->offset;
+
+    if (!transfer_write(t->fd, chunk->data, length, seg->offset))
+    {
+        fprintf(stderr, "Cannot write %s: %s\n", t->part_path, g_strerror(errno));
+        transfer_fail(t);
+        return;
+    }
+    if (t->checksums != NULL && t->hashed == seg->offset)
+        transfer_hash_update(t, chunk->data, length);
+    seg->offset += length;
+    t->current += length;
+    transfer_hash_schedule(t);
+    if (seg->end < 0 || seg->offset < seg->end)
+        transfer_throttle(seg, length);
+
+    if (g_get_monotonic_time() - t->saved > TRANSFER_SAVE_INTERVAL)
+        transfer_save_state(t);
+    if (t->progress_cb != NULL)
+        t->progress_cb(t, t->data);
+
+    if (seg->end >= 0 && seg->offset >= seg->end)
+    {
+        /* The first segment requests an open range and is stopped here, this
+         * may finish the transfer */
+        seg->done = true;
+        soup_session_cancel_message(dwb.misc.soupsession, msg, SOUP_STATUS_CANCELLED);
+    }
+}/*}}}*/
+
+/* transfer_retry_cb {{{*/
+static gboolean
+transfer_retry_cb(TransferSegment *seg)
+{
+    Transfer *t = seg->transfer;
+    if (t->status == TRANSFER_STARTED && !seg->dropped)
+        transfer_segment_start(seg);
+    transfer_unref(t);
+    return false;
+}/*}}}*/
+
+/* transfer_segment_finished_cb {{{*/
+static void
+transfer_segment_finished_cb(SoupSession *session, SoupMessage *msg, TransferSegment *seg)
+{
+    Transfer *t = seg->transfer;
+    guint status = msg->status_code;
+    seg->msg = NULL;
+
+    if (seg->dropped || t->status != TRANSFER_STARTED)
+        goto out;
+
+    if (seg->done || (seg->end < 0 && SOUP_STATUS_IS_SUCCESSFUL(status)))
+    {
+        seg->done = true;
+        transfer_check_finished(t);
+    }
+    else if (seg->retries < TRANSFER_MAX_RETRIES &&
+            (SOUP_STATUS_IS_TRANSPORT_ERROR(status) || SOUP_STATUS_IS_SERVER_ERROR(status) || SOUP_STATUS_IS_SUCCESSFUL(status)))
+    {
+        /* A successful but incomplete response means that the connection was
+         * closed early */
+        seg->retries++;
+        if (!t->ranges)
+        {
+            t->current = 0;
+            seg->offset = 0;
+            t->probing = true;
+            transfer_hash_reset(t);
+        }
+        t->ref++;
+        g_timeout_add_seconds(seg->retries, (GSourceFunc)transfer_retry_cb, seg);
+    }
+    else
+    {
+        fprintf(stderr, "Download of %s failed: %d %s\n", t->uri, status, msg->reason_phrase);
+        transfer_fail(t);
+    }
+out:
+    transfer_unref(t);
+}/*}}}*/
+
+/* transfer_segment_start {{{*/
+static void
+transfer_segment_start(TransferSegment *seg)
+{
+    Transfer *t = seg->transfer;
+    SoupMessage *msg = soup_message_new("GET", t->uri);
+    if (msg == NULL)
+    {
+        transfer_fail(t);
+        return;
+    }
+    soup_message_headers_foreach(t->headers, (SoupMessageHeadersForeachFunc)transfer_copy_header, msg->request_headers);
+    /* Ranges and sizes refer to the encoded body, the session's content
+     * decoder would hand out decoded chunks */
+    soup_message_disable_feature(msg, SOUP_TYPE_CONTENT_DECODER);
+    soup_message_headers_replace(msg->request_headers, "Accept-Encoding", "identity");
+    if (t->probing)
+        soup_message_headers_set_range(msg->request_headers, 0, -1);
+    else if (t->ranges)
+    {
+        soup_message_headers_set_range(msg->request_headers, seg->offset, seg->end - 1);
+        if (t->validator != NULL)
+            soup_message_headers_replace(msg->request_headers, "If-Range", t->validator);
+    }
+    soup_message_body_set_accumulate(msg->response_body, false);
+    g_signal_connect(msg, "got-headers", G_CALLBACK(transfer_got_headers_cb), seg);
+    g_signal_connect(msg, "got-chunk", G_CALLBACK(transfer_got_chunk_cb), seg);
+
+    seg->msg = msg;
+    t->ref++;
+    soup_session_queue_message(dwb.misc.soupsession, msg, (SoupSessionCallback)transfer_segment_finished_cb, seg);
+}/*}}}*/
+
+/* transfer_start {{{*/
+void
+transfer_start(Transfer *t)
+{
+    g_return_if_fail(t->status == TRANSFER_CREATED);
+
+    /* Opened for reading too, data that was written ahead of the hash
+     * position is read back */
+    if ((t->fd = open(t->part_path, O_RDWR | O_CREAT, 0644)) == -1)
+    {
+        fprintf(stderr, "Cannot open %s: %s\n", t->part_path, g_strerror(errno));
+        transfer_set_status(t, TRANSFER_ERROR);
+        return;
+    }
+    g_timer_start(t->timer);
+    transfer_set_status(t, TRANSFER_STARTED);
+
+    if (transfer_load_state(t))
+    {
+        t->resumed = true;
+        for (guint i=0; i<t->segments->len; i++)
+        {
+            TransferSegment *seg = g_ptr_array_index(t->segments, i);
+            if (!seg->done)
+                transfer_segment_start(seg);
+        }
+        transfer_hash_schedule(t);
+        transfer_check_finished(t);
+    }
+    else if (ftruncate(t->fd, 0) == 0)
+    {
+        t->probing = true;
+        transfer_segment_start(transfer_segment_new(t, 0, -1));
+    }
+    else
+        transfer_fail(t);
+}/*}}}*/
+
+/* transfer_cancel {{{*/
+void
+transfer_cancel(Transfer *t)
+{
+    if (t->status != TRANSFER_STARTED && t->status != TRANSFER_CREATED)
+        return;
+    transfer_set_status(t, TRANSFER_CANCELLED);
+    g_unlink(t->part_path);
+    transfer_remove_state(t);
+}/*}}}*/
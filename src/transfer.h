@@ -0,0 +1,53 @@
+/*
+ * Copyright (c) 2010-2014 Stefan Bolte <portix@gmx.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef __DWB_TRANSFER_H__
+#define __DWB_TRANSFER_H__
+
+typedef enum {
+    TRANSFER_CREATED,
+    TRANSFER_STARTED,
+    TRANSFER_FINISHED,
+    TRANSFER_CANCELLED,
+    TRANSFER_ERROR,
+} TransferStatus;
+
+typedef struct _Transfer Transfer;
+typedef void (*TransferFunc)(Transfer *, gpointer);
+
+Transfer * transfer_new(const char *uri, const char *path, SoupMessageHeaders *headers, int segments);
+void transfer_set_callbacks(Transfer *t, TransferFunc progress, TransferFunc status, gpointer data);
+void transfer_start(Transfer *t);
+void transfer_cancel(Transfer *t);
+void transfer_unref(Transfer *t);
+void transfer_set_bandwidth_limit(guint rate);
+
+TransferStatus transfer_get_status(Transfer *t);
+const char * transfer_get_uri(Transfer *t);
+const char * transfer_get_path(Transfer *t);
+goffset transfer_get_current_size(Transfer *t);
+goffset transfer_get_total_size(Transfer *t);
+double transfer_get_progress(Transfer *t);
+double transfer_get_elapsed_time(Transfer *t);
+int transfer_get_segments(Transfer *t);
+gboolean transfer_get_resumed(Transfer *t);
+void transfer_add_checksum(Transfer *t, GChecksumType type);
+const GChecksum * transfer_get_checksum(Transfer *t, GChecksumType type);
+goffset transfer_get_hashed_size(Transfer *t);
+
+#endif
@@ -897,6 +897,11 @@ util_create_json(int n, ...)
                 bval = va_arg(args, gboolean);
                 g_string_append_printf(string, "%s", bval ? "true" : "false");
                 break;
+            case OBJECT:
+                /* Already formatted json */
+                cval = va_arg(args, gchar*);
+                g_string_append(string, cval != NULL ? cval : "null");
+                break;
             default : g_string_append(string, "null"); break;
         }
         if (i<n-1)
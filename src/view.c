@@ -16,7 +16,12 @@
  * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
  */
 
+#include <stdio.h>
 #include <string.h>
+#include <unistd.h>
+#ifdef __GLIBC__
+#include <malloc.h>
+#endif
 #include <gdk/gdkkeysyms.h> 
 #include <JavaScriptCore/JavaScript.h> 
 #include "dwb.h"
@@ -42,6 +47,42 @@ static guint s_sig_caret_button_release;
 static guint s_sig_caret_motion;
 static const char * dummy_icon[] = { "1 1 1 1 ", "- c NONE", "", };
 
+/* Coalesced status bar and tab label updates */
+#define UPDATE_FRAME_INTERVAL 16
+#define UPDATE_BACKGROUND_INTERVAL 500
+enum {
+    VIEW_UPDATE_STATUS      = 1<<0,
+    VIEW_UPDATE_STATUS_TEXT = 1<<1,
+    VIEW_UPDATE_URI         = 1<<2,
+};
+static guint s_update_frame_source;
+static guint s_update_background_source;
+static guint s_dirty_views;
+static guint64 s_updates_skipped;
+
+/* Index of dwb.state.views, the nth element is the link of the nth tab */
+static GPtrArray *s_tabs;
+
+/* Placeholder tabs waiting to be loaded in the background */
+static GQueue s_prefetch_queue = G_QUEUE_INIT;
+static GSList *s_prefetch_loading;
+static guint s_prefetch_source;
+
+/* Hibernation of idle background tabs */
+#define HIBERNATE_INTERVAL 15
+#define HIBERNATE_MEASURE_DELAY 2
+static guint s_hibernate_source;
+static guint s_hibernate_count;
+static guint64 s_reclaimed;
+static gint64 s_rss_pending;
+static guint s_measure_source;
+
+typedef struct _RestoreState {
+    GList *gl;
+    unsigned int lock;
+    double scroll;
+} RestoreState;
+
 
 /* CALLBACKS */
 static gboolean view_caret_release_cb(WebKitWebView *web, GdkEventButton *e, WebKitDOMRange *other);
@@ -77,10 +118,29 @@ view_main_frame_committed_cb(WebKitWebFrame *frame, GList *gl) {
 }/*}}}*/
 #endif
 
+/* view_filter_resource {{{*/
+/* Checks the filters of the resource signal before the JavaScript engine is
+ * entered, the document of a frame is the request of its provisional data
+ * source */
+static gboolean
+view_filter_resource(WebKitWebView *wv, WebKitWebFrame *frame, WebKitNetworkRequest *request)
+{
+    const char *uri = webkit_network_request_get_uri(request);
+    gboolean document = false;
+    WebKitWebDataSource *ds = webkit_web_frame_get_provisional_data_source(frame);
+    if (ds != NULL)
+    {
+        WebKitNetworkRequest *ds_request = webkit_web_data_source_get_request(ds);
+        document = ds_request != NULL && !g_strcmp0(webkit_network_request_get_uri(ds_request), uri);
+    }
+    return scripts_filter_signal(SCRIPTS_SIG_RESOURCE, uri, frame == webkit_web_view_get_main_frame(wv), document);
+}/*}}}*/
+
 static void 
 view_resource_request_cb(WebKitWebView *wv, WebKitWebFrame *frame, WebKitWebResource *resource, WebKitNetworkRequest *request, WebKitNetworkResponse *response, GList *gl) 
 {
-    if (EMIT_SCRIPT(RESOURCE))  
+    VIEW(gl)->status->stats.resources++;
+    if (EMIT_SCRIPT(RESOURCE) && view_filter_resource(wv, frame, request))  
     {
         /**
          * Emitted before a resource is loaded
@@ -127,6 +187,11 @@ view_resource_request_cb(WebKitWebView *wv, WebKitWebFrame *frame, WebKitWebReso
 }
 #if WEBKIT_CHECK_VERSION(1, 8, 0) 
 static void 
+view_content_length_cb(WebKitWebView *wv, WebKitWebFrame *frame, WebKitWebResource *resource, gint length, GList *gl) 
+{
+    VIEW(gl)->status->stats.resource_bytes += length;
+}
+static void 
 view_document_finished(WebKitWebView *wv, WebKitWebFrame *frame, GList *gl) 
 {
     if (EMIT_SCRIPT(DOCUMENT_LOADED)) 
@@ -150,7 +215,7 @@ view_document_finished(WebKitWebView *wv, WebKitWebFrame *frame, GList *gl)
         ScriptSignal signal = { SCRIPTS_WV(gl), { G_OBJECT(frame) }, SCRIPTS_SIG_META(NULL, DOCUMENT_LOADED, 1) };
         scripts_emit(&signal);
     }
-    IPC_SEND_HOOK(document_finished, "%d %s", g_list_position(dwb.state.views, gl) + 1, 
+    IPC_SEND_TAB_HOOK(document_finished, view_position(gl) + 1, "%s", 
             webkit_web_view_get_main_frame(wv) ? "true" : "false");
 }
 #endif
@@ -631,6 +696,91 @@ view_hovering_over_link_cb(WebKitWebView *web, char *title, char *uri, GList *gl
     }
 }/*}}}*/
 
+/* view_apply_hint_style {{{*/
+/* Passes the current hint style to base.js in the main frame, the style is
+ * passed as a native object instead of parsing json */
+void 
+view_apply_hint_style(GList *gl) 
+{
+    HintStyle *hs = &dwb.misc.hint_style;
+    JSContextRef ctx;
+    JSObjectRef init, style;
+
+    if (VIEW(gl)->web == NULL || VIEW(gl)->js_base == NULL)
+        return;
+    ctx = webkit_web_frame_get_global_context(webkit_web_view_get_main_frame(WEBVIEW(gl)));
+    if ((init = js_get_object_property(ctx, VIEW(gl)->js_base, "init")) == NULL)
+        return;
+
+    style = JSObjectMake(ctx, NULL, NULL);
+    js_set_object_property(ctx, style, "hintLetterSeq", hs->letter_seq, NULL);
+    js_set_object_property(ctx, style, "hintFont", hs->font, NULL);
+    js_set_object_property(ctx, style, "hintStyle", hs->style, NULL);
+    js_set_object_property(ctx, style, "hintFgColor", hs->fg_color, NULL);
+    js_set_object_property(ctx, style, "hintBgColor", hs->bg_color, NULL);
+    js_set_object_property(ctx, style, "hintActiveColor", hs->active_color, NULL);
+    js_set_object_property(ctx, style, "hintNormalColor", hs->normal_color, NULL);
+    js_set_object_property(ctx, style, "hintBorder", hs->border, NULL);
+    js_set_object_number_property(ctx, style, "hintOffsetTop", hs->offset_top, NULL);
+    js_set_object_number_property(ctx, style, "hintOffsetLeft", hs->offset_left, NULL);
+    js_set_object_number_property(ctx, style, "hintOpacity", hs->opacity, NULL);
+    js_set_property(ctx, style, "hintHighlighLinks", JSValueMakeBoolean(ctx, hs->highlight_links), kJSPropertyAttributeNone, NULL);
+    js_set_property(ctx, style, "hintAutoFollow", JSValueMakeBoolean(ctx, hs->autofollow), kJSPropertyAttributeNone, NULL);
+
+    JSValueRef argv[] = { style };
+    JSObjectCallAsFunction(ctx, init, NULL, 1, argv, NULL);
+}/*}}}*/
+
+/* view_init_js_base {{{*/
+/* Evaluates base.js in the main frame and initializes it with the hint style */
+static void 
+view_init_js_base(GList *gl, WebKitWebView *web) 
+{
+    static JSStringRef sourceurl;
+    gint64 start = g_get_monotonic_time();
+
+    if (sourceurl == NULL)
+        sourceurl = JSStringCreateWithUTF8CString(BASE_SCRIPT);
+
+    memset(VIEW(gl)->js_base_functions, 0, sizeof(VIEW(gl)->js_base_functions));
+    VIEW(gl)->js_base = js_create_object_from_string(webkit_web_view_get_main_frame(web), dwb.misc.hints, sourceurl);
+    view_apply_hint_style(gl);
+
+    VIEW(gl)->status->stats.base_time += g_get_monotonic_time() - start;
+}/*}}}*/
+
+/* view_call_base {{{*/
+/* Calls a function of base.js in the main frame, the function objects are
+ * cached until a new document is created. Returns the return value of the
+ * function or NULL if base.js isn't available */
+JSValueRef 
+view_call_base(GList *gl, BaseFunction function, size_t argc, const JSValueRef argv[]) 
+{
+    static const char *names[BASE_LAST] = {
+        [BASE_SHOW_HINTS]       = "showHints", 
+        [BASE_UPDATE_HINTS]     = "updateHints", 
+        [BASE_FOLLOW_ACTIVE]    = "followActive", 
+        [BASE_FOCUS_NEXT]       = "focusNext", 
+        [BASE_FOCUS_PREV]       = "focusPrev", 
+        [BASE_FOLLOW]           = "follow", 
+        [BASE_CLEAR]            = "clear", 
+    };
+    View *v = VIEW(gl);
+    JSContextRef ctx;
+
+    if (v->js_base == NULL)
+        return NULL;
+
+    ctx = JS_CONTEXT_REF(gl);
+    if (v->js_base_functions[function] == NULL)
+    {
+        v->js_base_functions[function] = js_get_object_property(ctx, v->js_base, names[function]);
+        if (v->js_base_functions[function] == NULL)
+            return NULL;
+    }
+    return JSObjectCallAsFunction(ctx, v->js_base_functions[function], NULL, argc, argv, NULL);
+}/*}}}*/
+
 
 /* view_mime_type_policy_cb {{{*/
 static gboolean 
@@ -683,8 +833,7 @@ view_mime_type_policy_cb(WebKitWebView *web, WebKitWebFrame *frame, WebKitNetwor
         dwb.state.mimetype_request = g_strdup(mimetype);
         if (VIEW(gl)->js_base == NULL) 
         {
-            VIEW(gl)->js_base = js_create_object(webkit_web_view_get_main_frame(web), dwb.misc.hints);
-            js_call_as_function(webkit_web_view_get_main_frame(web), VIEW(gl)->js_base, "init", dwb.misc.hint_style, kJSTypeObject, NULL);
+            view_init_js_base(gl, web);
         }
         webkit_web_policy_decision_download(policy);
         return true;
@@ -704,13 +853,14 @@ view_navigation_policy_cb(WebKitWebView *web, WebKitWebFrame *frame, WebKitNetwo
     gint button = webkit_web_navigation_action_get_button(action);
     VIEW(gl)->status->reason = reason;
 
-    IPC_SEND_HOOK(navigation, "%d %s %s", g_list_position(dwb.state.views, gl) + 1, 
+    IPC_SEND_TAB_HOOK(navigation, view_position(gl) + 1, "%s %s", 
                             frame == webkit_web_view_get_main_frame(web) ? "true" : "false", 
                             uri);
 
     /* Ignore button 2 which opens in a new tab and new windows, otherwise the
      * signal will be emitted twice */
-    if (EMIT_SCRIPT(NAVIGATION) && button != 2 && !(dwb.state.nv & OPEN_NEW_WINDOW)) 
+    if (EMIT_SCRIPT(NAVIGATION) && button != 2 && !(dwb.state.nv & OPEN_NEW_WINDOW) 
+            && scripts_filter_signal(SCRIPTS_SIG_NAVIGATION, uri, frame == webkit_web_view_get_main_frame(web), true)) 
     {
         /**
          * Emitted before a new site or a new frame is loaded
@@ -904,6 +1054,7 @@ view_navigation_policy_cb(WebKitWebView *web, WebKitWebFrame *frame, WebKitNetwo
         {
             JSValueUnprotect(JS_CONTEXT_REF(gl), VIEW(gl)->js_base);
             VIEW(gl)->js_base = NULL;
+            memset(VIEW(gl)->js_base_functions, 0, sizeof(VIEW(gl)->js_base_functions));
         }
     }
     if (!ret && gl == dwb.state.fview)
@@ -1013,27 +1164,116 @@ view_scroll_tab_cb(GtkWidget *w, GdkEventScroll *e, GList *gl)
     {
         if (e->direction == GDK_SCROLL_DOWN)
         {
-            pos = util_modulo(g_list_position(dwb.state.views, dwb.state.fview) + 1, g_list_length(dwb.state.views));
+            pos = util_modulo(view_position(dwb.state.fview) + 1, view_count());
             event = "focus_next";
         }
         else if (e->direction == GDK_SCROLL_UP)
         {
-            pos = util_modulo(g_list_position(dwb.state.views, dwb.state.fview) - 1, g_list_length(dwb.state.views));
+            pos = util_modulo(view_position(dwb.state.fview) - 1, view_count());
             event = "focus_prev";
         }
         if (pos != -1)
         {
-            dwb_focus_view(g_list_nth(dwb.state.views, pos), event);
+            dwb_focus_view(view_nth(pos), event);
         }
     }
     return false;
 }/*}}}*/
 
+/* view_update_flush {{{*/
+static void 
+view_update_flush(GList *gl) 
+{
+    ViewStatus *status = VIEW(gl)->status;
+    unsigned int dirty = status->dirty;
+
+    if (dirty == 0)
+        return;
+    status->dirty = 0;
+    s_dirty_views--;
+
+    if (dirty & VIEW_UPDATE_STATUS) 
+        dwb_update_status(gl, NULL);
+    else if (dirty & VIEW_UPDATE_STATUS_TEXT) 
+        dwb_update_status_text(gl, NULL);
+    if (dirty & VIEW_UPDATE_URI) 
+        dwb_update_uri(gl, true);
+}/*}}}*/
+
+/* view_update_background {{{*/
+static gboolean 
+view_update_background(void) 
+{
+    for (GList *gl = dwb.state.views; gl && s_dirty_views > 0; gl=gl->next) 
+        view_update_flush(gl);
+    s_update_background_source = 0;
+    return false;
+}/*}}}*/
+
+/* view_update_frame {{{*/
+static gboolean 
+view_update_frame(void) 
+{
+    if (dwb.state.fview != NULL)
+        view_update_flush(dwb.state.fview);
+    /* the focus changed before the update was flushed */
+    if (s_dirty_views > 0 && s_update_background_source == 0)
+        s_update_background_source = g_timeout_add(UPDATE_BACKGROUND_INTERVAL, (GSourceFunc)view_update_background, NULL);
+    s_update_frame_source = 0;
+    return false;
+}/*}}}*/
+
+/* view_queue_update {{{*/
+/* 
+ * Marks parts of the status bar or the tab label as dirty, the focused tab is
+ * updated at most once per frame, labels of background tabs at a lower rate
+ * */
+static void 
+view_queue_update(GList *gl, unsigned int flags) 
+{
+    ViewStatus *status = VIEW(gl)->status;
+
+    /* Only the label of a background tab is visible */
+    if (gl != dwb.state.fview) 
+    {
+        flags &= VIEW_UPDATE_STATUS;
+        if (flags == 0)
+            return;
+    }
+    if ((status->dirty & flags) == flags) 
+    {
+        s_updates_skipped++;
+        return;
+    }
+    if (status->dirty == 0)
+        s_dirty_views++;
+    status->dirty |= flags;
+
+    if (gl == dwb.state.fview) 
+    {
+        if (s_update_frame_source == 0)
+            s_update_frame_source = g_timeout_add(UPDATE_FRAME_INTERVAL, (GSourceFunc)view_update_frame, NULL);
+    }
+    else if (s_update_background_source == 0) 
+        s_update_background_source = g_timeout_add(UPDATE_BACKGROUND_INTERVAL, (GSourceFunc)view_update_background, NULL);
+}/*}}}*/
+
+/* view_get_skipped_updates {{{*/
+/* 
+ * Number of status bar and tab label updates that were coalesced with an
+ * update that was already pending
+ * */
+guint64 
+view_get_skipped_updates(void) 
+{
+    return s_updates_skipped;
+}/*}}}*/
+
 /* view_value_changed_cb(GtkAdjustment *a, GList *gl) {{{ */
 static gboolean
 view_value_changed_cb(GtkAdjustment *a, GList *gl) 
 {
-    dwb_update_status_text(gl, a);
+    view_queue_update(gl, VIEW_UPDATE_STATUS_TEXT);
     return false;
 }/* }}} */
 #if WEBKIT_CHECK_VERSION(1, 10, 0)
@@ -1061,14 +1301,14 @@ view_icon_loaded(WebKitWebView *web, char *icon_uri, GList *gl)
 static void 
 view_title_cb(WebKitWebView *web, GParamSpec *pspec, GList *gl) 
 {
-    dwb_update_status(gl, NULL);
+    view_queue_update(gl, VIEW_UPDATE_STATUS);
 }/*}}}*/
 
 /* view_title_cb {{{*/
 static void 
 view_uri_cb(WebKitWebView *web, GParamSpec *pspec, GList *gl) 
 {
-    dwb_update_uri(gl, true);
+    view_queue_update(gl, VIEW_UPDATE_URI);
 }/*}}}*/
 
 /* view_progress_cb {{{*/
@@ -1080,7 +1320,7 @@ view_progress_cb(WebKitWebView *web, GParamSpec *pspec, GList *gl)
     if (v->status->progress == 100) 
         v->status->progress = 0;
     
-    dwb_update_status(gl, NULL);
+    view_queue_update(gl, VIEW_UPDATE_STATUS);
 }/*}}}*/
 
 /* view_popup_activate_cb {{{*/
@@ -1160,8 +1400,7 @@ view_load_status_after_cb(WebKitWebView *web, GParamSpec *pspec, GList *gl)
     WebKitLoadStatus status = webkit_web_view_get_load_status(web);
     if (status == WEBKIT_LOAD_COMMITTED) 
     {
-        VIEW(gl)->js_base = js_create_object(webkit_web_view_get_main_frame(web), dwb.misc.hints);
-        js_call_as_function(webkit_web_view_get_main_frame(web), VIEW(gl)->js_base, "init", dwb.misc.hint_style, kJSTypeObject, NULL);
+        view_init_js_base(gl, web);
     }
 }/*}}}*/
 /* view_load_status_cb {{{*/
@@ -1181,6 +1420,7 @@ view_load_status_cb(WebKitWebView *web, GParamSpec *pspec, GList *gl)
             dwb_clean_load_begin(gl);
             g_slist_free_full(v->status->frames, (GDestroyNotify)util_free_weak_ref);
             v->status->frames = NULL;
+            memset(&v->status->stats, 0, sizeof(ViewStats));
 
             WebKitWebFrame *main_frame = webkit_web_view_get_main_frame(web);
             v->status->frames = g_slist_prepend(v->status->frames, util_get_weak_ref(G_OBJECT(main_frame)));
@@ -1217,7 +1457,7 @@ view_load_status_cb(WebKitWebView *web, GParamSpec *pspec, GList *gl)
             {
                 plugins_disconnect(gl);
             }
-            IPC_SEND_HOOK(load_committed, "%d %s", g_list_position(dwb.state.views, dwb.state.fview) + 1, uri);
+            IPC_SEND_TAB_HOOK(load_committed, view_position(gl) + 1, "%s", uri);
             /**
              * Emitted when the load has just been commited, no data has been loaded
              * when this signal is emitted. This is the preferred signal for
@@ -1256,7 +1496,7 @@ view_load_status_cb(WebKitWebView *web, GParamSpec *pspec, GList *gl)
             if (dwb.state.auto_insert_mode) 
                 dwb_check_auto_insert(gl);
 
-            IPC_SEND_HOOK(load_finished, "%d %s", g_list_position(dwb.state.views, dwb.state.fview) + 1, uri);
+            IPC_SEND_TAB_HOOK(load_finished, view_position(gl) + 1, "%s", uri);
             /**
              * Emitted when the site has completely loaded.
              *
@@ -1505,7 +1745,7 @@ view_set_favicon(GList *gl, gboolean web)
     if ( (old = gtk_image_get_pixbuf(GTK_IMAGE(VIEW(gl)->tabicon))) ) 
         g_object_unref(old);
 
-    if (web) 
+    if (web && VIEW(gl)->web != NULL) 
     {
         pb = webkit_web_view_get_icon_pixbuf(WEBVIEW(gl));
         if (pb) 
@@ -1538,7 +1778,7 @@ view_set_active_style(GList *gl)
 void 
 view_set_normal_style(GList *gl) 
 {
-    if (g_list_position(dwb.state.views, gl) % 2 == 0)
+    if (view_position(gl) % 2 == 0)
         view_modify_style(gl, &dwb.color.tab_normal_fg1, &dwb.color.tab_normal_bg1, dwb.font.fd_inactive);
     else
         view_modify_style(gl, &dwb.color.tab_normal_fg2, &dwb.color.tab_normal_bg2, dwb.font.fd_inactive);
@@ -1614,12 +1854,11 @@ view_key_ignore_cb(WebKitWebView *wv, GdkEventKey *e, GList *gl)
     return !(dwb.state.mode & INSERT_MODE);
 }
 
-/* view_init_signals(View *v) {{{*/
+/* view_init_web_signals(GList *gl) {{{*/
 static void
-view_init_signals(GList *gl) 
+view_init_web_signals(GList *gl) 
 {
     View *v = gl->data;
-    GtkAdjustment *a = gtk_scrolled_window_get_vadjustment(GTK_SCROLLED_WINDOW(v->scroll));
     g_signal_connect(v->web, "key-press-event", G_CALLBACK(view_key_ignore_cb), gl);
     g_signal_connect(v->web, "key-release-event", G_CALLBACK(view_key_ignore_cb), gl);
     v->status->signals[SIG_BUTTON_PRESS]          = g_signal_connect(v->web, "button-press-event",                    G_CALLBACK(view_button_press_cb), gl);
@@ -1635,6 +1874,7 @@ view_init_signals(GList *gl)
     v->status->signals[SIG_RESOURCE_REQUEST]      = g_signal_connect(v->web, "resource-request-starting",             G_CALLBACK(view_resource_request_cb), gl);
 #if WEBKIT_CHECK_VERSION(1, 8, 0)
     v->status->signals[SIG_DOCUMENT_FINISHED]     = g_signal_connect(v->web, "document-load-finished",             G_CALLBACK(view_document_finished), gl);
+    v->status->signals[SIG_CONTENT_LENGTH]        = g_signal_connect(v->web, "resource-content-length-received",   G_CALLBACK(view_content_length_cb), gl);
 #endif
     v->status->signals[SIG_CREATE_PLUGIN_WIDGET]  = g_signal_connect(v->web, "create-plugin-widget",                  G_CALLBACK(view_create_plugin_widget_cb), gl);
     v->status->signals[SIG_FRAME_CREATED]         = g_signal_connect(v->web, "frame-created",                         G_CALLBACK(view_frame_created_cb), gl);
@@ -1647,18 +1887,15 @@ view_init_signals(GList *gl)
     v->status->signals[SIG_TITLE]                 = g_signal_connect(v->web, "notify::title",                         G_CALLBACK(view_title_cb), gl);
     v->status->signals[SIG_URI]                   = g_signal_connect(v->web, "notify::uri",                           G_CALLBACK(view_uri_cb), gl);
     v->status->signals[SIG_SCROLL]                = g_signal_connect(v->web, "scroll-event",                          G_CALLBACK(view_scroll_cb), gl);
-    v->status->signals[SIG_SCROLL_TAB]            = g_signal_connect(v->tabevent, "scroll-event",                          G_CALLBACK(view_scroll_tab_cb), gl);
 #if WEBKIT_CHECK_VERSION(1, 10, 0) 
     v->status->signals[SIG_RUN_FILE_CHOOSER]      = g_signal_connect(v->web,      "run-file-chooser",                         G_CALLBACK(view_run_file_chooser_cb), gl);
 #endif
-    v->status->signals[SIG_VALUE_CHANGED]         = g_signal_connect(a,      "value-changed",                         G_CALLBACK(view_value_changed_cb), gl);
     if (GET_BOOL("enable-favicon")) 
         v->status->signals[SIG_ICON_LOADED]           = g_signal_connect(v->web, "icon-loaded",                           G_CALLBACK(view_icon_loaded), gl);
 
     /* v->status->signals[SIG_ENTRY_ACTIVATE]        = g_signal_connect(v->entry, "activate",                            G_CALLBACK(view_entry_activate_cb), gl); */
 
     v->status->signals[SIG_MOTION_NOTIFY] = g_signal_connect(v->web, "motion-notify-event", G_CALLBACK(view_motion_notify_cb), gl);
-    v->status->signals[SIG_TAB_BUTTON_PRESS]      = g_signal_connect(v->tabevent, "button-press-event",               G_CALLBACK(view_tab_button_press_cb), gl);
     //WebKitWebFrame *frame = webkit_web_view_get_main_frame(WEBKIT_WEB_VIEW(v->web));
     //v->status->signals[SIG_MAIN_FRAME_COMMITTED]  = g_signal_connect(frame, "load-committed", G_CALLBACK(view_main_frame_committed_cb), gl);
 
@@ -1667,6 +1904,21 @@ view_init_signals(GList *gl)
     g_signal_connect(inspector, "inspect-web-view", G_CALLBACK(view_inspect_web_view_cb), gl);
 } /*}}}*/
 
+/* view_init_signals(GList *gl) {{{*/
+/* 
+ * Signals of the tab widgets, they are connected once, placeholder tabs don't
+ * have a webview 
+ * */
+static void
+view_init_signals(GList *gl) 
+{
+    View *v = gl->data;
+    GtkAdjustment *a = gtk_scrolled_window_get_vadjustment(GTK_SCROLLED_WINDOW(v->scroll));
+    v->status->signals[SIG_SCROLL_TAB]            = g_signal_connect(v->tabevent, "scroll-event",                          G_CALLBACK(view_scroll_tab_cb), gl);
+    v->status->signals[SIG_VALUE_CHANGED]         = g_signal_connect(a,      "value-changed",                         G_CALLBACK(view_value_changed_cb), gl);
+    v->status->signals[SIG_TAB_BUTTON_PRESS]      = g_signal_connect(v->tabevent, "button-press-event",               G_CALLBACK(view_tab_button_press_cb), gl);
+} /*}}}*/
+
 /* view_create_web_view(View *v)         return: GList * {{{*/
 static View * 
 view_create_web_view() 
@@ -1689,28 +1941,31 @@ view_create_web_view()
     status->group = 0;
     status->deferred = GET_BOOL("load-on-focus");
     status->deferred_uri = NULL;
+    status->placeholder = NULL;
+    status->last_active = g_get_monotonic_time();
+    status->position = -1;
+    status->dirty = 0;
 
     v->js_base = NULL;
+    memset(v->js_base_functions, 0, sizeof(v->js_base_functions));
     v->inspector_window = NULL;
     v->plugins = plugins_new();
     for (int i=0; i<SIG_LAST; i++) 
         status->signals[i] = 0;
     v->status = status;
+    v->settings = NULL;
+    v->script_wv = NULL;
     CLEAR_MARKS(v);
 
-    v->web = webkit_web_view_new();
+    /* The webview is created by view_init_web_view */
+    v->web = NULL;
 
     /* Srolling */
     v->scroll = gtk_scrolled_window_new(NULL, NULL);
-    gtk_container_add(GTK_CONTAINER(v->scroll), v->web);
 
 #if !_HAS_GTK3
     if (! GET_BOOL("scrollbars")) 
-    {
-        WebKitWebFrame *frame = webkit_web_view_get_main_frame(WEBKIT_WEB_VIEW(v->web));
-        g_signal_connect(frame, "scrollbars-policy-changed", G_CALLBACK(gtk_true), NULL);
         gtk_scrolled_window_set_policy(GTK_SCROLLED_WINDOW(v->scroll), GTK_POLICY_NEVER, GTK_POLICY_NEVER);
-    }
 #endif
 
 
@@ -1756,30 +2011,683 @@ view_create_web_view()
     return v;
 } /*}}}*/
 
+/* view_init_web_view(GList *gl) {{{*/
+/* 
+ * Creates the webview of a tab, new tabs get their webview immediately,
+ * placeholder tabs when they are materialized
+ * */
+static void
+view_init_web_view(GList *gl) 
+{
+    View *v = VIEW(gl);
+
+    v->web = webkit_web_view_new();
+    gtk_container_add(GTK_CONTAINER(v->scroll), v->web);
+#if !_HAS_GTK3
+    if (! GET_BOOL("scrollbars")) 
+    {
+        WebKitWebFrame *frame = webkit_web_view_get_main_frame(WEBKIT_WEB_VIEW(v->web));
+        g_signal_connect(frame, "scrollbars-policy-changed", G_CALLBACK(gtk_true), NULL);
+    }
+#endif
+    gtk_widget_show(v->web);
+
+    view_init_web_signals(gl);
+    view_init_settings(gl);
+    if (GET_BOOL("adblocker"))
+        adblock_connect(gl);
+    scripts_attach_tab(gl);
+} /*}}}*/
+
+/* view_destroy_web_view(GList *gl) {{{*/
+/* 
+ * Destroys the webview of a tab, the tab widgets and the script object of the
+ * tab are kept
+ * */
+static void
+view_destroy_web_view(GList *gl) 
+{
+    View *v = VIEW(gl);
+
+    if (v->web == NULL)
+        return;
+
+    if (v->js_base)
+    {
+        JSValueUnprotect(JS_CONTEXT_REF(v->web), v->js_base);
+        v->js_base = NULL;
+    }
+    memset(v->js_base_functions, 0, sizeof(v->js_base_functions));
+
+    /* Inspector */
+    if (v->inspector_window != NULL) 
+    {
+        gtk_widget_destroy(v->inspector_window);
+        v->inspector_window = NULL;
+    }
+
+    /* Adblock styles belong to the document */
+    if (v->status->exc_style) 
+    {
+        g_object_unref(v->status->exc_style);
+        v->status->exc_style = NULL;
+    }
+    g_slist_free_full(v->status->styles, g_object_unref);
+    v->status->styles = NULL;
+    g_slist_free_full(v->status->frames, (GDestroyNotify)util_free_weak_ref);
+    v->status->frames = NULL;
+    /* Blocked plugins belong to the document */
+    plugins_free(v->plugins);
+    v->plugins = plugins_new();
+    g_slist_free(v->status->allowed_plugins);
+    v->status->allowed_plugins = NULL;
+    /* A materialized tab gets the current global settings again */
+    if (v->settings != NULL) 
+    {
+        g_object_unref(v->settings);
+        v->settings = NULL;
+    }
+
+    scripts_detach_tab(gl);
+
+    gtk_widget_destroy(v->web);
+    v->web = NULL;
+
+    /* All handlers but the handlers of the tab widgets are gone */
+    for (int i=0; i<SIG_LAST; i++) 
+    {
+        if (i != SIG_SCROLL_TAB && i != SIG_VALUE_CHANGED && i != SIG_TAB_BUTTON_PRESS)
+            v->status->signals[i] = 0;
+    }
+} /*}}}*/
+
+/* view_index_update {{{*/
+/* 
+ * Updates the tab index from position from on, has to be called whenever tabs
+ * are inserted into, moved in or removed from dwb.state.views. Tabs before from
+ * must not have been changed.
+ * */
+void
+view_index_update(int from) 
+{
+    GList *gl;
+    int i = MAX(from, 0);
+
+    if (s_tabs == NULL)
+        s_tabs = g_ptr_array_new();
+
+    if (i > 0 && i <= (int)s_tabs->len) 
+        gl = ((GList *)g_ptr_array_index(s_tabs, i-1))->next;
+    else 
+    {
+        i = 0;
+        gl = dwb.state.views;
+    }
+    for (; gl; gl=gl->next, i++) 
+    {
+        VIEW(gl)->status->position = i;
+        if (i < (int)s_tabs->len)
+            s_tabs->pdata[i] = gl;
+        else 
+            g_ptr_array_add(s_tabs, gl);
+    }
+    g_ptr_array_set_size(s_tabs, i);
+}/*}}}*/
+
+/* view_position {{{*/
+/* 
+ * Position of a tab in dwb.state.views, -1 if gl is NULL
+ * */
+int
+view_position(GList *gl) 
+{
+    return gl != NULL ? VIEW(gl)->status->position : -1;
+}/*}}}*/
+
+/* view_nth {{{*/
+/* 
+ * The nth tab or NULL if n is out of range
+ * */
+GList *
+view_nth(int n) 
+{
+    if (s_tabs == NULL || n < 0 || n >= (int)s_tabs->len)
+        return NULL;
+    return g_ptr_array_index(s_tabs, n);
+}/*}}}*/
+
+/* view_count {{{*/
+int
+view_count(void) 
+{
+    return s_tabs != NULL ? (int)s_tabs->len : 0;
+}/*}}}*/
+
+/* view_placeholder_free {{{*/
+static void
+view_placeholder_free(TabHistory *th) 
+{
+    if (th == NULL)
+        return;
+    dwb_free_list(th->items, (void_func)dwb_navigation_free);
+    g_free(th);
+}/*}}}*/
+
 /* view_clear_tab {{{*/
 void 
 view_clear_tab(GList *gl) 
 {
+    View *v = VIEW(gl);
+    /* The saved history of a placeholder is dropped without loading it */
+    if (VIEW_PLACEHOLDER(v)) 
+    {
+        view_placeholder_free(v->status->placeholder);
+        v->status->placeholder = NULL;
+        g_queue_remove(&s_prefetch_queue, gl);
+        view_init_web_view(gl);
+    }
     WebKitWebBackForwardList *bf_list = webkit_web_view_get_back_forward_list(WEBVIEW(gl));
     webkit_web_back_forward_list_clear(bf_list);
     dwb_load_uri(gl, "about:blank");
 }/*}}}*/
 
+/* view_clear_history {{{*/
+/* 
+ * Clears the back/forward list of a tab, a placeholder only keeps its current
+ * item 
+ * */
+void 
+view_clear_history(GList *gl) 
+{
+    TabHistory *th = VIEW(gl)->status->placeholder;
+    if (th != NULL) 
+    {
+        GList *current = g_list_nth(th->items, th->current);
+        th->items = g_list_remove_link(th->items, current);
+        dwb_free_list(th->items, (void_func)dwb_navigation_free);
+        th->items = current;
+        th->current = 0;
+    }
+    else 
+        webkit_web_back_forward_list_clear(webkit_web_view_get_back_forward_list(WEBVIEW(gl)));
+}/*}}}*/
+
+/* view_restore_state_cb {{{*/
+static void
+view_restore_state_cb(WebKitWebView *wv, GParamSpec *p, RestoreState *rs) 
+{
+    switch (webkit_web_view_get_load_status(wv)) 
+    {
+        case WEBKIT_LOAD_FINISHED:  if (rs->lock > 0) 
+                                    {
+                                        VIEW(rs->gl)->status->lockprotect = rs->lock;
+                                        dwb_tab_label_set_text(rs->gl, NULL);
+                                    }
+                                    if (rs->scroll > 0) 
+                                    {
+                                        GtkAdjustment *adj = gtk_scrolled_window_get_vadjustment(GTK_SCROLLED_WINDOW(VIEW(rs->gl)->scroll));
+                                        gtk_adjustment_set_value(adj, MIN(rs->scroll, gtk_adjustment_get_upper(adj) - gtk_adjustment_get_page_size(adj)));
+                                    }
+        case WEBKIT_LOAD_FAILED:    g_signal_handlers_disconnect_by_func(wv, (GFunc)view_restore_state_cb, rs);
+                                    break;
+        default: break;
+    }
+}/*}}}*/
+
+/* view_materialize {{{*/
+/* 
+ * Creates the webview of a placeholder tab, replays the saved history and
+ * starts loading the current item, returns false if the tab isn't a
+ * placeholder
+ * */
+gboolean
+view_materialize(GList *gl) 
+{
+    View *v = VIEW(gl);
+    TabHistory *th = v->status->placeholder;
+    WebKitWebHistoryItem *item, *current = NULL;
+    int i = 0;
+
+    if (th == NULL)
+        return false;
+
+    v->status->placeholder = NULL;
+    /* an explicit prefetch overrides load-on-focus */
+    v->status->deferred = false;
+    g_queue_remove(&s_prefetch_queue, gl);
+
+    view_init_web_view(gl);
+
+    WebKitWebBackForwardList *bf_list = webkit_web_view_get_back_forward_list(WEBVIEW(gl));
+    for (GList *l = th->items; l; l=l->next, i++) 
+    {
+        Navigation *n = l->data;
+        item = webkit_web_history_item_new_with_data(n->first, n->second);
+        webkit_web_back_forward_list_add_item(bf_list, item);
+        if (i == th->current)
+            current = item;
+    }
+    /* Locking is applied after the first load, otherwise the locked tab would
+     * block its own history */
+    if (th->lockprotect > 0 || th->scroll > 0) 
+    {
+        RestoreState *rs = dwb_malloc(sizeof(RestoreState));
+        rs->gl = gl;
+        rs->lock = th->lockprotect;
+        rs->scroll = th->scroll;
+        g_signal_connect_data(WEBVIEW(gl), "notify::load-status", G_CALLBACK(view_restore_state_cb), rs, (GClosureNotify)g_free, 0);
+    }
+    if (current != NULL)
+        webkit_web_view_go_to_back_forward_item(WEBVIEW(gl), current);
+
+    view_placeholder_free(th);
+    return true;
+}/*}}}*/
+
+/* view_prefetch_status_cb {{{*/
+static void
+view_prefetch_status_cb(WebKitWebView *wv, GParamSpec *p, GList *gl) 
+{
+    WebKitLoadStatus status = webkit_web_view_get_load_status(wv);
+    if (status == WEBKIT_LOAD_FINISHED || status == WEBKIT_LOAD_FAILED) 
+    {
+        g_signal_handlers_disconnect_by_func(wv, (GFunc)view_prefetch_status_cb, gl);
+        s_prefetch_loading = g_slist_remove(s_prefetch_loading, gl);
+        view_prefetch_schedule();
+    }
+}/*}}}*/
+
+/* view_prefetch_next {{{*/
+static gboolean
+view_prefetch_next(void) 
+{
+    int max = GET_INT("session-prefetch-tabs");
+    GList *gl;
+
+    s_prefetch_source = 0;
+    while ((int)g_slist_length(s_prefetch_loading) < max && (gl = g_queue_pop_head(&s_prefetch_queue)) != NULL) 
+    {
+        if (view_materialize(gl)) 
+        {
+            s_prefetch_loading = g_slist_prepend(s_prefetch_loading, gl);
+            g_signal_connect(WEBVIEW(gl), "notify::load-status", G_CALLBACK(view_prefetch_status_cb), gl);
+        }
+    }
+    return false;
+}/*}}}*/
+
+/* view_prefetch_schedule {{{*/
 void
-view_clean(GList *gl) 
+view_prefetch_schedule(void) 
+{
+    if (s_prefetch_source == 0 && !g_queue_is_empty(&s_prefetch_queue))
+        s_prefetch_source = g_idle_add((GSourceFunc)view_prefetch_next, NULL);
+}/*}}}*/
+
+/* view_prefetch {{{*/
+/* 
+ * Queues a placeholder tab for background loading, at most
+ * session-prefetch-tabs tabs are loaded concurrently
+ * */
+void
+view_prefetch(GList *gl) 
+{
+    if (VIEW_PLACEHOLDER(VIEW(gl)) && g_queue_find(&s_prefetch_queue, gl) == NULL) 
+    {
+        g_queue_push_tail(&s_prefetch_queue, gl);
+        view_prefetch_schedule();
+    }
+}/*}}}*/
+
+/* view_get_title {{{*/
+const char *
+view_get_title(GList *gl) 
 {
     View *v = VIEW(gl);
-    if (v->js_base)
+    if (VIEW_PLACEHOLDER(v)) 
     {
-        JSValueUnprotect(JS_CONTEXT_REF(v->web), v->js_base);
+        Navigation *n = g_list_nth_data(v->status->placeholder->items, v->status->placeholder->current);
+        if (n != NULL)
+            return n->second != NULL && g_strcmp0(n->second, "unknown") ? n->second : n->first;
     }
+    if (v->status->deferred)
+        return v->status->deferred_uri;
+    if (v->web == NULL)
+        return NULL;
+    return webkit_web_view_get_title(WEBVIEW(gl));
+}/*}}}*/
 
-    /* Inspector */
-    if (v->inspector_window != NULL) 
+/* view_get_uri {{{*/
+const char *
+view_get_uri(GList *gl) 
+{
+    View *v = VIEW(gl);
+    if (VIEW_PLACEHOLDER(v)) 
     {
-        gtk_widget_destroy(v->inspector_window);
-        v->inspector_window = NULL;
+        Navigation *n = g_list_nth_data(v->status->placeholder->items, v->status->placeholder->current);
+        if (n != NULL)
+            return n->first;
+    }
+    if (v->status->deferred && v->status->deferred_uri)
+        return v->status->deferred_uri;
+    if (v->web == NULL)
+        return NULL;
+    return webkit_web_view_get_uri(WEBVIEW(gl));
+}/*}}}*/
+
+/* view_hibernate_loading {{{*/
+static gboolean
+view_hibernate_loading(void) 
+{
+    for (GList *gl = dwb.state.views; gl; gl=gl->next) 
+    {
+        if (VIEW(gl)->status->progress != 0)
+            return true;
+    }
+    return false;
+}/*}}}*/
+
+/* view_hibernate_measure {{{*/
+/* 
+ * Adds the decrease of the resident memory since the first hibernation of a
+ * batch to the reclaimed memory, freed heap memory is returned to the system
+ * first. The sample is discarded if a tab started loading in the meantime.
+ * */
+static gboolean
+view_hibernate_measure(void) 
+{
+    gint64 rss;
+#ifdef __GLIBC__
+    malloc_trim(0);
+#endif
+    rss = view_get_rss();
+    if (!view_hibernate_loading() && rss > 0 && rss < s_rss_pending) 
+        s_reclaimed += s_rss_pending - rss;
+    s_rss_pending = 0;
+    s_measure_source = 0;
+    return false;
+}/*}}}*/
+
+/* view_hibernate {{{*/
+/* 
+ * Destroys the webview of an idle background tab, the back/forward list, the
+ * title and the scroll position are kept in a placeholder, the tab is loaded
+ * again when it gets focus. Returns false if the tab cannot be hibernated.
+ * */
+gboolean
+view_hibernate(GList *gl) 
+{
+    View *v = VIEW(gl);
+    WebKitWebView *wv;
+    WebKitLoadStatus status;
+    WebKitWebHistoryItem *item;
+    const char *uri;
+    int back, forward;
+
+    if (gl == dwb.state.fview || VIEW_PLACEHOLDER(v) || v->status->deferred)
+        return false;
+
+    wv = WEBVIEW(gl);
+    status = webkit_web_view_get_load_status(wv);
+    uri = webkit_web_view_get_uri(wv);
+    if ((status != WEBKIT_LOAD_FINISHED && status != WEBKIT_LOAD_FAILED) 
+            || uri == NULL || !g_strcmp0(uri, "about:blank"))
+        return false;
+
+    WebKitWebBackForwardList *bf_list = webkit_web_view_get_back_forward_list(wv);
+    TabHistory *th = dwb_malloc(sizeof(TabHistory));
+    th->items = NULL;
+    th->current = 0;
+    th->lockprotect = v->status->lockprotect;
+    th->scroll = gtk_adjustment_get_value(gtk_scrolled_window_get_vadjustment(GTK_SCROLLED_WINDOW(v->scroll)));
+    th->hibernated = true;
+
+    back = webkit_web_back_forward_list_get_back_length(bf_list);
+    forward = webkit_web_back_forward_list_get_forward_length(bf_list);
+    for (int i=-back; i<=forward; i++) 
+    {
+        item = webkit_web_back_forward_list_get_nth_item(bf_list, i);
+        if (item == NULL) 
+            continue;
+        if (i == 0) 
+            th->current = g_list_length(th->items);
+        th->items = g_list_prepend(th->items, dwb_navigation_new(
+                    webkit_web_history_item_get_uri(item), webkit_web_history_item_get_title(item)));
+    }
+    if (th->items == NULL) 
+    {
+        g_free(th);
+        return false;
+    }
+    th->items = g_list_reverse(th->items);
+
+    /* The lock is restored after the tab has been loaded again, a locked tab
+     * would block its own history */
+    v->status->lockprotect &= ~(LP_LOCK_DOMAIN | LP_LOCK_URI);
+    v->status->placeholder = th;
+    v->status->progress = 0;
+    v->status->ssl = SSL_NONE;
+    memset(&v->status->stats, 0, sizeof(ViewStats));
+    FREE0(v->status->hover_uri);
+    if (v->status->dirty != 0) 
+    {
+        v->status->dirty = 0;
+        s_dirty_views--;
+    }
+
+    /* Only measured if no other tab is loading */
+    if (s_measure_source == 0 && !view_hibernate_loading()) 
+    {
+        s_rss_pending = view_get_rss();
+        if (s_rss_pending > 0)
+            s_measure_source = g_timeout_add_seconds(HIBERNATE_MEASURE_DELAY, (GSourceFunc)view_hibernate_measure, NULL);
+    }
+
+    /* No signals are emitted for the tab until it is materialized */
+    view_destroy_web_view(gl);
+    dwb_tab_label_set_text(gl, NULL);
+    s_hibernate_count++;
+    return true;
+}/*}}}*/
+
+/* view_get_rss {{{*/
+/* 
+ * Resident memory of the process in bytes, 0 if it cannot be determined
+ * */
+gint64 
+view_get_rss(void) 
+{
+    long pages = 0;
+    FILE *f = fopen("/proc/self/statm", "r");
+    if (f == NULL)
+        return 0;
+    if (fscanf(f, "%*d %ld", &pages) != 1)
+        pages = 0;
+    fclose(f);
+    return (gint64)pages * sysconf(_SC_PAGESIZE);
+}/*}}}*/
+
+/* view_get_frame_count {{{*/
+/* 
+ * Number of frames of a tab that are still alive
+ * */
+int
+view_get_frame_count(GList *gl) 
+{
+    int count = 0;
+    for (GSList *l = VIEW(gl)->status->frames; l; l=l->next) 
+    {
+        GObject *frame = g_weak_ref_get(l->data);
+        if (frame != NULL) 
+        {
+            count++;
+            g_object_unref(frame);
+        }
+    }
+    return count;
+}/*}}}*/
+
+/* view_count_elements {{{*/
+static gulong 
+view_count_elements(WebKitDOMDocument *doc) 
+{
+    gulong count = 0;
+    if (doc == NULL)
+        return 0;
+    WebKitDOMNodeList *list = webkit_dom_document_get_elements_by_tag_name(doc, "*");
+    if (list != NULL) 
+    {
+        count = webkit_dom_node_list_get_length(list);
+        g_object_unref(list);
+    }
+    return count;
+}/*}}}*/
+
+/* view_get_dom_node_count {{{*/
+/* 
+ * Number of elements in all frames of a tab
+ * */
+gulong
+view_get_dom_node_count(GList *gl) 
+{
+#if WEBKIT_CHECK_VERSION(1, 10, 0)
+    gulong count = 0;
+    for (GSList *l = VIEW(gl)->status->frames; l; l=l->next) 
+    {
+        WebKitWebFrame *frame = g_weak_ref_get(l->data);
+        if (frame != NULL) 
+        {
+            count += view_count_elements(webkit_web_frame_get_dom_document(frame));
+            g_object_unref(frame);
+        }
+    }
+    return count;
+#else 
+    if (VIEW(gl)->web == NULL)
+        return 0;
+    return view_count_elements(webkit_web_view_get_dom_document(WEBVIEW(gl)));
+#endif
+}/*}}}*/
+
+/* view_hibernate_compare {{{*/
+static int 
+view_hibernate_compare(GList *a, GList *b) 
+{
+    gint64 diff = VIEW(a)->status->last_active - VIEW(b)->status->last_active;
+    return diff < 0 ? -1 : diff > 0 ? 1 : 0;
+}/*}}}*/
+
+/* view_hibernate_check {{{*/
+/* 
+ * Periodically hibernates least recently used tabs that exceed
+ * hibernate-timeout, hibernate-max-tabs or hibernate-memory-limit
+ * */
+static gboolean
+view_hibernate_check(void) 
+{
+    GSList *candidates = NULL;
+    gint64 now = g_get_monotonic_time();
+    gint64 rss = view_get_rss();
+    gint64 limit = (gint64)dwb.misc.hibernate_memory_limit * 1024 * 1024;
+    gboolean memory_exceeded = limit > 0 && rss > limit;
+    int loaded = 0;
+
+    for (GList *gl = dwb.state.views; gl; gl=gl->next) 
+    {
+        if (VIEW_PLACEHOLDER(VIEW(gl)) || VIEW(gl)->status->deferred)
+            continue;
+        loaded++;
+        if (gl != dwb.state.fview)
+            candidates = g_slist_prepend(candidates, gl);
+    }
+    candidates = g_slist_sort(candidates, (GCompareFunc)view_hibernate_compare);
+
+    for (GSList *l = candidates; l; l=l->next) 
+    {
+        GList *gl = l->data;
+        gboolean hibernate = false;
+        if (dwb.misc.hibernate_timeout > 0 && now - VIEW(gl)->status->last_active >= (gint64)dwb.misc.hibernate_timeout * G_USEC_PER_SEC) 
+            hibernate = true;
+        else if (dwb.misc.hibernate_max_tabs > 0 && loaded > dwb.misc.hibernate_max_tabs) 
+            hibernate = true;
+        else if (memory_exceeded) 
+        {
+            /* one tab per interval, until the next measurement */
+            hibernate = true;
+            memory_exceeded = false;
+        }
+        if (hibernate && view_hibernate(gl)) 
+            loaded--;
     }
+    g_slist_free(candidates);
+    return true;
+}/*}}}*/
+
+/* view_hibernate_schedule {{{*/
+/* 
+ * Starts or stops the hibernation timer, called when one of the hibernate
+ * settings changes
+ * */
+void
+view_hibernate_schedule(void) 
+{
+    gboolean enabled = dwb.misc.hibernate_timeout > 0 || dwb.misc.hibernate_max_tabs > 0 || dwb.misc.hibernate_memory_limit > 0;
+    if (enabled && s_hibernate_source == 0)
+        s_hibernate_source = g_timeout_add_seconds(HIBERNATE_INTERVAL, (GSourceFunc)view_hibernate_check, NULL);
+    else if (!enabled && s_hibernate_source != 0) 
+    {
+        g_source_remove(s_hibernate_source);
+        s_hibernate_source = 0;
+    }
+}/*}}}*/
+
+/* view_hibernate_stats {{{*/
+/* 
+ * Number of currently hibernated tabs, total number of hibernations and the
+ * measured memory in bytes that was reclaimed by hibernation
+ * */
+void
+view_hibernate_stats(guint *hibernated, guint *total, guint64 *reclaimed) 
+{
+    if (hibernated != NULL) 
+    {
+        *hibernated = 0;
+        for (GList *gl = dwb.state.views; gl; gl=gl->next) 
+        {
+            if (VIEW_PLACEHOLDER(VIEW(gl)) && VIEW(gl)->status->placeholder->hibernated)
+                (*hibernated)++;
+        }
+    }
+    if (total != NULL)
+        *total = s_hibernate_count;
+    if (reclaimed != NULL)
+        *reclaimed = s_reclaimed;
+}/*}}}*/
+
+void
+view_clean(GList *gl) 
+{
+    View *v = VIEW(gl);
+
+    if (v->status->dirty != 0) 
+    {
+        v->status->dirty = 0;
+        s_dirty_views--;
+    }
+    g_queue_remove(&s_prefetch_queue, gl);
+    if (g_slist_find(s_prefetch_loading, gl) != NULL) 
+    {
+        s_prefetch_loading = g_slist_remove(s_prefetch_loading, gl);
+        view_prefetch_schedule();
+    }
+    view_placeholder_free(v->status->placeholder);
+    v->status->placeholder = NULL;
+
+    scripts_remove_tab(v->script_wv);
+    v->script_wv = NULL;
+
+    /* Destroys the inspector, the adblock styles and the webview */
+    view_destroy_web_view(gl);
 
     /* Favicon */ 
     GdkPixbuf *pb;
@@ -1793,25 +2701,8 @@ view_clean(GList *gl)
 
     plugins_free(v->plugins);
     g_slist_free(v->status->allowed_plugins);
-    g_slist_free_full(v->status->frames, (GDestroyNotify)util_free_weak_ref);
-
-    scripts_remove_tab(v->script_wv);
-    v->script_wv = NULL;
-
 
-    if (v->status->exc_style) 
-        g_object_unref(v->status->exc_style);
-    
-    if (v->status->styles) 
-    {
-        for (GSList *l = v->status->styles; l; l=l->next) 
-            g_object_unref(l->data);
-        g_slist_free(v->status->styles);
-    }
-
-    g_object_unref(v->settings);
     /* Destroy widget */
-    gtk_widget_destroy(v->web);
     gtk_widget_destroy(v->scroll);
 
     FREE0(v->status->deferred_uri);
@@ -1841,7 +2732,7 @@ view_remove(GList *gl)
     }
     if (dwb.state.nummod >= 0) 
     {
-        gl = g_list_nth(dwb.state.views, dwb.state.nummod - 1);
+        gl = view_nth(dwb.state.nummod - 1);
         if (gl == NULL)
             return STATUS_OK;
     }
@@ -1849,7 +2740,7 @@ view_remove(GList *gl)
         gl = dwb.state.fview;
 
     View *v = gl->data;
-    int position = g_list_position(dwb.state.views, gl);
+    int position = view_position(gl);
     /* Check for protected tab */
     if (LP_PROTECTED(v) && !dwb_confirm(dwb.state.fview, "Really close tab %d [y/n]?", position + 1) ) 
     {
@@ -1896,8 +2787,16 @@ view_remove(GList *gl)
     }
 
     /* Get History for the undo list */
-    WebKitWebBackForwardList *bflist = webkit_web_view_get_back_forward_list(WEBKIT_WEB_VIEW(v->web));
-    if ( bflist != NULL ) 
+    WebKitWebBackForwardList *bflist = NULL;
+    if (VIEW_PLACEHOLDER(v)) 
+    {
+        GList *store = NULL;
+        int i = 0;
+        for (GList *l = v->status->placeholder->items; l && i <= v->status->placeholder->current; l=l->next, i++) 
+            store = g_list_append(store, dwb_navigation_dup(l->data));
+        dwb.state.undo_list = g_list_prepend(dwb.state.undo_list, store);
+    }
+    else if ( (bflist = webkit_web_view_get_back_forward_list(WEBKIT_WEB_VIEW(v->web))) != NULL ) 
     {
         GList *store = NULL;
 
@@ -1914,11 +2813,12 @@ view_remove(GList *gl)
     dwb_focus_view(new_fview, "close_tab");
     view_clean(gl);
 
-    IPC_SEND_HOOK(close_tab, "%d", g_list_position(dwb.state.views, gl) + 1);
+    IPC_SEND_TAB_HOOK(close_tab, position + 1, NULL);
 
     dwb_source_remove();
 
     dwb.state.views = g_list_delete_link(dwb.state.views, gl);
+    view_index_update(position);
     if (!dwb.state.views->next && !dwb.misc.show_single_tab)
         gtk_widget_hide(dwb.gui.tabbox);
 
@@ -1954,9 +2854,9 @@ view_ssl_state(GList *gl)
 }/*}}}*/
 
 
-/* view_add(Arg *arg)               return: View *{{{*/
-GList *  
-view_add(const char *uri, gboolean background) 
+/* view_add_tab(const char *uri, gboolean background, TabHistory *th) {{{*/
+static GList *  
+view_add_tab(const char *uri, gboolean background, TabHistory *th) 
 {
     GList *ret = NULL;
 
@@ -1966,24 +2866,26 @@ view_add(const char *uri, gboolean background)
         return NULL;
     }
     View *v = view_create_web_view();
+    /* A placeholder gets its webview when it is materialized */
+    v->status->placeholder = th;
 #if _HAS_GTK3
     gtk_box_pack_end(GTK_BOX(dwb.gui.tabbox), v->tabevent, true, true, 0);
 #else
     gtk_box_pack_end(GTK_BOX(dwb.gui.tabcontainer), v->tabevent, true, true, 0);
 #endif
 
-    int length = g_list_length(dwb.state.views);
+    int length = view_count();
     if (dwb.state.fview) 
     {
         int p;
         if (dwb.misc.tab_position & TAB_POSITION_RIGHTMOST) 
             p = length;
         else if (dwb.misc.tab_position & TAB_POSITION_LEFT) 
-            p = g_list_position(dwb.state.views, dwb.state.fview);
+            p = view_position(dwb.state.fview);
         else if (dwb.misc.tab_position & TAB_POSITION_LEFTMOST) 
             p = 0;
         else 
-            p = g_list_position(dwb.state.views, dwb.state.fview) + 1;
+            p = view_position(dwb.state.fview) + 1;
 
 #if _HAS_GTK3
         gtk_box_reorder_child(GTK_BOX(dwb.gui.tabbox), v->tabevent, length - p);
@@ -1991,8 +2893,13 @@ view_add(const char *uri, gboolean background)
         gtk_box_reorder_child(GTK_BOX(dwb.gui.tabcontainer), v->tabevent, length - p);
 #endif
         gtk_box_insert(GTK_BOX(dwb.gui.mainbox), v->scroll, true, true, 0, p, GTK_PACK_START);
-        dwb.state.views = g_list_insert(dwb.state.views, v, p);
-        ret = g_list_nth(dwb.state.views, p);
+        GList *sibling = view_nth(p);
+        dwb.state.views = g_list_insert_before(dwb.state.views, sibling, v);
+        ret = sibling != NULL ? sibling->prev : g_list_last(dwb.state.views);
+        view_index_update(p);
+        view_init_signals(ret);
+        if (th == NULL)
+            view_init_web_view(ret);
         scripts_create_tab(ret);
 
         if (background) 
@@ -2010,6 +2917,10 @@ view_add(const char *uri, gboolean background)
         gtk_box_pack_start(GTK_BOX(dwb.gui.mainbox), v->scroll, true, true, 0);
         dwb.state.views = g_list_prepend(dwb.state.views, v);
         ret = dwb.state.views;
+        view_index_update(0);
+        view_init_signals(ret);
+        if (th == NULL)
+            view_init_web_view(ret);
         scripts_create_tab(ret);
         dwb_focus(ret);
     }
@@ -2027,7 +2938,7 @@ view_add(const char *uri, gboolean background)
 #endif
         }
     }
-    IPC_SEND_HOOK(new_tab, "%d %s", g_list_position(dwb.state.views, ret) + 1, uri ? uri : "");
+    IPC_SEND_TAB_HOOK(new_tab, view_position(ret) + 1, "%s", uri ? uri : "");
     if (EMIT_SCRIPT(CREATE_TAB)) 
     {
         /**
@@ -2048,16 +2959,11 @@ view_add(const char *uri, gboolean background)
          *      the startpage will be loaded
          * */
         char *json = util_create_json(1, CHAR, "uri", uri);
-        ScriptSignal signal = { VIEW(ret)->script_wv, SCRIPTS_SIG_META(json, CREATE_TAB, 0) };
+        ScriptSignal signal = { SCRIPTS_WV(ret), SCRIPTS_SIG_META(json, CREATE_TAB, 0) };
         scripts_emit(&signal);
         g_free(json);
     }
 
-    view_init_signals(ret);
-    view_init_settings(ret);
-    if (GET_BOOL("adblocker"))
-        adblock_connect(ret);
-
     dwb_update_layout();
 
     if (uri != NULL) 
@@ -2066,4 +2972,25 @@ view_add(const char *uri, gboolean background)
     return ret;
 } /*}}}*/
 
+/* view_add(const char *uri, gboolean background) {{{*/
+GList *  
+view_add(const char *uri, gboolean background) 
+{
+    return view_add_tab(uri, background, NULL);
+}/*}}}*/
+
+/* view_add_placeholder(TabHistory *th) {{{*/
+/* 
+ * Adds a background tab without a webview, the history is replayed when the
+ * tab gets focus or the prefetch queue reaches it, takes ownership of th 
+ * */
+GList *  
+view_add_placeholder(TabHistory *th) 
+{
+    GList *gl = view_add_tab(NULL, true, th);
+    if (gl == NULL)
+        view_placeholder_free(th);
+    return gl;
+}/*}}}*/
+
 /*}}}*/
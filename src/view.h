@@ -20,6 +20,7 @@
 #define __DWB_VIEW_H__
 
 GList * view_add(const char *uri, gboolean background);
+GList * view_add_placeholder(TabHistory *th);
 DwbStatus view_remove(GList *gl);
 void view_clean(GList *gl);
 DwbStatus view_push_master(Arg *);
@@ -29,6 +30,25 @@ void view_modify_style(GList *, DwbColor *tabfg, DwbColor *tabbg, PangoFontDescr
 void view_icon_loaded(WebKitWebView *web, char *icon_uri, GList *gl);
 void view_set_favicon(GList *gl, gboolean);
 void view_clear_tab(GList *gl);
+void view_clear_history(GList *gl);
+gboolean view_materialize(GList *gl);
+void view_prefetch(GList *gl);
+void view_prefetch_schedule(void);
+const char * view_get_title(GList *gl);
+const char * view_get_uri(GList *gl);
+guint64 view_get_skipped_updates(void);
+void view_index_update(int from);
+int view_position(GList *gl);
+GList * view_nth(int n);
+int view_count(void);
+gboolean view_hibernate(GList *gl);
+void view_hibernate_schedule(void);
+void view_hibernate_stats(guint *hibernated, guint *total, guint64 *reclaimed);
+gint64 view_get_rss(void);
+int view_get_frame_count(GList *gl);
+gulong view_get_dom_node_count(GList *gl);
+JSValueRef view_call_base(GList *gl, BaseFunction function, size_t argc, const JSValueRef argv[]);
+void view_apply_hint_style(GList *gl);
 
 GtkWidget * dwb_web_view_create_plugin_widget_cb(WebKitWebView *, char *, char *, GHashTable *, GList *);
 #endif
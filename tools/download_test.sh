@@ -0,0 +1,136 @@
+#!/bin/sh
+
+# Tests segmented downloads against a local range capable http server. Runs
+# dwb three times: a segmented download, a download from a server without range
+# support and a download that is interrupted by exiting dwb and then resumed.
+# Uses a temporary configuration, needs python3 and a running X server or
+# xvfb-run.
+#
+# Usage: download_test.sh [path to dwb binary]
+
+DWB="${1:-$(dirname "$0")/../dwb}"
+PORT=${PORT:-8766}
+SIZE_MB=24
+
+if [ ! -x "${DWB}" ]; then
+  echo "dwb binary ${DWB} not found, run 'make' first"
+  exit 1
+fi
+DWB="$(cd "$(dirname "${DWB}")" && pwd)/$(basename "${DWB}")"
+
+TESTDIR="$(mktemp -d "${TMPDIR:-/tmp}/download_test.XXXXXX")"
+SERVER_PID=""
+trap '[ -n "${SERVER_PID}" ] && kill ${SERVER_PID}; rm -rf "${TESTDIR}"' EXIT
+
+mkdir -p "${TESTDIR}/config/dwb/userscripts" "${TESTDIR}/cache" "${TESTDIR}/data" "${TESTDIR}/www" "${TESTDIR}/out"
+head -c $((SIZE_MB * 1024 * 1024)) /dev/urandom > "${TESTDIR}/www/data.bin"
+
+cat > "${TESTDIR}/server.py" <<'EOF'
+import http.server, os, re, sys, time
+
+class Handler(http.server.SimpleHTTPRequestHandler):
+    def log_message(self, *args):
+        pass
+
+    def do_GET(self):
+        ranges = not self.path.startswith("/noranges/")
+        slow = self.path.startswith("/slow/")
+        path = os.path.join(self.directory, "data.bin")
+        size = os.path.getsize(path)
+        match = re.match(r"bytes=(\d+)-(\d*)", self.headers.get("Range", "")) if ranges else None
+        if match:
+            start = int(match.group(1))
+            end = int(match.group(2)) if match.group(2) else size - 1
+            self.send_response(206)
+            self.send_header("Content-Range", "bytes %d-%d/%d" % (start, end, size))
+        else:
+            start, end = 0, size - 1
+            self.send_response(200)
+        if ranges:
+            self.send_header("Accept-Ranges", "bytes")
+        self.send_header("Content-Length", str(end - start + 1))
+        self.send_header("Content-Type", "application/octet-stream")
+        self.send_header("Content-Disposition", "attachment; filename=\"data.bin\"")
+        self.send_header("ETag", "\"data-1\"")
+        self.end_headers()
+        with open(path, "rb") as f:
+            f.seek(start)
+            remaining = end - start + 1
+            while remaining > 0:
+                chunk = f.read(min(65536, remaining))
+                try:
+                    self.wfile.write(chunk)
+                except (BrokenPipeError, ConnectionResetError):
+                    return
+                remaining -= len(chunk)
+                if slow:
+                    time.sleep(0.05)
+
+http.server.ThreadingHTTPServer.daemon_threads = True
+server = http.server.ThreadingHTTPServer(("127.0.0.1", int(sys.argv[1])),
+        lambda *a: Handler(*a, directory=sys.argv[2]))
+server.serve_forever()
+EOF
+python3 "${TESTDIR}/server.py" ${PORT} "${TESTDIR}/www" &
+SERVER_PID=$!
+sleep 1
+
+RUN=""
+if [ -z "${DISPLAY}" ]; then
+  if command -v xvfb-run > /dev/null 2>&1; then
+    RUN="xvfb-run -a"
+  else
+    echo "No X server and xvfb-run not found"
+    exit 1
+  fi
+fi
+
+# run_dwb <uri path> <seconds until exit, 0 waits for the download>
+run_dwb() {
+  cat > "${TESTDIR}/config/dwb/userscripts/test.js" <<EOF
+//!javascript
+
+Signal.connect("downloadStatus", function(download, data) {
+    if (data.status == "finished" || data.status == "error" || data.status == "cancelled") {
+        io.out(data.status + " segments=" + data.segments + " resumed=" + data.resumed + 
+                " size=" + data.totalSize);
+        exit();
+    }
+});
+Signal.connect("ready", function() {
+    execute("set download-directory ${TESTDIR}/out");
+    execute("set download-no-confirm true");
+    execute("open http://127.0.0.1:${PORT}/$1/data.bin");
+    if ($2 > 0)
+        timerStart($2 * 1000, function() { exit(); });
+});
+EOF
+  XDG_CONFIG_HOME="${TESTDIR}/config" \
+  XDG_CACHE_HOME="${TESTDIR}/cache" \
+  XDG_DATA_HOME="${TESTDIR}/data" \
+    ${RUN} "${DWB}" -n -S -R 2>/dev/null
+}
+
+check() {
+  if cmp -s "${TESTDIR}/www/data.bin" "${TESTDIR}/out/data.bin"; then
+    echo "pass  $1"
+  else
+    echo "FAIL  $1"
+  fi
+  rm -f "${TESTDIR}/out/"*
+}
+
+run_dwb ranges 0
+check "segmented download"
+
+run_dwb noranges 0
+check "single stream download"
+
+run_dwb slow 2
+if [ -f "${TESTDIR}/out/data.bin.part.state" ]; then
+  echo "pass  state saved after interruption"
+else
+  echo "FAIL  state saved after interruption"
+fi
+run_dwb slow 0
+check "resumed download"
@@ -0,0 +1,48 @@
+#!/bin/sh
+
+# Benchmark for exar, packs a synthetic archive of about 50 MB, deletes a
+# directory from it and unpacks it.
+#
+# Usage: exar_bench.sh [path to exar binary]
+
+EXAR="${1:-$(dirname "$0")/../exar/exar}"
+SIZE_MB=50
+
+if [ ! -x "${EXAR}" ]; then 
+  echo "exar binary ${EXAR} not found, run 'make -C exar exar' first"
+  exit 1
+fi
+EXAR="$(cd "$(dirname "${EXAR}")" && pwd)/$(basename "${EXAR}")"
+
+BENCHDIR="$(mktemp -d "${TMPDIR:-/tmp}/exar_bench.XXXXXX")"
+trap 'rm -rf "${BENCHDIR}"' EXIT
+
+now() {
+  date +%s.%N
+}
+run() {
+  label="$1"
+  shift
+  start=$(now)
+  "$@" || { echo "${label} failed"; exit 1; }
+  end=$(now)
+  awk "BEGIN { printf \"%-10s %8.3f s\\n\", \"${label}\", ${end} - ${start} }"
+}
+
+cd "${BENCHDIR}"
+mkdir -p data/large data/small unpacked
+
+# Half of the data in 1 MB files, half in 2000 small files
+i=0
+while [ $i -lt $((SIZE_MB / 2)) ]; do 
+  head -c 1048576 /dev/urandom > data/large/file$i.bin
+  i=$((i + 1))
+done
+head -c $((SIZE_MB / 2 * 1048576)) /dev/urandom > small.bin
+split -a 4 -n 2000 small.bin data/small/file
+rm small.bin
+
+run pack   "${EXAR}" p data data.exar
+ls -l data.exar | awk '{ printf "archive    %8.1f MB\n", $5 / 1048576 }'
+run delete "${EXAR}" d data.exar data/small
+run unpack "${EXAR}" u data.exar unpacked
@@ -0,0 +1,77 @@
+#!/bin/sh
+
+# Benchmark for the per-document initialization of base.js, opens a page with
+# many links in 100 tabs and measures the time from loadCommitted to
+# documentLoaded of the main frame. Uses a temporary configuration, needs a
+# running X server or xvfb-run.
+#
+# Usage: hints_bench.sh [path to dwb binary]
+
+DWB="${1:-$(dirname "$0")/../dwb}"
+TABS=100
+LINKS=2000
+
+if [ ! -x "${DWB}" ]; then
+  echo "dwb binary ${DWB} not found, run 'make' first"
+  exit 1
+fi
+DWB="$(cd "$(dirname "${DWB}")" && pwd)/$(basename "${DWB}")"
+
+BENCHDIR="$(mktemp -d "${TMPDIR:-/tmp}/hints_bench.XXXXXX")"
+trap 'rm -rf "${BENCHDIR}"' EXIT
+
+mkdir -p "${BENCHDIR}/config/dwb/userscripts" "${BENCHDIR}/cache" "${BENCHDIR}/data"
+
+awk -v links=${LINKS} 'BEGIN {
+  print "<html><head><title>hints bench</title></head><body>"
+  for (i=0; i<links; i++)
+    printf "<p><a href=\"#link%d\">link %d</a> <input type=\"text\"></p>\n", i, i
+  print "</body></html>"
+}' > "${BENCHDIR}/page.html"
+
+cat > "${BENCHDIR}/config/dwb/userscripts/bench.js" <<EOF
+//!javascript
+
+var tabsToOpen = ${TABS}, committed = {}, times = [];
+
+Signal.connect("loadCommitted", function(wv) {
+    if (/page\.html/.test(wv.uri))
+        committed[wv.number] = Date.now();
+});
+Signal.connect("documentLoaded", function(wv, frame) {
+    if (frame != wv.mainFrame || committed[wv.number] === undefined)
+        return;
+
+    times.push(Date.now() - committed[wv.number]);
+    delete committed[wv.number];
+    if (times.length < tabsToOpen)
+        return;
+
+    times.sort(function(a, b) { return a - b; });
+    var sum = times.reduce(function(a, b) { return a + b; }, 0);
+    io.out("tabs       " + times.length);
+    io.out("mean       " + (sum / times.length).toFixed(1) + " ms");
+    io.out("median     " + times[Math.floor(times.length / 2)] + " ms");
+    io.out("max        " + times[times.length - 1] + " ms");
+    exit();
+});
+Signal.connect("ready", function() {
+    for (var i=0; i<tabsToOpen; i++)
+        execute("tabopen file://${BENCHDIR}/page.html");
+});
+EOF
+
+RUN=""
+if [ -z "${DISPLAY}" ]; then
+  if command -v xvfb-run > /dev/null 2>&1; then
+    RUN="xvfb-run -a"
+  else
+    echo "No X server and xvfb-run not found"
+    exit 1
+  fi
+fi
+
+XDG_CONFIG_HOME="${BENCHDIR}/config" \
+XDG_CACHE_HOME="${BENCHDIR}/cache" \
+XDG_DATA_HOME="${BENCHDIR}/data" \
+  ${RUN} "${DWB}" -n -S -R 2>/dev/null
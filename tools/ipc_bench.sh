@@ -0,0 +1,61 @@
+#!/bin/sh
+
+# Benchmark for dwbremote, sends the same command N times through X properties
+# and through the ipc socket and prints the throughput of both transports.
+# Uses a temporary configuration, needs a running X server or xvfb-run.
+#
+# Usage: ipc_bench.sh [path to dwb binary] [number of commands]
+
+DWB="${1:-$(dirname "$0")/../dwb}"
+DWBREMOTE="$(dirname "$0")/../dwbremote/dwbremote"
+COMMANDS="${2:-1000}"
+
+if [ ! -x "${DWB}" ] || [ ! -x "${DWBREMOTE}" ]; then
+  echo "dwb or dwbremote binary not found, run 'make' first"
+  exit 1
+fi
+DWB="$(cd "$(dirname "${DWB}")" && pwd)/$(basename "${DWB}")"
+DWBREMOTE="$(cd "$(dirname "${DWBREMOTE}")" && pwd)/$(basename "${DWBREMOTE}")"
+
+BENCHDIR="$(mktemp -d "${TMPDIR:-/tmp}/ipc_bench.XXXXXX")"
+trap 'rm -rf "${BENCHDIR}"' EXIT
+
+mkdir -p "${BENCHDIR}/config/dwb" "${BENCHDIR}/cache" "${BENCHDIR}/data"
+
+# Started by xvfb-run or directly, waits until the dwb window accepts ipc
+# commands and runs the benchmark against it
+cat > "${BENCHDIR}/bench.sh" <<EOF2
+#!/bin/sh
+"${DWB}" -n -R 2>/dev/null &
+PID=\$!
+for i in \$(seq 50); do
+  WID="\$("${DWBREMOTE}" -l 2>/dev/null | head -n 1)"
+  [ -n "\${WID}" ] && break
+  sleep 0.2
+done
+if [ -z "\${WID}" ]; then
+  echo "dwb window not found, is enable-ipc set?"
+  kill "\${PID}"
+  exit 1
+fi
+"${DWBREMOTE}" -i "\${WID}" -b ${COMMANDS} get ntabs
+"${DWBREMOTE}" -i "\${WID}" -S -b ${COMMANDS} get ntabs
+"${DWBREMOTE}" -i "\${WID}" :quit
+wait
+EOF2
+chmod +x "${BENCHDIR}/bench.sh"
+
+RUN=""
+if [ -z "${DISPLAY}" ]; then
+  if command -v xvfb-run > /dev/null 2>&1; then
+    RUN="xvfb-run -a"
+  else
+    echo "No X server and xvfb-run not found"
+    exit 1
+  fi
+fi
+
+XDG_CONFIG_HOME="${BENCHDIR}/config" \
+XDG_CACHE_HOME="${BENCHDIR}/cache" \
+XDG_DATA_HOME="${BENCHDIR}/data" \
+  ${RUN} "${BENCHDIR}/bench.sh"
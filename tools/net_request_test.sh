@@ -0,0 +1,123 @@
+#!/bin/sh
+
+# Exercises net.sendRequestAsync and net.streamRequest against a local http
+# server, streams a large file, streams a multibyte body whose characters
+# cross chunk boundaries, cancels a streamed request and sends 20 concurrent
+# requests to the same host. Uses a temporary configuration, needs
+# python3 and a running X server or xvfb-run.
+#
+# Usage: net_request_test.sh [path to dwb binary]
+
+DWB="${1:-$(dirname "$0")/../dwb}"
+PORT=${PORT:-8765}
+SIZE_MB=32
+CONCURRENT=20
+
+if [ ! -x "${DWB}" ]; then
+  echo "dwb binary ${DWB} not found, run 'make' first"
+  exit 1
+fi
+DWB="$(cd "$(dirname "${DWB}")" && pwd)/$(basename "${DWB}")"
+
+TESTDIR="$(mktemp -d "${TMPDIR:-/tmp}/net_request_test.XXXXXX")"
+SERVER_PID=""
+trap '[ -n "${SERVER_PID}" ] && kill ${SERVER_PID}; rm -rf "${TESTDIR}"' EXIT
+
+mkdir -p "${TESTDIR}/config/dwb/userscripts" "${TESTDIR}/cache" "${TESTDIR}/data" "${TESTDIR}/www"
+
+awk -v size=${SIZE_MB} 'BEGIN {
+  line = sprintf("%063d", 0)
+  for (i=0; i<size*16384; i++)
+    print line
+}' > "${TESTDIR}/www/large.txt"
+echo "small" > "${TESTDIR}/www/small.txt"
+# 2, 3 and 4 byte characters, the chunk boundaries fall into some of them
+python3 -c 'import sys; sys.stdout.buffer.write(("\u00e4\u20ac\U0001f600x" * 100000).encode("utf-8"))' \
+  > "${TESTDIR}/www/multibyte.txt"
+
+(cd "${TESTDIR}/www" && exec python3 -m http.server ${PORT} --bind 127.0.0.1 > /dev/null 2>&1) &
+SERVER_PID=$!
+sleep 1
+
+cat > "${TESTDIR}/config/dwb/userscripts/test.js" <<EOF
+//!javascript
+
+var base = "http://127.0.0.1:${PORT}/", failed = 0, pending = 5;
+
+function check(name, ok) {
+    io.out((ok ? "pass  " : "FAIL  ") + name);
+    if (!ok)
+        failed++;
+}
+function done() {
+    if (--pending == 0)
+        exit();
+}
+
+Signal.connect("ready", function() {
+    var start = Date.now(), bytes = 0, chunks = 0;
+
+    net.sendRequestAsync(base + "small.txt").then(function(response) {
+        check("sendRequestAsync body", response.status == 200 && response.body == "small\n");
+        done();
+    });
+    net.sendRequestAsync("http://127.0.0.1:1/").then(function() {
+        check("sendRequestAsync rejects on connection errors", false);
+        done();
+    }, function(response) {
+        check("sendRequestAsync rejects on connection errors", true);
+        done();
+    });
+    net.streamRequest(base + "large.txt", function(chunk) {
+        bytes += chunk.length;
+        chunks++;
+    }).then(function(response) {
+        check("streamRequest " + bytes + " bytes in " + chunks + " chunks, " + 
+                (Date.now() - start) + " ms", bytes == ${SIZE_MB} * 1024 * 1024 && response.body === undefined);
+        var cancelled = 0;
+        return net.streamRequest(base + "large.txt", function(chunk) {
+            return ++cancelled == 3;
+        }).then(function() {
+            check("streamRequest cancels", cancelled == 3);
+        });
+    }).then(done);
+
+    var text = "", mbChunks = 0, expected = new Array(100001).join("\\u00e4\\u20ac\\ud83d\\ude00x");
+    net.streamRequest(base + "multibyte.txt", function(chunk) {
+        text += chunk;
+        mbChunks++;
+    }).then(function() {
+        check("streamRequest multibyte body in " + mbChunks + " chunks", mbChunks > 1 && text == expected);
+        done();
+    });
+
+    var finished = 0, requestStart = Date.now();
+    for (var i=0; i<${CONCURRENT}; i++) {
+        net.sendRequestAsync(base + "small.txt?" + i).then(function(response) {
+            if (response.status == 200 && ++finished == ${CONCURRENT}) {
+                check("${CONCURRENT} concurrent requests, " + (Date.now() - requestStart) + " ms", true);
+                done();
+            }
+        });
+    }
+    timerStart(30000, function() {
+        check("timeout", false);
+        exit();
+    });
+});
+EOF
+
+RUN=""
+if [ -z "${DISPLAY}" ]; then
+  if command -v xvfb-run > /dev/null 2>&1; then
+    RUN="xvfb-run -a"
+  else
+    echo "No X server and xvfb-run not found"
+    exit 1
+  fi
+fi
+
+XDG_CONFIG_HOME="${TESTDIR}/config" \
+XDG_CACHE_HOME="${TESTDIR}/cache" \
+XDG_DATA_HOME="${TESTDIR}/data" \
+  ${RUN} "${DWB}" -n -S -R 2>/dev/null
@@ -0,0 +1,105 @@
+#!/bin/sh
+
+# Benchmark for filtered resource signals, opens a page with many subresources
+# in 20 tabs and measures the time from loadCommitted to loadFinished of each
+# tab. The page is loaded once without a resource handler, once with an
+# unfiltered handler and once with a handler that only matches a single host.
+# Uses a temporary configuration, needs a running X server or xvfb-run.
+#
+# Usage: signal_filter_bench.sh [path to dwb binary]
+
+DWB="${1:-$(dirname "$0")/../dwb}"
+TABS=20
+RESOURCES=500
+
+if [ ! -x "${DWB}" ]; then
+  echo "dwb binary ${DWB} not found, run 'make' first"
+  exit 1
+fi
+DWB="$(cd "$(dirname "${DWB}")" && pwd)/$(basename "${DWB}")"
+
+BENCHDIR="$(mktemp -d "${TMPDIR:-/tmp}/signal_filter_bench.XXXXXX")"
+trap 'rm -rf "${BENCHDIR}"' EXIT
+
+mkdir -p "${BENCHDIR}/res"
+
+# 1x1 transparent gif
+printf 'GIF89a\001\000\001\000\200\000\000\000\000\000\377\377\377!\371\004\001\000\000\000\000,\000\000\000\000\001\000\001\000\000\002\002D\001\000;' > "${BENCHDIR}/res/pixel.gif"
+i=0
+while [ ${i} -lt ${RESOURCES} ]; do
+  ln -s pixel.gif "${BENCHDIR}/res/${i}.gif"
+  i=$((i+1))
+done
+
+awk -v resources=${RESOURCES} 'BEGIN {
+  print "<html><head><title>signal filter bench</title></head><body>"
+  for (i=0; i<resources; i++)
+    printf "<img src=\"res/%d.gif\">\n", i
+  print "</body></html>"
+}' > "${BENCHDIR}/page.html"
+
+RUN=""
+if [ -z "${DISPLAY}" ]; then
+  if command -v xvfb-run > /dev/null 2>&1; then
+    RUN="xvfb-run -a"
+  else
+    echo "No X server and xvfb-run not found"
+    exit 1
+  fi
+fi
+
+run_bench() {
+  CONFIG="${BENCHDIR}/config-$1"
+  mkdir -p "${CONFIG}/dwb/userscripts" "${BENCHDIR}/cache-$1" "${BENCHDIR}/data-$1"
+
+  cat > "${CONFIG}/dwb/userscripts/bench.js" <<EOF
+//!javascript
+
+var tabsToOpen = ${TABS}, committed = {}, times = [], resources = 0;
+
+switch ("$1") {
+  case "unfiltered" : 
+    Signal.connect("resource", function() { resources++; });
+    break;
+  case "filtered" :
+    Signal.connect("resource", function() { resources++; }, { host : "ads.example.com" });
+    break;
+}
+
+Signal.connect("loadCommitted", function(wv) {
+    if (/page\.html/.test(wv.uri))
+        committed[wv.number] = Date.now();
+});
+Signal.connect("loadFinished", function(wv) {
+    if (committed[wv.number] === undefined)
+        return;
+
+    times.push(Date.now() - committed[wv.number]);
+    delete committed[wv.number];
+    if (times.length < tabsToOpen)
+        return;
+
+    times.sort(function(a, b) { return a - b; });
+    var sum = times.reduce(function(a, b) { return a + b; }, 0);
+    io.out("$1");
+    io.out("  handler calls " + resources);
+    io.out("  mean          " + (sum / times.length).toFixed(1) + " ms");
+    io.out("  median        " + times[Math.floor(times.length / 2)] + " ms");
+    io.out("  max           " + times[times.length - 1] + " ms");
+    exit();
+});
+Signal.connect("ready", function() {
+    for (var i=0; i<tabsToOpen; i++)
+        execute("tabopen file://${BENCHDIR}/page.html");
+});
+EOF
+
+  XDG_CONFIG_HOME="${CONFIG}" \
+  XDG_CACHE_HOME="${BENCHDIR}/cache-$1" \
+  XDG_DATA_HOME="${BENCHDIR}/data-$1" \
+    ${RUN} "${DWB}" -n -S -R 2>/dev/null
+}
+
+run_bench none
+run_bench unfiltered
+run_bench filtered